@@ -40,7 +40,7 @@ static std::ostream& operator<<(std::ostream& stream, windows10colors::SysPartsM
 
 int main()
 {
-    CoInitializeEx (nullptr, COINIT_APARTMENTTHREADED);
+    HRESULT hrCom = CoInitializeEx (nullptr, COINIT_APARTMENTTHREADED);
 
     std::cout << std::boolalpha;
 
@@ -57,6 +57,18 @@ int main()
     hr = windows10colors::GetSysPartsMode(sys_parts);
     std::cout << "Sys parts:     " << sys_parts << " " << output_HRESULT(hr) << std::endl;
 
+    unsigned long individual_calls = windows10colors::GetSystemCallCount();
+    windows10colors::ThemeSnapshot snapshot;
+    windows10colors::CaptureThemeSnapshot(snapshot);
+    std::cout << "System calls:  " << individual_calls << " individual queries, "
+              << snapshot.systemCalls << " snapshot" << std::endl;
+
+    if (SUCCEEDED (hrCom))
+    {
+        windows10colors::ReleaseApartmentResources ();
+        CoUninitialize ();
+    }
+
     return 0;
 }
 
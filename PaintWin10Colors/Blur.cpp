@@ -0,0 +1,434 @@
+// Blur.cpp : Portable separable blur for shadows and other effects.
+//
+
+#include "Blur.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define BLUR_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define BLUR_SSE2
+#endif
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define BLUR_NEON
+#include <arm_neon.h>
+#endif
+
+// Code using AVX2 intrinsics needs to be marked for GCC and Clang; MSVC allows them anywhere
+#if defined(BLUR_X86) && (defined(__GNUC__) || defined(__clang__))
+#define BLUR_TARGET_AVX2 __attribute__ ((target ("avx2")))
+#else
+#define BLUR_TARGET_AVX2
+#endif
+
+namespace
+{
+    /* Running sums are 16 bit wide, so a box may cover at most 257 samples.
+     * Averages are computed as (sum * scale) >> 16, with scale = ceil(65536 / size);
+     * a full box of 255 yields 255 again. */
+    const int maxBoxSize = 257;
+
+    inline uint16_t BoxScale (int size)
+    {
+        return static_cast<uint16_t> ((65536 + size - 1) / size);
+    }
+
+    // Row operations of the vertical passes
+    struct RowOps
+    {
+        /// sums[i] += row[i]
+        void (*add) (uint16_t* sums, const uint8_t* row, size_t n);
+        /// sums[i] -= row[i]
+        void (*sub) (uint16_t* sums, const uint8_t* row, size_t n);
+        /// row[i] = (sums[i] * scale) >> 16
+        void (*store) (uint8_t* row, const uint16_t* sums, uint16_t scale, size_t n);
+    };
+
+    void AddRowScalar (uint16_t* sums, const uint8_t* row, size_t n)
+    {
+        for (size_t i = 0; i < n; i++) sums[i] += row[i];
+    }
+
+    void SubRowScalar (uint16_t* sums, const uint8_t* row, size_t n)
+    {
+        for (size_t i = 0; i < n; i++) sums[i] -= row[i];
+    }
+
+    void StoreRowScalar (uint8_t* row, const uint16_t* sums, uint16_t scale, size_t n)
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            uint32_t v = (static_cast<uint32_t> (sums[i]) * scale) >> 16;
+            row[i] = static_cast<uint8_t> (std::min (v, 255u));
+        }
+    }
+
+#if defined(BLUR_SSE2)
+    void AddRowSSE2 (uint16_t* sums, const uint8_t* row, size_t n)
+    {
+        const __m128i zero = _mm_setzero_si128 ();
+        size_t i = 0;
+        for (; i + 16 <= n; i += 16)
+        {
+            __m128i v = _mm_loadu_si128 (reinterpret_cast<const __m128i*> (row + i));
+            __m128i* s = reinterpret_cast<__m128i*> (sums + i);
+            _mm_storeu_si128 (s, _mm_add_epi16 (_mm_loadu_si128 (s), _mm_unpacklo_epi8 (v, zero)));
+            _mm_storeu_si128 (s + 1, _mm_add_epi16 (_mm_loadu_si128 (s + 1), _mm_unpackhi_epi8 (v, zero)));
+        }
+        AddRowScalar (sums + i, row + i, n - i);
+    }
+
+    void SubRowSSE2 (uint16_t* sums, const uint8_t* row, size_t n)
+    {
+        const __m128i zero = _mm_setzero_si128 ();
+        size_t i = 0;
+        for (; i + 16 <= n; i += 16)
+        {
+            __m128i v = _mm_loadu_si128 (reinterpret_cast<const __m128i*> (row + i));
+            __m128i* s = reinterpret_cast<__m128i*> (sums + i);
+            _mm_storeu_si128 (s, _mm_sub_epi16 (_mm_loadu_si128 (s), _mm_unpacklo_epi8 (v, zero)));
+            _mm_storeu_si128 (s + 1, _mm_sub_epi16 (_mm_loadu_si128 (s + 1), _mm_unpackhi_epi8 (v, zero)));
+        }
+        SubRowScalar (sums + i, row + i, n - i);
+    }
+
+    void StoreRowSSE2 (uint8_t* row, const uint16_t* sums, uint16_t scale, size_t n)
+    {
+        const __m128i vscale = _mm_set1_epi16 (static_cast<short> (scale));
+        size_t i = 0;
+        for (; i + 16 <= n; i += 16)
+        {
+            const __m128i* s = reinterpret_cast<const __m128i*> (sums + i);
+            __m128i lo = _mm_mulhi_epu16 (_mm_loadu_si128 (s), vscale);
+            __m128i hi = _mm_mulhi_epu16 (_mm_loadu_si128 (s + 1), vscale);
+            _mm_storeu_si128 (reinterpret_cast<__m128i*> (row + i), _mm_packus_epi16 (lo, hi));
+        }
+        StoreRowScalar (row + i, sums + i, scale, n - i);
+    }
+#endif
+
+#if defined(BLUR_X86)
+    BLUR_TARGET_AVX2 void AddRowAVX2 (uint16_t* sums, const uint8_t* row, size_t n)
+    {
+        size_t i = 0;
+        for (; i + 16 <= n; i += 16)
+        {
+            __m256i v = _mm256_cvtepu8_epi16 (_mm_loadu_si128 (reinterpret_cast<const __m128i*> (row + i)));
+            __m256i* s = reinterpret_cast<__m256i*> (sums + i);
+            _mm256_storeu_si256 (s, _mm256_add_epi16 (_mm256_loadu_si256 (s), v));
+        }
+        AddRowScalar (sums + i, row + i, n - i);
+    }
+
+    BLUR_TARGET_AVX2 void SubRowAVX2 (uint16_t* sums, const uint8_t* row, size_t n)
+    {
+        size_t i = 0;
+        for (; i + 16 <= n; i += 16)
+        {
+            __m256i v = _mm256_cvtepu8_epi16 (_mm_loadu_si128 (reinterpret_cast<const __m128i*> (row + i)));
+            __m256i* s = reinterpret_cast<__m256i*> (sums + i);
+            _mm256_storeu_si256 (s, _mm256_sub_epi16 (_mm256_loadu_si256 (s), v));
+        }
+        SubRowScalar (sums + i, row + i, n - i);
+    }
+
+    BLUR_TARGET_AVX2 void StoreRowAVX2 (uint8_t* row, const uint16_t* sums, uint16_t scale, size_t n)
+    {
+        const __m256i vscale = _mm256_set1_epi16 (static_cast<short> (scale));
+        size_t i = 0;
+        for (; i + 32 <= n; i += 32)
+        {
+            const __m256i* s = reinterpret_cast<const __m256i*> (sums + i);
+            __m256i lo = _mm256_mulhi_epu16 (_mm256_loadu_si256 (s), vscale);
+            __m256i hi = _mm256_mulhi_epu16 (_mm256_loadu_si256 (s + 1), vscale);
+            // Packing works on 128-bit lanes, so restore the element order afterwards
+            __m256i packed = _mm256_permute4x64_epi64 (_mm256_packus_epi16 (lo, hi), 0xd8);
+            _mm256_storeu_si256 (reinterpret_cast<__m256i*> (row + i), packed);
+        }
+        StoreRowScalar (row + i, sums + i, scale, n - i);
+    }
+
+    bool HaveAVX2 ()
+    {
+#if defined(_MSC_VER) && !defined(__clang__)
+        int info[4];
+        __cpuid (info, 0);
+        if (info[0] < 7) return false;
+        __cpuid (info, 1);
+        // OS must save YMM registers
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        bool avx = (info[2] & (1 << 28)) != 0;
+        if (!osxsave || !avx || ((_xgetbv (0) & 6) != 6)) return false;
+        __cpuidex (info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+#else
+        return __builtin_cpu_supports ("avx2");
+#endif
+    }
+#endif
+
+#if defined(BLUR_NEON)
+    void AddRowNEON (uint16_t* sums, const uint8_t* row, size_t n)
+    {
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8)
+        {
+            vst1q_u16 (sums + i, vaddw_u8 (vld1q_u16 (sums + i), vld1_u8 (row + i)));
+        }
+        AddRowScalar (sums + i, row + i, n - i);
+    }
+
+    void SubRowNEON (uint16_t* sums, const uint8_t* row, size_t n)
+    {
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8)
+        {
+            vst1q_u16 (sums + i, vsubw_u8 (vld1q_u16 (sums + i), vld1_u8 (row + i)));
+        }
+        SubRowScalar (sums + i, row + i, n - i);
+    }
+
+    void StoreRowNEON (uint8_t* row, const uint16_t* sums, uint16_t scale, size_t n)
+    {
+        const uint16x4_t vscale = vdup_n_u16 (scale);
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8)
+        {
+            uint16x8_t s = vld1q_u16 (sums + i);
+            uint16x4_t lo = vshrn_n_u32 (vmull_u16 (vget_low_u16 (s), vscale), 16);
+            uint16x4_t hi = vshrn_n_u32 (vmull_u16 (vget_high_u16 (s), vscale), 16);
+            vst1_u8 (row + i, vqmovn_u16 (vcombine_u16 (lo, hi)));
+        }
+        StoreRowScalar (row + i, sums + i, scale, n - i);
+    }
+#endif
+
+    BlurISA DetectISA ()
+    {
+#if defined(BLUR_X86)
+        if (HaveAVX2 ()) return BlurISA::AVX2;
+#endif
+#if defined(BLUR_SSE2)
+        return BlurISA::SSE2;
+#elif defined(BLUR_NEON)
+        return BlurISA::NEON;
+#else
+        return BlurISA::Scalar;
+#endif
+    }
+
+    RowOps GetRowOps (BlurISA isa)
+    {
+        switch (isa)
+        {
+#if defined(BLUR_X86)
+        case BlurISA::AVX2:     return RowOps { &AddRowAVX2, &SubRowAVX2, &StoreRowAVX2 };
+#endif
+#if defined(BLUR_SSE2)
+        case BlurISA::SSE2:     return RowOps { &AddRowSSE2, &SubRowSSE2, &StoreRowSSE2 };
+#endif
+#if defined(BLUR_NEON)
+        case BlurISA::NEON:     return RowOps { &AddRowNEON, &SubRowNEON, &StoreRowNEON };
+#endif
+        default:                break;
+        }
+        return RowOps { &AddRowScalar, &SubRowScalar, &StoreRowScalar };
+    }
+
+    /* Radii of three boxes approximating a Gaussian with the given standard deviation.
+     * See "Fast Almost-Gaussian Filtering" by Peter Kovesi. */
+    void BoxRadii (float sigma, int radii[3])
+    {
+        const int n = 3;
+        float idealSize = std::sqrt (12 * sigma * sigma / n + 1);
+        int lower = static_cast<int> (idealSize);
+        if (lower % 2 == 0) lower--;
+        lower = std::max (lower, 1);
+        int upper = lower + 2;
+        float idealLower = (12 * sigma * sigma - n * lower * lower - 4 * n * lower - 3 * n) / (-4 * lower - 4);
+        int numLower = static_cast<int> (std::floor (idealLower + 0.5f));
+        for (int i = 0; i < n; i++)
+        {
+            int size = std::min (i < numLower ? lower : upper, maxBoxSize);
+            radii[i] = (size - 1) / 2;
+        }
+    }
+
+    // Box blur a row in place. 'temp' receives a copy of the row.
+    void BoxBlurRow (uint8_t* row, int width, int channels, int radius, uint8_t* temp)
+    {
+        size_t rowBytes = static_cast<size_t> (width) * channels;
+        std::copy (row, row + rowBytes, temp);
+        uint16_t scale = BoxScale (2 * radius + 1);
+        for (int c = 0; c < channels; c++)
+        {
+            const uint8_t* src = temp + c;
+            uint8_t* dest = row + c;
+            uint32_t sum = 0;
+            for (int x = 0; x < std::min (radius, width); x++) sum += src[x * channels];
+            for (int x = 0; x < width; x++)
+            {
+                if (x + radius < width) sum += src[(x + radius) * channels];
+                if (x - radius - 1 >= 0) sum -= src[(x - radius - 1) * channels];
+                dest[x * channels] = static_cast<uint8_t> (std::min ((sum * scale) >> 16, 255u));
+            }
+        }
+    }
+
+    /* Box blur a strip of columns in place.
+     * 'ring' holds radius+1 rows of original data, as rows above the current one
+     * have already been overwritten when they're needed again. */
+    void BoxBlurColumns (uint8_t* pixels, int height, ptrdiff_t stride, size_t n, int radius, const RowOps& ops,
+                         uint16_t* sums, uint8_t* ring)
+    {
+        std::fill (sums, sums + n, uint16_t (0));
+        for (int y = 0; y < std::min (radius, height); y++) ops.add (sums, pixels + y * stride, n);
+
+        uint16_t scale = BoxScale (2 * radius + 1);
+        int ringRows = radius + 1;
+        for (int y = 0; y < height; y++)
+        {
+            uint8_t* row = pixels + y * stride;
+            if (y + radius < height) ops.add (sums, pixels + (y + radius) * stride, n);
+            uint8_t* saved = ring + (y % ringRows) * n;
+            // Slot holds row y - radius - 1, which leaves the window now
+            if (y - radius - 1 >= 0) ops.sub (sums, saved, n);
+            std::copy (row, row + n, saved);
+            ops.store (row, sums, scale, n);
+        }
+    }
+
+    // Run 'body' on ranges of [0, count), spread over up to 'threads' threads
+    template<typename Body>
+    void ParallelFor (int count, unsigned int threads, const Body& body)
+    {
+        if (count <= 0) return;
+        threads = std::max (1u, std::min (threads, static_cast<unsigned int> (count)));
+        int chunk = (count + threads - 1) / threads;
+        // Rounding up the chunk size may need fewer threads; don't hand out empty ranges
+        threads = static_cast<unsigned int> ((count + chunk - 1) / chunk);
+        std::vector<std::thread> workers;
+        workers.reserve (threads - 1);
+        for (unsigned int t = 1; t < threads; t++)
+        {
+            int begin = static_cast<int> (t) * chunk;
+            int end = std::min (count, begin + chunk);
+            workers.emplace_back ([&body, begin, end]() { body (begin, end); });
+        }
+        // Calling thread takes the first range
+        body (0, std::min (count, chunk));
+        for (auto& worker : workers) worker.join ();
+    }
+
+    // Images smaller than this (in bytes) aren't worth distributing over threads
+    const size_t minParallelBytes = 256 * 256;
+} // anonymous namespace
+
+BlurISA GetBlurISA ()
+{
+    static const BlurISA isa = DetectISA ();
+    return isa;
+}
+
+void BoxBlur (uint8_t* pixels, int width, int height, ptrdiff_t stride, BlurFormat format, int radius,
+              unsigned int threads)
+{
+    if ((radius <= 0) || (width <= 0) || (height <= 0)) return;
+
+    int radii[3];
+    BoxRadii (radius / 3.0f, radii);
+
+    int channels = (format == BlurFormat::Alpha8) ? 1 : 4;
+    size_t rowBytes = static_cast<size_t> (width) * channels;
+    if (threads == 0) threads = std::max (std::thread::hardware_concurrency (), 1u);
+    if (rowBytes * height < minParallelBytes) threads = 1;
+
+    // Horizontal passes: all three boxes while a row is in the cache
+    ParallelFor (height, threads, [&](int begin, int end)
+    {
+        std::vector<uint8_t> temp (rowBytes);
+        for (int y = begin; y < end; y++)
+        {
+            for (int r : radii)
+            {
+                if (r > 0) BoxBlurRow (pixels + y * stride, width, channels, r, temp.data ());
+            }
+        }
+    });
+
+    /* Vertical passes, on strips of columns. Channels are independent, so
+     * columns are handled as bytes, regardless of the format. */
+    const RowOps ops = GetRowOps (GetBlurISA ());
+    const size_t stripAlign = 64;
+    int numStrips = static_cast<int> ((rowBytes + stripAlign - 1) / stripAlign);
+    ParallelFor (numStrips, threads, [&](int begin, int end)
+    {
+        size_t first = begin * stripAlign;
+        size_t n = std::min (rowBytes, end * stripAlign) - first;
+        std::vector<uint16_t> sums (n);
+        std::vector<uint8_t> ring;
+        for (int r : radii)
+        {
+            if (r <= 0) continue;
+            ring.resize ((r + 1) * n);
+            BoxBlurColumns (pixels + first, height, stride, n, r, ops, sums.data (), ring.data ());
+        }
+    });
+}
+
+void GaussianBlurReference (uint8_t* pixels, int width, int height, ptrdiff_t stride, BlurFormat format,
+                            int radius)
+{
+    if ((radius <= 0) || (width <= 0) || (height <= 0)) return;
+
+    // Kernel edges are at three standard deviations
+    std::vector<float> kernel (2 * radius + 1);
+    float sigma = radius / 3.0f;
+    float kernelSum = 0;
+    for (int i = -radius; i <= radius; i++)
+    {
+        kernelSum += kernel[i + radius] = std::exp (-(i * i) / (2 * sigma * sigma));
+    }
+    for (auto& w : kernel) w /= kernelSum;
+
+    int channels = (format == BlurFormat::Alpha8) ? 1 : 4;
+    std::vector<float> temp (static_cast<size_t> (width) * height * channels);
+    auto TempAt = [&](int x, int y, int c) -> float& { return temp[(static_cast<size_t> (y) * width + x) * channels + c]; };
+
+    for (int y = 0; y < height; y++)
+    {
+        const uint8_t* row = pixels + y * stride;
+        for (int x = 0; x < width; x++)
+        {
+            for (int c = 0; c < channels; c++)
+            {
+                float sum = 0;
+                for (int i = std::max (x - radius, 0); i <= std::min (x + radius, width - 1); i++)
+                    sum += row[i * channels + c] * kernel[i - x + radius];
+                TempAt (x, y, c) = sum;
+            }
+        }
+    }
+    for (int y = 0; y < height; y++)
+    {
+        uint8_t* row = pixels + y * stride;
+        for (int x = 0; x < width; x++)
+        {
+            for (int c = 0; c < channels; c++)
+            {
+                float sum = 0;
+                for (int i = std::max (y - radius, 0); i <= std::min (y + radius, height - 1); i++)
+                    sum += TempAt (x, i, c) * kernel[i - y + radius];
+                row[x * channels + c] = static_cast<uint8_t> (std::min (sum + 0.5f, 255.0f));
+            }
+        }
+    }
+}
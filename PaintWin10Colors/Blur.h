@@ -0,0 +1,53 @@
+// Blur.h : Portable separable blur for shadows and other effects.
+//
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// Pixel formats supported by the blur functions
+enum struct BlurFormat
+{
+    /// 8-bit alpha only
+    Alpha8,
+    /// 32-bit premultiplied RGBA (any channel order, as all channels are blurred alike)
+    PremultipliedRGBA
+};
+
+/// Instruction set used for the vertical passes
+enum struct BlurISA
+{
+    Scalar,
+    SSE2,
+    AVX2,
+    NEON
+};
+
+/// Returns the instruction set the blur functions use on this machine
+BlurISA GetBlurISA ();
+
+/**
+ * Blur an image in place, approximating a Gaussian blur with three box blur passes.
+ * Each box pass uses running sums, so the cost doesn't depend on the radius.
+ * Pixels outside the image are treated as transparent, so the image should
+ * have a border of \a radius pixels for the blur to fade out completely.
+ * \param pixels Image data.
+ * \param width Width in pixels.
+ * \param height Height in pixels.
+ * \param stride Distance between rows, in bytes.
+ * \param format Pixel format.
+ * \param radius Blur radius. The Gaussian's standard deviation is a third of it.
+ * \param threads Maximum number of threads to use. 0 picks the number of
+ *   hardware threads. Small images are always blurred on the calling thread.
+ */
+void BoxBlur (uint8_t* pixels, int width, int height, ptrdiff_t stride, BlurFormat format, int radius,
+              unsigned int threads = 0);
+
+/**
+ * Reference implementation: direct convolution with a Gaussian kernel.
+ * Cost grows linearly with the radius; meant for verifying and measuring BoxBlur().
+ * Parameters are the same as for BoxBlur().
+ */
+void GaussianBlurReference (uint8_t* pixels, int width, int height, ptrdiff_t stride, BlurFormat format,
+                            int radius);
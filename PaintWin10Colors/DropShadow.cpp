@@ -0,0 +1,56 @@
+// DropShadow.cpp : Generation and caching of drop shadow images.
+//
+
+#include "DropShadow.h"
+
+#include "Blur.h"
+
+#include <algorithm>
+
+void GenerateShadow (const ShadowKey& key, ShadowImage& image)
+{
+    int radius = std::max (key.radius, 0);
+    int width = std::max (key.width, 0);
+    int height = std::max (key.height, 0);
+    image.width = width + 2 * radius;
+    image.height = height + 2 * radius;
+    size_t numPixels = static_cast<size_t> (image.width) * image.height;
+
+    /* Solid rectangle of the shadow's alpha, clipped to the image: a negative inset
+     * grows it beyond the image, an inset of half the size or more leaves it empty */
+    uint8_t alpha = static_cast<uint8_t> ((key.color >> 24) & 0xff);
+    std::vector<uint8_t> mask (numPixels, 0);
+    int left = std::min (std::max (radius + key.inset, 0), image.width);
+    int top = std::min (std::max (radius + key.inset, 0), image.height);
+    int right = std::min (std::max (radius + width - key.inset, left), image.width);
+    int bottom = std::min (std::max (radius + height - key.inset, top), image.height);
+    if (left == right) bottom = top;
+    for (int y = top; y < bottom; y++)
+    {
+        std::fill (mask.begin () + y * image.width + left, mask.begin () + y * image.width + right, alpha);
+    }
+
+    BoxBlur (mask.data (), image.width, image.height, image.width, BlurFormat::Alpha8, radius);
+
+    uint32_t rgb = key.color & 0xffffff;
+    image.pixels.resize (numPixels);
+    for (size_t i = 0; i < numPixels; i++)
+    {
+        image.pixels[i] = (static_cast<uint32_t> (mask[i]) << 24) | rgb;
+    }
+}
+
+const ShadowImage& ShadowCache::Get (const ShadowKey& key)
+{
+    auto it = images.find (key);
+    if (it != images.end ())
+    {
+        hits++;
+        return it->second;
+    }
+
+    misses++;
+    ShadowImage& image = images[key];
+    GenerateShadow (key, image);
+    return image;
+}
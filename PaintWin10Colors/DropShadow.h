@@ -0,0 +1,90 @@
+// DropShadow.h : Generation and caching of drop shadow images.
+// Independent of GDI+, so it can be built and measured on other platforms.
+//
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <initializer_list>
+#include <unordered_map>
+#include <vector>
+
+/// Parameters of a drop shadow
+struct ShadowKey
+{
+    /// Size of the shadow casting rectangle
+    int width;
+    int height;
+    /// Inset of the solid part of the shadow from the rectangle edges
+    int inset;
+    /// Blur radius. The image extends the rectangle by this amount on each side.
+    int radius;
+    /// Shadow color, as ARGB
+    uint32_t color;
+
+    bool operator== (const ShadowKey& other) const
+    {
+        return (width == other.width) && (height == other.height) && (inset == other.inset)
+            && (radius == other.radius) && (color == other.color);
+    }
+};
+
+struct ShadowKeyHash
+{
+    size_t operator() (const ShadowKey& key) const
+    {
+        size_t h = static_cast<size_t> (key.color);
+        for (int v : { key.width, key.height, key.inset, key.radius })
+        {
+            h = h * 31 + static_cast<size_t> (v);
+        }
+        return h;
+    }
+};
+
+/**
+ * Drop shadow image. Pixels are non-premultiplied ARGB, top-down, matching
+ * GDI+'s PixelFormat32bppARGB, so a Gdiplus::Bitmap can wrap them directly.
+ */
+struct ShadowImage
+{
+    int width;
+    int height;
+    std::vector<uint32_t> pixels;
+};
+
+/**
+ * Generate a drop shadow: a rectangle of the shadow color, inset from the
+ * image's inner rectangle, blurred with a Gaussian kernel.
+ * Only alpha varies over the image, so only the alpha mask is blurred.
+ */
+void GenerateShadow (const ShadowKey& key, ShadowImage& image);
+
+/**
+ * Cache of drop shadow images.
+ * Images are generated on first use and kept until Clear() is called,
+ * e.g. on theme or DPI changes.
+ */
+class ShadowCache
+{
+public:
+    ShadowCache () : hits (0), misses (0) {}
+
+    /// Get shadow image, generating it if needed. Stays valid until Clear().
+    const ShadowImage& Get (const ShadowKey& key);
+    /// Drop all images
+    void Clear () { images.clear (); }
+
+    /// Number of images in the cache
+    size_t GetSize () const { return images.size (); }
+    /// Number of Get() calls served from the cache
+    unsigned long GetHits () const { return hits; }
+    /// Number of Get() calls that generated an image
+    unsigned long GetMisses () const { return misses; }
+private:
+    std::unordered_map<ShadowKey, ShadowImage, ShadowKeyHash> images;
+    unsigned long hits;
+    unsigned long misses;
+};
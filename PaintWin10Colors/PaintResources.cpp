@@ -0,0 +1,136 @@
+// PaintResources.cpp : Cache of GDI+ objects used for painting.
+//
+
+#include "stdafx.h"
+#include "PaintResources.h"
+
+static Gdiplus::Color RGBAtoGdiplus (DWORD c)
+{
+    return Gdiplus::Color ((c >> 24) & 0xff, GetRValue (c), GetGValue (c), GetBValue (c));
+}
+
+PaintResources::PaintResources ()
+    : generation (0), dpi (0), creations (0), frameCreations (0), graphicsDC (nullptr), metricsValid (false)
+{
+}
+
+PaintResources::~PaintResources ()
+{
+}
+
+void PaintResources::BeginFrame (uint64_t generation, int dpi)
+{
+    if (dpi != this->dpi)
+    {
+        Clear ();
+    }
+    else if (generation != this->generation)
+    {
+        // Metrics, fonts and shadows don't depend on theme colors
+        ClearColors ();
+    }
+    this->generation = generation;
+    this->dpi = dpi;
+    frameCreations = 0;
+}
+
+void PaintResources::Clear ()
+{
+    ClearColors ();
+    metricsValid = false;
+    captionFont.reset ();
+    captionFormat.reset ();
+    shadowBitmaps.clear ();
+}
+
+void PaintResources::ClearColors ()
+{
+    brushes.clear ();
+    pens.clear ();
+}
+
+Gdiplus::Graphics& PaintResources::GetGraphics (HDC dc)
+{
+    if (!graphics || (dc != graphicsDC))
+    {
+        graphics.reset (new Gdiplus::Graphics (dc));
+        graphicsDC = dc;
+        Created ();
+    }
+    return *graphics;
+}
+
+void PaintResources::ReleaseGraphics ()
+{
+    graphics.reset ();
+    graphicsDC = nullptr;
+}
+
+Gdiplus::SolidBrush* PaintResources::GetBrush (DWORD rgba)
+{
+    auto& brush = brushes[rgba];
+    if (!brush)
+    {
+        brush.reset (new Gdiplus::SolidBrush (RGBAtoGdiplus (rgba)));
+        Created ();
+    }
+    return brush.get ();
+}
+
+Gdiplus::Pen* PaintResources::GetPen (DWORD rgba)
+{
+    auto& pen = pens[rgba];
+    if (!pen)
+    {
+        pen.reset (new Gdiplus::Pen (RGBAtoGdiplus (rgba)));
+        Created ();
+    }
+    return pen.get ();
+}
+
+const NONCLIENTMETRICS& PaintResources::GetNonClientMetrics ()
+{
+    if (!metricsValid)
+    {
+        metrics = NONCLIENTMETRICS{ sizeof (NONCLIENTMETRICS) };
+        SystemParametersInfo (SPI_GETNONCLIENTMETRICS, sizeof (NONCLIENTMETRICS), &metrics, 0);
+        metricsValid = true;
+        Created ();
+    }
+    return metrics;
+}
+
+Gdiplus::Font* PaintResources::GetCaptionFont (HDC dc)
+{
+    if (!captionFont)
+    {
+        captionFont.reset (new Gdiplus::Font (dc, &GetNonClientMetrics ().lfCaptionFont));
+        Created ();
+    }
+    return captionFont.get ();
+}
+
+Gdiplus::StringFormat* PaintResources::GetCaptionFormat ()
+{
+    if (!captionFormat)
+    {
+        captionFormat.reset (new Gdiplus::StringFormat);
+        captionFormat->SetAlignment (Gdiplus::StringAlignmentNear);
+        captionFormat->SetLineAlignment (Gdiplus::StringAlignmentCenter);
+        Created ();
+    }
+    return captionFormat.get ();
+}
+
+Gdiplus::Bitmap* PaintResources::GetShadowBitmap (const ShadowKey& key, const ShadowImage& image)
+{
+    auto& bitmap = shadowBitmaps[key];
+    if (!bitmap)
+    {
+        bitmap.reset (new Gdiplus::Bitmap (image.width, image.height, image.width * sizeof (uint32_t),
+                                           PixelFormat32bppARGB,
+                                           reinterpret_cast<BYTE*> (const_cast<uint32_t*> (image.pixels.data ()))));
+        Created ();
+    }
+    return bitmap.get ();
+}
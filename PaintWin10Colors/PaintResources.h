@@ -0,0 +1,88 @@
+// PaintResources.h : Cache of GDI+ objects used for painting.
+//
+
+#pragma once
+
+#include <objidl.h>
+#include <gdiplus.h>
+
+#include <memory>
+#include <unordered_map>
+
+#include "DropShadow.h"
+
+/**
+ * Owns the GDI+ objects used for painting, so steady-state paints don't create any.
+ * Brushes and pens are kept until the theme generation changes; everything else
+ * until the DPI changes or Clear() is called.
+ */
+class PaintResources
+{
+public:
+    PaintResources ();
+    ~PaintResources ();
+
+    /**
+     * Start painting a frame. Drops brushes and pens if the theme generation differs
+     * from the previous frame, all objects if the DPI differs, and resets the
+     * per-frame creation counter.
+     */
+    void BeginFrame (uint64_t generation, int dpi);
+    /// Drop all objects, except the Graphics object
+    void Clear ();
+
+    /**
+     * Get a Graphics object for a DC. It's kept as long as the same DC is passed in.
+     * Clipping set on the DC after creation is not picked up; set it on the Graphics object instead.
+     */
+    Gdiplus::Graphics& GetGraphics (HDC dc);
+    /// Drop the Graphics object, e.g. when its DC is deleted or gets a different bitmap selected
+    void ReleaseGraphics ();
+
+    /// Get a solid brush for an RGBA color
+    Gdiplus::SolidBrush* GetBrush (DWORD rgba);
+    /// Get a 1 pixel pen for an RGBA color
+    Gdiplus::Pen* GetPen (DWORD rgba);
+    /// Get the non-client metrics
+    const NONCLIENTMETRICS& GetNonClientMetrics ();
+    /// Get the caption font, created for the given DC
+    Gdiplus::Font* GetCaptionFont (HDC dc);
+    /// Get the format for caption texts: left aligned, vertically centered
+    Gdiplus::StringFormat* GetCaptionFormat ();
+    /**
+     * Get a bitmap wrapping a shadow image, without copying the pixels.
+     * The image must stay valid until Clear() is called.
+     */
+    Gdiplus::Bitmap* GetShadowBitmap (const ShadowKey& key, const ShadowImage& image);
+
+    /// Number of objects created in total
+    unsigned long GetCreations () const { return creations; }
+    /**
+     * Number of objects created since the last BeginFrame().
+     * Should be 0 for steady-state paints.
+     */
+    unsigned long GetFrameCreations () const { return frameCreations; }
+private:
+    uint64_t generation;
+    int dpi;
+    unsigned long creations;
+    unsigned long frameCreations;
+
+    HDC graphicsDC;
+    std::unique_ptr<Gdiplus::Graphics> graphics;
+    std::unordered_map<DWORD, std::unique_ptr<Gdiplus::SolidBrush>> brushes;
+    std::unordered_map<DWORD, std::unique_ptr<Gdiplus::Pen>> pens;
+    bool metricsValid;
+    NONCLIENTMETRICS metrics;
+    std::unique_ptr<Gdiplus::Font> captionFont;
+    std::unique_ptr<Gdiplus::StringFormat> captionFormat;
+    std::unordered_map<ShadowKey, std::unique_ptr<Gdiplus::Bitmap>, ShadowKeyHash> shadowBitmaps;
+
+    /// Drop the objects depending on theme colors
+    void ClearColors ();
+    void Created ()
+    {
+        creations++;
+        frameCreations++;
+    }
+};
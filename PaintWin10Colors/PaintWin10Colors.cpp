@@ -6,10 +6,16 @@
 
 #include <objidl.h>
 #include <gdiplus.h>
+#include <shellapi.h>
 
-#include <memory>
+#include <stdio.h>
 
 #include "Windows10Colors.h"
+#include "Windows10ColorsRefresh.h"
+
+#include "DropShadow.h"
+#include "PaintResources.h"
+#include "Preview.h"
 
 #define MAX_LOADSTRING 100
 
@@ -23,11 +29,91 @@ bool accents_valid = false;
 windows10colors::FrameColors colors;
 windows10colors::FrameColors colorsGlass;
 
+uint64_t colors_generation = 0;
+
+// Settings changes arrive in bursts; refresh once they calmed down
+windows10colors::RefreshCoalescer settingsRefresh (std::chrono::milliseconds (100), std::chrono::milliseconds (500));
+static const UINT_PTR refreshTimerID = 1;
+
+// Drop shadows of the mock windows; cleared on shadow color or DPI changes
+ShadowCache shadowCache;
+
+// GDI+ objects used for painting
+PaintResources paintResources;
+
+// Off-screen buffer all painting goes through, to avoid flicker
+HDC backBufferDC = nullptr;
+HBITMAP backBuffer = nullptr;
+HGDIOBJ backBufferOldBitmap = nullptr;
+SIZE backBufferSize = {};
+
+// Element bounds from the last paint, to invalidate only what changed
+RECT accentsBounds = {};
+RECT mockWindowBounds[4] = {};
+
+// Drop shadows and the GDI+ objects wrapping them
+static void ClearPaintCaches ()
+{
+    paintResources.Clear ();
+    shadowCache.Clear ();
+}
+
 static void UpdateWindows10Colors ()
 {
-    accents_valid = SUCCEEDED (windows10colors::GetAccentColor (accents));
-    windows10colors::GetFrameColors (colors, windows10colors::fcDefault, windows10colors::DarkMode::Auto);
-    windows10colors::GetFrameColors (colorsGlass, windows10colors::fcGlassEffect, windows10colors::DarkMode::Auto);
+    windows10colors::ThemeState state;
+    colors_generation = windows10colors::GetThemeCache ().Read (state);
+    accents = state.accent;
+    accents_valid = SUCCEEDED (state.accentResult);
+    windows10colors::FrameColorVariants variants;
+    windows10colors::GetAllFrameColorVariants (state.snapshot, variants);
+    colors = variants.Get (windows10colors::fcDefault, windows10colors::DarkMode::Auto);
+    colorsGlass = variants.Get (windows10colors::fcGlassEffect, windows10colors::DarkMode::Auto);
+}
+
+// Collect the colors the window shows, for headless rendering
+static void GetPreviewColors (PreviewColors& previewColors)
+{
+    previewColors.accents = accents;
+    previewColors.accentsValid = accents_valid;
+    previewColors.colors = colors;
+    previewColors.colorsGlass = colorsGlass;
+    // COLORREF has the same layout as RGBA, minus alpha
+    previewColors.background = windows10colors::MakeOpaque (GetSysColor (COLOR_WINDOW));
+    previewColors.window = previewColors.background;
+    previewColors.shadow = windows10colors::MakeOpaque (GetSysColor (COLOR_WINDOWTEXT));
+}
+
+// Render a preview of the current theme into a file, without showing a window
+static int WritePreview (const wchar_t* path)
+{
+    HRESULT hrCom = CoInitializeEx (nullptr, COINIT_APARTMENTTHREADED);
+    UpdateWindows10Colors ();
+    if (SUCCEEDED (hrCom))
+    {
+        windows10colors::ReleaseApartmentResources ();
+        CoUninitialize ();
+    }
+    PreviewColors previewColors;
+    GetPreviewColors (previewColors);
+
+    int width, height;
+    GetPreviewSize (previewColors, width, height);
+    std::vector<uint8_t> pixels (width * height * 4);
+    RenderPreview (previewColors, pixels.data (), width, height, width * 4, &shadowCache);
+
+    // PNG, unless a .ppm file was requested
+    std::vector<uint8_t> data;
+    size_t pathLen = wcslen (path);
+    if ((pathLen >= 4) && (_wcsicmp (path + pathLen - 4, L".ppm") == 0))
+        EncodePPM (pixels.data (), width, height, width * 4, data);
+    else
+        EncodePNG (pixels.data (), width, height, width * 4, data);
+
+    FILE* file = nullptr;
+    if (_wfopen_s (&file, path, L"wb") != 0) return 1;
+    bool written = fwrite (data.data (), 1, data.size (), file) == data.size ();
+    fclose (file);
+    return written ? 0 : 1;
 }
 
 // Forward declarations of functions included in this code module:
@@ -42,7 +128,17 @@ int APIENTRY wWinMain(_In_ HINSTANCE hInstance,
                      _In_ int       nCmdShow)
 {
     UNREFERENCED_PARAMETER(hPrevInstance);
-    UNREFERENCED_PARAMETER(lpCmdLine);
+
+    // "/preview <file>" writes a preview image and exits
+    int argc = 0;
+    LPWSTR* argv = CommandLineToArgvW (lpCmdLine, &argc);
+    if (argv && (argc >= 2) && (_wcsicmp (argv[0], L"/preview") == 0))
+    {
+        int result = WritePreview (argv[1]);
+        LocalFree (argv);
+        return result;
+    }
+    LocalFree (argv);
 
     // Initialize global strings
     LoadStringW(hInstance, IDS_APP_TITLE, szTitle, MAX_LOADSTRING);
@@ -75,6 +171,10 @@ int APIENTRY wWinMain(_In_ HINSTANCE hInstance,
 
     Gdiplus::GdiplusShutdown (gdip_token);
 
+    // COM was initialized by InitInstance()
+    windows10colors::ReleaseApartmentResources ();
+    CoUninitialize ();
+
     return (int) msg.wParam;
 }
 
@@ -137,11 +237,6 @@ BOOL InitInstance(HINSTANCE hInstance, int nCmdShow)
    return TRUE;
 }
 
-static Gdiplus::Color RGBAtoGdiplus (DWORD c)
-{
-    return Gdiplus::Color ((c >> 24) & 0xff, GetRValue (c), GetGValue (c), GetBValue (c));
-}
-
 static void DrawFramedRect (Gdiplus::Graphics& g, const Gdiplus::Rect& r, Gdiplus::Pen* pen, Gdiplus::Brush* fill)
 {
     g.DrawRectangle (pen, r);
@@ -152,7 +247,27 @@ static void DrawFramedRect (Gdiplus::Graphics& g, const Gdiplus::Rect& r, Gdiplu
     g.FillRectangle (fill, inner);
 }
 
-static RECT PaintAccentColors (HDC dc, int x, int y)
+// Shades in the order they're painted
+static void GetAccentShades (const windows10colors::AccentColor& accentColor, DWORD shades[preview_layout::swatchCount])
+{
+    shades[0] = accentColor.lightest;
+    shades[1] = accentColor.lighter;
+    shades[2] = accentColor.light;
+    shades[3] = accentColor.accent;
+    shades[4] = accentColor.dark;
+    shades[5] = accentColor.darker;
+    shades[6] = accentColor.darkest;
+}
+
+// Area covered by an accent color swatch, given the bounds of all swatches
+static RECT GetSwatchRect (const RECT& bounds, int index)
+{
+    int top = bounds.top + index * (preview_layout::swatchSize + preview_layout::swatchSpacing);
+    // Outline covers one pixel more than the swatch size
+    return RECT{ bounds.left, top, bounds.left + preview_layout::swatchSize + 1, top + preview_layout::swatchSize + 1 };
+}
+
+static RECT PaintAccentColors (Gdiplus::Graphics& g, const RECT& paintRect, int x, int y)
 {
     if (!accents_valid)
     {
@@ -161,127 +276,194 @@ static RECT PaintAccentColors (HDC dc, int x, int y)
 
     using namespace Gdiplus;
 
-    static const int blockWidth = 24;
-    static const int blockHeight = 24;
-    static const int blockSpacing = 12;
+    static const int blockWidth = preview_layout::swatchSize;
+    static const int blockHeight = preview_layout::swatchSize;
+    static const int blockSpacing = preview_layout::swatchSpacing;
+    static const int blockCount = preview_layout::swatchCount;
+
+    RECT bounds = { x, y, x + blockWidth - 1, y + blockHeight * blockCount + blockSpacing * (blockCount - 1) - 1 };
+
+    Pen* framepen = paintResources.GetPen (windows10colors::MakeRGBA (128, 128, 128, 255));
 
-    Graphics g (dc);
-    Pen framepen (Color (128, 128, 128));
-    
+    DWORD shades[blockCount];
+    GetAccentShades (accents, shades);
     Rect r (x, y, blockWidth, blockHeight);
+    for (int i = 0; i < blockCount; i++)
     {
-        SolidBrush fill (RGBAtoGdiplus (accents.lightest));
-        DrawFramedRect (g, r, &framepen, &fill);
-    }
-    r.Offset (0, blockHeight + blockSpacing);
-    {
-        SolidBrush fill (RGBAtoGdiplus (accents.lighter));
-        DrawFramedRect (g, r, &framepen, &fill);
-    }
-    r.Offset (0, blockHeight + blockSpacing);
-    {
-        SolidBrush fill (RGBAtoGdiplus (accents.light));
-        DrawFramedRect (g, r, &framepen, &fill);
-    }
-    r.Offset (0, blockHeight + blockSpacing);
-    {
-        SolidBrush fill (RGBAtoGdiplus (accents.accent));
-        DrawFramedRect (g, r, &framepen, &fill);
-    }
-    r.Offset (0, blockHeight + blockSpacing);
-    {
-        SolidBrush fill (RGBAtoGdiplus (accents.dark));
-        DrawFramedRect (g, r, &framepen, &fill);
-    }
-    r.Offset (0, blockHeight + blockSpacing);
-    {
-        SolidBrush fill (RGBAtoGdiplus (accents.darker));
-        DrawFramedRect (g, r, &framepen, &fill);
-    }
-    r.Offset (0, blockHeight + blockSpacing);
-    {
-        SolidBrush fill (RGBAtoGdiplus (accents.darkest));
-        DrawFramedRect (g, r, &framepen, &fill);
+        RECT swatchRect = GetSwatchRect (bounds, i);
+        RECT visible;
+        if (IntersectRect (&visible, &swatchRect, &paintRect))
+        {
+            DrawFramedRect (g, r, framepen, paintResources.GetBrush (shades[i]));
+        }
+        r.Offset (0, blockHeight + blockSpacing);
     }
 
-    return RECT{ x, y, x + blockWidth - 1, y + blockHeight * 7 + blockSpacing * 6 - 1 };
+    return bounds;
 }
 
-static RECT PaintMockWindow (HDC dc, int x, int y,
+static RECT PaintMockWindow (Gdiplus::Graphics& g, HDC dc, const RECT& paintRect, int x, int y,
                              const wchar_t* caption,
                              DWORD captionBG, DWORD captionText, DWORD frame,
                              DWORD fill = 0)
 {
     using namespace Gdiplus;
 
-    static const int width = 200;
-    static const int height = 200;
-    static const int captionHeight = 24;
-    static const int blurInset = 8;
-    static const int blurRadius = 20;
-
-    Bitmap dropShadow (width + 2 * blurRadius, height + 2 * blurRadius, PixelFormat32bppARGB);
-    {
-        std::unique_ptr<Graphics> dropShadowGraphics (Graphics::FromImage (&dropShadow));
-        Color shadowColor;
-        shadowColor.SetFromCOLORREF (GetSysColor (COLOR_WINDOWTEXT));
-        SolidBrush brush (shadowColor);
-        Rect solidRect (blurRadius + blurInset, blurRadius + blurInset, width - 2*blurInset, height - 2*blurInset);
-        dropShadowGraphics->FillRectangle (&brush, solidRect);
-    }
-    {
-        BlurParams blurParams = { blurRadius, false };
-        Blur blur;
-        blur.SetParameters (&blurParams);
-        dropShadow.ApplyEffect (&blur, nullptr);
-    }
-
-    Graphics g (dc);
-    g.DrawImage (&dropShadow, x, y);
+    static const int width = preview_layout::windowWidth;
+    static const int height = preview_layout::windowHeight;
+    static const int captionHeight = preview_layout::captionHeight;
+    static const int blurInset = preview_layout::shadowInset;
+    static const int blurRadius = preview_layout::shadowRadius;
+
+    RECT bounds = { x, y, x + width + 2*blurRadius - 1, y + height + 2*blurRadius - 1 };
+    RECT boundsExclusive = { bounds.left, bounds.top, bounds.right + 1, bounds.bottom + 1 };
+    RECT visible;
+    if (!IntersectRect (&visible, &boundsExclusive, &paintRect)) return bounds;
+
+    Color shadowColor;
+    shadowColor.SetFromCOLORREF (GetSysColor (COLOR_WINDOWTEXT));
+    ShadowKey shadowKey = { width, height, blurInset, blurRadius, shadowColor.GetValue () };
+    const ShadowImage& shadow = shadowCache.Get (shadowKey);
+    g.DrawImage (paintResources.GetShadowBitmap (shadowKey, shadow), x, y);
     {
         Rect frameRect = { x + blurRadius, y + blurRadius, width, height };
-        Color windowColor;
-        if (fill != 0)
-            windowColor = RGBAtoGdiplus (fill);
-        else
-            windowColor.SetFromCOLORREF (GetSysColor (COLOR_WINDOW));
-        SolidBrush fillBrush (windowColor);
-        g.FillRectangle (&fillBrush, frameRect);
-        Pen pen (RGBAtoGdiplus (frame));
-        g.DrawRectangle (&pen, frameRect);
+        DWORD windowColor = fill != 0 ? fill : windows10colors::MakeOpaque (GetSysColor (COLOR_WINDOW));
+        g.FillRectangle (paintResources.GetBrush (windowColor), frameRect);
+        g.DrawRectangle (paintResources.GetPen (frame), frameRect);
     }
 
-    SolidBrush captionBrush (RGBAtoGdiplus (captionBG));
     Rect captionRect (x + blurRadius + 1, y + blurRadius + 1, width - 2, captionHeight);
-    g.FillRectangle (&captionBrush, captionRect.X, captionRect.Y, captionRect.Width+1, captionRect.Height+1);
+    g.FillRectangle (paintResources.GetBrush (captionBG),
+                     captionRect.X, captionRect.Y, captionRect.Width+1, captionRect.Height+1);
 
-    NONCLIENTMETRICS ncm = { sizeof (NONCLIENTMETRICS) };
-    SystemParametersInfo (SPI_GETNONCLIENTMETRICS, sizeof(NONCLIENTMETRICS), &ncm, 0);
-    Font captionFont (dc, &ncm.lfCaptionFont);
     RectF captionRect_f (captionRect.X, captionRect.Y, captionRect.Width, captionRect.Height);
-    StringFormat stringFmt;
-    stringFmt.SetAlignment (StringAlignmentNear);
-    stringFmt.SetLineAlignment (StringAlignmentCenter);
-    SolidBrush textBrush (RGBAtoGdiplus (captionText));
-    g.DrawString (caption, -1, &captionFont, captionRect_f, &stringFmt, &textBrush);
+    g.DrawString (caption, -1, paintResources.GetCaptionFont (dc), captionRect_f, paintResources.GetCaptionFormat (),
+                  paintResources.GetBrush (captionText));
+
+    return bounds;
+}
+
+// Paint all elements intersecting 'paintRect'
+static void PaintContents (HDC dc, const RECT& r, const RECT& paintRect)
+{
+    const int margin = preview_layout::margin;
+
+    Gdiplus::Graphics& g = paintResources.GetGraphics (dc);
+    g.SetClip (Gdiplus::Rect (paintRect.left, paintRect.top,
+                              paintRect.right - paintRect.left, paintRect.bottom - paintRect.top));
+    g.FillRectangle (paintResources.GetBrush (windows10colors::MakeOpaque (GetSysColor (COLOR_WINDOW))),
+                     paintRect.left, paintRect.top, paintRect.right - paintRect.left, paintRect.bottom - paintRect.top);
+
+    accentsBounds = PaintAccentColors (g, paintRect, r.left + margin, r.top + margin);
+
+    mockWindowBounds[0] = PaintMockWindow (g, dc, paintRect, accentsBounds.right + margin, accentsBounds.top, L"Active caption",
+                                           colors.activeCaptionBG, colors.activeCaptionText, colors.activeFrame);
+    const RECT& activeRect = mockWindowBounds[0];
+    mockWindowBounds[1] = PaintMockWindow (g, dc, paintRect, activeRect.right + margin, activeRect.top, L"Inactive caption",
+                                           colors.inactiveCaptionBG, colors.inactiveCaptionText, colors.inactiveFrame);
+    mockWindowBounds[2] = PaintMockWindow (g, dc, paintRect, activeRect.left, activeRect.bottom + margin, L"Active caption (glass)",
+                                           colorsGlass.activeCaptionBG, colorsGlass.activeCaptionText, colorsGlass.activeFrame,
+                                           colorsGlass.activeCaptionBG);
+    mockWindowBounds[3] = PaintMockWindow (g, dc, paintRect, activeRect.right + margin, activeRect.bottom + margin, L"Inactive caption (glass)",
+                                           colorsGlass.inactiveCaptionBG, colorsGlass.inactiveCaptionText, colorsGlass.inactiveFrame,
+                                           colorsGlass.inactiveCaptionBG);
+    // Drawing must be complete before the DC is used with GDI
+    g.Flush (Gdiplus::FlushIntentionSync);
+}
+
+// Get the back buffer DC, (re)creating the buffer if needed. Returns nullptr on failure.
+static HDC GetBackBuffer (HDC dc, int width, int height)
+{
+    if (backBufferDC && (backBufferSize.cx >= width) && (backBufferSize.cy >= height)) return backBufferDC;
 
-    return RECT{ x, y, x + width + 2*blurRadius - 1, y + height + 2*blurRadius - 1 };
+    if (!backBufferDC)
+    {
+        backBufferDC = CreateCompatibleDC (dc);
+        if (!backBufferDC) return nullptr;
+    }
+    HBITMAP newBuffer = CreateCompatibleBitmap (dc, width, height);
+    if (!newBuffer) return nullptr;
+    // Graphics object would keep drawing to the old bitmap
+    paintResources.ReleaseGraphics ();
+    HGDIOBJ oldBitmap = SelectObject (backBufferDC, newBuffer);
+    if (backBuffer)
+        DeleteObject (backBuffer);
+    else
+        backBufferOldBitmap = oldBitmap;
+    backBuffer = newBuffer;
+    backBufferSize.cx = width;
+    backBufferSize.cy = height;
+    return backBufferDC;
 }
 
-static void PaintContents (HDC dc, const RECT& r)
+static void FreeBackBuffer ()
 {
-    RECT accentsRect = PaintAccentColors (dc, r.left + 16, r.top + 16);
-
-    RECT activeRect = PaintMockWindow (dc, accentsRect.right + 16, accentsRect.top, L"Active caption",
-                                       colors.activeCaptionBG, colors.activeCaptionText, colors.activeFrame);
-    PaintMockWindow (dc, activeRect.right + 16, activeRect.top, L"Inactive caption",
-                     colors.inactiveCaptionBG, colors.inactiveCaptionText, colors.inactiveFrame);
-    PaintMockWindow (dc, activeRect.left, activeRect.bottom + 16, L"Active caption (glass)",
-                     colorsGlass.activeCaptionBG, colorsGlass.activeCaptionText, colorsGlass.activeFrame,
-                     colorsGlass.activeCaptionBG);
-    PaintMockWindow (dc, activeRect.right + 16, activeRect.bottom + 16, L"Inactive caption (glass)",
-                     colorsGlass.inactiveCaptionBG, colorsGlass.inactiveCaptionText, colorsGlass.inactiveFrame,
-                     colorsGlass.inactiveCaptionBG);
+    if (!backBufferDC) return;
+    paintResources.ReleaseGraphics ();
+    SelectObject (backBufferDC, backBufferOldBitmap);
+    DeleteObject (backBuffer);
+    DeleteDC (backBufferDC);
+    backBufferDC = nullptr;
+    backBuffer = nullptr;
+    backBufferSize = SIZE{};
+}
+
+// Invalidate the elements whose colors differ from the given previous ones
+static void InvalidateChangedColors (HWND hWnd, const windows10colors::AccentColor& oldAccents, bool oldAccentsValid,
+                                     const windows10colors::FrameColors& oldColors,
+                                     const windows10colors::FrameColors& oldColorsGlass)
+{
+    // Showing or hiding the accent colors moves everything
+    if (oldAccentsValid != accents_valid)
+    {
+        InvalidateRect (hWnd, nullptr, false);
+        return;
+    }
+
+    if (accents_valid)
+    {
+        DWORD oldShades[preview_layout::swatchCount];
+        DWORD newShades[preview_layout::swatchCount];
+        GetAccentShades (oldAccents, oldShades);
+        GetAccentShades (accents, newShades);
+        for (int i = 0; i < preview_layout::swatchCount; i++)
+        {
+            if (oldShades[i] == newShades[i]) continue;
+            RECT swatchRect = GetSwatchRect (accentsBounds, i);
+            InvalidateRect (hWnd, &swatchRect, false);
+        }
+    }
+
+    auto invalidateMockWindow = [hWnd](int index)
+    {
+        const RECT& bounds = mockWindowBounds[index];
+        RECT rect = { bounds.left, bounds.top, bounds.right + 1, bounds.bottom + 1 };
+        InvalidateRect (hWnd, &rect, false);
+    };
+    if ((oldColors.activeCaptionBG != colors.activeCaptionBG)
+        || (oldColors.activeCaptionText != colors.activeCaptionText)
+        || (oldColors.activeFrame != colors.activeFrame))
+    {
+        invalidateMockWindow (0);
+    }
+    if ((oldColors.inactiveCaptionBG != colors.inactiveCaptionBG)
+        || (oldColors.inactiveCaptionText != colors.inactiveCaptionText)
+        || (oldColors.inactiveFrame != colors.inactiveFrame))
+    {
+        invalidateMockWindow (1);
+    }
+    if ((oldColorsGlass.activeCaptionBG != colorsGlass.activeCaptionBG)
+        || (oldColorsGlass.activeCaptionText != colorsGlass.activeCaptionText)
+        || (oldColorsGlass.activeFrame != colorsGlass.activeFrame))
+    {
+        invalidateMockWindow (2);
+    }
+    if ((oldColorsGlass.inactiveCaptionBG != colorsGlass.inactiveCaptionBG)
+        || (oldColorsGlass.inactiveCaptionText != colorsGlass.inactiveCaptionText)
+        || (oldColorsGlass.inactiveFrame != colorsGlass.inactiveFrame))
+    {
+        invalidateMockWindow (3);
+    }
 }
 
 //
@@ -321,17 +503,78 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
             GetClientRect (hWnd, &cr);
             PAINTSTRUCT ps;
             HDC hdc = BeginPaint(hWnd, &ps);
-            PaintContents (hdc, cr);
+            const RECT& paintRect = ps.rcPaint;
+            paintResources.BeginFrame (colors_generation, GetDeviceCaps (hdc, LOGPIXELSY));
+            HDC bufferDC = GetBackBuffer (hdc, cr.right - cr.left, cr.bottom - cr.top);
+            if (bufferDC)
+            {
+                // Only the invalid area is painted and copied
+                PaintContents (bufferDC, cr, paintRect);
+                BitBlt (hdc, paintRect.left, paintRect.top,
+                        paintRect.right - paintRect.left, paintRect.bottom - paintRect.top,
+                        bufferDC, paintRect.left, paintRect.top, SRCCOPY);
+            }
+            else
+            {
+                PaintContents (hdc, cr, paintRect);
+                // Paint DC is only valid until EndPaint()
+                paintResources.ReleaseGraphics ();
+            }
             EndPaint(hWnd, &ps);
         }
         break;
+    case WM_ERASEBKGND:
+        // Background is painted along with the contents
+        return 1;
     case WM_DESTROY:
+        // GDI+ objects must be gone before GDI+ shuts down
+        FreeBackBuffer ();
+        paintResources.Clear ();
         PostQuitMessage(0);
         break;
+    case WM_SYSCOLORCHANGE:
+        // Shadow color is a system color
+        ClearPaintCaches ();
+        InvalidateRect (hWnd, nullptr, false);
+        break;
+    case WM_DPICHANGED:
+        ClearPaintCaches ();
+        InvalidateRect (hWnd, nullptr, false);
+        return DefWindowProc(hWnd, message, wParam, lParam);
     case WM_SETTINGCHANGE:
-        UpdateWindows10Colors ();
-        InvalidateRect (hWnd, nullptr, true);
+        if (wParam == SPI_SETNONCLIENTMETRICS)
+        {
+            // Caption font may have changed
+            paintResources.Clear ();
+            InvalidateRect (hWnd, nullptr, false);
+        }
+        settingsRefresh.Notify ();
+        SetTimer (hWnd, refreshTimerID, static_cast<UINT> (settingsRefresh.GetDelay ().count ()), nullptr);
         return DefWindowProc(hWnd, message, wParam, lParam);
+    case WM_TIMER:
+        if (wParam != refreshTimerID) return DefWindowProc(hWnd, message, wParam, lParam);
+        if (!settingsRefresh.Poll ())
+        {
+            if (settingsRefresh.IsPending ())
+                SetTimer (hWnd, refreshTimerID, static_cast<UINT> (settingsRefresh.GetDelay ().count ()), nullptr);
+            else
+                KillTimer (hWnd, refreshTimerID);
+            break;
+        }
+        KillTimer (hWnd, refreshTimerID);
+        windows10colors::GetThemeCache ().Invalidate ();
+        // Only repaint if colors actually changed, and only the elements showing them
+        if (windows10colors::GetThemeCache ().GetGeneration () != colors_generation)
+        {
+            windows10colors::AccentColor oldAccents = accents;
+            bool oldAccentsValid = accents_valid;
+            windows10colors::FrameColors oldColors = colors;
+            windows10colors::FrameColors oldColorsGlass = colorsGlass;
+            // Next paint drops the brushes and pens for the old colors
+            UpdateWindows10Colors ();
+            InvalidateChangedColors (hWnd, oldAccents, oldAccentsValid, oldColors, oldColorsGlass);
+        }
+        break;
     default:
         return DefWindowProc(hWnd, message, wParam, lParam);
     }
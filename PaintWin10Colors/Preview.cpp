@@ -0,0 +1,452 @@
+// Preview.cpp : Headless rendering of theme previews into memory buffers.
+//
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif // NOMINMAX
+
+#include "Preview.h"
+
+#include <algorithm>
+#include <atomic>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+
+using windows10colors::RGBA;
+
+namespace
+{
+    // Destination image, with clipping
+    struct Canvas
+    {
+        uint8_t* pixels;
+        int width;
+        int height;
+        ptrdiff_t stride;
+    };
+
+    // Calculates (v / 255), rounded, for v in [0, 255*255]
+    inline uint32_t Div255 (uint32_t v)
+    {
+        v += 128;
+        return (v + (v >> 8)) >> 8;
+    }
+
+    // Blend a non-premultiplied color over a pixel
+    inline void BlendPixel (uint8_t* dest, uint32_t r, uint32_t g, uint32_t b, uint32_t a)
+    {
+        uint32_t inv_a = 255 - a;
+        dest[0] = static_cast<uint8_t> (Div255 (r * a + dest[0] * inv_a));
+        dest[1] = static_cast<uint8_t> (Div255 (g * a + dest[1] * inv_a));
+        dest[2] = static_cast<uint8_t> (Div255 (b * a + dest[2] * inv_a));
+        dest[3] = static_cast<uint8_t> (a + Div255 (dest[3] * inv_a));
+    }
+
+    // Fill a rectangle, blending if the color is translucent
+    void FillRect (const Canvas& canvas, int x, int y, int w, int h, RGBA color)
+    {
+        int left = std::max (x, 0);
+        int top = std::max (y, 0);
+        int right = std::min (x + w, canvas.width);
+        int bottom = std::min (y + h, canvas.height);
+        if ((left >= right) || (top >= bottom)) return;
+
+        uint8_t r = windows10colors::GetRed (color);
+        uint8_t g = windows10colors::GetGreen (color);
+        uint8_t b = windows10colors::GetBlue (color);
+        uint8_t a = windows10colors::GetAlpha (color);
+        if (a == 0) return;
+        uint8_t* firstRow = canvas.pixels + top * canvas.stride + left * 4;
+        if (a == 255)
+        {
+            // Fill the first row, copy it to the others
+            const uint8_t bytes[4] = { r, g, b, a };
+            uint8_t* dest = firstRow;
+            for (int px = left; px < right; px++, dest += 4)
+            {
+                memcpy (dest, bytes, 4);
+            }
+            size_t rowBytes = (right - left) * 4;
+            for (int py = top + 1; py < bottom; py++)
+            {
+                memcpy (firstRow + (py - top) * canvas.stride, firstRow, rowBytes);
+            }
+            return;
+        }
+        for (int py = top; py < bottom; py++)
+        {
+            uint8_t* dest = firstRow + (py - top) * canvas.stride;
+            for (int px = left; px < right; px++, dest += 4)
+            {
+                BlendPixel (dest, r, g, b, a);
+            }
+        }
+    }
+
+    // Outline a rectangle like GDI+ does with a 1 pixel pen: covers (w+1) x (h+1) pixels
+    void DrawRect (const Canvas& canvas, int x, int y, int w, int h, RGBA color)
+    {
+        FillRect (canvas, x, y, w + 1, 1, color);
+        FillRect (canvas, x, y + h, w + 1, 1, color);
+        FillRect (canvas, x, y + 1, 1, h - 1, color);
+        FillRect (canvas, x + w, y + 1, 1, h - 1, color);
+    }
+
+    // Blend a row of shadow pixels (non-premultiplied ARGB)
+    void BlendShadowRow (uint8_t* dest, const uint32_t* src, int count)
+    {
+        for (int i = 0; i < count; i++, src++, dest += 4)
+        {
+            uint32_t argb = *src;
+            uint32_t a = argb >> 24;
+            if (a == 0) continue;
+            BlendPixel (dest, (argb >> 16) & 0xff, (argb >> 8) & 0xff, argb & 0xff, a);
+        }
+    }
+
+    /* Draw a shadow image. Columns [skipLeft, skipRight) of rows [skipTop, skipBottom)
+     * (in image coordinates) are left out, as they'd be painted over opaquely anyway. */
+    void DrawShadow (const Canvas& canvas, int x, int y, const ShadowImage& shadow,
+                     int skipLeft = 0, int skipTop = 0, int skipRight = 0, int skipBottom = 0)
+    {
+        int left = std::max (x, 0);
+        int top = std::max (y, 0);
+        int right = std::min (x + shadow.width, canvas.width);
+        int bottom = std::min (y + shadow.height, canvas.height);
+        if ((left >= right) || (top >= bottom)) return;
+        for (int py = top; py < bottom; py++)
+        {
+            const uint32_t* src = shadow.pixels.data () + (py - y) * shadow.width;
+            uint8_t* dest = canvas.pixels + py * canvas.stride;
+            if ((py - y >= skipTop) && (py - y < skipBottom))
+            {
+                int spanEnd = std::min (x + skipLeft, right);
+                int spanStart = std::max (x + skipRight, left);
+                if (spanEnd > left) BlendShadowRow (dest + left * 4, src + (left - x), spanEnd - left);
+                if (right > spanStart) BlendShadowRow (dest + spanStart * 4, src + (spanStart - x), right - spanStart);
+            }
+            else
+            {
+                BlendShadowRow (dest + left * 4, src + (left - x), right - left);
+            }
+        }
+    }
+
+    /* Indicate a text by solid glyph cells, roughly matching the extent of
+     * the caption font at 96 DPI. */
+    void DrawGreekedText (const Canvas& canvas, int x, int y, int w, int h, const char* text, RGBA color)
+    {
+        static const int padding = 2;
+        static const int glyphWidth = 5;
+        static const int glyphHeight = 7;
+        static const int glyphAdvance = 6;
+
+        int glyphX = x + padding;
+        int glyphY = y + (h - glyphHeight) / 2;
+        for (; *text; text++, glyphX += glyphAdvance)
+        {
+            if (glyphX + glyphWidth > x + w) break;
+            if (*text == ' ') continue;
+            FillRect (canvas, glyphX, glyphY, glyphWidth, glyphHeight, color);
+        }
+    }
+
+    // Rectangle, with inclusive right and bottom coordinates, like the GDI+ painting code uses
+    struct Extent
+    {
+        int left;
+        int top;
+        int right;
+        int bottom;
+    };
+
+    Extent AccentColorsExtent (const PreviewColors& colors, int x, int y)
+    {
+        using namespace preview_layout;
+        if (!colors.accentsValid) return Extent { x, y, x + 1, y + 1 };
+        return Extent { x, y, x + swatchSize - 1, y + swatchSize * swatchCount + swatchSpacing * (swatchCount - 1) - 1 };
+    }
+
+    Extent MockWindowExtent (int x, int y)
+    {
+        using namespace preview_layout;
+        return Extent { x, y, x + windowWidth + 2 * shadowRadius - 1, y + windowHeight + 2 * shadowRadius - 1 };
+    }
+
+    // Mock window positions: active, inactive, active glass, inactive glass
+    void LayoutPreview (const PreviewColors& colors, Extent& accentsExtent, Extent windowExtents[4])
+    {
+        using namespace preview_layout;
+        accentsExtent = AccentColorsExtent (colors, margin, margin);
+        windowExtents[0] = MockWindowExtent (accentsExtent.right + margin, accentsExtent.top);
+        windowExtents[1] = MockWindowExtent (windowExtents[0].right + margin, windowExtents[0].top);
+        windowExtents[2] = MockWindowExtent (windowExtents[0].left, windowExtents[0].bottom + margin);
+        windowExtents[3] = MockWindowExtent (windowExtents[0].right + margin, windowExtents[0].bottom + margin);
+    }
+
+    void RenderAccentColors (const Canvas& canvas, const PreviewColors& colors, const Extent& extent)
+    {
+        using namespace preview_layout;
+        if (!colors.accentsValid) return;
+
+        const RGBA frameColor = windows10colors::MakeRGBA (128, 128, 128, 255);
+        const RGBA shades[swatchCount] = { colors.accents.lightest, colors.accents.lighter, colors.accents.light,
+                                           colors.accents.accent,
+                                           colors.accents.dark, colors.accents.darker, colors.accents.darkest };
+        int y = extent.top;
+        for (RGBA shade : shades)
+        {
+            DrawRect (canvas, extent.left, y, swatchSize, swatchSize, frameColor);
+            FillRect (canvas, extent.left + 1, y + 1, swatchSize - 1, swatchSize - 1, shade);
+            y += swatchSize + swatchSpacing;
+        }
+    }
+
+    void RenderMockWindow (const Canvas& canvas, const Extent& extent, const ShadowImage& shadow, const char* caption,
+                           RGBA captionBG, RGBA captionText, RGBA frame, RGBA fill)
+    {
+        using namespace preview_layout;
+        int x = extent.left;
+        int y = extent.top;
+        if (windows10colors::GetAlpha (fill) == 255)
+        {
+            DrawShadow (canvas, x, y, shadow, shadowRadius, shadowRadius,
+                        shadowRadius + windowWidth, shadowRadius + windowHeight);
+        }
+        else
+        {
+            DrawShadow (canvas, x, y, shadow);
+        }
+        FillRect (canvas, x + shadowRadius, y + shadowRadius, windowWidth, windowHeight, fill);
+        DrawRect (canvas, x + shadowRadius, y + shadowRadius, windowWidth, windowHeight, frame);
+
+        int captionX = x + shadowRadius + 1;
+        int captionY = y + shadowRadius + 1;
+        FillRect (canvas, captionX, captionY, windowWidth - 1, captionHeight + 1, captionBG);
+        DrawGreekedText (canvas, captionX, captionY, windowWidth - 2, captionHeight, caption, captionText);
+    }
+} // anonymous namespace
+
+void GetPreviewSize (const PreviewColors& colors, int& width, int& height)
+{
+    Extent accentsExtent;
+    Extent windowExtents[4];
+    LayoutPreview (colors, accentsExtent, windowExtents);
+    width = windowExtents[3].right + 1 + preview_layout::margin;
+    height = windowExtents[3].bottom + 1 + preview_layout::margin;
+}
+
+void RenderPreview (const PreviewColors& colors, uint8_t* pixels, int width, int height, ptrdiff_t stride,
+                    ShadowCache* shadows)
+{
+    using namespace preview_layout;
+    Canvas canvas = { pixels, width, height, stride };
+    FillRect (canvas, 0, 0, width, height, windows10colors::MakeOpaque (colors.background));
+
+    Extent accentsExtent;
+    Extent windowExtents[4];
+    LayoutPreview (colors, accentsExtent, windowExtents);
+    RenderAccentColors (canvas, colors, accentsExtent);
+
+    // Shadow images are ARGB
+    RGBA shadowColor = colors.shadow;
+    ShadowKey shadowKey = { windowWidth, windowHeight, shadowInset, shadowRadius,
+                            0xff000000u | (uint32_t (windows10colors::GetRed (shadowColor)) << 16)
+                            | (uint32_t (windows10colors::GetGreen (shadowColor)) << 8)
+                            | windows10colors::GetBlue (shadowColor) };
+    ShadowCache localShadows;
+    const ShadowImage& shadow = (shadows ? *shadows : localShadows).Get (shadowKey);
+
+    const windows10colors::FrameColors& fc = colors.colors;
+    const windows10colors::FrameColors& glass = colors.colorsGlass;
+    RGBA window = windows10colors::MakeOpaque (colors.window);
+    RenderMockWindow (canvas, windowExtents[0], shadow, "Active caption",
+                      fc.activeCaptionBG, fc.activeCaptionText, fc.activeFrame, window);
+    RenderMockWindow (canvas, windowExtents[1], shadow, "Inactive caption",
+                      fc.inactiveCaptionBG, fc.inactiveCaptionText, fc.inactiveFrame, window);
+    RenderMockWindow (canvas, windowExtents[2], shadow, "Active caption (glass)",
+                      glass.activeCaptionBG, glass.activeCaptionText, glass.activeFrame, glass.activeCaptionBG);
+    RenderMockWindow (canvas, windowExtents[3], shadow, "Inactive caption (glass)",
+                      glass.inactiveCaptionBG, glass.inactiveCaptionText, glass.inactiveFrame, glass.inactiveCaptionBG);
+}
+
+void RenderPreviews (size_t count, const PreviewColors* colors, const PreviewSink& sink, unsigned int threads)
+{
+    if (count == 0) return;
+    if (threads == 0) threads = std::max (std::thread::hardware_concurrency (), 1u);
+    threads = static_cast<unsigned int> (std::min (static_cast<size_t> (threads), count));
+
+    std::atomic<size_t> next (0);
+    auto worker = [&]()
+    {
+        std::vector<uint8_t> buffer;
+        ShadowCache shadows;
+        size_t index;
+        while ((index = next.fetch_add (1)) < count)
+        {
+            int width, height;
+            GetPreviewSize (colors[index], width, height);
+            ptrdiff_t stride = width * 4;
+            buffer.resize (stride * height);
+            RenderPreview (colors[index], buffer.data (), width, height, stride, &shadows);
+            sink (index, buffer.data (), width, height, stride);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve (threads - 1);
+    for (unsigned int t = 1; t < threads; t++)
+    {
+        workers.emplace_back (worker);
+    }
+    worker ();
+    for (auto& w : workers) w.join ();
+}
+
+void EncodePPM (const uint8_t* pixels, int width, int height, ptrdiff_t stride, std::vector<uint8_t>& out)
+{
+    char header[32];
+    int headerLen = snprintf (header, sizeof (header), "P6\n%d %d\n255\n", width, height);
+    out.assign (header, header + headerLen);
+    out.reserve (headerLen + static_cast<size_t> (width) * height * 3);
+    for (int y = 0; y < height; y++)
+    {
+        const uint8_t* src = pixels + y * stride;
+        for (int x = 0; x < width; x++, src += 4)
+        {
+            out.insert (out.end (), src, src + 3);
+        }
+    }
+}
+
+namespace
+{
+    uint32_t PNGCrc (const uint8_t* data, size_t size, uint32_t crc = 0)
+    {
+        struct Table
+        {
+            uint32_t entries[256];
+            Table ()
+            {
+                for (uint32_t n = 0; n < 256; n++)
+                {
+                    uint32_t c = n;
+                    for (int k = 0; k < 8; k++)
+                    {
+                        c = (c & 1) ? (0xedb88320u ^ (c >> 1)) : (c >> 1);
+                    }
+                    entries[n] = c;
+                }
+            }
+        };
+        static const Table table;
+
+        crc = ~crc;
+        for (size_t i = 0; i < size; i++)
+        {
+            crc = table.entries[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+        }
+        return ~crc;
+    }
+
+    void PutBE32 (std::vector<uint8_t>& out, uint32_t v)
+    {
+        const uint8_t bytes[4] = { uint8_t (v >> 24), uint8_t (v >> 16), uint8_t (v >> 8), uint8_t (v) };
+        out.insert (out.end (), bytes, bytes + 4);
+    }
+
+    // Append a chunk; 'data' is appended by the caller, between the two calls
+    size_t BeginPNGChunk (std::vector<uint8_t>& out, const char* type)
+    {
+        PutBE32 (out, 0);
+        size_t start = out.size ();
+        out.insert (out.end (), type, type + 4);
+        return start;
+    }
+
+    void EndPNGChunk (std::vector<uint8_t>& out, size_t start)
+    {
+        uint32_t length = static_cast<uint32_t> (out.size () - start - 4);
+        out[start - 4] = uint8_t (length >> 24);
+        out[start - 3] = uint8_t (length >> 16);
+        out[start - 2] = uint8_t (length >> 8);
+        out[start - 1] = uint8_t (length);
+        PutBE32 (out, PNGCrc (out.data () + start, out.size () - start));
+    }
+} // anonymous namespace
+
+void EncodePNG (const uint8_t* pixels, int width, int height, ptrdiff_t stride, std::vector<uint8_t>& out)
+{
+    static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    out.assign (signature, signature + sizeof (signature));
+
+    size_t chunk = BeginPNGChunk (out, "IHDR");
+    PutBE32 (out, width);
+    PutBE32 (out, height);
+    // 8 bits per channel, RGBA, no interlacing
+    const uint8_t format[5] = { 8, 6, 0, 0, 0 };
+    out.insert (out.end (), format, format + sizeof (format));
+    EndPNGChunk (out, chunk);
+
+    /* zlib stream of 'stored' deflate blocks. Each row is preceded by a
+     * filter type byte (0 = none). */
+    size_t rowBytes = static_cast<size_t> (width) * 4;
+    size_t rawSize = (rowBytes + 1) * height;
+    const size_t maxBlock = 65535;
+    size_t numBlocks = std::max ((rawSize + maxBlock - 1) / maxBlock, size_t (1));
+    out.reserve (out.size () + rawSize + numBlocks * 5 + 32);
+
+    chunk = BeginPNGChunk (out, "IDAT");
+    out.push_back (0x78);
+    out.push_back (0x01);
+    uint32_t adlerA = 1, adlerB = 0;
+    size_t remaining = rawSize;
+    size_t blockLeft = 0;
+    for (int y = 0; y < height; y++)
+    {
+        const uint8_t* row = pixels + y * stride;
+        // Row data, with filter byte at offset -1
+        for (size_t pos = 0; pos < rowBytes + 1;)
+        {
+            if (blockLeft == 0)
+            {
+                blockLeft = std::min (remaining, maxBlock);
+                remaining -= blockLeft;
+                const uint8_t blockHeader[5] = { uint8_t (remaining == 0 ? 1 : 0),
+                                                 uint8_t (blockLeft), uint8_t (blockLeft >> 8),
+                                                 uint8_t (~blockLeft), uint8_t (~blockLeft >> 8) };
+                out.insert (out.end (), blockHeader, blockHeader + 5);
+            }
+            const uint8_t filter = 0;
+            const uint8_t* src = (pos == 0) ? &filter : row + pos - 1;
+            size_t n = (pos == 0) ? 1 : std::min (rowBytes + 1 - pos, blockLeft);
+            out.insert (out.end (), src, src + n);
+            for (size_t i = 0; i < n; i++)
+            {
+                adlerA += src[i];
+                adlerB += adlerA;
+                // Defer the modulo; 5552 bytes is the largest run that can't overflow
+                if ((i & 4095) == 4095)
+                {
+                    adlerA %= 65521;
+                    adlerB %= 65521;
+                }
+            }
+            adlerA %= 65521;
+            adlerB %= 65521;
+            pos += n;
+            blockLeft -= n;
+        }
+    }
+    if (rawSize == 0)
+    {
+        const uint8_t emptyBlock[5] = { 1, 0, 0, 0xff, 0xff };
+        out.insert (out.end (), emptyBlock, emptyBlock + 5);
+    }
+    PutBE32 (out, (adlerB << 16) | adlerA);
+    EndPNGChunk (out, chunk);
+
+    chunk = BeginPNGChunk (out, "IEND");
+    EndPNGChunk (out, chunk);
+}
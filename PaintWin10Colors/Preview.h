@@ -0,0 +1,98 @@
+// Preview.h : Headless rendering of theme previews into memory buffers.
+// Independent of GDI+, so previews can be generated and compared on other platforms.
+//
+
+#pragma once
+
+#include "Windows10ColorsCore.h"
+
+#include <functional>
+#include <vector>
+
+#include "DropShadow.h"
+
+/// Layout of the preview, shared with the GDI+ painting code
+namespace preview_layout
+{
+    /// Distance of elements from the edges and each other
+    const int margin = 16;
+    /// Size of an accent color swatch
+    const int swatchSize = 24;
+    /// Vertical distance between accent color swatches
+    const int swatchSpacing = 12;
+    /// Number of accent color swatches
+    const int swatchCount = 7;
+    /// Size of a mock window, excluding the shadow
+    const int windowWidth = 200;
+    const int windowHeight = 200;
+    /// Height of a mock window caption
+    const int captionHeight = 24;
+    /// Inset of the solid part of the window shadow
+    const int shadowInset = 8;
+    /// Blur radius of the window shadow
+    const int shadowRadius = 20;
+} // namespace preview_layout
+
+/// Colors shown in a preview
+struct PreviewColors
+{
+    /// Accent color shades
+    windows10colors::AccentColor accents;
+    /// Whether accent colors are shown
+    bool accentsValid;
+    /// Frame colors of the normal mock windows
+    windows10colors::FrameColors colors;
+    /// Frame colors of the mock windows with glass effect
+    windows10colors::FrameColors colorsGlass;
+    /// Background of the preview (COLOR_WINDOW)
+    windows10colors::RGBA background;
+    /// Client area of the normal mock windows (COLOR_WINDOW)
+    windows10colors::RGBA window;
+    /// Shadow color (COLOR_WINDOWTEXT)
+    windows10colors::RGBA shadow;
+};
+
+/// Get size of the area covered by a preview, including the outer margin
+void GetPreviewSize (const PreviewColors& colors, int& width, int& height);
+
+/**
+ * Render a preview into a caller-owned buffer.
+ * Produces the same layout as the GDI+ painting code: accent color swatches,
+ * followed by active and inactive mock windows, with and without glass effect.
+ * As no fonts are available, caption texts are indicated by solid glyph cells.
+ * \param colors Colors to show.
+ * \param pixels Image data: 8-bit RGBA, R in the first byte. Alpha of the
+ *   result is always 255, as the background is drawn opaque.
+ * \param width Width of the image. Content outside is clipped.
+ * \param height Height of the image.
+ * \param stride Distance between rows, in bytes.
+ * \param shadows Shadow cache to use. May be \c nullptr, in which case shadows are
+ *   generated for this call only. A cache must not be shared across threads.
+ */
+void RenderPreview (const PreviewColors& colors, uint8_t* pixels, int width, int height, ptrdiff_t stride,
+                    ShadowCache* shadows = nullptr);
+
+/**
+ * Function receiving rendered previews.
+ * Called on worker threads; the pixels are only valid during the call.
+ */
+typedef std::function<void (size_t index, const uint8_t* pixels, int width, int height, ptrdiff_t stride)> PreviewSink;
+
+/**
+ * Render a number of previews, spread over multiple threads.
+ * Each thread reuses its image buffer and shadow cache across previews.
+ * \param count Number of previews.
+ * \param colors Array of \a count preview colors.
+ * \param sink Receives the rendered images, in no particular order.
+ * \param threads Maximum number of threads to use. 0 picks the number of hardware threads.
+ */
+void RenderPreviews (size_t count, const PreviewColors* colors, const PreviewSink& sink, unsigned int threads = 0);
+
+/// Encode an RGBA image as binary PPM (P6). Alpha is dropped.
+void EncodePPM (const uint8_t* pixels, int width, int height, ptrdiff_t stride, std::vector<uint8_t>& out);
+
+/**
+ * Encode an RGBA image as PNG.
+ * Image data is stored uncompressed, trading file size for encoding speed.
+ */
+void EncodePNG (const uint8_t* pixels, int width, int height, ptrdiff_t stride, std::vector<uint8_t>& out);
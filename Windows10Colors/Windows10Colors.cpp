@@ -29,6 +29,10 @@ https://github.com/res2k/Windows10Colors
 #endif // NOMINMAX
 #include "Windows10Colors.h"
 
+#include "Windows10ColorsActivation.h"
+#include "Windows10ColorsCapabilities.h"
+#include "Windows10ColorsModules.h"
+
 #include <comdef.h>
 #include <Dwmapi.h>
 #include <winnt.h>
@@ -37,10 +41,16 @@ https://github.com/res2k/Windows10Colors
 #include <windows.ui.viewmanagement.h>
 
 #include <algorithm>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
 
 #if defined(_MSC_VER)
 #pragma comment(lib, "dwmapi.lib")
 #pragma comment(lib, "ntdll.lib")
+#pragma comment(lib, "ole32.lib")
 #endif
 
 namespace windows10colors
@@ -52,122 +62,109 @@ using namespace Microsoft::WRL;
 /// Helper macro to exit early in case of failure HRESULTs.
 #define CHECKED(X)     do { HRESULT hr = (X); if (FAILED(hr)) return hr; } while (false)
 
-namespace
+/// Number of system calls made by the library on the current thread
+static thread_local unsigned long systemCallCount = 0;
+
+/// Helper macro to count a system call.
+#define SYSCALL(X)     (++systemCallCount, (X))
+
+unsigned long GetSystemCallCount ()
 {
-    extern "C" NTSYSAPI NTSTATUS NTAPI RtlVerifyVersionInfo (PRTL_OSVERSIONINFOEXW VersionInfo,
-                                                             ULONG TypeMask,
-                                                             ULONGLONG ConditionMask);
+    return systemCallCount;
+}
 
-    /// IsWindows8OrGreater() implementation using RtlVerifyVersionInfo
-    static bool IsWindows8OrGreater ()
-    {
-      RTL_OSVERSIONINFOEXW version = { sizeof (RTL_OSVERSIONINFOEXW), 6, 2 };
-      ULONGLONG conditionMask = 0;
-      VER_SET_CONDITION (conditionMask, VER_MAJORVERSION, VER_GREATER_EQUAL);
-      VER_SET_CONDITION (conditionMask, VER_MINORVERSION, VER_GREATER_EQUAL);
-      return RtlVerifyVersionInfo (&version, VER_MAJORVERSION | VER_MINORVERSION, conditionMask) == 0;
-    }
+CapabilityCache& GetCapabilityCache ()
+{
+    static CapabilityCache cache;
+    return cache;
+}
 
-    /// IsWindows10OrGreater() implementation using RtlVerifyVersionInfo
-    static bool IsWindows10OrGreater ()
-    {
-      RTL_OSVERSIONINFOEXW version = { sizeof (RTL_OSVERSIONINFOEXW), 10, 0 };
-      ULONGLONG conditionMask = 0;
-      VER_SET_CONDITION (conditionMask, VER_MAJORVERSION, VER_GREATER_EQUAL);
-      VER_SET_CONDITION (conditionMask, VER_MINORVERSION, VER_GREATER_EQUAL);
-      return RtlVerifyVersionInfo (&version, VER_MAJORVERSION | VER_MINORVERSION, conditionMask) == 0;
-    }
+namespace
+{
+    extern "C" NTSYSAPI NTSTATUS NTAPI RtlGetVersion (PRTL_OSVERSIONINFOW VersionInformation);
 
-    static bool IsWindows10_1809OrGreater ()
+    /// Obtain actual OS version, regardless of compatibility manifest
+    static OSVersion GetOSVersion ()
     {
-      RTL_OSVERSIONINFOEXW version = { sizeof (RTL_OSVERSIONINFOEXW), 10, 0, 17763 };
-      ULONGLONG conditionMask = 0;
-      VER_SET_CONDITION (conditionMask, VER_MAJORVERSION, VER_GREATER_EQUAL);
-      VER_SET_CONDITION (conditionMask, VER_MINORVERSION, VER_GREATER_EQUAL);
-      VER_SET_CONDITION (conditionMask, VER_BUILDNUMBER, VER_GREATER_EQUAL);
-      return RtlVerifyVersionInfo (&version, VER_MAJORVERSION | VER_MINORVERSION | VER_BUILDNUMBER, conditionMask) == 0;
+        OSVersion version;
+        if (GetCapabilityCache ().GetOSVersion (version)) return version;
+
+        RTL_OSVERSIONINFOW info = { sizeof (RTL_OSVERSIONINFOW) };
+        SYSCALL (RtlGetVersion (&info));
+        version = { info.dwMajorVersion, info.dwMinorVersion, info.dwBuildNumber };
+        GetCapabilityCache ().SetOSVersion (version);
+        return version;
     }
 
-    static bool IsWindows10_1903OrGreater ()
+    /// ModuleLoader using LoadLibrary/GetProcAddress
+    class Win32ModuleLoader : public ModuleLoader
     {
-        RTL_OSVERSIONINFOEXW version = { sizeof (RTL_OSVERSIONINFOEXW), 10, 0, 18362 };
-        ULONGLONG conditionMask = 0;
-        VER_SET_CONDITION (conditionMask, VER_MAJORVERSION, VER_GREATER_EQUAL);
-        VER_SET_CONDITION (conditionMask, VER_MINORVERSION, VER_GREATER_EQUAL);
-        VER_SET_CONDITION (conditionMask, VER_BUILDNUMBER, VER_GREATER_EQUAL);
-        return RtlVerifyVersionInfo (&version, VER_MAJORVERSION | VER_MINORVERSION | VER_BUILDNUMBER, conditionMask) == 0;
-    }
+    public:
+        void* LoadModule (const wchar_t* name) override
+        {
+            return SYSCALL (LoadLibraryW (name));
+        }
+        void* GetSymbol (void* module, const char* name) override
+        {
+            return reinterpret_cast<void*> (SYSCALL (GetProcAddress (static_cast<HMODULE> (module), name)));
+        }
+        void FreeModule (void* module) override
+        {
+            FreeLibrary (static_cast<HMODULE> (module));
+        }
+    };
 
     /// Wrapper for the few WinRT functions we need to use
     class WinRT
     {
-        bool modules_loaded = false;
-        HMODULE winrt = 0;
-        HMODULE winrt_string = 0;
+        static Win32ModuleLoader loader;
+        static const ModuleImport importList[];
+        enum { impRoActivateInstance, impWindowsCreateStringReference, numImports };
+        LazyImports imports;
 
         typedef HRESULT (STDAPICALLTYPE *pfnWindowsCreateStringReference)(
             PCWSTR sourceString, UINT32 length, HSTRING_HEADER* hstringHeader, HSTRING* string);
-        pfnWindowsCreateStringReference pWindowsCreateStringReference = nullptr;
         typedef HRESULT (WINAPI *pfnRoActivateInstance)(HSTRING activatableClassId, IInspectable** instance);
-        pfnRoActivateInstance pRoActivateInstance = nullptr;
     protected:
-        WinRT ()
+        WinRT () : imports (loader, importList, numImports)
         {}
-        ~WinRT ()
-        {
-            if (winrt) FreeLibrary (winrt);
-            if (winrt_string) FreeLibrary (winrt);
-        }
 
         static WinRT instance;
 
-        /// Load DLLs
-        bool init ()
-        {
-            if (!modules_loaded)
-            {
-                modules_loaded = true;
-                winrt = LoadLibraryW (L"api-ms-win-core-winrt-l1-1-0.dll");
-                if (winrt)
-                {
-                    pRoActivateInstance = reinterpret_cast<pfnRoActivateInstance> (
-                        GetProcAddress (winrt, "RoActivateInstance"));
-                }
-                winrt_string = LoadLibraryW (L"api-ms-win-core-winrt-string-l1-1-0.dll");
-                if (winrt_string)
-                {
-                    pWindowsCreateStringReference = reinterpret_cast<pfnWindowsCreateStringReference> (
-                        GetProcAddress (winrt_string, "WindowsCreateStringReference"));
-                }
-            }
-            return winrt && winrt_string;
-        }
-
         /// Wrap WindowsCreateStringReference
         inline HRESULT WindowsCreateStringReferenceImpl (PCWSTR sourceString, UINT32 length, HSTRING_HEADER* hstringHeader, HSTRING* string)
         {
-            if (!init () || !pWindowsCreateStringReference) return E_NOTIMPL;
+            auto pWindowsCreateStringReference = reinterpret_cast<pfnWindowsCreateStringReference> (
+                imports.Get (impWindowsCreateStringReference));
+            if (!pWindowsCreateStringReference) return E_NOTIMPL;
             return pWindowsCreateStringReference (sourceString, length, hstringHeader, string);
         }
         /// Wrap RoActivateInstance
         inline HRESULT RoActivateInstanceImpl (HSTRING activatableClassId, IInspectable** instance)
         {
-            if (!init () || !pRoActivateInstance) return E_NOTIMPL;
+            auto pRoActivateInstance = reinterpret_cast<pfnRoActivateInstance> (imports.Get (impRoActivateInstance));
+            if (!pRoActivateInstance) return E_NOTIMPL;
             return pRoActivateInstance (activatableClassId, instance);
         }
     public:
         /// Dynamically loaded WindowsCreateStringReference, if available
         static HRESULT WindowsCreateStringReference (PCWSTR sourceString, UINT32 length, HSTRING_HEADER* hstringHeader, HSTRING* string)
         {
-            return instance.WindowsCreateStringReferenceImpl (sourceString, length, hstringHeader, string);
+            return SYSCALL (instance.WindowsCreateStringReferenceImpl (sourceString, length, hstringHeader, string));
         }
         /// Dynamically loaded RoActivateInstance, if available
         static HRESULT RoActivateInstance (HSTRING activatableClassId, IInspectable** newInstance)
         {
-            return instance.RoActivateInstanceImpl (activatableClassId, newInstance);
+            return SYSCALL (instance.RoActivateInstanceImpl (activatableClassId, newInstance));
         }
     };
 
+    // Order matches the WinRT::imp* enum
+    const ModuleImport WinRT::importList[] = {
+        { L"api-ms-win-core-winrt-l1-1-0.dll", "RoActivateInstance" },
+        { L"api-ms-win-core-winrt-string-l1-1-0.dll", "WindowsCreateStringReference" }
+    };
+    Win32ModuleLoader WinRT::loader;
     WinRT WinRT::instance;
 
     /// Wrapper class for WinRT string reference
@@ -194,7 +191,7 @@ namespace
     {
         ComPtr<IInspectable> inspectable;
         CHECKED (WinRT::RoActivateInstance (classId, &inspectable));
-        return inspectable.As (&instance);
+        return SYSCALL (inspectable.As (&instance));
     }
 
     // RAII-ish wrapper for HKEYs
@@ -218,70 +215,116 @@ namespace
     };
 }
 
-static inline RGBA MakeRGBA (uint8_t R, uint8_t G, uint8_t B, uint8_t A)
+static inline RGBA ToRGBA (WindowsUI::Color color)
 {
-    return RGB (R, G, B) | (A << 24);
+    return MakeRGBA (color.R, color.G, color.B, color.A);
 }
 
-static inline RGBA MakeOpaque (RGBA base)
+#if defined(____x_ABI_CWindows_CUI_CViewManagement_CIUISettings3_INTERFACE_DEFINED__)
+typedef ComPtr<WindowsUI::ViewManagement::IUISettings3> UISettingsPtr;
+typedef PerApartmentCache<UISettingsPtr> UISettingsCache;
+
+static HRESULT ActivateUISettings (UISettingsPtr& settings3)
 {
-    return base | 0xff000000;
+    HStringRef classId;
+    CHECKED(classId.Set (L"Windows.UI.ViewManagement.UISettings"));
+    ComPtr<WindowsUI::ViewManagement::IUISettings> settings;
+    CHECKED (ActivateInstance (classId, settings));
+
+    CHECKED(SYSCALL (settings.As (&settings3)));
+    if (!settings3) return E_FAIL;
+    return S_OK;
 }
 
-static inline uint8_t GetAValue (RGBA rgba)
+static UISettingsCache& GetUISettingsCache ()
 {
-    return (rgba >> 24) & 0xff;
+    /* Intentionally leaked: releasing the cached objects during static
+     * destruction would happen after COM was shut down. */
+    static UISettingsCache* cache = new UISettingsCache (&ActivateUISettings);
+    return *cache;
 }
 
-static RGBA BlendRGBA (RGBA a, RGBA b, float f)
+/// Get UISettings object for calling apartment, activating it on first use.
+static HRESULT GetUISettings (UISettingsPtr& settings3)
 {
-  float a_factor = 1.f - f;
-  float b_factor = f;
-  BYTE alpha_a = GetAValue (a);
-  BYTE alpha_b = GetAValue (b);
-  return MakeRGBA (static_cast<int> (GetRValue (a) * a_factor + GetRValue (b) * b_factor),
-                   static_cast<int> (GetGValue (a) * a_factor + GetGValue (b) * b_factor),
-                   static_cast<int> (GetBValue (a) * a_factor + GetBValue (b) * b_factor),
-                   static_cast<int> (alpha_a * a_factor + alpha_b * b_factor));
+    ULONG_PTR token;
+    // Fails if COM isn't initialized; let activation report the error then
+    if (FAILED (SYSCALL (CoGetContextToken (&token))))
+        return ActivateUISettings (settings3);
+    return GetUISettingsCache ().Get (token, settings3);
 }
 
-static inline RGBA ToRGBA (WindowsUI::Color color)
+/// Drop a UISettings object that turned out to be stale for the calling apartment.
+static void DiscardUISettings (const UISettingsPtr& settings3)
 {
-    return MakeRGBA (color.R, color.G, color.B, color.A);
+    ULONG_PTR token;
+    if (SUCCEEDED (CoGetContextToken (&token)))
+        GetUISettingsCache ().Discard (token, settings3);
 }
 
-static HRESULT GetAccentColor_win10 (AccentColor& color)
+static HRESULT QueryAccentShades (const UISettingsPtr& settings3, AccentColor& color, unsigned int shades)
 {
-    HStringRef classId;
-    CHECKED(classId.Set (L"Windows.UI.ViewManagement.UISettings"));
-    ComPtr<WindowsUI::ViewManagement::IUISettings> settings;
-    CHECKED (ActivateInstance (classId, settings));
+    static const struct
+    {
+        unsigned int shade;
+        WindowsUI::ViewManagement::UIColorType type;
+        RGBA AccentColor::* member;
+    } shadeTypes[] = {
+        { shadeDarkest, WindowsUI::ViewManagement::UIColorType_AccentDark3, &AccentColor::darkest },
+        { shadeDarker, WindowsUI::ViewManagement::UIColorType_AccentDark2, &AccentColor::darker },
+        { shadeDark, WindowsUI::ViewManagement::UIColorType_AccentDark1, &AccentColor::dark },
+        { shadeAccent, WindowsUI::ViewManagement::UIColorType_Accent, &AccentColor::accent },
+        { shadeLight, WindowsUI::ViewManagement::UIColorType_AccentLight1, &AccentColor::light },
+        { shadeLighter, WindowsUI::ViewManagement::UIColorType_AccentLight2, &AccentColor::lighter },
+        { shadeLightest, WindowsUI::ViewManagement::UIColorType_AccentLight3, &AccentColor::lightest },
+    };
+    WindowsUI::Color ui_color;
+    for (const auto& shadeType : shadeTypes)
+    {
+        if ((shades & shadeType.shade) == 0) continue;
+        CHECKED(SYSCALL (settings3->GetColorValue (shadeType.type, &ui_color)));
+        color.*shadeType.member = ToRGBA (ui_color);
+    }
+    return S_OK;
+}
+#endif
 
+static HRESULT GetAccentColor_win10 (AccentColor& color, unsigned int shades)
+{
 #if !defined(____x_ABI_CWindows_CUI_CViewManagement_CIUISettings3_INTERFACE_DEFINED__)
     #pragma message("WARNING: Windows 10 SDK not present. GetWindows10AccentColor() will always fail at run time.")
     return E_NOTIMPL;
 #else
-    ComPtr<WindowsUI::ViewManagement::IUISettings3> settings3;
-    CHECKED(settings.As (&settings3));
-    if (!settings3) return E_FAIL;
+    CapabilityCache& capabilities = GetCapabilityCache ();
+    if (!capabilities.ShouldTry (capWinRT) || !capabilities.ShouldTry (capUISettings3))
+        return E_NOTIMPL;
+    // IUISettings3 was introduced with Windows 10
+    if (!IsOSVersionAtLeast (GetOSVersion (), 10, 0))
+    {
+        capabilities.RecordResult (capUISettings3, E_NOTIMPL);
+        return E_NOTIMPL;
+    }
 
-    WindowsUI::Color ui_color;
-    CHECKED(settings3->GetColorValue (WindowsUI::ViewManagement::UIColorType_AccentDark3, &ui_color));
-    color.darkest = ToRGBA (ui_color);
-    CHECKED(settings3->GetColorValue (WindowsUI::ViewManagement::UIColorType_AccentDark2, &ui_color));
-    color.darker = ToRGBA (ui_color);
-    CHECKED(settings3->GetColorValue (WindowsUI::ViewManagement::UIColorType_AccentDark1, &ui_color));
-    color.dark = ToRGBA (ui_color);
-    CHECKED(settings3->GetColorValue (WindowsUI::ViewManagement::UIColorType_Accent, &ui_color));
-    color.accent = ToRGBA (ui_color);
-    CHECKED(settings3->GetColorValue (WindowsUI::ViewManagement::UIColorType_AccentLight1, &ui_color));
-    color.light = ToRGBA (ui_color);
-    CHECKED(settings3->GetColorValue (WindowsUI::ViewManagement::UIColorType_AccentLight2, &ui_color));
-    color.lighter = ToRGBA (ui_color);
-    CHECKED(settings3->GetColorValue (WindowsUI::ViewManagement::UIColorType_AccentLight3, &ui_color));
-    color.lightest = ToRGBA (ui_color);
+    UISettingsPtr settings3;
+    HRESULT hr = GetUISettings (settings3);
+    if (FAILED (hr))
+    {
+        // E_NOTIMPL means the WinRT functions could not be loaded
+        capabilities.RecordResult (hr == E_NOTIMPL ? capWinRT : capUISettings3, hr);
+        return hr;
+    }
 
-    return S_OK;
+    hr = QueryAccentShades (settings3, color, shades);
+    if (IsApartmentGoneError (hr))
+    {
+        /* Object is left over from a torn down apartment whose context token
+         * got reused: replace it and try again. */
+        DiscardUISettings (settings3);
+        settings3.Reset ();
+        hr = GetUISettings (settings3);
+        if (SUCCEEDED (hr)) hr = QueryAccentShades (settings3, color, shades);
+    }
+    return hr;
 #endif
 }
 
@@ -290,7 +333,7 @@ static LONG QueryFromDWORD (HKEY key, const wchar_t* value, T& dest)
 {
     DWORD v = 0;
     DWORD dataSize = sizeof (v);
-    LONG result = RegGetValueW (key, nullptr, value, RRF_RT_REG_DWORD, nullptr, &v, &dataSize);
+    LONG result = SYSCALL (RegGetValueW (key, nullptr, value, RRF_RT_REG_DWORD, nullptr, &v, &dataSize));
     if (result == ERROR_SUCCESS)
     {
         dest = static_cast<T> (v);
@@ -298,209 +341,181 @@ static LONG QueryFromDWORD (HKEY key, const wchar_t* value, T& dest)
     return result;
 }
 
-struct DwmColors
-{
-    RGBA ColorizationColor;
-    int ColorizationColorBalance;
-    bool haveAccentColor;
-    RGBA AccentColor;
-};
-
-/* Obtain DWM colors from Registry, via undocumented keys.
-   Although there's also an API to get these, it's undocumented as well... */
-static HRESULT GetDwmColors (DwmColors& colors)
+RegistrySettingsStore::RegistrySettingsStore (HKEY root) : root (root), stopEvent (NULL)
 {
-    HRESULT hr;
-    if (!IsWindows8OrGreater ())
+    for (size_t i = 0; i < numKeys; i++)
     {
-        BOOL dwmEnabled;
-        hr = DwmIsCompositionEnabled (&dwmEnabled);
-        if (SUCCEEDED (hr) && !dwmEnabled)
-            return E_FAIL;
+        watchKeys[i] = NULL;
+        watchEvents[i] = NULL;
     }
+}
+
+RegistrySettingsStore::~RegistrySettingsStore ()
+{
+    CloseWatch ();
+}
 
-    HKEYWrapper keyDWM;
-    LONG result = RegOpenKeyExW (HKEY_CURRENT_USER, L"SOFTWARE\\Microsoft\\Windows\\DWM", 0, KEY_READ, &keyDWM);
+HRESULT RegistrySettingsStore::QueryValues (SettingsKey key, size_t count, const wchar_t* const* names,
+                                            uint32_t* values, HRESULT* results)
+{
+    HKEYWrapper hkey;
+    LONG result = SYSCALL (RegOpenKeyExW (root, GetSettingsKeyPath (key), 0, KEY_READ, &hkey));
     if (result != ERROR_SUCCESS) return HRESULT_FROM_WIN32 (result);
 
-    hr = S_OK;
-    DWORD c;
-    result = QueryFromDWORD (keyDWM, L"ColorizationColor", c);
-    if (result == ERROR_SUCCESS)
-    {
-        // Stored in the registry as BGRA
-        colors.ColorizationColor =
-            MakeRGBA ((c >> 16) & 0xff, (c >> 8) & 0xff, c & 0xff, (c >> 24) & 0xff);
-    }
-    else
+    for (size_t i = 0; i < count; i++)
     {
-        hr = HRESULT_FROM_WIN32 (result);
+        DWORD v;
+        result = QueryFromDWORD (hkey, names[i], v);
+        if (result == ERROR_SUCCESS) values[i] = v;
+        results[i] = HRESULT_FROM_WIN32 (result);
     }
-    result = QueryFromDWORD (keyDWM, L"ColorizationColorBalance", colors.ColorizationColorBalance);
-    if (result != ERROR_SUCCESS) hr = HRESULT_FROM_WIN32 (result);
-
-    result = QueryFromDWORD (keyDWM, L"AccentColor", colors.AccentColor);
-    colors.haveAccentColor = result == ERROR_SUCCESS;
-
-    return hr;
+    return S_OK;
 }
 
-static bool IsHighContrast ()
+HRESULT RegistrySettingsStore::ArmWatch (size_t index)
 {
-    HIGHCONTRAST hc = { sizeof (HIGHCONTRAST) };
-    return SystemParametersInfo (SPI_GETHIGHCONTRAST, sizeof (HIGHCONTRAST), &hc, 0)
-        && ((hc.dwFlags & HCF_HIGHCONTRASTON) != 0);
+    LONG result = SYSCALL (RegNotifyChangeKeyValue (watchKeys[index], FALSE, REG_NOTIFY_CHANGE_LAST_SET,
+                                                    watchEvents[index], TRUE));
+    return HRESULT_FROM_WIN32 (result);
 }
 
-namespace
+void RegistrySettingsStore::CloseWatch ()
 {
-    // HSV color space helper functions
-    struct HSV
+    for (size_t i = 0; i < numKeys; i++)
     {
-        int H, S, V;
-    };
+        if (watchKeys[i]) RegCloseKey (watchKeys[i]);
+        watchKeys[i] = NULL;
+        if (watchEvents[i]) CloseHandle (watchEvents[i]);
+        watchEvents[i] = NULL;
+    }
+    if (stopEvent) CloseHandle (stopEvent);
+    stopEvent = NULL;
+}
 
-    static HSV RGBtoHSV (RGBA color)
-    {
-        HSV result;
+HRESULT RegistrySettingsStore::StartWatching ()
+{
+    CloseWatch ();
+    stopEvent = CreateEventW (nullptr, TRUE, FALSE, nullptr);
+    if (!stopEvent) return HRESULT_FROM_WIN32 (GetLastError ());
 
-        // Compute color as HSV. Use range [0..0x8000]
-        int R = (GetRValue (color) * 0x8000) / 255;
-        int G = (GetGValue (color) * 0x8000) / 255;
-        int B = (GetBValue (color) * 0x8000) / 255;
-        int maxComp = std::max (R, std::max (G, B));
-        int minComp = std::min (R, std::min (G, B));
-        int minMaxDiff = maxComp - minComp;
-        result.H = 0;
-        if (minMaxDiff != 0)
+    for (size_t i = 0; i < numKeys; i++)
+    {
+        LONG result = SYSCALL (RegOpenKeyExW (root, GetSettingsKeyPath (static_cast<SettingsKey> (i)), 0, KEY_NOTIFY,
+                                              &watchKeys[i]));
+        // A key that doesn't exist can't be watched; keep watching the others
+        if (result != ERROR_SUCCESS)
         {
-            if (maxComp == R)
-            {
-                result.H = (((G - B) * 0x8000) / minMaxDiff);
-                if (result.H < 0) result.H += (6 * 0x8000);
-            }
-            else if (maxComp == G)
-            {
-                result.H = (((B - R) * 0x8000) / minMaxDiff) + (2 * 0x8000);
-            }
-            else
-            {
-                result.H = (((R - G) * 0x8000) / minMaxDiff) + (4 * 0x8000);
-            }
+            watchKeys[i] = NULL;
+            continue;
+        }
+        watchEvents[i] = CreateEventW (nullptr, FALSE, FALSE, nullptr);
+        HRESULT hr = watchEvents[i] ? ArmWatch (i) : HRESULT_FROM_WIN32 (GetLastError ());
+        if (FAILED (hr))
+        {
+            CloseWatch ();
+            return hr;
         }
-        result.V = maxComp;
-        result.S = result.V != 0 ? (minMaxDiff * 0x8000) / result.V : 0;
-        return result;
     }
+    return S_OK;
+}
 
-    static HSV Lighter (const HSV& prev, const HSV& base)
+HRESULT RegistrySettingsStore::WaitForChange ()
+{
+    if (!stopEvent) return E_FAIL;
+
+    // Stop event comes first, so it takes precedence over changes
+    HANDLE handles[numKeys + 1];
+    size_t handleKeys[numKeys + 1];
+    DWORD numHandles = 0;
+    handles[numHandles++] = stopEvent;
+    for (size_t i = 0; i < numKeys; i++)
     {
-        HSV result = prev;
-
-        // Shade: 25% of V
-        // If V >= 70%, reduce sat to 75% rel
-        int Vstep = base.V / 4;
-
-        result.V = std::min (prev.V + Vstep, 0x8000);
-        result.S = (result.V >= 22937) ? ((prev.S * 192) >> 8) : prev.S;
-        return result;
+        if (!watchEvents[i]) continue;
+        handleKeys[numHandles] = i;
+        handles[numHandles++] = watchEvents[i];
     }
 
-    static HSV Darker (const HSV& prev, const HSV& base)
+    DWORD wait = WaitForMultipleObjects (numHandles, handles, FALSE, INFINITE);
+    if (wait == WAIT_OBJECT_0) return S_FALSE;
+    if ((wait > WAIT_OBJECT_0) && (wait < WAIT_OBJECT_0 + numHandles))
     {
-        HSV result = prev;
+        // Notifications are one-shot, so re-register
+        CHECKED (ArmWatch (handleKeys[wait - WAIT_OBJECT_0]));
+        return S_OK;
+    }
+    return HRESULT_FROM_WIN32 (GetLastError ());
+}
 
-        // Shade: 25% of V
-        int Vstep = base.V / 4;
+void RegistrySettingsStore::StopWaiting ()
+{
+    if (stopEvent) SetEvent (stopEvent);
+}
 
-        result.V = std::max (prev.V - Vstep, 0);
-        return result;
-    }
+SettingsStore& GetDefaultSettingsStore ()
+{
+    static RegistrySettingsStore store;
+    return store;
+}
 
-    static RGBA HSVtoRGB (const HSV& color, unsigned int alpha)
-    {
-        int R, G, B;
-        int chroma = (color.V * color.S) / 0x8000;
-        int second = (chroma * (0x8000 - abs (int (color.H % (2 * 0x8000) - 0x8000)))) / 0x8000;
-        switch (color.H / 0x8000)
-        {
-        case 0:
-            R = chroma;
-            G = second;
-            B = 0;
-            break;
-        case 1:
-            R = second;
-            G = chroma;
-            B = 0;
-            break;
-        case 2:
-            R = 0;
-            G = chroma;
-            B = second;
-            break;
-        case 3:
-            R = 0;
-            G = second;
-            B = chroma;
-            break;
-        case 4:
-            R = second;
-            G = 0;
-            B = chroma;
-            break;
-        case 5:
-            R = chroma;
-            G = 0;
-            B = second;
-            break;
-        }
-        int minComp = color.V - chroma;
-        return MakeRGBA (std::min (((R + minComp) * 255) / 0x8000, 255),
-                         std::min (((G + minComp) * 255) / 0x8000, 255),
-                         std::min (((B + minComp) * 255) / 0x8000, 255),
-                         alpha);
-    }
+// Query a single DWORD value from a settings store
+static HRESULT QueryValue (SettingsStore& store, SettingsKey key, const wchar_t* name, uint32_t& value)
+{
+    HRESULT result;
+    CHECKED (store.QueryValues (key, 1, &name, &value, &result));
+    return result;
 }
 
-static void GenerateAccentColors (RGBA base, AccentColor& color)
+// Returns whether DWM colors are unavailable due to disabled composition
+static bool IsDwmCompositionDisabled (const OSVersion& osVersion)
 {
-    color.accent = base;
+    // Composition can't be disabled on Windows 8 and above
+    if (IsOSVersionAtLeast (osVersion, 6, 2)) return false;
 
-    // Compute shades
-    HSV colorHSV = RGBtoHSV (base);
+    BOOL dwmEnabled;
+    HRESULT hr = SYSCALL (DwmIsCompositionEnabled (&dwmEnabled));
+    return SUCCEEDED (hr) && !dwmEnabled;
+}
+
+/* Obtain DWM colors from Registry, via undocumented keys.
+   Although there's also an API to get these, it's undocumented as well... */
+static HRESULT GetDwmColors (SettingsStore& store, DwmColors& colors)
+{
+    if (IsDwmCompositionDisabled (GetOSVersion ())) return E_FAIL;
 
-    HSV light = Lighter (colorHSV, colorHSV);
-    color.light = HSVtoRGB (light, GetAValue (base));
-    light = Lighter (light, colorHSV);
-    color.lighter = HSVtoRGB (light, GetAValue (base));
-    light = Lighter (light, colorHSV);
-    color.lightest = HSVtoRGB (light, GetAValue (base));
+    ThemeSnapshot snapshot = ThemeSnapshot ();
+    ReadDwmSettings (store, snapshot);
+    colors = snapshot.dwmColors;
+    return snapshot.dwmResult;
+}
 
-    HSV dark = Darker (colorHSV, colorHSV);
-    color.dark = HSVtoRGB (dark, GetAValue (base));
-    dark = Darker (dark, colorHSV);
-    color.darker = HSVtoRGB (dark, GetAValue (base));
-    dark = Darker (dark, colorHSV);
-    color.darkest = HSVtoRGB (dark, GetAValue (base));
+static bool IsHighContrast ()
+{
+    HIGHCONTRAST hc = { sizeof (HIGHCONTRAST) };
+    return SYSCALL (SystemParametersInfo (SPI_GETHIGHCONTRAST, sizeof (HIGHCONTRAST), &hc, 0))
+        && ((hc.dwFlags & HCF_HIGHCONTRASTON) != 0);
 }
 
 static HRESULT GetAccentColor_dwm (RGBA& color)
 {
     DwmColors dwmColor;
-    CHECKED (GetDwmColors (dwmColor));
+    CHECKED (GetDwmColors (GetDefaultSettingsStore (), dwmColor));
 
     // Compose color against background
     color =
         BlendRGBA (0xffffffff, MakeOpaque (dwmColor.ColorizationColor),
-                   GetAValue (dwmColor.ColorizationColor) / 255.0f);
+                   GetAlpha (dwmColor.ColorizationColor) / 255.0f);
     return S_OK;
 }
 
 HRESULT GetAccentColor (AccentColor& color)
+{
+    return GetAccentColor (color, shadeAll);
+}
+
+HRESULT GetAccentColor (AccentColor& color, unsigned int shades)
 {
     HRESULT hr;
-    hr = GetAccentColor_win10 (color);
+    hr = GetAccentColor_win10 (color, shades);
     if (SUCCEEDED (hr)) return hr;
 
     bool highContrast = IsHighContrast ();
@@ -510,7 +525,7 @@ HRESULT GetAccentColor (AccentColor& color)
         hr = GetAccentColor_dwm (colorizationComposed);
         if (SUCCEEDED (hr))
         {
-            GenerateAccentColors (colorizationComposed, color);
+            GenerateAccentColors (colorizationComposed, color, shades);
             return S_ACCENT_COLOR_GUESSED;
         }
     }
@@ -518,61 +533,43 @@ HRESULT GetAccentColor (AccentColor& color)
     if (highContrast)
     {
         // Windows 10 High Contrast mode uses the same color for all shades
-        color.accent =
-        color.light =
-        color.lighter =
-        color.lightest =
-        color.dark =
-        color.darker =
-        color.darkest = MakeOpaque (GetSysColor (COLOR_HIGHLIGHT));
+        RGBA highlight = MakeOpaque (SYSCALL (GetSysColor (COLOR_HIGHLIGHT)));
+        if (shades & shadeAccent) color.accent = highlight;
+        if (shades & shadeLight) color.light = highlight;
+        if (shades & shadeLighter) color.lighter = highlight;
+        if (shades & shadeLightest) color.lightest = highlight;
+        if (shades & shadeDark) color.dark = highlight;
+        if (shades & shadeDarker) color.darker = highlight;
+        if (shades & shadeDarkest) color.darkest = highlight;
     }
     else
     {
-        GenerateAccentColors (MakeOpaque (GetSysColor (COLOR_ACTIVECAPTION)), color);
+        GenerateAccentColors (MakeOpaque (SYSCALL (GetSysColor (COLOR_ACTIVECAPTION))), color, shades);
     }
     return S_ACCENT_COLOR_GUESSED;
 }
 
-static HRESULT GetSystemFrameColors (FrameColors& color)
+static SystemColors GetSystemColors ()
 {
-    color.activeCaptionBG = MakeOpaque (GetSysColor (COLOR_ACTIVECAPTION));
-    color.activeCaptionText = MakeOpaque (GetSysColor (COLOR_CAPTIONTEXT));
-    color.activeFrame = MakeOpaque (GetSysColor (COLOR_CAPTIONTEXT));
-    color.inactiveCaptionBG = MakeOpaque (GetSysColor (COLOR_INACTIVECAPTION));
-    RGBA rawInactiveCaptionText = MakeOpaque (GetSysColor (COLOR_INACTIVECAPTIONTEXT));
-    color.inactiveFrame = MakeOpaque (GetSysColor (COLOR_INACTIVECAPTIONTEXT));
-    color.inactiveCaptionText = BlendRGBA (rawInactiveCaptionText, color.inactiveCaptionBG, 0.6f);
-
-    return S_OK;
+    SystemColors colors;
+    colors.activeCaption = SYSCALL (GetSysColor (COLOR_ACTIVECAPTION));
+    colors.captionText = SYSCALL (GetSysColor (COLOR_CAPTIONTEXT));
+    colors.inactiveCaption = SYSCALL (GetSysColor (COLOR_INACTIVECAPTION));
+    colors.inactiveCaptionText = SYSCALL (GetSysColor (COLOR_INACTIVECAPTIONTEXT));
+    colors.highlight = SYSCALL (GetSysColor (COLOR_HIGHLIGHT));
+    return colors;
 }
 
-// Returns whether title bars are colored with the accent color (Windows 10)
-static bool ColoredTitleBars ()
+/* Returns whether title bars are colored with the accent color (Windows 10).
+ * dwmSettings are the settings already read from the DWM key. */
+static bool ColoredTitleBars (SettingsStore& store, const ThemeSnapshot& dwmSettings)
 {
     // Key on Windows 10 version 1607
-    {
-        HKEYWrapper keyDWM;
-        LONG result = RegOpenKeyExW (HKEY_CURRENT_USER, L"SOFTWARE\\Microsoft\\Windows\\DWM",
-                                     0, KEY_READ, &keyDWM);
-        if (result == ERROR_SUCCESS)
-        {
-            DWORD prevalenceFlag = 0;
-            if (QueryFromDWORD (keyDWM, L"ColorPrevalence", prevalenceFlag) == ERROR_SUCCESS)
-                return prevalenceFlag != 0;
-        }
-    }
+    if (dwmSettings.haveDwmColorPrevalence) return dwmSettings.dwmColorPrevalence;
     // Key on Windows 10 version 1511. After 1607 this is the start/taskbar colorization only
-    {
-        HKEYWrapper keyPersonalize;
-        LONG result = RegOpenKeyExW (HKEY_CURRENT_USER, L"SOFTWARE\\Microsoft\\Windows\\CurrentVersion\\Themes\\Personalize",
-                                     0, KEY_READ, &keyPersonalize);
-        if (result == ERROR_SUCCESS)
-        {
-            DWORD prevalenceFlag = 0;
-            if (QueryFromDWORD (keyPersonalize, L"ColorPrevalence", prevalenceFlag) == ERROR_SUCCESS)
-                return prevalenceFlag != 0;
-        }
-    }
+    uint32_t prevalenceFlag = 0;
+    if (SUCCEEDED (QueryValue (store, SettingsKey::Personalize, L"ColorPrevalence", prevalenceFlag)))
+        return prevalenceFlag != 0;
     return false;
 }
 
@@ -581,7 +578,7 @@ static HRESULT GetAccentColorOnly (RGBA& color)
 {
     AccentColor ac;
     HRESULT hr;
-    hr = GetAccentColor_win10 (ac);
+    hr = GetAccentColor_win10 (ac, shadeAccent);
     if (SUCCEEDED (hr))
     {
         color = ac.accent;
@@ -594,185 +591,456 @@ static HRESULT GetAccentColorOnly (RGBA& color)
         return S_ACCENT_COLOR_GUESSED;
     }
 
-    color = GetSysColor (COLOR_ACTIVECAPTION);
+    color = SYSCALL (GetSysColor (COLOR_ACTIVECAPTION));
     return S_ACCENT_COLOR_GUESSED;
 }
 
-static bool ResolveDarkMode (DarkMode darkMode)
+/* Gather inputs for ComputeFrameColors().
+ * Only values actually needed for the given options and dark mode are obtained. */
+static void GatherThemeInputs (ThemeInputs& inputs, unsigned int options, DarkMode darkMode)
 {
-    bool isDarkMode;
-    if (darkMode == DarkMode::Auto)
+    SettingsStore& store = GetDefaultSettingsStore ();
+    inputs = ThemeInputs ();
+    inputs.highContrast = IsHighContrast ();
+    if (inputs.highContrast)
+    {
+        inputs.sysColors = GetSystemColors ();
+        return;
+    }
+
+    inputs.osVersion = GetOSVersion ();
+    // Read the DWM key once, for both the DWM colors and the ColorPrevalence flag
+    ThemeSnapshot dwmSettings = ThemeSnapshot ();
+    ReadDwmSettings (store, dwmSettings);
+    bool isWin10 = IsOSVersionAtLeast (inputs.osVersion, 10, 0);
+    bool glassEffect = (options & fcGlassEffect) != 0;
+    if (isWin10 && ((options & fcTitleBarsColored) == 0) && !glassEffect)
     {
-        /* Although the Dark Mode Apps setting was introduced in Win10 1809,
-         * only in 1903 the Explorer as a Win32 app started to consider it.
-         * Go with that. */
-        darkMode = IsWindows10_1903OrGreater () ? DarkMode::User : DarkMode::Light;
+        inputs.coloredTitleBars = ColoredTitleBars (store, dwmSettings);
     }
-    if (darkMode == DarkMode::User)
+
+    inputs.haveDwmColors = SUCCEEDED (dwmSettings.dwmResult) && !IsDwmCompositionDisabled (inputs.osVersion);
+    inputs.dwmColors = dwmSettings.dwmColors;
+    if (!inputs.haveDwmColors || !inputs.dwmColors.haveAccentColor)
     {
-        GetAppDarkModeEnabled (isDarkMode);
+        GetAccentColorOnly (inputs.accent);
     }
-    else
+
+    bool userDarkMode = (darkMode == DarkMode::User)
+        || ((darkMode == DarkMode::Auto) && IsOSVersionAtLeast (inputs.osVersion, 10, 0, 18362));
+    if (userDarkMode)
     {
-        isDarkMode = darkMode == DarkMode::Dark;
+        GetAppDarkModeEnabled (store, inputs.appsDarkMode);
     }
-    return isDarkMode;
 }
 
-static HRESULT GetAccentedFrameColors (FrameColors& color, unsigned int options, DarkMode darkMode)
+HRESULT GetThemeInputs (ThemeInputs& inputs)
 {
-    bool isWin10 = IsWindows10OrGreater ();
-    bool glassEffect = (options & fcGlassEffect) != 0;
-    bool useAccentColor = !isWin10 || ((options & fcTitleBarsColored) != 0)
-        || (!glassEffect && ColoredTitleBars());
+    ThemeSnapshot snapshot;
+    CHECKED (CaptureThemeSnapshot (snapshot));
+    inputs = GetThemeInputs (snapshot);
+    return S_OK;
+}
 
-    DwmColors dwmColors;
-    bool haveDwmColors = SUCCEEDED (GetDwmColors(dwmColors));
+HRESULT GetFrameColors (FrameColors& color, unsigned int options, DarkMode darkMode)
+{
+    ThemeInputs inputs;
+    GatherThemeInputs (inputs, options, darkMode);
+    color = ComputeFrameColors (inputs, options, darkMode);
+    return S_OK;
+}
 
-    RGBA accent;
-    if (haveDwmColors && dwmColors.haveAccentColor)
+HRESULT GetAllFrameColorVariants (FrameColorVariants& variants)
+{
+    ThemeSnapshot snapshot;
+    CHECKED (CaptureThemeSnapshot (snapshot));
+    return GetAllFrameColorVariants (snapshot, variants);
+}
+
+static HRESULT GetThemePersonalizeFlag (SettingsStore& store, bool& resultFlag, const wchar_t* key)
+{
+    uint32_t flag;
+    CHECKED (QueryValue (store, SettingsKey::Personalize, key, flag));
+
+    resultFlag = flag != 0;
+    return S_OK;
+}
+
+static HRESULT GetAppDarkModeEnabled (SettingsStore& store, bool& darkMode)
+{
+    bool appsLight = true; // Default: light mode
+    HRESULT hr = GetThemePersonalizeFlag (store, appsLight, L"AppsUseLightTheme");
+    darkMode = !appsLight;
+    return hr;
+}
+
+HRESULT GetAppDarkModeEnabled (bool& darkMode)
+{
+    return GetAppDarkModeEnabled (GetDefaultSettingsStore (), darkMode);
+}
+
+HRESULT GetSysPartsDarkModeEnabled (bool& darkMode)
+{
+    bool sysLight = true; // Default: light mode
+    HRESULT hr = GetThemePersonalizeFlag (GetDefaultSettingsStore (), sysLight, L"SystemUsesLightTheme");
+    darkMode = !sysLight;
+    return hr;
+}
+
+HRESULT GetSysPartsMode (SysPartsMode& mode)
+{
+    mode = SysPartsMode::Dark;
+
+    bool themedSysParts = false;
+    HRESULT hr = GetThemePersonalizeFlag(GetDefaultSettingsStore (), themedSysParts, L"ColorPrevalence");
+    if(SUCCEEDED(hr) && themedSysParts)
     {
-        /* Prefer AccentColor from registry, if present, as that typically matches the actual
-         * title bar color */
-        accent = dwmColors.AccentColor;
+        mode = SysPartsMode::AccentColor;
+        return hr;
     }
-    else
+
+    bool sysDarkMode;
+    hr = GetSysPartsDarkModeEnabled(sysDarkMode);
+    if(SUCCEEDED(hr))
+        mode = sysDarkMode ? SysPartsMode::Dark : SysPartsMode::Light;
+    return hr;
+}
+
+// Capture the settings that are the same for all users
+static void CaptureSystemSettings (ThemeSnapshot& snapshot)
+{
+    snapshot.osVersion = GetOSVersion ();
+    snapshot.highContrast = IsHighContrast ();
+    snapshot.sysColors = GetSystemColors ();
+}
+
+HRESULT CaptureThemeSnapshot (ThemeSnapshot& snapshot)
+{
+    unsigned long startCalls = systemCallCount;
+
+    snapshot = ThemeSnapshot ();
+    CaptureSystemSettings (snapshot);
+    snapshot.uiSettingsResult = GetAccentColor_win10 (snapshot.uiSettingsAccent, shadeAll);
+
+    ReadThemeSettings (GetDefaultSettingsStore (), snapshot);
+    if (SUCCEEDED (snapshot.dwmResult) && IsDwmCompositionDisabled (snapshot.osVersion))
+        snapshot.dwmResult = E_FAIL;
+
+    snapshot.systemCalls = systemCallCount - startCalls;
+    return S_OK;
+}
+
+HRESULT CaptureThemeSnapshot (HKEY userRoot, ThemeSnapshot& snapshot)
+{
+    unsigned long startCalls = systemCallCount;
+
+    ThemeSnapshot system = ThemeSnapshot ();
+    CaptureSystemSettings (system);
+    RegistrySettingsStore store (userRoot);
+    CHECKED (CaptureProfileSnapshot (store, system, snapshot));
+    if (SUCCEEDED (snapshot.dwmResult) && IsDwmCompositionDisabled (snapshot.osVersion))
+        snapshot.dwmResult = E_FAIL;
+
+    snapshot.systemCalls = systemCallCount - startCalls;
+    return S_OK;
+}
+
+HRESULT EvaluateUserProfiles (size_t count, const wchar_t* const* sids, ProfileColors* colors,
+                              unsigned int options, DarkMode darkMode, unsigned int threads)
+{
+    // Settings that are the same for all users only need to be captured once
+    ThemeSnapshot system = ThemeSnapshot ();
+    CaptureSystemSettings (system);
+    bool compositionDisabled = IsDwmCompositionDisabled (system.osVersion);
+
+    auto capture = [&](size_t index, ThemeSnapshot& snapshot) -> HRESULT
     {
-        CHECKED (GetAccentColorOnly (accent));
-    }
+        HKEYWrapper userRoot;
+        LONG result = SYSCALL (RegOpenKeyExW (HKEY_USERS, sids[index], 0, KEY_READ, &userRoot));
+        if (result != ERROR_SUCCESS) return HRESULT_FROM_WIN32 (result);
+
+        RegistrySettingsStore store (userRoot);
+        CHECKED (CaptureProfileSnapshot (store, system, snapshot));
+        if (SUCCEEDED (snapshot.dwmResult) && compositionDisabled) snapshot.dwmResult = E_FAIL;
+        return S_OK;
+    };
+    return EvaluateProfiles (count, capture, colors, options, darkMode, threads);
+}
+
+namespace
+{
+    /// Warm cache file state
+    struct WarmCache
+    {
+        std::mutex mutex;
+        /// Path of cache file. Empty if warm cache is not enabled.
+        std::wstring path;
+        /// Whether \c saved is valid
+        bool haveSaved = false;
+        /// Snapshot stored in cache file
+        ThemeSnapshot saved;
+        /// Background verification of the loaded snapshot
+        std::future<void> verification;
+    };
 
-    bool isDarkMode = ResolveDarkMode (darkMode);
-    if (useAccentColor)
+    static WarmCache& GetWarmCache ()
     {
-        color.activeCaptionBG = accent;
+        static WarmCache warmCache;
+        return warmCache;
     }
+}
+
+static HRESULT ReadFileContents (const wchar_t* path, std::vector<unsigned char>& data)
+{
+    HANDLE file = SYSCALL (CreateFileW (path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+                                        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr));
+    if (file == INVALID_HANDLE_VALUE) return HRESULT_FROM_WIN32 (GetLastError ());
+
+    HRESULT hr = S_OK;
+    LARGE_INTEGER size;
+    DWORD bytesRead = 0;
+    if (!SYSCALL (GetFileSizeEx (file, &size)))
+        hr = HRESULT_FROM_WIN32 (GetLastError ());
+    else if (size.QuadPart > 0x10000) // Way larger than any valid cache file
+        hr = HRESULT_FROM_WIN32 (ERROR_INVALID_DATA);
     else
     {
-        color.activeCaptionBG = isDarkMode ? 0xff000000 : 0xffffffff;
+        data.resize (static_cast<size_t> (size.QuadPart));
+        if (!SYSCALL (ReadFile (file, data.data (), static_cast<DWORD> (data.size ()), &bytesRead, nullptr)))
+            hr = HRESULT_FROM_WIN32 (GetLastError ());
+        data.resize (bytesRead);
     }
+    CloseHandle (file);
+    return hr;
+}
 
-    auto DefaultCaptionText =
-        [](RGBA bg)
-        {
-            bool textIsBright = IsColorDark (bg);
-            return textIsBright ? 0xffffffff : 0xff000000; // Colors seem static
-        };
+// Write a file by writing a temporary file first, then replacing the actual file
+static HRESULT WriteFileReplacing (const std::wstring& path, const std::vector<unsigned char>& data)
+{
+    std::wstring tempPath = path + L".tmp";
+    HANDLE file = SYSCALL (CreateFileW (tempPath.c_str (), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+                                        FILE_ATTRIBUTE_NORMAL, nullptr));
+    if (file == INVALID_HANDLE_VALUE) return HRESULT_FROM_WIN32 (GetLastError ());
 
-    color.activeCaptionText = DefaultCaptionText (color.activeCaptionBG);
+    HRESULT hr = S_OK;
+    DWORD written = 0;
+    if (!SYSCALL (WriteFile (file, data.data (), static_cast<DWORD> (data.size ()), &written, nullptr)))
+        hr = HRESULT_FROM_WIN32 (GetLastError ());
+    CloseHandle (file);
+    if (SUCCEEDED (hr) && !SYSCALL (MoveFileExW (tempPath.c_str (), path.c_str (), MOVEFILE_REPLACE_EXISTING)))
+        hr = HRESULT_FROM_WIN32 (GetLastError ());
+    if (FAILED (hr)) DeleteFileW (tempPath.c_str ());
+    return hr;
+}
 
-    if (glassEffect)
+// Save a captured snapshot to the warm cache file, if enabled and the settings changed
+static void SaveWarmCache (const ThemeSnapshot& snapshot)
+{
+    WarmCache& warmCache = GetWarmCache ();
+    std::lock_guard<std::mutex> lock (warmCache.mutex);
+    if (warmCache.path.empty ()) return;
+    if (warmCache.haveSaved && SameThemeSettings (warmCache.saved, snapshot)) return;
+
+    std::vector<unsigned char> data;
+    SerializeWarmCache (snapshot, data);
+    if (SUCCEEDED (WriteFileReplacing (warmCache.path, data)))
     {
-        color.activeFrame = color.activeCaptionBG;
+        warmCache.saved = snapshot;
+        warmCache.haveSaved = true;
     }
-    else if (IsWindows10_1809OrGreater () && !useAccentColor)
+}
+
+// Hooks for background threads capturing the theme state
+static ThreadHooks MakeCaptureThreadHooks ()
+{
+    ThreadHooks hooks;
+    // Capturing the theme state needs COM for the WinRT accent color
+    hooks.start = []() { return CoInitializeEx (nullptr, COINIT_MULTITHREADED); };
+    hooks.finish = []()
     {
-        /* After Windows 10, v1809 the frame color is controlled by the colored title bars option as well;
-         * it's not based on the DWM ColorizationColor if colored title bars are off */
-        color.activeFrame = 0xb2323232;
-    }
-    else
+        ReleaseApartmentResources ();
+        CoUninitialize ();
+    };
+    return hooks;
+}
+
+QueryService& GetQueryService ()
+{
+    static QueryService service (&CaptureThemeSnapshot, MakeCaptureThreadHooks ());
+    return service;
+}
+
+// Capture on the service thread, if it's running
+static HRESULT CaptureThemeSnapshotViaService (ThemeSnapshot& snapshot)
+{
+    QueryService& service = GetQueryService ();
+    if (service.IsRunning () && !service.IsServiceThread ())
     {
-        if (haveDwmColors)
-        {
-            const RGBA activeFrameBaseColor = 0xffd9d9d9;
-            // Frame color is based on DWM colors, though those usually coincide or are based on the accent color
-            if (dwmColors.ColorizationColorBalance >= 0)
-            {
-                color.activeFrame = BlendRGBA (activeFrameBaseColor,
-                                               MakeOpaque (dwmColors.ColorizationColor),
-                                               dwmColors.ColorizationColorBalance * 0.01f);
-            }
-            else
-            {
-                // Not sure, but matches observation
-                color.activeFrame = accent;
-            }
-        }
-        else
+        SnapshotResult result = service.Query ().get ();
+        if (result.result != E_ABORT)
         {
-            // Fallback
-            color.activeFrame = accent;
+            snapshot = result.snapshot;
+            return result.result;
         }
+        // Service was stopped in the meantime
     }
+    return CaptureThemeSnapshot (snapshot);
+}
 
-    color.inactiveCaptionBG = isDarkMode ? 0xff2b2b2b : 0xffffffff;
-    RGBA rawInactiveCaptionText = DefaultCaptionText (color.inactiveCaptionBG);
-    // inactive frame: Probably a 0.5 blend of 0xffaaaaaa and 0. Maybe 0xffaaaaaa is itself a blend.
-    color.inactiveFrame = 0x7f565656;
-    color.inactiveCaptionText = BlendRGBA (rawInactiveCaptionText, color.inactiveCaptionBG, isDarkMode ? 0.4f : 0.6f);
-    // dark mode goal: 0xffaaaaaa
+// Shared memory snapshot, set by SetSharedSnapshotMode(). Accessed atomically.
+static std::shared_ptr<SharedThemeSnapshot> sharedSnapshot;
 
+// Capture function of the theme cache, considering the shared snapshot
+static HRESULT CaptureCachedThemeSnapshot (ThemeSnapshot& snapshot)
+{
+    std::shared_ptr<SharedThemeSnapshot> shared = std::atomic_load (&sharedSnapshot);
+    if (shared && !shared->IsWritable () && SUCCEEDED (shared->Read (snapshot))) return S_OK;
+
+    CHECKED (CaptureThemeSnapshotViaService (snapshot));
+    if (shared && shared->IsWritable ()) shared->Write (snapshot);
+    SaveWarmCache (snapshot);
     return S_OK;
 }
 
-HRESULT GetFrameColors (FrameColors& color, unsigned int options, DarkMode darkMode)
+ThemeCache& GetThemeCache ()
 {
-    // High contrast colors -> use GetSysColors
-    bool use_sys_colors = IsHighContrast ();
-
-    if (!use_sys_colors)
-    {
-        HRESULT hr = GetAccentedFrameColors (color, options, darkMode);
-        if (SUCCEEDED (hr)) return hr;
-    }
+    // Construct the service first, so it outlives captures running on cache threads
+    GetQueryService ();
+    static ThemeCache cache (&CaptureCachedThemeSnapshot, MakeCaptureThreadHooks ());
+    return cache;
+}
 
-    return GetSystemFrameColors (color);
+// Snapshot of the settings that are cheap to query, to guess colors from
+static void CaptureQuickThemeSnapshot (ThemeSnapshot& snapshot)
+{
+    snapshot = ThemeSnapshot ();
+    CaptureSystemSettings (snapshot);
+    snapshot.uiSettingsResult = snapshot.dwmResult = E_PENDING;
+    snapshot.personalizeColorPrevalenceResult = snapshot.appsUseLightThemeResult =
+        snapshot.systemUsesLightThemeResult = E_PENDING;
 }
 
-static HRESULT GetThemePersonalizeFlag (bool& resultFlag, const wchar_t* key)
+/* Refresh the theme cache within a budget.
+ * Returns S_OK if the state is fresh, S_FALSE if it's the last known or a guessed state. */
+static HRESULT GetThemeStateWithin (std::chrono::milliseconds budget, ThemeState& state,
+                                    ThemeCache::RefreshCallback onComplete)
 {
-    HKEYWrapper keyPersonalize;
-    LONG result = RegOpenKeyExW (HKEY_CURRENT_USER, L"SOFTWARE\\Microsoft\\Windows\\CurrentVersion\\Themes\\Personalize", 0, KEY_READ, &keyPersonalize);
-    if (result != ERROR_SUCCESS) return HRESULT_FROM_WIN32 (result);
+    HRESULT hr = GetThemeCache ().RefreshWithin (budget, state, std::move (onComplete));
+    if (hr != E_PENDING) return hr;
 
-    HRESULT hr = S_OK;
-    DWORD flag;
-    result = QueryFromDWORD (keyPersonalize, key, flag);
-    if (result == ERROR_SUCCESS)
-    {
-        resultFlag = flag != 0;
-    }
-    else
+    ThemeSnapshot snapshot;
+    CaptureQuickThemeSnapshot (snapshot);
+    MakeThemeState (snapshot, state);
+    return S_FALSE;
+}
+
+HRESULT GetAccentColor (AccentColor& color, std::chrono::milliseconds budget, AccentColorCallback onComplete)
+{
+    ThemeCache::RefreshCallback refreshed;
+    if (onComplete)
     {
-        hr = HRESULT_FROM_WIN32 (result);
+        refreshed = [onComplete](const ThemeState& state) { onComplete (state.accentResult, state.accent); };
     }
 
-    return hr;
+    ThemeState state;
+    HRESULT hr = GetThemeStateWithin (budget, state, std::move (refreshed));
+    color = state.accent;
+    // Report guesses (and failures) as such, even if the state is fresh
+    if ((hr == S_OK) || (state.accentResult != S_OK)) return state.accentResult;
+    return S_COLOR_REFRESH_PENDING;
 }
 
-HRESULT GetAppDarkModeEnabled (bool& darkMode)
+HRESULT GetFrameColors (FrameColors& color, unsigned int options, DarkMode darkMode,
+                        std::chrono::milliseconds budget, FrameColorsCallback onComplete)
 {
-    bool appsLight = true; // Default: light mode
-    HRESULT hr = GetThemePersonalizeFlag (appsLight, L"AppsUseLightTheme");
-    darkMode = !appsLight;
-    return hr;
+    ThemeCache::RefreshCallback refreshed;
+    if (onComplete)
+    {
+        refreshed = [onComplete, options, darkMode](const ThemeState& state)
+        {
+            FrameColors refreshedColor;
+            HRESULT hr = GetFrameColors (state.snapshot, refreshedColor, options, darkMode);
+            onComplete (hr, refreshedColor);
+        };
+    }
+
+    ThemeState state;
+    HRESULT hr = GetThemeStateWithin (budget, state, std::move (refreshed));
+    HRESULT hrColors = GetFrameColors (state.snapshot, color, options, darkMode);
+    if ((hr == S_OK) || (hrColors != S_OK)) return hrColors;
+    return S_COLOR_REFRESH_PENDING;
 }
 
-HRESULT GetSysPartsDarkModeEnabled (bool& darkMode)
+HRESULT SetSharedSnapshotMode (SharedSnapshotMode mode, const char* name)
 {
-    bool sysLight = true; // Default: light mode
-    HRESULT hr = GetThemePersonalizeFlag (sysLight, L"SystemUsesLightTheme");
-    darkMode = !sysLight;
-    return hr;
+    std::shared_ptr<SharedThemeSnapshot> shared;
+    if (mode != SharedSnapshotMode::Off)
+    {
+        shared = std::make_shared<SharedThemeSnapshot> ();
+        CHECKED (mode == SharedSnapshotMode::Publish ? shared->Create (name) : shared->Open (name));
+    }
+    std::atomic_store (&sharedSnapshot, shared);
+    return GetThemeCache ().Invalidate ();
 }
 
-HRESULT GetSysPartsMode (SysPartsMode& mode)
+HRESULT EnableWarmCache (const wchar_t* path)
 {
-    mode = SysPartsMode::Dark;
+    /* Construct the cache first, so it's destroyed after the warm cache state,
+     * which waits for the verification to finish */
+    ThemeCache& cache = GetThemeCache ();
+    WarmCache& warmCache = GetWarmCache ();
 
-    bool themedSysParts = false;
-    HRESULT hr = GetThemePersonalizeFlag(themedSysParts, L"ColorPrevalence");
-    if(SUCCEEDED(hr) && themedSysParts)
+    ThemeSnapshot snapshot;
+    HRESULT hr;
     {
-        mode = SysPartsMode::AccentColor;
-        return hr;
+        std::lock_guard<std::mutex> lock (warmCache.mutex);
+        warmCache.path = path;
+        warmCache.haveSaved = false;
+        std::vector<unsigned char> data;
+        hr = ReadFileContents (path, data);
+        if (SUCCEEDED (hr)) hr = ParseWarmCache (data.data (), data.size (), GetOSVersion (), snapshot);
+        if (SUCCEEDED (hr))
+        {
+            warmCache.saved = snapshot;
+            warmCache.haveSaved = true;
+        }
     }
 
-    bool sysDarkMode;
-    hr = GetSysPartsDarkModeEnabled(sysDarkMode);
-    if(SUCCEEDED(hr))
-        mode = sysDarkMode ? SysPartsMode::Dark : SysPartsMode::Light;
+    if (SUCCEEDED (hr) && cache.PublishCached (snapshot))
+    {
+        /* A previous verification saves to the warm cache, taking the lock, so
+         * only wait for it (by destroying its future) after releasing the lock */
+        std::future<void> previousVerification;
+        std::lock_guard<std::mutex> lock (warmCache.mutex);
+        previousVerification = std::move (warmCache.verification);
+        warmCache.verification = std::async (std::launch::async, [&cache]()
+        {
+            // Capturing the theme state needs COM for the WinRT accent color
+            HRESULT hrCom = CoInitializeEx (nullptr, COINIT_MULTITHREADED);
+            cache.Invalidate ();
+            if (SUCCEEDED (hrCom))
+            {
+                ReleaseApartmentResources ();
+                CoUninitialize ();
+            }
+        });
+    }
     return hr;
 }
 
+ThemeWatcher& GetThemeWatcher ()
+{
+    static ThemeWatcher watcher (GetDefaultSettingsStore (), GetThemeCache (), MakeCaptureThreadHooks ());
+    return watcher;
+}
+
+void ReleaseApartmentResources ()
+{
+#if defined(____x_ABI_CWindows_CUI_CViewManagement_CIUISettings3_INTERFACE_DEFINED__)
+    ULONG_PTR token;
+    if (SUCCEEDED (CoGetContextToken (&token)))
+        GetUISettingsCache ().Release (token);
+#endif
+}
+
 } // namespace windows10colors
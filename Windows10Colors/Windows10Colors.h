@@ -32,6 +32,16 @@ https://github.com/res2k/Windows10Colors
 
 #include <Windows.h>
 
+#include "Windows10ColorsCore.h"
+#include "Windows10ColorsCache.h"
+#include "Windows10ColorsCapabilities.h"
+#include "Windows10ColorsProfiles.h"
+#include "Windows10ColorsService.h"
+#include "Windows10ColorsSettings.h"
+#include "Windows10ColorsShared.h"
+#include "Windows10ColorsWarmCache.h"
+#include "Windows10ColorsWatcher.h"
+
 #if (__cplusplus >= 201402L)
 #define W10C_DEPRECATED(msg)	[[deprecated(msg)]]
 #elif defined(_MSC_VER)
@@ -42,97 +52,21 @@ https://github.com/res2k/Windows10Colors
 
 namespace windows10colors
 {
-    static const HRESULT S_ACCENT_COLOR_GUESSED = MAKE_HRESULT (0, 0x457, 0xC);
-
-    /**
-     * RGBA color. Red is in the LSB, Alpha in the MSB.
-     * You can use GetRValue() et al to access individual components.
-     */
-    typedef DWORD RGBA;
-
-    /// Accent color shades
-    struct AccentColor
-    {
-        /// Base accent color
-        RGBA accent;
-        /// Darkest shade.
-        RGBA darkest;
-        /// Darker shade.
-        RGBA darker;
-        /// Dark shade.
-        RGBA dark;
-        /// Light shade.
-        RGBA light;
-        /// Lighter shade.
-        RGBA lighter;
-        /// Lightest shade.
-        RGBA lightest;
-    };
-
     /**
      * Return current accent color.
      * \remarks On platforms other than Windows 10 tries to guess an appropriate
      *   color. Returns \c S_ACCENT_COLOR_GUESSED in that case.
      */
     extern HRESULT GetAccentColor (AccentColor& color);
-
-    /// Colors for Windows 10 frame painting.
-    struct FrameColors
-    {
-        /// Color of text for active captions.
-        RGBA activeCaptionText;
-        /// Background color of active captions.
-        RGBA activeCaptionBG;
-        /**
-         * Frame color of active windows.
-         * \remarks Usually the frame is drawn by DWM.
-         */
-        RGBA activeFrame;
-        /// Color of text for inactive captions.
-        RGBA inactiveCaptionText;
-        /// Background color of inactive captions.
-        RGBA inactiveCaptionBG;
-        /**
-        * Frame color of inactive windows.
-        * \remarks Usually the frame is drawn by DWM.
-        */
-        RGBA inactiveFrame;
-    };
-
-    /// Frame color options
-    enum FrameColorOption
-    {
-        /// Default frame colors
-        fcDefault = 0,
-        /**
-         * Whether to compute colors for a window with an enabled "sheet of glass" effect.
-         * This is the case if blur behind was enabled for a window with a valid opaque
-         * client area (i.e. only positive margins passed to DwmExtendFrameIntoClientArea).
-         * The resulting colors will emulate a "composed" appearance.
-         */
-        fcGlassEffect = 1,
-        /**
-         * Always compute title bar colors as if they were colored.
-         * Otherwise uses current system setting.
-         */
-        fcTitleBarsColored = 2
-    };
-
-    /// Dark mode colors selections
-    enum struct DarkMode
-    {
-        /**
-         * Choose dark mode depending on Windows version:
-         * User on Windows 1903 and newer, Light otherwise.
-         */
-        Auto,
-        /// Use user setting for Dark Mode
-        User,
-        /// Use light mode
-        Light,
-        /// Use dark mode
-        Dark
-    };
+    /**
+     * Return selected shades of the current accent color.
+     * Only the requested shades are queried or computed, which is cheaper
+     * than obtaining all of them.
+     * \param color Receives accent color shades. Shades not requested are left unchanged.
+     * \param shades Shades to obtain. Combination of AccentShade values.
+     * \remarks Returns \c S_ACCENT_COLOR_GUESSED if the color was guessed.
+     */
+    extern HRESULT GetAccentColor (AccentColor& color, unsigned int shades);
 
     /**
      * Get colors used to paint window frames.
@@ -148,16 +82,215 @@ namespace windows10colors
     extern HRESULT GetFrameColors (FrameColors& color, unsigned int options = fcDefault,
                                    DarkMode darkMode = DarkMode::Light);
 
+    /// Function receiving the accent color once a query exceeding its budget finished
+    typedef std::function<void (HRESULT result, const AccentColor& color)> AccentColorCallback;
+    /// Function receiving frame colors once a query exceeding its budget finished
+    typedef std::function<void (HRESULT result, const FrameColors& color)> FrameColorsCallback;
+
+    /**
+     * Return current accent color, waiting at most \a budget for the system to respond.
+     * The colors are queried on a background thread. If that doesn't finish in
+     * time, the last known color is returned instead, or a guessed one if no
+     * color is known yet.
+     * \param color Receives accent color shades.
+     * \param budget Maximum time to wait for the query.
+     * \param onComplete Function to call with the actual color if the query didn't
+     *   finish in time. Called on the querying thread.
+     * \remarks Returns \c S_COLOR_REFRESH_PENDING if the last known color was
+     *   returned, \c S_ACCENT_COLOR_GUESSED if the color was guessed.
+     */
+    extern HRESULT GetAccentColor (AccentColor& color, std::chrono::milliseconds budget,
+                                   AccentColorCallback onComplete = AccentColorCallback ());
+    /**
+     * Get colors used to paint window frames, waiting at most \a budget for the system to respond.
+     * Like the GetAccentColor() overload taking a budget, returns the last
+     * known or guessed colors if the query doesn't finish in time.
+     * \param color Receives frame color values.
+     * \param options Frame color options. Combination of FrameColorOption values.
+     * \param darkMode Whether to use Dark Mode colors.
+     * \param budget Maximum time to wait for the query.
+     * \param onComplete Function to call with the actual colors if the query didn't
+     *   finish in time. Called on the querying thread.
+     */
+    extern HRESULT GetFrameColors (FrameColors& color, unsigned int options, DarkMode darkMode,
+                                   std::chrono::milliseconds budget,
+                                   FrameColorsCallback onComplete = FrameColorsCallback ());
+
+    /**
+     * Get colors used to paint window frames for all combinations of options
+     * and dark mode. System settings are only queried once.
+     * \param variants Receives frame colors. Use FrameColorVariants::Get() to pick a variant.
+     */
+    extern HRESULT GetAllFrameColorVariants (FrameColorVariants& variants);
+
+    /**
+     * Obtain all system settings window frame colors are derived from.
+     * Use ComputeFrameColors() to compute colors for any options and dark
+     * mode setting from these, without querying the system again.
+     */
+    extern HRESULT GetThemeInputs (ThemeInputs& inputs);
+
+    /**
+     * Capture all system settings relevant for accent and frame colors at once.
+     * Each registry key is opened only once. Use the overloads of GetAccentColor(),
+     * GetFrameColors() etc. taking a ThemeSnapshot to derive the actual colors.
+     */
+    extern HRESULT CaptureThemeSnapshot (ThemeSnapshot& snapshot);
+
+    /**
+     * Capture the theme settings of an explicit user.
+     * Reads the user's registry settings and derives the accent color from the
+     * DWM colors, as UISettings only provides the current user's accent color.
+     * \param userRoot Root key of the user's registry hive, e.g. a subkey of
+     *   \c HKEY_USERS or a hive loaded with \c RegLoadAppKey().
+     * \param snapshot Receives the snapshot. Use the overloads of GetAccentColor(),
+     *   GetFrameColors() etc. taking a ThemeSnapshot to derive the actual colors.
+     */
+    extern HRESULT CaptureThemeSnapshot (HKEY userRoot, ThemeSnapshot& snapshot);
+
+    /**
+     * Evaluate the colors of many users in parallel, e.g. all users signed in to
+     * a terminal server. Settings not stored per user are only captured once.
+     * \param count Number of users.
+     * \param sids String SIDs of the users. Their hives must be loaded under \c HKEY_USERS.
+     * \param colors Receives colors of each user. Must have room for \a count entries.
+     * \param options Frame color options. Combination of FrameColorOption values.
+     * \param darkMode Whether to use Dark Mode frame colors.
+     * \param threads Number of worker threads. 0 picks the number of hardware threads.
+     * \returns \c S_OK if all users were evaluated, \c S_FALSE if some failed
+     *   (see ProfileColors::result).
+     */
+    extern HRESULT EvaluateUserProfiles (size_t count, const wchar_t* const* sids, ProfileColors* colors,
+                                         unsigned int options = fcDefault, DarkMode darkMode = DarkMode::Light,
+                                         unsigned int threads = 0);
+
+    /**
+     * Returns the number of system calls (registry, WinRT and other API calls)
+     * made by the library on the calling thread so far.
+     */
+    extern unsigned long GetSystemCallCount ();
+
     /**
-     * Returns whether some color is 'dark' for the purpose of finding a contrasting
-     * color - e.g. given some background color, use the 'dark' property to choose
-     * an appropriate text (foreground) color.
-     * Formula matches the one in https://learn.microsoft.com/en-us/windows/apps/desktop/modernize/apply-windows-themes
+     * Process-wide theme cache, capturing the state with CaptureThemeSnapshot().
+     * Call ThemeCache::Invalidate() to refresh it, e.g. in response to
+     * \c WM_SETTINGCHANGE.
      */
-    static inline bool IsColorDark (RGBA color)
+    extern ThemeCache& GetThemeCache ();
+
+    /// Default name of the shared memory segment used by SetSharedSnapshotMode()
+    static const char defaultSharedSnapshotName[] = "Local\\Windows10Colors.ThemeSnapshot";
+
+    /// Use of a theme snapshot in shared memory by GetThemeCache()
+    enum struct SharedSnapshotMode
     {
-      return (GetRValue (color) * 2 + GetGValue (color) * 5 + GetBValue (color)) <= 1024;
-    }
+        /// No sharing: the theme state is captured by this process
+        Off,
+        /// Capture the theme state and publish every captured snapshot
+        Publish,
+        /**
+         * Use the snapshot published by another process, instead of capturing
+         * the theme state. Falls back to capturing if nothing was published yet.
+         */
+        Read
+    };
+
+    /**
+     * Set up sharing of the theme state between processes.
+     * Typically one process publishes the theme state and other processes
+     * read it, saving them the cost of querying the system. The cache is
+     * refreshed from the new source immediately.
+     * \remarks In \c Read mode ThemeCache::Invalidate() only reads shared memory,
+     *   so it's cheap enough to be called whenever an update might have happened.
+     */
+    extern HRESULT SetSharedSnapshotMode (SharedSnapshotMode mode, const char* name = defaultSharedSnapshotName);
+
+    /**
+     * Use a file as persistent "warm" cache for GetThemeCache(), to have colors
+     * available right away at startup.
+     * If the file contains a valid snapshot captured on the running OS version,
+     * it's published to the cache immediately (with ThemeState::fromCache set),
+     * and verified by capturing the actual state in the background.
+     * Captured snapshots are written to the file whenever the settings changed.
+     * Call once at startup, before reading from the cache.
+     * \param path Path of the cache file, e.g. in the local application data folder.
+     * \returns Result of loading the file. Captured snapshots are saved to the file
+     *   even if loading failed.
+     */
+    extern HRESULT EnableWarmCache (const wchar_t* path);
+
+    /**
+     * Release objects the library keeps alive for the calling thread's COM apartment.
+     * WinRT objects used to query the accent color are activated once per apartment
+     * and reused afterwards. Call this before uninitializing COM on a thread that
+     * used the library.
+     */
+    extern void ReleaseApartmentResources ();
+
+    /**
+     * Cache of capabilities known to be unavailable on the running system.
+     * Accent color queries consult it to skip sources that can't work, e.g.
+     * WinRT on Windows 7. Call CapabilityCache::Reset() to try all sources again.
+     */
+    extern CapabilityCache& GetCapabilityCache ();
+
+    /**
+     * Settings store reading theme settings from the registry.
+     * Changes are watched with RegNotifyChangeKeyValue().
+     */
+    class RegistrySettingsStore : public SettingsStore
+    {
+    public:
+        /**
+         * Constructor.
+         * \param root Root key containing the settings keys. Must stay open while
+         *   the store is used.
+         */
+        explicit RegistrySettingsStore (HKEY root = HKEY_CURRENT_USER);
+        ~RegistrySettingsStore ();
+
+        HRESULT QueryValues (SettingsKey key, size_t count, const wchar_t* const* names,
+                             uint32_t* values, HRESULT* results) override;
+        HRESULT StartWatching () override;
+        HRESULT WaitForChange () override;
+        void StopWaiting () override;
+    private:
+        enum { numKeys = 2 };
+        HKEY root;
+        HKEY watchKeys[numKeys];
+        HANDLE watchEvents[numKeys];
+        HANDLE stopEvent;
+
+        HRESULT ArmWatch (size_t index);
+        void CloseWatch ();
+
+        RegistrySettingsStore (const RegistrySettingsStore&) = delete;
+        RegistrySettingsStore& operator= (const RegistrySettingsStore&) = delete;
+    };
+
+    /**
+     * Settings store for the current user: a RegistrySettingsStore on \c HKEY_CURRENT_USER.
+     * The functions reading theme settings of the current user, as well as
+     * GetThemeWatcher(), use this store.
+     */
+    extern SettingsStore& GetDefaultSettingsStore ();
+
+    /**
+     * Watcher for the registry theme settings of the current user, invalidating
+     * GetThemeCache() when relevant settings change. Call ThemeWatcher::Start()
+     * to start watching.
+     */
+    extern ThemeWatcher& GetThemeWatcher ();
+
+    /**
+     * Service thread capturing theme snapshots with CaptureThemeSnapshot(),
+     * for threads that don't have COM initialized (or use an apartment the
+     * library's WinRT objects can't be used in). The service thread owns its
+     * own COM apartment and the WinRT objects activated in it.
+     * Not running by default; call QueryService::Start() to start it.
+     * While it runs, GetThemeCache() captures through it as well, so the
+     * cache can be invalidated from any thread.
+     */
+    extern QueryService& GetQueryService ();
 
     /// Determines whether "Dark Mode" is enabled for apps
     extern HRESULT GetAppDarkModeEnabled (bool& darkMode);
@@ -175,16 +308,6 @@ namespace windows10colors
      */
     extern HRESULT GetSysPartsDarkModeEnabled (bool& darkMode);
 
-    /// Mode (colorization) of system parts (start menu, taskbar).
-    enum struct SysPartsMode
-    {
-        /// Accent color is used
-        AccentColor,
-        /// Dark mode is used
-        Dark,
-        /// Light mode is used
-        Light
-    };
     /// Get mode (colorization) of system parts (start menu, taskbar).
     extern HRESULT GetSysPartsMode (SysPartsMode& mode);
 
@@ -0,0 +1,190 @@
+/*
+This library is licensed under the zlib license.
+
+Copyright (C) 2016-2018 Frank Richter
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+claim that you wrote the original software. If you use this software
+in a product, an acknowledgment in the product documentation would be
+appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+
+Original source:
+https://github.com/res2k/Windows10Colors
+
+*/
+
+/* Vectorized accent color shade computation.
+ * This file is included by Windows10ColorsSIMD.cpp once per instruction set,
+ * after defining a suitable 'Ops' struct. Everything is computed on doubles:
+ * all intermediate values of the integer HSV computations fit into a double
+ * mantissa, and truncating an exact double quotient of such values gives the
+ * same result as integer division. So the results are bit-identical to the
+ * scalar GenerateAccentColors(). */
+
+typedef Ops::V V;
+
+/// Per-lane hue-dependent values, shared by all shades of a color.
+struct HueFactors
+{
+    V secondFactor;
+    V Rchroma, Rsecond;
+    V Gchroma, Gsecond;
+    V Bchroma, Bsecond;
+};
+
+static inline V DivTrunc (V a, V b)
+{
+    return Ops::Trunc (Ops::Div (a, b));
+}
+
+/// Compute (a * b) / 0x8000 for non-negative a, b
+static inline V MulShift15 (V a, V b)
+{
+    return Ops::Trunc (Ops::Mul (Ops::Mul (a, b), Ops::Set (1.0 / 0x8000)));
+}
+
+/**
+ * Compute (c * 0x8000) / 255 for a component value c.
+ * Uses a multiplication instead of a division: the fractional part of the
+ * exact quotient is either 0 or at least 1/255, so a small bias
+ * compensates for the rounding of the reciprocal without affecting the result.
+ */
+static inline V ScaleComponent (V c)
+{
+    return Ops::Trunc (Ops::Add (Ops::Mul (c, Ops::Set (0x8000 / 255.0)), Ops::Set (1.0 / 0x10000)));
+}
+
+static inline __m128i ShadeToRGBA (V S, V Vval, const HueFactors& hue, __m128i alpha)
+{
+    const V zero = Ops::Set (0);
+    const V c255 = Ops::Set (255);
+    V chroma = MulShift15 (Vval, S);
+    V second = MulShift15 (chroma, hue.secondFactor);
+    V minComp = Ops::Sub (Vval, chroma);
+
+    V R = Ops::Select (hue.Rchroma, chroma, Ops::Select (hue.Rsecond, second, zero));
+    V G = Ops::Select (hue.Gchroma, chroma, Ops::Select (hue.Gsecond, second, zero));
+    V B = Ops::Select (hue.Bchroma, chroma, Ops::Select (hue.Bsecond, second, zero));
+    R = Ops::Min (MulShift15 (Ops::Add (R, minComp), c255), c255);
+    G = Ops::Min (MulShift15 (Ops::Add (G, minComp), c255), c255);
+    B = Ops::Min (MulShift15 (Ops::Add (B, minComp), c255), c255);
+
+    __m128i rgba = Ops::ToInt (R);
+    rgba = _mm_or_si128 (rgba, _mm_slli_epi32 (Ops::ToInt (G), 8));
+    rgba = _mm_or_si128 (rgba, _mm_slli_epi32 (Ops::ToInt (B), 16));
+    return _mm_or_si128 (rgba, alpha);
+}
+
+static inline void LighterStep (V& S, V& Vval, V Vstep)
+{
+    Vval = Ops::Min (Ops::Add (Vval, Vstep), Ops::Set (0x8000));
+    S = Ops::Select (Ops::CmpGe (Vval, Ops::Set (22937)), Ops::Trunc (Ops::Mul (S, Ops::Set (0.75))), S);
+}
+
+static inline void DarkerStep (V& Vval, V Vstep)
+{
+    Vval = Ops::Max (Ops::Sub (Vval, Vstep), Ops::Set (0));
+}
+
+static void GenerateAccentColorsKernel (const RGBA* base, AccentColor* colors, size_t count)
+{
+    const V zero = Ops::Set (0);
+    const V one = Ops::Set (1);
+    const V c8000 = Ops::Set (0x8000);
+    const __m128i byteMask = _mm_set1_epi32 (0xff);
+
+    size_t i = 0;
+    for (; i + Ops::Lanes <= count; i += Ops::Lanes)
+    {
+        __m128i input = Ops::LoadColors (base + i);
+        __m128i alpha = _mm_slli_epi32 (_mm_srli_epi32 (input, 24), 24);
+
+        // RGBtoHSV
+        V R = ScaleComponent (Ops::FromInt (_mm_and_si128 (input, byteMask)));
+        V G = ScaleComponent (Ops::FromInt (_mm_and_si128 (_mm_srli_epi32 (input, 8), byteMask)));
+        V B = ScaleComponent (Ops::FromInt (_mm_and_si128 (_mm_srli_epi32 (input, 16), byteMask)));
+        V maxComp = Ops::Max (R, Ops::Max (G, B));
+        V minComp = Ops::Min (R, Ops::Min (G, B));
+        V minMaxDiff = Ops::Sub (maxComp, minComp);
+        V diffZero = Ops::CmpEq (minMaxDiff, zero);
+
+        V maxIsR = Ops::CmpEq (maxComp, R);
+        V maxIsG = Ops::AndNot (maxIsR, Ops::CmpEq (maxComp, G));
+        V hueNum = Ops::Select (maxIsR, Ops::Sub (G, B), Ops::Select (maxIsG, Ops::Sub (B, R), Ops::Sub (R, G)));
+        V hueOffset = Ops::Select (maxIsR, zero, Ops::Select (maxIsG, Ops::Set (2 * 0x8000), Ops::Set (4 * 0x8000)));
+        V H = DivTrunc (Ops::Mul (hueNum, c8000), Ops::Select (diffZero, one, minMaxDiff));
+        hueOffset = Ops::Add (hueOffset, Ops::Select (Ops::And (maxIsR, Ops::CmpLt (H, zero)), Ops::Set (6 * 0x8000), zero));
+        H = Ops::Select (diffZero, zero, Ops::Add (H, hueOffset));
+
+        V Vval = maxComp;
+        V Vzero = Ops::CmpEq (Vval, zero);
+        V S = Ops::Select (Vzero, zero, DivTrunc (Ops::Mul (minMaxDiff, c8000), Ops::Select (Vzero, one, Vval)));
+
+        // Hue-dependent parts of HSVtoRGB
+        HueFactors hue;
+        V sector = Ops::Trunc (Ops::Mul (H, Ops::Set (1.0 / 0x8000)));
+        V Hmod = Ops::Sub (H, Ops::Mul (Ops::Trunc (Ops::Mul (H, Ops::Set (1.0 / (2 * 0x8000)))), Ops::Set (2 * 0x8000)));
+        V Hdist = Ops::Sub (Hmod, c8000);
+        hue.secondFactor = Ops::Sub (c8000, Ops::Max (Hdist, Ops::Sub (zero, Hdist)));
+        V sector0 = Ops::CmpEq (sector, zero);
+        V sector1 = Ops::CmpEq (sector, one);
+        V sector2 = Ops::CmpEq (sector, Ops::Set (2));
+        V sector3 = Ops::CmpEq (sector, Ops::Set (3));
+        V sector4 = Ops::CmpEq (sector, Ops::Set (4));
+        V sector5 = Ops::CmpEq (sector, Ops::Set (5));
+        hue.Rchroma = Ops::Or (sector0, sector5);
+        hue.Rsecond = Ops::Or (sector1, sector4);
+        hue.Gchroma = Ops::Or (sector1, sector2);
+        hue.Gsecond = Ops::Or (sector0, sector3);
+        hue.Bchroma = Ops::Or (sector3, sector4);
+        hue.Bsecond = Ops::Or (sector2, sector5);
+
+        // Shades: 25% of V
+        V Vstep = Ops::Trunc (Ops::Mul (Vval, Ops::Set (0.25)));
+        uint32_t shades[6][4];
+
+        V lightS = S, lightV = Vval;
+        LighterStep (lightS, lightV, Vstep);
+        _mm_storeu_si128 (reinterpret_cast<__m128i*> (shades[0]), ShadeToRGBA (lightS, lightV, hue, alpha));
+        LighterStep (lightS, lightV, Vstep);
+        _mm_storeu_si128 (reinterpret_cast<__m128i*> (shades[1]), ShadeToRGBA (lightS, lightV, hue, alpha));
+        LighterStep (lightS, lightV, Vstep);
+        _mm_storeu_si128 (reinterpret_cast<__m128i*> (shades[2]), ShadeToRGBA (lightS, lightV, hue, alpha));
+
+        V darkV = Vval;
+        DarkerStep (darkV, Vstep);
+        _mm_storeu_si128 (reinterpret_cast<__m128i*> (shades[3]), ShadeToRGBA (S, darkV, hue, alpha));
+        DarkerStep (darkV, Vstep);
+        _mm_storeu_si128 (reinterpret_cast<__m128i*> (shades[4]), ShadeToRGBA (S, darkV, hue, alpha));
+        DarkerStep (darkV, Vstep);
+        _mm_storeu_si128 (reinterpret_cast<__m128i*> (shades[5]), ShadeToRGBA (S, darkV, hue, alpha));
+
+        for (size_t l = 0; l < Ops::Lanes; l++)
+        {
+            AccentColor& color = colors[i + l];
+            color.accent = base[i + l];
+            color.light = shades[0][l];
+            color.lighter = shades[1][l];
+            color.lightest = shades[2][l];
+            color.dark = shades[3][l];
+            color.darker = shades[4][l];
+            color.darkest = shades[5][l];
+        }
+    }
+
+    for (; i < count; i++)
+    {
+        GenerateAccentColors (base[i], colors[i]);
+    }
+}
@@ -0,0 +1,168 @@
+/*
+This library is licensed under the zlib license.
+
+Copyright (C) 2016-2018 Frank Richter
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+claim that you wrote the original software. If you use this software
+in a product, an acknowledgment in the product documentation would be
+appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+
+Original source:
+https://github.com/res2k/Windows10Colors
+
+*/
+#ifndef __WINDOWS10COLORSACTIVATION_H__
+#define __WINDOWS10COLORSACTIVATION_H__
+
+/**\file
+ * Caching of activated (WinRT) objects per COM apartment.
+ */
+
+#include "Windows10ColorsCore.h"
+
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+namespace windows10colors
+{
+    /**
+     * Cache of objects activated by a factory, keyed by apartment.
+     * Objects are usually bound to the apartment they were created in, so an
+     * object is only handed out to callers in the same apartment. The apartment
+     * identifiers are provided by the caller (on Windows, the COM context token).
+     * \tparam T Object handle type. Must be copyable and comparable, e.g. a smart pointer.
+     * \remarks Objects should be released (Release()) from within their apartment before
+     *   the apartment is torn down, as an identifier may be reused for a new apartment
+     *   afterwards. If that was missed, calls on the stale object fail with an error
+     *   for which IsApartmentGoneError() returns \c true; callers should then
+     *   Discard() the object and Get() a new one.
+     */
+    template<typename T>
+    class PerApartmentCache
+    {
+    public:
+        /// Apartment identifier
+        typedef uintptr_t ApartmentId;
+        /// Function creating a new object
+        typedef std::function<HRESULT (T&)> Factory;
+
+        explicit PerApartmentCache (Factory factory) : factory (std::move (factory)) {}
+
+        /**
+         * Get the object for an apartment, creating it if necessary.
+         * Failures to create an object are not cached.
+         */
+        HRESULT Get (ApartmentId apartment, T& object)
+        {
+            {
+                std::lock_guard<std::mutex> lock (mutex);
+                auto it = objects.find (apartment);
+                if (it != objects.end ())
+                {
+                    hits++;
+                    object = it->second;
+                    return S_OK;
+                }
+            }
+            /* Activate without holding the lock: activation may pump messages
+             * or take a while. */
+            T newObject;
+            HRESULT hr = factory (newObject);
+            if (FAILED (hr)) return hr;
+            std::lock_guard<std::mutex> lock (mutex);
+            activations++;
+            // Another caller in the same apartment may have been faster
+            auto inserted = objects.insert (std::make_pair (apartment, newObject));
+            object = inserted.first->second;
+            return hr;
+        }
+
+        /**
+         * Drop a stale object, e.g. one created in a torn down apartment whose
+         * identifier was reused. The entry is only removed if it still holds
+         * \a object, so an object another caller created meanwhile is kept.
+         */
+        void Discard (ApartmentId apartment, const T& object)
+        {
+            T stale;
+            {
+                std::lock_guard<std::mutex> lock (mutex);
+                auto it = objects.find (apartment);
+                if ((it == objects.end ()) || !(it->second == object)) return;
+                stale = std::move (it->second);
+                objects.erase (it);
+                discards++;
+            }
+            // 'stale' goes out of scope outside the lock
+        }
+
+        /**
+         * Release the object for an apartment.
+         * Should be called from within that apartment.
+         */
+        void Release (ApartmentId apartment)
+        {
+            T object;
+            {
+                std::lock_guard<std::mutex> lock (mutex);
+                auto it = objects.find (apartment);
+                if (it == objects.end ()) return;
+                object = std::move (it->second);
+                objects.erase (it);
+            }
+            // 'object' goes out of scope outside the lock
+        }
+
+        /// Number of objects created by the factory
+        unsigned long GetActivationCount () const
+        {
+            std::lock_guard<std::mutex> lock (mutex);
+            return activations;
+        }
+        /// Number of requests served from the cache
+        unsigned long GetHitCount () const
+        {
+            std::lock_guard<std::mutex> lock (mutex);
+            return hits;
+        }
+        /// Number of stale objects dropped by Discard()
+        unsigned long GetDiscardCount () const
+        {
+            std::lock_guard<std::mutex> lock (mutex);
+            return discards;
+        }
+    private:
+        Factory factory;
+        mutable std::mutex mutex;
+        std::unordered_map<ApartmentId, T> objects;
+        unsigned long activations = 0;
+        unsigned long hits = 0;
+        unsigned long discards = 0;
+    };
+
+    /**
+     * Whether an error returned by a call on an apartment-bound object
+     * indicates that the object's apartment (or its server) is gone.
+     */
+    static inline bool IsApartmentGoneError (HRESULT hr)
+    {
+        return (hr == RPC_E_DISCONNECTED) || (hr == CO_E_OBJNOTCONNECTED) || (hr == RPC_E_SERVER_DIED_DNE);
+    }
+
+} // namespace windows10colors
+
+#endif // __WINDOWS10COLORSACTIVATION_H__
@@ -0,0 +1,475 @@
+/*
+This library is licensed under the zlib license.
+
+Copyright (C) 2016-2018 Frank Richter
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+claim that you wrote the original software. If you use this software
+in a product, an acknowledgment in the product documentation would be
+appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+
+Original source:
+https://github.com/res2k/Windows10Colors
+
+*/
+
+#include "Windows10ColorsCache.h"
+
+namespace windows10colors
+{
+
+void MakeThemeState (const ThemeSnapshot& snapshot, ThemeState& state)
+{
+    state = ThemeState ();
+    state.snapshot = snapshot;
+    state.accentResult = GetAccentColor (snapshot, state.accent);
+    state.sysPartsModeResult = GetSysPartsMode (snapshot, state.sysPartsMode);
+    state.generation = 0;
+    state.fromCache = false;
+}
+
+static bool operator== (const AccentColor& a, const AccentColor& b)
+{
+    return (a.accent == b.accent) && (a.darkest == b.darkest) && (a.darker == b.darker) && (a.dark == b.dark)
+        && (a.light == b.light) && (a.lighter == b.lighter) && (a.lightest == b.lightest);
+}
+
+static bool operator== (const DwmColors& a, const DwmColors& b)
+{
+    return (a.ColorizationColor == b.ColorizationColor) && (a.ColorizationColorBalance == b.ColorizationColorBalance)
+        && (a.haveAccentColor == b.haveAccentColor) && (!a.haveAccentColor || (a.AccentColor == b.AccentColor));
+}
+
+static bool operator== (const SystemColors& a, const SystemColors& b)
+{
+    return (a.activeCaption == b.activeCaption) && (a.captionText == b.captionText)
+        && (a.inactiveCaption == b.inactiveCaption) && (a.inactiveCaptionText == b.inactiveCaptionText)
+        && (a.highlight == b.highlight);
+}
+
+bool SameThemeSettings (const ThemeSnapshot& a, const ThemeSnapshot& b)
+{
+    // Compare values only if they were obtained successfully
+    auto SameFlag = [](HRESULT hrA, bool flagA, HRESULT hrB, bool flagB)
+    {
+        return (hrA == hrB) && (FAILED (hrA) || (flagA == flagB));
+    };
+
+    return (a.osVersion.major == b.osVersion.major) && (a.osVersion.minor == b.osVersion.minor)
+        && (a.osVersion.build == b.osVersion.build)
+        && (a.highContrast == b.highContrast)
+        && (a.sysColors == b.sysColors)
+        && (a.uiSettingsResult == b.uiSettingsResult)
+        && (FAILED (a.uiSettingsResult) || (a.uiSettingsAccent == b.uiSettingsAccent))
+        && (a.dwmResult == b.dwmResult)
+        && (FAILED (a.dwmResult) || (a.dwmColors == b.dwmColors))
+        && SameFlag (a.haveDwmColorPrevalence ? S_OK : E_FAIL, a.dwmColorPrevalence,
+                     b.haveDwmColorPrevalence ? S_OK : E_FAIL, b.dwmColorPrevalence)
+        && SameFlag (a.personalizeColorPrevalenceResult, a.personalizeColorPrevalence,
+                     b.personalizeColorPrevalenceResult, b.personalizeColorPrevalence)
+        && SameFlag (a.appsUseLightThemeResult, a.appsUseLightTheme,
+                     b.appsUseLightThemeResult, b.appsUseLightTheme)
+        && SameFlag (a.systemUsesLightThemeResult, a.systemUsesLightTheme,
+                     b.systemUsesLightThemeResult, b.systemUsesLightTheme);
+}
+
+unsigned int DiffThemeStates (const ThemeState& oldState, const ThemeState& newState,
+                              unsigned int options, DarkMode darkMode)
+{
+    unsigned int changes = 0;
+
+    static const RGBA AccentColor::* const accentFields[] = {
+        &AccentColor::accent, &AccentColor::dark, &AccentColor::darker, &AccentColor::darkest,
+        &AccentColor::light, &AccentColor::lighter, &AccentColor::lightest
+    };
+    static const unsigned int accentChanges[] = {
+        tcAccent, tcAccentDark, tcAccentDarker, tcAccentDarkest,
+        tcAccentLight, tcAccentLighter, tcAccentLightest
+    };
+    for (size_t i = 0; i < sizeof (accentFields) / sizeof (accentFields[0]); i++)
+    {
+        if (oldState.accent.*accentFields[i] != newState.accent.*accentFields[i]) changes |= accentChanges[i];
+    }
+
+    FrameColors oldFrame, newFrame;
+    windows10colors::GetFrameColors (oldState.snapshot, oldFrame, options, darkMode);
+    windows10colors::GetFrameColors (newState.snapshot, newFrame, options, darkMode);
+    static const RGBA FrameColors::* const frameFields[] = {
+        &FrameColors::activeCaptionText, &FrameColors::activeCaptionBG, &FrameColors::activeFrame,
+        &FrameColors::inactiveCaptionText, &FrameColors::inactiveCaptionBG, &FrameColors::inactiveFrame
+    };
+    static const unsigned int frameChanges[] = {
+        tcActiveCaptionText, tcActiveCaptionBG, tcActiveFrame,
+        tcInactiveCaptionText, tcInactiveCaptionBG, tcInactiveFrame
+    };
+    for (size_t i = 0; i < sizeof (frameFields) / sizeof (frameFields[0]); i++)
+    {
+        if (oldFrame.*frameFields[i] != newFrame.*frameFields[i]) changes |= frameChanges[i];
+    }
+
+    bool oldDarkMode, newDarkMode;
+    windows10colors::GetAppDarkModeEnabled (oldState.snapshot, oldDarkMode);
+    windows10colors::GetAppDarkModeEnabled (newState.snapshot, newDarkMode);
+    if (oldDarkMode != newDarkMode) changes |= tcAppDarkMode;
+
+    if (oldState.sysPartsMode != newState.sysPartsMode) changes |= tcSysPartsMode;
+
+    return changes;
+}
+
+ThemeCache::ThemeCache (CaptureFunction capture, ThreadHooks refreshHooks) : capture (std::move (capture)),
+    generation (0), lastSubscriptionId (0), firstWaiter (nullptr), activeNotifications (nullptr), refreshHooks (std::move (refreshHooks)), refreshRunning (false),
+    refreshesFinished (0)
+{
+}
+
+ThemeCache::~ThemeCache ()
+{
+    if (refreshThread.valid ()) refreshThread.wait ();
+}
+
+void ThemeCache::EnsureInitialized ()
+{
+    if (generation.load (std::memory_order_acquire) != 0) return;
+
+    std::lock_guard<std::mutex> lock (writeMutex);
+    if (generation.load (std::memory_order_relaxed) != 0) return;
+
+    ThemeSnapshot snapshot;
+    if (FAILED (capture (snapshot)))
+    {
+        // Publish default state anyway, to not retry on each read
+        snapshot = ThemeSnapshot ();
+        snapshot.uiSettingsResult = snapshot.dwmResult = E_FAIL;
+        snapshot.personalizeColorPrevalenceResult = snapshot.appsUseLightThemeResult =
+            snapshot.systemUsesLightThemeResult = E_FAIL;
+    }
+    // Initial state is not a change, so subscribers are not notified
+    ThemeState oldState, newState;
+    PublishLocked (snapshot, oldState, newState);
+}
+
+uint64_t ThemeCache::Read (ThemeState& current)
+{
+    EnsureInitialized ();
+    state.Load (current);
+    return current.generation;
+}
+
+HRESULT ThemeCache::GetAccentColor (AccentColor& color, uint64_t* stateGeneration)
+{
+    ThemeState current;
+    Read (current);
+    color = current.accent;
+    if (stateGeneration) *stateGeneration = current.generation;
+    return current.accentResult;
+}
+
+HRESULT ThemeCache::GetFrameColors (FrameColors& color, unsigned int options, DarkMode darkMode,
+                                    uint64_t* stateGeneration)
+{
+    ThemeState current;
+    Read (current);
+    if (stateGeneration) *stateGeneration = current.generation;
+    return windows10colors::GetFrameColors (current.snapshot, color, options, darkMode);
+}
+
+HRESULT ThemeCache::GetAllFrameColorVariants (FrameColorVariants& variants, uint64_t* stateGeneration)
+{
+    ThemeState current;
+    Read (current);
+    if (stateGeneration) *stateGeneration = current.generation;
+    return windows10colors::GetAllFrameColorVariants (current.snapshot, variants);
+}
+
+HRESULT ThemeCache::GetSysPartsMode (SysPartsMode& mode, uint64_t* stateGeneration)
+{
+    ThemeState current;
+    Read (current);
+    mode = current.sysPartsMode;
+    if (stateGeneration) *stateGeneration = current.generation;
+    return current.sysPartsModeResult;
+}
+
+HRESULT ThemeCache::Invalidate ()
+{
+    ThemeSnapshot snapshot;
+    HRESULT hr = capture (snapshot);
+    if (FAILED (hr)) return hr;
+
+    Publish (snapshot);
+    return hr;
+}
+
+HRESULT ThemeCache::RefreshWithin (std::chrono::milliseconds budget, ThemeState& current,
+                                   RefreshCallback onComplete)
+{
+    std::unique_lock<std::mutex> lock (refreshMutex);
+    if (!refreshRunning)
+    {
+        refreshRunning = true;
+        /* The previous thread may still be running callbacks (which may call
+         * this method), so let the new thread wait for it instead of blocking here. */
+        std::future<void> previous (std::move (refreshThread));
+        refreshThread = std::async (std::launch::async, [this, previous = std::move (previous)]() mutable
+        {
+            if (previous.valid ()) previous.wait ();
+            RunRefresh ();
+        });
+    }
+    /* Wait for the next refresh to finish. That is either the one started above,
+     * or one that was already running and thus may have started before the call. */
+    uint64_t target = refreshesFinished + 1;
+    if (refreshDone.wait_for (lock, budget, [&]() { return refreshesFinished >= target; }))
+    {
+        lock.unlock ();
+        state.Load (current);
+        return S_OK;
+    }
+    if (onComplete) refreshCallbacks.push_back (std::move (onComplete));
+    lock.unlock ();
+
+    // Don't use Read(): capturing the initial state here could exceed the budget
+    if (generation.load (std::memory_order_acquire) == 0) return E_PENDING;
+    state.Load (current);
+    return S_FALSE;
+}
+
+void ThemeCache::RunRefresh ()
+{
+    bool hooked = refreshHooks.start && SUCCEEDED (refreshHooks.start ());
+    // If capturing fails, report the last known (or default) state
+    if (FAILED (Invalidate ())) EnsureInitialized ();
+    ThemeState refreshed;
+    state.Load (refreshed);
+
+    std::vector<RefreshCallback> callbacks;
+    {
+        std::lock_guard<std::mutex> lock (refreshMutex);
+        callbacks.swap (refreshCallbacks);
+        refreshesFinished++;
+        refreshRunning = false;
+    }
+    refreshDone.notify_all ();
+    for (const auto& callback : callbacks)
+    {
+        callback (refreshed);
+    }
+    if (hooked && refreshHooks.finish) refreshHooks.finish ();
+}
+
+uint64_t ThemeCache::Publish (const ThemeSnapshot& snapshot)
+{
+    ThemeState oldState, newState;
+    bool changed;
+    {
+        std::lock_guard<std::mutex> lock (writeMutex);
+        changed = PublishLocked (snapshot, oldState, newState);
+    }
+    // Notify without holding the lock
+    if (changed && (oldState.generation != 0))
+    {
+        NotifySubscribers (oldState, newState);
+        NotifyWaiters (oldState, newState);
+    }
+    return newState.generation;
+}
+
+bool ThemeCache::PublishLocked (const ThemeSnapshot& snapshot, ThemeState& oldState, ThemeState& newState)
+{
+    uint64_t currentGeneration = generation.load (std::memory_order_relaxed);
+    if (currentGeneration != 0)
+    {
+        state.Load (oldState);
+        if (SameThemeSettings (oldState.snapshot, snapshot))
+        {
+            newState = oldState;
+            if (oldState.fromCache)
+            {
+                // Cached state was verified
+                newState.snapshot = snapshot;
+                newState.fromCache = false;
+                state.Store (newState);
+            }
+            return false;
+        }
+    }
+    else
+    {
+        oldState = ThemeState ();
+    }
+
+    MakeThemeState (snapshot, newState);
+    newState.generation = currentGeneration + 1;
+    state.Store (newState);
+    generation.store (newState.generation, std::memory_order_release);
+    return true;
+}
+
+bool ThemeCache::PublishCached (const ThemeSnapshot& snapshot)
+{
+    std::lock_guard<std::mutex> lock (writeMutex);
+    if (generation.load (std::memory_order_relaxed) != 0) return false;
+
+    ThemeState newState;
+    MakeThemeState (snapshot, newState);
+    newState.generation = 1;
+    newState.fromCache = true;
+    state.Store (newState);
+    generation.store (newState.generation, std::memory_order_release);
+    return true;
+}
+
+ThemeCache::SubscriptionId ThemeCache::Subscribe (ChangeCallback callback, unsigned int options, DarkMode darkMode)
+{
+    std::lock_guard<std::mutex> lock (subscriberMutex);
+    std::shared_ptr<const SubscriberList> current = std::atomic_load (&subscribers);
+    auto newList = current ? std::make_shared<SubscriberList> (*current) : std::make_shared<SubscriberList> ();
+
+    Subscriber subscriber;
+    subscriber.id = ++lastSubscriptionId;
+    subscriber.callback = std::move (callback);
+    subscriber.options = options;
+    subscriber.darkMode = darkMode;
+    newList->push_back (std::move (subscriber));
+
+    std::atomic_store (&subscribers, std::shared_ptr<const SubscriberList> (std::move (newList)));
+    return lastSubscriptionId;
+}
+
+void ThemeCache::Unsubscribe (SubscriptionId id)
+{
+    std::lock_guard<std::mutex> lock (subscriberMutex);
+    std::shared_ptr<const SubscriberList> current = std::atomic_load (&subscribers);
+    if (!current) return;
+
+    auto newList = std::make_shared<SubscriberList> ();
+    newList->reserve (current->size ());
+    for (const auto& subscriber : *current)
+    {
+        if (subscriber.id != id) newList->push_back (subscriber);
+    }
+    std::atomic_store (&subscribers, std::shared_ptr<const SubscriberList> (std::move (newList)));
+}
+
+void ThemeCache::NotifySubscribers (const ThemeState& oldState, const ThemeState& newState)
+{
+    // Iterate over a snapshot of the list; (un)subscribing replaces the list
+    std::shared_ptr<const SubscriberList> current = std::atomic_load (&subscribers);
+    if (!current) return;
+
+    for (const auto& subscriber : *current)
+    {
+        unsigned int changes = DiffThemeStates (oldState, newState, subscriber.options, subscriber.darkMode);
+        if (changes != 0) subscriber.callback (oldState, newState, changes);
+    }
+}
+
+bool ThemeCache::AddWaiter (ThemeChangeWaiter& waiter, uint64_t waitGeneration)
+{
+    std::lock_guard<std::mutex> lock (waiterMutex);
+    /* Publishing updates the generation before notifying waiters, so checking
+     * under the lock guarantees the waiter sees any later change. */
+    if (generation.load (std::memory_order_acquire) != waitGeneration) return false;
+
+    waiter.prev = nullptr;
+    waiter.next = firstWaiter;
+    if (firstWaiter) firstWaiter->prev = &waiter;
+    firstWaiter = &waiter;
+    waiter.registered = true;
+    waiter.generation = waitGeneration;
+    return true;
+}
+
+bool ThemeCache::RemoveWaiter (ThemeChangeWaiter& waiter)
+{
+    std::unique_lock<std::mutex> lock (waiterMutex);
+    // Don't let the waiter go away while another thread is notifying it
+    waiterNotified.wait (lock, [&]()
+    {
+        return !waiter.notification || (waiter.notification->thread == std::this_thread::get_id ());
+    });
+    if (waiter.notification)
+    {
+        // Removed from within the notification, so the notifying thread must not touch it anymore
+        waiter.notification->waiter = nullptr;
+        waiter.notification = nullptr;
+    }
+    if (!waiter.registered) return false;
+    UnlinkWaiter (waiter);
+    return true;
+}
+
+void ThemeCache::UnlinkWaiter (ThemeChangeWaiter& waiter)
+{
+    // Notifications in progress continue after the waiter
+    for (auto active = activeNotifications; active; active = active->nextActive)
+    {
+        if (active->cursor == &waiter) active->cursor = waiter.next;
+    }
+    if (waiter.prev)
+        waiter.prev->next = waiter.next;
+    else
+        firstWaiter = waiter.next;
+    if (waiter.next) waiter.next->prev = waiter.prev;
+    waiter.prev = waiter.next = nullptr;
+    waiter.registered = false;
+}
+
+void ThemeCache::NotifyWaiters (const ThemeState& oldState, const ThemeState& newState)
+{
+    /* Call waiters one at a time, without holding the lock during the call.
+     * The notification pins the waiter: RemoveWaiter() on other threads waits for
+     * the call to finish, while removing it from within the call unpins it.
+     * The notification's cursor marks where to continue; unlinking that waiter
+     * during the call advances it. Waiters added meanwhile are skipped anyway. */
+    ThemeChangeWaiter::Notification notification;
+    notification.thread = std::this_thread::get_id ();
+    std::unique_lock<std::mutex> lock (waiterMutex);
+    notification.nextActive = activeNotifications;
+    activeNotifications = &notification;
+    ThemeChangeWaiter* waiter = firstWaiter;
+    while (waiter)
+    {
+        // Skip waiters registered after this change was published
+        if (waiter->generation >= newState.generation)
+        {
+            waiter = waiter->next;
+            continue;
+        }
+        unsigned int changes = DiffThemeStates (oldState, newState, waiter->options, waiter->darkMode);
+        if ((changes & waiter->changeMask) == 0)
+        {
+            waiter = waiter->next;
+            continue;
+        }
+
+        notification.cursor = waiter->next;
+        UnlinkWaiter (*waiter);
+        notification.waiter = waiter;
+        waiter->notification = &notification;
+        lock.unlock ();
+        waiter->OnThemeChange (newState, changes);
+        lock.lock ();
+        if (notification.waiter) notification.waiter->notification = nullptr;
+        waiterNotified.notify_all ();
+        waiter = notification.cursor;
+    }
+
+    auto link = &activeNotifications;
+    while (*link != &notification) link = &(*link)->nextActive;
+    *link = notification.nextActive;
+}
+
+} // namespace windows10colors
@@ -0,0 +1,395 @@
+/*
+This library is licensed under the zlib license.
+
+Copyright (C) 2016-2018 Frank Richter
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+claim that you wrote the original software. If you use this software
+in a product, an acknowledgment in the product documentation would be
+appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+
+Original source:
+https://github.com/res2k/Windows10Colors
+
+*/
+#ifndef __WINDOWS10COLORSCACHE_H__
+#define __WINDOWS10COLORSCACHE_H__
+
+/**\file
+ * Process-wide cache of theme state for concurrent readers.
+ */
+
+#include "Windows10ColorsCore.h"
+#include "Windows10ColorsSeqLock.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace windows10colors
+{
+    /// Theme snapshot and values derived from it.
+    struct ThemeState
+    {
+        /// Captured system settings
+        ThemeSnapshot snapshot;
+        /// Result of deriving \c accent
+        HRESULT accentResult;
+        /// Accent color shades
+        AccentColor accent;
+        /// Result of deriving \c sysPartsMode
+        HRESULT sysPartsModeResult;
+        /// Mode of system parts
+        SysPartsMode sysPartsMode;
+        /// Generation of the state in the cache. 0 if the state was never captured.
+        uint64_t generation;
+        /// Whether the state was loaded from a persistent cache and not verified yet
+        bool fromCache;
+    };
+
+    /// Derive a ThemeState from a snapshot. \c generation is set to 0.
+    extern void MakeThemeState (const ThemeSnapshot& snapshot, ThemeState& state);
+
+    /**
+     * Returns whether two snapshots describe the same settings.
+     * Bookkeeping fields (like \c systemCalls) are ignored.
+     */
+    extern bool SameThemeSettings (const ThemeSnapshot& a, const ThemeSnapshot& b);
+
+    /// Changes between two theme states, as reported by DiffThemeStates()
+    enum ThemeChange
+    {
+        /// AccentColor::accent changed
+        tcAccent = shadeAccent,
+        /// AccentColor::dark changed
+        tcAccentDark = shadeDark,
+        /// AccentColor::darker changed
+        tcAccentDarker = shadeDarker,
+        /// AccentColor::darkest changed
+        tcAccentDarkest = shadeDarkest,
+        /// AccentColor::light changed
+        tcAccentLight = shadeLight,
+        /// AccentColor::lighter changed
+        tcAccentLighter = shadeLighter,
+        /// AccentColor::lightest changed
+        tcAccentLightest = shadeLightest,
+        /// Any accent color shade changed
+        tcAccentAll = shadeAll,
+
+        /// FrameColors::activeCaptionText changed
+        tcActiveCaptionText = 1 << 7,
+        /// FrameColors::activeCaptionBG changed
+        tcActiveCaptionBG = 1 << 8,
+        /// FrameColors::activeFrame changed
+        tcActiveFrame = 1 << 9,
+        /// FrameColors::inactiveCaptionText changed
+        tcInactiveCaptionText = 1 << 10,
+        /// FrameColors::inactiveCaptionBG changed
+        tcInactiveCaptionBG = 1 << 11,
+        /// FrameColors::inactiveFrame changed
+        tcInactiveFrame = 1 << 12,
+        /// Any frame color changed
+        tcFrameAll = 0x1f80,
+
+        /// App "Dark Mode" setting changed
+        tcAppDarkMode = 1 << 13,
+        /// SysPartsMode changed
+        tcSysPartsMode = 1 << 14
+    };
+
+    /**
+     * Determine which colors and modes differ between two theme states.
+     * \param oldState Old state.
+     * \param newState New state.
+     * \param options Frame color options to compare frame colors for.
+     * \param darkMode Dark mode to compare frame colors for.
+     * \returns Combination of ThemeChange values.
+     */
+    extern unsigned int DiffThemeStates (const ThemeState& oldState, const ThemeState& newState,
+                                         unsigned int options = fcDefault, DarkMode darkMode = DarkMode::Light);
+
+    /**
+     * Functions called on a background thread, e.g. to initialize COM,
+     * as invalidating a cache captures the theme state on that thread.
+     */
+    struct ThreadHooks
+    {
+        /// Called when the thread starts
+        std::function<HRESULT ()> start;
+        /// Called before the thread exits, if \c start succeeded
+        std::function<void ()> finish;
+    };
+
+    /**
+     * Intrusive node for waiting on a change of a ThemeCache's state.
+     * Registering a waiter with ThemeCache::AddWaiter() doesn't allocate,
+     * so waiters can be embedded e.g. in coroutine awaiters.
+     */
+    class ThemeChangeWaiter
+    {
+    public:
+        /**
+         * Constructor.
+         * \param changeMask Changes to wait for. Combination of ThemeChange values.
+         * \param options Frame color options to compare frame colors for.
+         * \param darkMode Dark mode to compare frame colors for.
+         */
+        explicit ThemeChangeWaiter (unsigned int changeMask = ~0u, unsigned int options = fcDefault,
+                                    DarkMode darkMode = DarkMode::Light)
+          : changeMask (changeMask), options (options), darkMode (darkMode), prev (nullptr), next (nullptr),
+            registered (false), generation (0), notification (nullptr) {}
+    protected:
+        ~ThemeChangeWaiter () {}
+
+        /**
+         * Called once when a matching change was published, on the publishing
+         * thread. The waiter is no longer registered at that point, so it may
+         * be destroyed from within this function. While this function runs,
+         * ThemeCache::RemoveWaiter() on other threads blocks until it returned.
+         * \param newState New cache state.
+         * \param changes Changes that happened. Combination of ThemeChange values.
+         */
+        virtual void OnThemeChange (const ThemeState& newState, unsigned int changes) = 0;
+    private:
+        friend class ThemeCache;
+
+        /// A notification in progress, owned by the notifying thread
+        struct Notification
+        {
+            /// Notifying thread
+            std::thread::id thread;
+            /// Notified waiter. Reset if the waiter was removed during the notification.
+            ThemeChangeWaiter* waiter;
+            /// Waiter to continue with. Advanced if that waiter is unlinked during the notification.
+            ThemeChangeWaiter* cursor;
+            /// Next notification in progress on the same cache
+            Notification* nextActive;
+        };
+
+        unsigned int changeMask;
+        unsigned int options;
+        DarkMode darkMode;
+        ThemeChangeWaiter* prev;
+        ThemeChangeWaiter* next;
+        bool registered;
+        /// Generation the waiter waits to change
+        uint64_t generation;
+        /// Notification in progress, if any
+        Notification* notification;
+    };
+
+    /**
+     * Cache of theme state, for use by many threads.
+     * Readers never block: the state is published through a sequence lock,
+     * so reading only needs to retry if a refresh happens concurrently.
+     * The cached state is refreshed only on explicit invalidation
+     * (e.g. in response to \c WM_SETTINGCHANGE), except for the very first
+     * read which captures the initial state.
+     */
+    class ThemeCache
+    {
+    public:
+        /// Function to capture a snapshot
+        typedef std::function<HRESULT (ThemeSnapshot&)> CaptureFunction;
+        /**
+         * Function called when the cached state changed.
+         * Receives the old and new state and a combination of ThemeChange values.
+         */
+        typedef std::function<void (const ThemeState& oldState, const ThemeState& newState,
+                                    unsigned int changes)> ChangeCallback;
+        /// Identifies a subscription
+        typedef uint64_t SubscriptionId;
+        /// Function receiving the state captured by a refresh that exceeded its budget
+        typedef std::function<void (const ThemeState& state)> RefreshCallback;
+
+        /**
+         * Constructor.
+         * \param capture Function to capture a snapshot.
+         * \param refreshHooks Functions to call on the thread running background refreshes.
+         */
+        explicit ThemeCache (CaptureFunction capture, ThreadHooks refreshHooks = ThreadHooks ());
+        /// Waits for a background refresh to finish.
+        ~ThemeCache ();
+
+        /**
+         * Obtain the current state.
+         * \returns Generation of the returned state.
+         */
+        uint64_t Read (ThemeState& state);
+        /**
+         * Returns the current generation.
+         * Cheap enough to be called frequently, e.g. to check whether
+         * resources derived from theme colors need to be recreated.
+         * Returns 0 if no state was captured yet.
+         */
+        uint64_t GetGeneration () const { return generation.load (std::memory_order_acquire); }
+
+        /// Get accent color from cached state. Optionally returns the state generation.
+        HRESULT GetAccentColor (AccentColor& color, uint64_t* stateGeneration = nullptr);
+        /// Get frame colors from cached state. Optionally returns the state generation.
+        HRESULT GetFrameColors (FrameColors& color, unsigned int options = fcDefault,
+                                DarkMode darkMode = DarkMode::Light, uint64_t* stateGeneration = nullptr);
+        /// Get all frame color variants from cached state. Optionally returns the state generation.
+        HRESULT GetAllFrameColorVariants (FrameColorVariants& variants, uint64_t* stateGeneration = nullptr);
+        /// Get system parts mode from cached state. Optionally returns the state generation.
+        HRESULT GetSysPartsMode (SysPartsMode& mode, uint64_t* stateGeneration = nullptr);
+
+        /**
+         * Capture a new snapshot and publish it.
+         * The generation is only incremented if the settings actually changed.
+         * \returns Result of the capture. On failure the cached state stays unchanged.
+         */
+        HRESULT Invalidate ();
+        /**
+         * Capture a new snapshot on a background thread, waiting at most \a budget for it.
+         * Only one background refresh runs at a time; calls made while one is
+         * running wait for that one instead of starting another.
+         * Never captures on the calling thread, so the call returns after
+         * \a budget even if capturing blocks.
+         * \param budget Maximum time to wait for the refresh.
+         * \param current Receives the refreshed state if the refresh finished in time,
+         *   otherwise the last known state.
+         * \param onComplete Function to call with the refreshed state if the refresh
+         *   did not finish in time. Called on the refreshing thread.
+         * \returns \c S_OK if \a current is the refreshed state. \c S_FALSE if
+         *   \a current is the last known state. \c E_PENDING if no state is known
+         *   yet; \a current is not changed in that case.
+         */
+        HRESULT RefreshWithin (std::chrono::milliseconds budget, ThemeState& current,
+                               RefreshCallback onComplete = RefreshCallback ());
+        /**
+         * Publish an externally obtained snapshot.
+         * The generation is only incremented if the settings actually changed.
+         * \returns New generation.
+         */
+        uint64_t Publish (const ThemeSnapshot& snapshot);
+        /**
+         * Publish a snapshot loaded from a persistent cache, if no state was captured yet.
+         * The published state has \c fromCache set until the next Invalidate()
+         * or Publish() verifies it. If the settings turn out to be unchanged,
+         * the generation stays the same and subscribers are not notified.
+         * \returns Whether the snapshot was published.
+         */
+        bool PublishCached (const ThemeSnapshot& snapshot);
+
+        /**
+         * Subscribe to changes of the cached state.
+         * The callback is invoked on the thread publishing a change, after the
+         * new state was published, and only if any color or mode compared by
+         * DiffThemeStates() changed. No lock is held while callbacks run, so
+         * they may call back into the cache (including Subscribe() and
+         * Unsubscribe()); if changes are published from several threads,
+         * callbacks may run concurrently.
+         * \param callback Function to call on changes.
+         * \param options Frame color options to compare frame colors for.
+         * \param darkMode Dark mode to compare frame colors for.
+         * \returns Subscription identifier, to be passed to Unsubscribe().
+         */
+        SubscriptionId Subscribe (ChangeCallback callback, unsigned int options = fcDefault,
+                                  DarkMode darkMode = DarkMode::Light);
+        /**
+         * End a subscription.
+         * \remarks A callback invocation already in progress on another thread
+         *   may still complete after this returns.
+         */
+        void Unsubscribe (SubscriptionId id);
+
+        /**
+         * Register a waiter for the next matching change of the cached state.
+         * Waiters are only notified of changes published after the state
+         * with generation \a generation.
+         * \returns Whether the waiter was registered. \c false if the current
+         *   generation is not \a generation anymore; the caller should read the
+         *   state instead of waiting.
+         */
+        bool AddWaiter (ThemeChangeWaiter& waiter, uint64_t generation);
+        /**
+         * Unregister a waiter. Returns whether it was still registered.
+         * If the waiter is being notified on another thread, waits until its
+         * ThemeChangeWaiter::OnThemeChange() returned, so the waiter may be
+         * destroyed after this call.
+         */
+        bool RemoveWaiter (ThemeChangeWaiter& waiter);
+    private:
+        CaptureFunction capture;
+        /// Serializes writers
+        std::mutex writeMutex;
+        /// Current state
+        detail::SeqLocked<ThemeState> state;
+        /// Generation of current state
+        std::atomic<uint64_t> generation;
+
+        struct Subscriber
+        {
+            SubscriptionId id;
+            ChangeCallback callback;
+            unsigned int options;
+            DarkMode darkMode;
+        };
+        typedef std::vector<Subscriber> SubscriberList;
+        /// Serializes changes to the subscriber list
+        std::mutex subscriberMutex;
+        /// Current subscribers. Replaced on changes, so it can be iterated without locking.
+        std::shared_ptr<const SubscriberList> subscribers;
+        SubscriptionId lastSubscriptionId;
+
+        /// Protects the waiter list
+        std::mutex waiterMutex;
+        /// First registered waiter
+        ThemeChangeWaiter* firstWaiter;
+        /// Waiter notifications in progress, to keep their cursors valid
+        ThemeChangeWaiter::Notification* activeNotifications;
+        /// Signalled when a waiter notification finished
+        std::condition_variable waiterNotified;
+
+        ThreadHooks refreshHooks;
+        /// Protects background refresh state
+        std::mutex refreshMutex;
+        /// Signalled when a background refresh finished
+        std::condition_variable refreshDone;
+        /// Whether a background refresh is running
+        bool refreshRunning;
+        /// Number of finished background refreshes
+        uint64_t refreshesFinished;
+        /// Functions to call when the running background refresh finished
+        std::vector<RefreshCallback> refreshCallbacks;
+        /// Background refresh thread
+        std::future<void> refreshThread;
+
+        /**
+         * Publish a snapshot, writeMutex must be held.
+         * \returns Whether the state changed. \a oldState and \a newState receive
+         *   the previous and the current state.
+         */
+        bool PublishLocked (const ThemeSnapshot& snapshot, ThemeState& oldState, ThemeState& newState);
+        /// Call subscribers for a state change
+        void NotifySubscribers (const ThemeState& oldState, const ThemeState& newState);
+        /// Call waiters matching a state change
+        void NotifyWaiters (const ThemeState& oldState, const ThemeState& newState);
+        /// Remove a waiter from the list, waiterMutex must be held
+        void UnlinkWaiter (ThemeChangeWaiter& waiter);
+        /// Capture initial state, if still needed
+        void EnsureInitialized ();
+        /// Body of the background refresh thread
+        void RunRefresh ();
+    };
+
+} // namespace windows10colors
+
+#endif // __WINDOWS10COLORSCACHE_H__
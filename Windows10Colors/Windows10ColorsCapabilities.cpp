@@ -0,0 +1,91 @@
+/*
+This library is licensed under the zlib license.
+
+Copyright (C) 2016-2018 Frank Richter
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+claim that you wrote the original software. If you use this software
+in a product, an acknowledgment in the product documentation would be
+appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+
+Original source:
+https://github.com/res2k/Windows10Colors
+
+*/
+#include "Windows10ColorsCapabilities.h"
+
+namespace windows10colors
+{
+
+CapabilityCache::CapabilityCache () : haveOSVersion (false)
+{
+    for (int i = 0; i < numCapabilities; i++)
+    {
+        unavailable[i].store (false, std::memory_order_relaxed);
+        skipped[i].store (0, std::memory_order_relaxed);
+    }
+}
+
+bool CapabilityCache::IsPermanentFailure (HRESULT hr)
+{
+    switch (hr)
+    {
+    case E_NOTIMPL:             // Functionality not present (eg WinRT missing)
+    case REGDB_E_CLASSNOTREG:   // Runtime class not registered
+    case E_NOINTERFACE:         // Interface not supported by OS version
+        return true;
+    }
+    return false;
+}
+
+bool CapabilityCache::ShouldTry (Capability capability)
+{
+    if (!unavailable[capability].load (std::memory_order_relaxed)) return true;
+    skipped[capability].fetch_add (1, std::memory_order_relaxed);
+    return false;
+}
+
+void CapabilityCache::RecordResult (Capability capability, HRESULT hr)
+{
+    if (IsPermanentFailure (hr)) unavailable[capability].store (true, std::memory_order_relaxed);
+}
+
+bool CapabilityCache::GetOSVersion (OSVersion& version) const
+{
+    if (!haveOSVersion.load (std::memory_order_acquire)) return false;
+    osVersion.Load (version);
+    return true;
+}
+
+void CapabilityCache::SetOSVersion (const OSVersion& version)
+{
+    std::lock_guard<std::mutex> lock (osVersionMutex);
+    osVersion.Store (version);
+    haveOSVersion.store (true, std::memory_order_release);
+}
+
+void CapabilityCache::Reset ()
+{
+    {
+        std::lock_guard<std::mutex> lock (osVersionMutex);
+        haveOSVersion.store (false, std::memory_order_relaxed);
+    }
+    for (int i = 0; i < numCapabilities; i++)
+    {
+        unavailable[i].store (false, std::memory_order_relaxed);
+        skipped[i].store (0, std::memory_order_relaxed);
+    }
+}
+
+} // namespace windows10colors
@@ -0,0 +1,102 @@
+/*
+This library is licensed under the zlib license.
+
+Copyright (C) 2016-2018 Frank Richter
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+claim that you wrote the original software. If you use this software
+in a product, an acknowledgment in the product documentation would be
+appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+
+Original source:
+https://github.com/res2k/Windows10Colors
+
+*/
+#ifndef __WINDOWS10COLORSCAPABILITIES_H__
+#define __WINDOWS10COLORSCAPABILITIES_H__
+
+/**\file
+ * Cache of permanent system capabilities, used to skip queries known to fail.
+ */
+
+#include "Windows10ColorsCore.h"
+#include "Windows10ColorsSeqLock.h"
+
+#include <atomic>
+#include <mutex>
+
+namespace windows10colors
+{
+    /// System capabilities tracked by CapabilityCache
+    enum Capability
+    {
+        /// WinRT runtime functions can be loaded
+        capWinRT,
+        /// UISettings can be activated and supports IUISettings3
+        capUISettings3,
+
+        numCapabilities
+    };
+
+    /**
+     * Remembers capabilities that are permanently unavailable on the running
+     * system, as well as the OS version.
+     * Only failures that can't change while the process is running are remembered
+     * (see IsPermanentFailure()); transient errors are retried on every call.
+     */
+    class CapabilityCache
+    {
+    public:
+        CapabilityCache ();
+
+        /// Whether an error means that a capability won't ever be available in this process
+        static bool IsPermanentFailure (HRESULT hr);
+
+        /**
+         * Check whether a capability should be tried.
+         * Returns \c false if it is known to be unavailable; this is counted as
+         * a skipped attempt.
+         */
+        bool ShouldTry (Capability capability);
+        /// Record the result of using a capability.
+        void RecordResult (Capability capability, HRESULT hr);
+        /// Whether a capability is known to be unavailable
+        bool IsUnavailable (Capability capability) const
+        {
+            return unavailable[capability].load (std::memory_order_relaxed);
+        }
+        /// Number of attempts skipped because a capability was known to be unavailable
+        unsigned long GetSkippedAttempts (Capability capability) const
+        {
+            return skipped[capability].load (std::memory_order_relaxed);
+        }
+
+        /// Get the cached OS version. Returns \c false if none was stored yet.
+        bool GetOSVersion (OSVersion& version) const;
+        /// Store the OS version.
+        void SetOSVersion (const OSVersion& version);
+
+        /// Forget everything known, including the OS version, and reset counters.
+        void Reset ();
+    private:
+        std::atomic<bool> unavailable[numCapabilities];
+        std::atomic<unsigned long> skipped[numCapabilities];
+
+        std::mutex osVersionMutex;
+        std::atomic<bool> haveOSVersion;
+        detail::SeqLocked<OSVersion> osVersion;
+    };
+} // namespace windows10colors
+
+#endif // __WINDOWS10COLORSCAPABILITIES_H__
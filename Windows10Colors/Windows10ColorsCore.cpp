@@ -0,0 +1,430 @@
+/*
+This library is licensed under the zlib license.
+
+Copyright (C) 2016-2018 Frank Richter
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+claim that you wrote the original software. If you use this software
+in a product, an acknowledgment in the product documentation would be
+appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+
+Original source:
+https://github.com/res2k/Windows10Colors
+
+*/
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif // NOMINMAX
+#include "Windows10ColorsCore.h"
+
+#include <algorithm>
+#include <stdlib.h>
+
+namespace windows10colors
+{
+
+namespace
+{
+    // HSV color space helper functions
+    struct HSV
+    {
+        int H, S, V;
+    };
+
+    static HSV RGBtoHSV (RGBA color)
+    {
+        HSV result;
+
+        // Compute color as HSV. Use range [0..0x8000]
+        int R = (GetRed (color) * 0x8000) / 255;
+        int G = (GetGreen (color) * 0x8000) / 255;
+        int B = (GetBlue (color) * 0x8000) / 255;
+        int maxComp = std::max (R, std::max (G, B));
+        int minComp = std::min (R, std::min (G, B));
+        int minMaxDiff = maxComp - minComp;
+        result.H = 0;
+        if (minMaxDiff != 0)
+        {
+            if (maxComp == R)
+            {
+                result.H = (((G - B) * 0x8000) / minMaxDiff);
+                if (result.H < 0) result.H += (6 * 0x8000);
+            }
+            else if (maxComp == G)
+            {
+                result.H = (((B - R) * 0x8000) / minMaxDiff) + (2 * 0x8000);
+            }
+            else
+            {
+                result.H = (((R - G) * 0x8000) / minMaxDiff) + (4 * 0x8000);
+            }
+        }
+        result.V = maxComp;
+        result.S = result.V != 0 ? (minMaxDiff * 0x8000) / result.V : 0;
+        return result;
+    }
+
+    static HSV Lighter (const HSV& prev, const HSV& base)
+    {
+        HSV result = prev;
+
+        // Shade: 25% of V
+        // If V >= 70%, reduce sat to 75% rel
+        int Vstep = base.V / 4;
+
+        result.V = std::min (prev.V + Vstep, 0x8000);
+        result.S = (result.V >= 22937) ? ((prev.S * 192) >> 8) : prev.S;
+        return result;
+    }
+
+    static HSV Darker (const HSV& prev, const HSV& base)
+    {
+        HSV result = prev;
+
+        // Shade: 25% of V
+        int Vstep = base.V / 4;
+
+        result.V = std::max (prev.V - Vstep, 0);
+        return result;
+    }
+
+    static RGBA HSVtoRGB (const HSV& color, unsigned int alpha)
+    {
+        int R, G, B;
+        int chroma = (color.V * color.S) / 0x8000;
+        int second = (chroma * (0x8000 - abs (int (color.H % (2 * 0x8000) - 0x8000)))) / 0x8000;
+        switch (color.H / 0x8000)
+        {
+        case 0:
+            R = chroma;
+            G = second;
+            B = 0;
+            break;
+        case 1:
+            R = second;
+            G = chroma;
+            B = 0;
+            break;
+        case 2:
+            R = 0;
+            G = chroma;
+            B = second;
+            break;
+        case 3:
+            R = 0;
+            G = second;
+            B = chroma;
+            break;
+        case 4:
+            R = second;
+            G = 0;
+            B = chroma;
+            break;
+        case 5:
+        default:
+            R = chroma;
+            G = 0;
+            B = second;
+            break;
+        }
+        int minComp = color.V - chroma;
+        return MakeRGBA (std::min (((R + minComp) * 255) / 0x8000, 255),
+                         std::min (((G + minComp) * 255) / 0x8000, 255),
+                         std::min (((B + minComp) * 255) / 0x8000, 255),
+                         alpha);
+    }
+}
+
+void GenerateAccentColors (RGBA base, AccentColor& color)
+{
+    GenerateAccentColors (base, color, shadeAll);
+}
+
+void GenerateAccentColors (RGBA base, AccentColor& color, unsigned int shades)
+{
+    if (shades & shadeAccent) color.accent = base;
+    if ((shades & ~shadeAccent) == 0) return;
+
+    // Compute shades. Each shade is derived from the previous one, so stop after the last requested one
+    HSV colorHSV = RGBtoHSV (base);
+
+    if (shades & (shadeLight | shadeLighter | shadeLightest))
+    {
+        HSV light = Lighter (colorHSV, colorHSV);
+        if (shades & shadeLight) color.light = HSVtoRGB (light, GetAlpha (base));
+        if (shades & (shadeLighter | shadeLightest))
+        {
+            light = Lighter (light, colorHSV);
+            if (shades & shadeLighter) color.lighter = HSVtoRGB (light, GetAlpha (base));
+            if (shades & shadeLightest)
+            {
+                light = Lighter (light, colorHSV);
+                color.lightest = HSVtoRGB (light, GetAlpha (base));
+            }
+        }
+    }
+
+    if (shades & (shadeDark | shadeDarker | shadeDarkest))
+    {
+        HSV dark = Darker (colorHSV, colorHSV);
+        if (shades & shadeDark) color.dark = HSVtoRGB (dark, GetAlpha (base));
+        if (shades & (shadeDarker | shadeDarkest))
+        {
+            dark = Darker (dark, colorHSV);
+            if (shades & shadeDarker) color.darker = HSVtoRGB (dark, GetAlpha (base));
+            if (shades & shadeDarkest)
+            {
+                dark = Darker (dark, colorHSV);
+                color.darkest = HSVtoRGB (dark, GetAlpha (base));
+            }
+        }
+    }
+}
+
+bool ResolveDarkMode (const ThemeInputs& inputs, DarkMode darkMode)
+{
+    if (darkMode == DarkMode::Auto)
+    {
+        /* Although the Dark Mode Apps setting was introduced in Win10 1809,
+         * only in 1903 the Explorer as a Win32 app started to consider it.
+         * Go with that. */
+        darkMode = IsOSVersionAtLeast (inputs.osVersion, 10, 0, 18362) ? DarkMode::User : DarkMode::Light;
+    }
+    if (darkMode == DarkMode::User)
+    {
+        return inputs.appsDarkMode;
+    }
+    return darkMode == DarkMode::Dark;
+}
+
+static FrameColors ComputeSystemFrameColors (const SystemColors& sysColors)
+{
+    FrameColors color;
+    color.activeCaptionBG = MakeOpaque (sysColors.activeCaption);
+    color.activeCaptionText = MakeOpaque (sysColors.captionText);
+    color.activeFrame = MakeOpaque (sysColors.captionText);
+    color.inactiveCaptionBG = MakeOpaque (sysColors.inactiveCaption);
+    RGBA rawInactiveCaptionText = MakeOpaque (sysColors.inactiveCaptionText);
+    color.inactiveFrame = MakeOpaque (sysColors.inactiveCaptionText);
+    color.inactiveCaptionText = BlendRGBA (rawInactiveCaptionText, color.inactiveCaptionBG, 0.6f);
+    return color;
+}
+
+static RGBA DefaultCaptionText (RGBA bg)
+{
+    bool textIsBright = IsColorDark (bg);
+    return textIsBright ? 0xffffffff : 0xff000000; // Colors seem static
+}
+
+FrameColors ComputeFrameColors (const ThemeInputs& inputs, unsigned int options, DarkMode darkMode)
+{
+    // High contrast colors -> use system colors
+    if (inputs.highContrast) return ComputeSystemFrameColors (inputs.sysColors);
+
+    FrameColors color;
+    bool isWin10 = IsOSVersionAtLeast (inputs.osVersion, 10, 0);
+    bool glassEffect = (options & fcGlassEffect) != 0;
+    bool useAccentColor = !isWin10 || ((options & fcTitleBarsColored) != 0)
+        || (!glassEffect && inputs.coloredTitleBars);
+
+    const DwmColors& dwmColors = inputs.dwmColors;
+    RGBA accent;
+    if (inputs.haveDwmColors && dwmColors.haveAccentColor)
+    {
+        /* Prefer AccentColor from registry, if present, as that typically matches the actual
+         * title bar color */
+        accent = dwmColors.AccentColor;
+    }
+    else
+    {
+        accent = inputs.accent;
+    }
+
+    bool isDarkMode = ResolveDarkMode (inputs, darkMode);
+    if (useAccentColor)
+    {
+        color.activeCaptionBG = accent;
+    }
+    else
+    {
+        color.activeCaptionBG = isDarkMode ? 0xff000000 : 0xffffffff;
+    }
+
+    color.activeCaptionText = DefaultCaptionText (color.activeCaptionBG);
+
+    if (glassEffect)
+    {
+        color.activeFrame = color.activeCaptionBG;
+    }
+    else if (IsOSVersionAtLeast (inputs.osVersion, 10, 0, 17763) && !useAccentColor)
+    {
+        /* After Windows 10, v1809 the frame color is controlled by the colored title bars option as well;
+         * it's not based on the DWM ColorizationColor if colored title bars are off */
+        color.activeFrame = 0xb2323232;
+    }
+    else
+    {
+        if (inputs.haveDwmColors)
+        {
+            const RGBA activeFrameBaseColor = 0xffd9d9d9;
+            // Frame color is based on DWM colors, though those usually coincide or are based on the accent color
+            if (dwmColors.ColorizationColorBalance >= 0)
+            {
+                color.activeFrame = BlendRGBA (activeFrameBaseColor,
+                                               MakeOpaque (dwmColors.ColorizationColor),
+                                               dwmColors.ColorizationColorBalance * 0.01f);
+            }
+            else
+            {
+                // Not sure, but matches observation
+                color.activeFrame = accent;
+            }
+        }
+        else
+        {
+            // Fallback
+            color.activeFrame = accent;
+        }
+    }
+
+    color.inactiveCaptionBG = isDarkMode ? 0xff2b2b2b : 0xffffffff;
+    RGBA rawInactiveCaptionText = DefaultCaptionText (color.inactiveCaptionBG);
+    // inactive frame: Probably a 0.5 blend of 0xffaaaaaa and 0. Maybe 0xffaaaaaa is itself a blend.
+    color.inactiveFrame = 0x7f565656;
+    color.inactiveCaptionText = BlendRGBA (rawInactiveCaptionText, color.inactiveCaptionBG, isDarkMode ? 0.4f : 0.6f);
+    // dark mode goal: 0xffaaaaaa
+
+    return color;
+}
+
+void ComputeAllFrameColorVariants (const ThemeInputs& inputs, FrameColorVariants& variants)
+{
+    for (unsigned int options = 0; options < 4; options++)
+    {
+        variants.colors[options][0] = ComputeFrameColors (inputs, options, DarkMode::Light);
+        variants.colors[options][1] = ComputeFrameColors (inputs, options, DarkMode::Dark);
+    }
+    variants.userDarkMode = ResolveDarkMode (inputs, DarkMode::User);
+    variants.autoDarkMode = ResolveDarkMode (inputs, DarkMode::Auto);
+}
+
+/// Compose DWM colorization color against background
+static RGBA ComposedColorizationColor (const DwmColors& dwmColors)
+{
+    return BlendRGBA (0xffffffff, MakeOpaque (dwmColors.ColorizationColor),
+                      GetAlpha (dwmColors.ColorizationColor) / 255.0f);
+}
+
+HRESULT GetAccentColor (const ThemeSnapshot& snapshot, AccentColor& color)
+{
+    if (SUCCEEDED (snapshot.uiSettingsResult))
+    {
+        color = snapshot.uiSettingsAccent;
+        return snapshot.uiSettingsResult;
+    }
+
+    if (snapshot.highContrast)
+    {
+        // Windows 10 High Contrast mode uses the same color for all shades
+        color.accent =
+        color.light =
+        color.lighter =
+        color.lightest =
+        color.dark =
+        color.darker =
+        color.darkest = MakeOpaque (snapshot.sysColors.highlight);
+    }
+    else if (SUCCEEDED (snapshot.dwmResult))
+    {
+        GenerateAccentColors (ComposedColorizationColor (snapshot.dwmColors), color);
+    }
+    else
+    {
+        GenerateAccentColors (MakeOpaque (snapshot.sysColors.activeCaption), color);
+    }
+    return S_ACCENT_COLOR_GUESSED;
+}
+
+ThemeInputs GetThemeInputs (const ThemeSnapshot& snapshot)
+{
+    ThemeInputs inputs;
+    inputs.osVersion = snapshot.osVersion;
+    inputs.highContrast = snapshot.highContrast;
+    inputs.sysColors = snapshot.sysColors;
+    inputs.haveDwmColors = SUCCEEDED (snapshot.dwmResult);
+    inputs.dwmColors = snapshot.dwmColors;
+    // Only obtain accent color - doesn't compute shades if using fallback
+    if (SUCCEEDED (snapshot.uiSettingsResult))
+        inputs.accent = snapshot.uiSettingsAccent.accent;
+    else if (inputs.haveDwmColors)
+        inputs.accent = ComposedColorizationColor (snapshot.dwmColors);
+    else
+        inputs.accent = snapshot.sysColors.activeCaption;
+    // DWM key on Windows 10 version 1607, Personalize key on 1511
+    if (snapshot.haveDwmColorPrevalence)
+        inputs.coloredTitleBars = snapshot.dwmColorPrevalence;
+    else if (SUCCEEDED (snapshot.personalizeColorPrevalenceResult))
+        inputs.coloredTitleBars = snapshot.personalizeColorPrevalence;
+    else
+        inputs.coloredTitleBars = false;
+    GetAppDarkModeEnabled (snapshot, inputs.appsDarkMode);
+    return inputs;
+}
+
+HRESULT GetFrameColors (const ThemeSnapshot& snapshot, FrameColors& color, unsigned int options, DarkMode darkMode)
+{
+    color = ComputeFrameColors (GetThemeInputs (snapshot), options, darkMode);
+    return S_OK;
+}
+
+HRESULT GetAllFrameColorVariants (const ThemeSnapshot& snapshot, FrameColorVariants& variants)
+{
+    ComputeAllFrameColorVariants (GetThemeInputs (snapshot), variants);
+    return S_OK;
+}
+
+HRESULT GetAppDarkModeEnabled (const ThemeSnapshot& snapshot, bool& darkMode)
+{
+    // Default: light mode
+    darkMode = SUCCEEDED (snapshot.appsUseLightThemeResult) && !snapshot.appsUseLightTheme;
+    return snapshot.appsUseLightThemeResult;
+}
+
+HRESULT GetSysPartsDarkModeEnabled (const ThemeSnapshot& snapshot, bool& darkMode)
+{
+    // Default: light mode
+    darkMode = SUCCEEDED (snapshot.systemUsesLightThemeResult) && !snapshot.systemUsesLightTheme;
+    return snapshot.systemUsesLightThemeResult;
+}
+
+HRESULT GetSysPartsMode (const ThemeSnapshot& snapshot, SysPartsMode& mode)
+{
+    mode = SysPartsMode::Dark;
+
+    HRESULT hr = snapshot.personalizeColorPrevalenceResult;
+    if (SUCCEEDED (hr) && snapshot.personalizeColorPrevalence)
+    {
+        mode = SysPartsMode::AccentColor;
+        return hr;
+    }
+
+    bool sysDarkMode;
+    hr = GetSysPartsDarkModeEnabled (snapshot, sysDarkMode);
+    if (SUCCEEDED (hr))
+        mode = sysDarkMode ? SysPartsMode::Dark : SysPartsMode::Light;
+    return hr;
+}
+
+} // namespace windows10colors
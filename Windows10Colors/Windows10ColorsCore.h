@@ -0,0 +1,495 @@
+/*
+This library is licensed under the zlib license.
+
+Copyright (C) 2016-2018 Frank Richter
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+claim that you wrote the original software. If you use this software
+in a product, an acknowledgment in the product documentation would be
+appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+
+Original source:
+https://github.com/res2k/Windows10Colors
+
+*/
+#ifndef __WINDOWS10COLORSCORE_H__
+#define __WINDOWS10COLORSCORE_H__
+
+/**\file
+ * Platform-independent color types and computations.
+ * Does not require the Windows headers on other platforms.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#else
+// Subset of HRESULT definitions used by the library
+typedef int32_t HRESULT;
+
+#define SUCCEEDED(hr)                   (((HRESULT)(hr)) >= 0)
+#define FAILED(hr)                      (((HRESULT)(hr)) < 0)
+#define MAKE_HRESULT(sev, fac, code)    ((HRESULT)(((uint32_t)(sev) << 31) | ((uint32_t)(fac) << 16) | ((uint32_t)(code))))
+#define HRESULT_FROM_WIN32(x)           ((HRESULT)(x) <= 0 ? ((HRESULT)(x)) : ((HRESULT)(((x) & 0x0000FFFF) | (7 << 16) | 0x80000000)))
+
+#define S_OK                            ((HRESULT)0)
+#define S_FALSE                         ((HRESULT)1)
+#define E_NOTIMPL                       ((HRESULT)0x80004001)
+#define E_NOINTERFACE                   ((HRESULT)0x80004002)
+#define E_POINTER                       ((HRESULT)0x80004003)
+#define E_ABORT                         ((HRESULT)0x80004004)
+#define E_FAIL                          ((HRESULT)0x80004005)
+#define E_PENDING                       ((HRESULT)0x8000000A)
+#define E_OUTOFMEMORY                   ((HRESULT)0x8007000E)
+#define E_INVALIDARG                    ((HRESULT)0x80070057)
+#define REGDB_E_CLASSNOTREG             ((HRESULT)0x80040154)
+#define CO_E_OBJNOTCONNECTED            ((HRESULT)0x800401FD)
+#define RPC_E_DISCONNECTED              ((HRESULT)0x80010108)
+#define RPC_E_SERVER_DIED_DNE           ((HRESULT)0x80010012)
+
+#define ERROR_SUCCESS                   0L
+#define ERROR_FILE_NOT_FOUND            2L
+#define ERROR_INVALID_DATA              13L
+#define ERROR_UNSUPPORTED_TYPE          1630L
+#endif
+
+namespace windows10colors
+{
+    static const HRESULT S_ACCENT_COLOR_GUESSED = MAKE_HRESULT (0, 0x457, 0xC);
+    /// Returned colors are the last known ones, as refreshing them took too long
+    static const HRESULT S_COLOR_REFRESH_PENDING = MAKE_HRESULT (0, 0x457, 0xD);
+
+    /**
+     * RGBA color. Red is in the LSB, Alpha in the MSB.
+     * You can use GetRed() et al (or GetRValue() et al on Windows) to access
+     * individual components.
+     */
+#if defined(_WIN32)
+    typedef unsigned long RGBA; // Same as DWORD
+#else
+    typedef uint32_t RGBA;
+#endif
+
+    /// Get red component of an RGBA color
+    static inline uint8_t GetRed (RGBA rgba)
+    {
+        return rgba & 0xff;
+    }
+
+    /// Get green component of an RGBA color
+    static inline uint8_t GetGreen (RGBA rgba)
+    {
+        return (rgba >> 8) & 0xff;
+    }
+
+    /// Get blue component of an RGBA color
+    static inline uint8_t GetBlue (RGBA rgba)
+    {
+        return (rgba >> 16) & 0xff;
+    }
+
+    /// Get alpha component of an RGBA color
+    static inline uint8_t GetAlpha (RGBA rgba)
+    {
+        return (rgba >> 24) & 0xff;
+    }
+
+    /// Construct an RGBA color from components
+    static inline RGBA MakeRGBA (uint8_t R, uint8_t G, uint8_t B, uint8_t A)
+    {
+        return static_cast<RGBA> (R) | (static_cast<RGBA> (G) << 8)
+            | (static_cast<RGBA> (B) << 16) | (static_cast<RGBA> (A) << 24);
+    }
+
+    /// Return a color with the same RGB components but full opacity
+    static inline RGBA MakeOpaque (RGBA base)
+    {
+        return base | 0xff000000;
+    }
+
+    /**
+     * Linearly interpolate between two colors (including alpha).
+     * \param a First color.
+     * \param b Second color.
+     * \param f Interpolation factor. 0 returns \a a, 1 returns \a b.
+     */
+    static inline RGBA BlendRGBA (RGBA a, RGBA b, float f)
+    {
+        float a_factor = 1.f - f;
+        float b_factor = f;
+        return MakeRGBA (static_cast<int> (GetRed (a) * a_factor + GetRed (b) * b_factor),
+                         static_cast<int> (GetGreen (a) * a_factor + GetGreen (b) * b_factor),
+                         static_cast<int> (GetBlue (a) * a_factor + GetBlue (b) * b_factor),
+                         static_cast<int> (GetAlpha (a) * a_factor + GetAlpha (b) * b_factor));
+    }
+
+    /**
+     * Returns whether some color is 'dark' for the purpose of finding a contrasting
+     * color - e.g. given some background color, use the 'dark' property to choose
+     * an appropriate text (foreground) color.
+     * Formula matches the one in https://learn.microsoft.com/en-us/windows/apps/desktop/modernize/apply-windows-themes
+     */
+    static inline bool IsColorDark (RGBA color)
+    {
+      return (GetRed (color) * 2 + GetGreen (color) * 5 + GetBlue (color)) <= 1024;
+    }
+
+    /// Accent color shades
+    struct AccentColor
+    {
+        /// Base accent color
+        RGBA accent;
+        /// Darkest shade.
+        RGBA darkest;
+        /// Darker shade.
+        RGBA darker;
+        /// Dark shade.
+        RGBA dark;
+        /// Light shade.
+        RGBA light;
+        /// Lighter shade.
+        RGBA lighter;
+        /// Lightest shade.
+        RGBA lightest;
+    };
+
+    /// Shades of an accent color, for selective queries. Values can be combined.
+    enum AccentShade
+    {
+        /// Base accent color (AccentColor::accent)
+        shadeAccent = 1,
+        /// AccentColor::dark
+        shadeDark = 2,
+        /// AccentColor::darker
+        shadeDarker = 4,
+        /// AccentColor::darkest
+        shadeDarkest = 8,
+        /// AccentColor::light
+        shadeLight = 16,
+        /// AccentColor::lighter
+        shadeLighter = 32,
+        /// AccentColor::lightest
+        shadeLightest = 64,
+
+        /// All shades
+        shadeAll = 127
+    };
+
+    /// Colors for Windows 10 frame painting.
+    struct FrameColors
+    {
+        /// Color of text for active captions.
+        RGBA activeCaptionText;
+        /// Background color of active captions.
+        RGBA activeCaptionBG;
+        /**
+         * Frame color of active windows.
+         * \remarks Usually the frame is drawn by DWM.
+         */
+        RGBA activeFrame;
+        /// Color of text for inactive captions.
+        RGBA inactiveCaptionText;
+        /// Background color of inactive captions.
+        RGBA inactiveCaptionBG;
+        /**
+        * Frame color of inactive windows.
+        * \remarks Usually the frame is drawn by DWM.
+        */
+        RGBA inactiveFrame;
+    };
+
+    /// Frame color options
+    enum FrameColorOption
+    {
+        /// Default frame colors
+        fcDefault = 0,
+        /**
+         * Whether to compute colors for a window with an enabled "sheet of glass" effect.
+         * This is the case if blur behind was enabled for a window with a valid opaque
+         * client area (i.e. only positive margins passed to DwmExtendFrameIntoClientArea).
+         * The resulting colors will emulate a "composed" appearance.
+         */
+        fcGlassEffect = 1,
+        /**
+         * Always compute title bar colors as if they were colored.
+         * Otherwise uses current system setting.
+         */
+        fcTitleBarsColored = 2
+    };
+
+    /// Dark mode colors selections
+    enum struct DarkMode
+    {
+        /**
+         * Choose dark mode depending on Windows version:
+         * User on Windows 1903 and newer, Light otherwise.
+         */
+        Auto,
+        /// Use user setting for Dark Mode
+        User,
+        /// Use light mode
+        Light,
+        /// Use dark mode
+        Dark
+    };
+
+    /// Mode (colorization) of system parts (start menu, taskbar).
+    enum struct SysPartsMode
+    {
+        /// Accent color is used
+        AccentColor,
+        /// Dark mode is used
+        Dark,
+        /// Light mode is used
+        Light
+    };
+
+    /**
+     * Compute accent color shades from a base color.
+     * This is used to guess shades if the actual accent color can't be obtained.
+     */
+    extern void GenerateAccentColors (RGBA base, AccentColor& color);
+    /**
+     * Compute selected accent color shades from a base color.
+     * \param base Base color.
+     * \param color Receives computed shades. Shades not requested are left unchanged.
+     * \param shades Shades to compute. Combination of AccentShade values.
+     */
+    extern void GenerateAccentColors (RGBA base, AccentColor& color, unsigned int shades);
+
+    /**
+     * Compute accent color shades for a number of base colors.
+     * Results are identical to calling GenerateAccentColors() for each color,
+     * but processing is vectorized if the CPU supports it.
+     * \param base Array of \a count base colors.
+     * \param colors Array receiving \a count computed accent color shades.
+     * \param count Number of colors to process.
+     */
+    extern void GenerateAccentColors (const RGBA* base, AccentColor* colors, size_t count);
+
+    /// Implementations of the batch accent color computation
+    enum struct AccentColorsISA
+    {
+        /// Portable implementation, computing one color at a time
+        Scalar,
+        /// SSE2 kernel, two colors at a time
+        SSE2,
+        /// AVX kernel, four colors at a time
+        AVX
+    };
+
+    /**
+     * Compute accent color shades for a number of base colors, with a specific implementation.
+     * Meant for testing and benchmarking the implementations against each other.
+     * \returns Whether the implementation is available on this platform and CPU.
+     *   If not, \a colors is left unchanged.
+     */
+    extern bool GenerateAccentColors (AccentColorsISA isa, const RGBA* base, AccentColor* colors, size_t count);
+
+    /// Operating system version
+    struct OSVersion
+    {
+        /// Major version number
+        unsigned int major;
+        /// Minor version number
+        unsigned int minor;
+        /// Build number
+        unsigned int build;
+    };
+
+    /// Returns whether \a version is at least major.minor.build.
+    static inline bool IsOSVersionAtLeast (const OSVersion& version, unsigned int major,
+                                           unsigned int minor, unsigned int build = 0)
+    {
+        if (version.major != major) return version.major > major;
+        if (version.minor != minor) return version.minor > minor;
+        return version.build >= build;
+    }
+
+    /// Colors stored by DWM in the registry
+    struct DwmColors
+    {
+        /// Colorization color
+        RGBA ColorizationColor;
+        /// Colorization color balance (percentage)
+        int ColorizationColorBalance;
+        /// Whether \c AccentColor is valid
+        bool haveAccentColor;
+        /// Accent color as used by DWM
+        RGBA AccentColor;
+    };
+
+    /// System colors (as returned by GetSysColor()) used for frame painting
+    struct SystemColors
+    {
+        /// COLOR_ACTIVECAPTION
+        RGBA activeCaption;
+        /// COLOR_CAPTIONTEXT
+        RGBA captionText;
+        /// COLOR_INACTIVECAPTION
+        RGBA inactiveCaption;
+        /// COLOR_INACTIVECAPTIONTEXT
+        RGBA inactiveCaptionText;
+        /// COLOR_HIGHLIGHT
+        RGBA highlight;
+    };
+
+    /**
+     * All system settings frame colors are derived from.
+     * On Windows, these are obtained from the registry, WinRT and various APIs;
+     * ComputeFrameColors() itself does not do any system queries.
+     */
+    struct ThemeInputs
+    {
+        /// Version of the OS to compute the colors for
+        OSVersion osVersion;
+        /// Whether high contrast mode is enabled
+        bool highContrast;
+        /// System colors. Used in high contrast mode.
+        SystemColors sysColors;
+        /// Whether \c dwmColors is valid
+        bool haveDwmColors;
+        /// DWM colors
+        DwmColors dwmColors;
+        /**
+         * Accent color (or a guess for it).
+         * Only used if \c dwmColors doesn't provide an accent color.
+         */
+        RGBA accent;
+        /// Whether title bars are colored with the accent color ("ColorPrevalence")
+        bool coloredTitleBars;
+        /// Whether "Dark Mode" is enabled for apps
+        bool appsDarkMode;
+    };
+
+    /**
+     * Resolve a DarkMode value to an actual light/dark decision.
+     * \returns Whether dark mode colors should be used.
+     */
+    extern bool ResolveDarkMode (const ThemeInputs& inputs, DarkMode darkMode);
+
+    /**
+     * Compute colors used to paint window frames from explicitly given inputs.
+     * \param inputs System settings to compute the colors from.
+     * \param options Frame color options. Combination of FrameColorOption values.
+     * \param darkMode Whether to use Dark Mode colors.
+     * \sa GetFrameColors()
+     */
+    extern FrameColors ComputeFrameColors (const ThemeInputs& inputs, unsigned int options = fcDefault,
+                                           DarkMode darkMode = DarkMode::Light);
+
+    /**
+     * Frame colors for all combinations of frame color options and light/dark mode.
+     * Switching between variants is a table lookup, see Get().
+     */
+    struct FrameColorVariants
+    {
+        /**
+         * Frame colors, indexed by options (combination of FrameColorOption values)
+         * and dark mode (0: light, 1: dark).
+         */
+        FrameColors colors[4][2];
+        /// Whether DarkMode::User resolves to dark mode
+        bool userDarkMode;
+        /// Whether DarkMode::Auto resolves to dark mode
+        bool autoDarkMode;
+
+        /// Resolve a DarkMode value to an actual light/dark decision.
+        bool IsDarkMode (DarkMode darkMode) const
+        {
+            switch (darkMode)
+            {
+            case DarkMode::Auto:    return autoDarkMode;
+            case DarkMode::User:    return userDarkMode;
+            case DarkMode::Light:   break;
+            case DarkMode::Dark:    return true;
+            }
+            return false;
+        }
+        /// Get frame colors for the given options and dark mode.
+        const FrameColors& Get (unsigned int options = fcDefault, DarkMode darkMode = DarkMode::Light) const
+        {
+            return colors[options & (fcGlassEffect | fcTitleBarsColored)][IsDarkMode (darkMode) ? 1 : 0];
+        }
+    };
+
+    /**
+     * Compute all frame color variants from explicitly given inputs.
+     * \sa ComputeFrameColors()
+     */
+    extern void ComputeAllFrameColorVariants (const ThemeInputs& inputs, FrameColorVariants& variants);
+
+    /**
+     * Snapshot of all system settings relevant for accent and frame colors.
+     * On Windows, use CaptureThemeSnapshot() to obtain it; the overloads of
+     * GetAccentColor(), GetFrameColors() etc. taking a snapshot derive their
+     * results from it without querying the system again.
+     */
+    struct ThemeSnapshot
+    {
+        /// Version of the OS
+        OSVersion osVersion;
+        /// Whether high contrast mode is enabled
+        bool highContrast;
+        /// System colors
+        SystemColors sysColors;
+        /// Result of obtaining the accent colors from UISettings
+        HRESULT uiSettingsResult;
+        /// Accent colors from UISettings. Valid if \c uiSettingsResult indicates success.
+        AccentColor uiSettingsAccent;
+        /// Result of obtaining the DWM colors
+        HRESULT dwmResult;
+        /// DWM colors. Valid if \c dwmResult indicates success.
+        DwmColors dwmColors;
+        /// Whether the DWM key contains a \c ColorPrevalence value
+        bool haveDwmColorPrevalence;
+        /// \c ColorPrevalence value from the DWM key
+        bool dwmColorPrevalence;
+        /// Result of reading \c ColorPrevalence from the Personalize key
+        HRESULT personalizeColorPrevalenceResult;
+        /// \c ColorPrevalence value from the Personalize key
+        bool personalizeColorPrevalence;
+        /// Result of reading \c AppsUseLightTheme
+        HRESULT appsUseLightThemeResult;
+        /// \c AppsUseLightTheme value
+        bool appsUseLightTheme;
+        /// Result of reading \c SystemUsesLightTheme
+        HRESULT systemUsesLightThemeResult;
+        /// \c SystemUsesLightTheme value
+        bool systemUsesLightTheme;
+        /// Number of system calls made to capture the snapshot
+        unsigned int systemCalls;
+    };
+
+    /// Derive accent color from a snapshot. \sa GetAccentColor()
+    extern HRESULT GetAccentColor (const ThemeSnapshot& snapshot, AccentColor& color);
+    /// Derive inputs for ComputeFrameColors() from a snapshot
+    extern ThemeInputs GetThemeInputs (const ThemeSnapshot& snapshot);
+    /// Derive frame colors from a snapshot. \sa GetFrameColors()
+    extern HRESULT GetFrameColors (const ThemeSnapshot& snapshot, FrameColors& color,
+                                   unsigned int options = fcDefault, DarkMode darkMode = DarkMode::Light);
+    /// Derive all frame color variants from a snapshot. \sa GetAllFrameColorVariants()
+    extern HRESULT GetAllFrameColorVariants (const ThemeSnapshot& snapshot, FrameColorVariants& variants);
+    /// Derive app "Dark Mode" setting from a snapshot. \sa GetAppDarkModeEnabled()
+    extern HRESULT GetAppDarkModeEnabled (const ThemeSnapshot& snapshot, bool& darkMode);
+    /// Derive system parts "Dark Mode" setting from a snapshot. \sa GetSysPartsDarkModeEnabled()
+    extern HRESULT GetSysPartsDarkModeEnabled (const ThemeSnapshot& snapshot, bool& darkMode);
+    /// Derive system parts mode from a snapshot. \sa GetSysPartsMode()
+    extern HRESULT GetSysPartsMode (const ThemeSnapshot& snapshot, SysPartsMode& mode);
+
+} // namespace windows10colors
+
+#endif // __WINDOWS10COLORSCORE_H__
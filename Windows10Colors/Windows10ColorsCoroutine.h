@@ -0,0 +1,223 @@
+/*
+This library is licensed under the zlib license.
+
+Copyright (C) 2016-2018 Frank Richter
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+claim that you wrote the original software. If you use this software
+in a product, an acknowledgment in the product documentation would be
+appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+
+Original source:
+https://github.com/res2k/Windows10Colors
+
+*/
+#ifndef __WINDOWS10COLORSCOROUTINE_H__
+#define __WINDOWS10COLORSCOROUTINE_H__
+
+/**\file
+ * C++20 coroutine support: awaiting theme changes and querying colors asynchronously.
+ * Only available if the compiler supports coroutines; \c W10C_HAVE_COROUTINES
+ * is defined in that case.
+ */
+
+#include "Windows10ColorsCache.h"
+
+#if defined(__cpp_impl_coroutine) && (__cpp_impl_coroutine >= 201902L)
+#include <coroutine>
+
+#if defined(_WIN32)
+#include "Windows10Colors.h"
+#endif
+
+#define W10C_HAVE_COROUTINES
+
+namespace windows10colors
+{
+    /**
+     * Executor resuming coroutines right away, on the thread that completed
+     * the awaited operation.
+     * Executors are callables receiving a \c std::coroutine_handle<> to resume;
+     * pass your own to resume coroutines e.g. on a UI thread.
+     */
+    struct InlineExecutor
+    {
+        void operator() (std::coroutine_handle<> handle) const { handle.resume (); }
+    };
+
+    /**
+     * Awaiter for a change of a ThemeCache's state, returned by NextThemeChange().
+     * The waiter node is part of the awaiter (and thus of the coroutine frame),
+     * so awaiting doesn't allocate.
+     */
+    template<typename Executor>
+    class ThemeChangeAwaiter : private ThemeChangeWaiter
+    {
+    public:
+        ThemeChangeAwaiter (ThemeCache& cache, uint64_t generation, Executor executor,
+                            unsigned int changeMask, unsigned int options, DarkMode darkMode)
+          : ThemeChangeWaiter (changeMask, options, darkMode), cache (cache), generation (generation),
+            executor (std::move (executor)) {}
+        /**
+         * Stops waiting, in case the awaiting coroutine was destroyed while suspended.
+         * If another thread is resuming the coroutine at that time, waits until
+         * the executor returned.
+         */
+        ~ThemeChangeAwaiter () { cache.RemoveWaiter (*this); }
+
+        bool await_ready ()
+        {
+            cache.Read (state);
+            return state.generation != generation;
+        }
+        bool await_suspend (std::coroutine_handle<> awaiting)
+        {
+            handle = awaiting;
+            if (cache.AddWaiter (*this, generation)) return true;
+            // State changed since await_ready()
+            cache.Read (state);
+            return false;
+        }
+        ThemeState await_resume () const { return state; }
+    private:
+        ThemeCache& cache;
+        uint64_t generation;
+        Executor executor;
+        std::coroutine_handle<> handle;
+        ThemeState state;
+
+        void OnThemeChange (const ThemeState& newState, unsigned int) override
+        {
+            state = newState;
+            executor (handle);
+        }
+
+        ThemeChangeAwaiter (const ThemeChangeAwaiter&) = delete;
+        ThemeChangeAwaiter& operator= (const ThemeChangeAwaiter&) = delete;
+    };
+
+    /**
+     * Wait for a relevant change of the cached theme state.
+     * \param cache Cache to watch.
+     * \param generation Generation of the state the caller knows about.
+     * \param executor Executor used to resume the awaiting coroutine.
+     * \param changeMask Changes to wait for. Combination of ThemeChange values.
+     * \param options Frame color options to compare frame colors for.
+     * \param darkMode Dark mode to compare frame colors for.
+     * \returns Awaitable yielding the new ThemeState. Completes immediately if the
+     *   cache generation isn't \a generation anymore, as changes were missed then.
+     */
+    template<typename Executor = InlineExecutor>
+    ThemeChangeAwaiter<Executor> NextThemeChange (ThemeCache& cache, uint64_t generation,
+                                                  Executor executor = Executor (), unsigned int changeMask = ~0u,
+                                                  unsigned int options = fcDefault,
+                                                  DarkMode darkMode = DarkMode::Light)
+    {
+        return ThemeChangeAwaiter<Executor> (cache, generation, std::move (executor), changeMask, options, darkMode);
+    }
+
+    /// Result of GetFrameColorsAsync()
+    struct FrameColorsResult
+    {
+        /// Result of GetFrameColors()
+        HRESULT result;
+        /// Frame colors
+        FrameColors colors;
+    };
+
+    /// Awaiter for frame colors, returned by GetFrameColorsAsync()
+    template<typename Executor>
+    class FrameColorsAwaiter
+    {
+    public:
+        FrameColorsAwaiter (ThemeCache& cache, unsigned int options, DarkMode darkMode, Executor executor)
+          : cache (cache), options (options), darkMode (darkMode), executor (std::move (executor)) {}
+
+        bool await_ready () const { return false; }
+        bool await_suspend (std::coroutine_handle<> awaiting)
+        {
+            handle = awaiting;
+            /* The callback may run before RefreshWithin() returns, so the
+             * awaiter must not be touched after a callback was registered. */
+            ThemeState current;
+            HRESULT hr = cache.RefreshWithin (std::chrono::milliseconds (0), current,
+                                              [this](const ThemeState& refreshed)
+                                              {
+                                                  SetColors (refreshed);
+                                                  executor (handle);
+                                              });
+            if (hr != S_OK) return true;
+            // Refreshed already, callback won't be called
+            SetColors (current);
+            return false;
+        }
+        FrameColorsResult await_resume () const { return colors; }
+    private:
+        ThemeCache& cache;
+        unsigned int options;
+        DarkMode darkMode;
+        Executor executor;
+        std::coroutine_handle<> handle;
+        FrameColorsResult colors;
+
+        void SetColors (const ThemeState& state)
+        {
+            colors.result = windows10colors::GetFrameColors (state.snapshot, colors.colors, options, darkMode);
+        }
+
+        FrameColorsAwaiter (const FrameColorsAwaiter&) = delete;
+        FrameColorsAwaiter& operator= (const FrameColorsAwaiter&) = delete;
+    };
+
+    /**
+     * Get colors used to paint window frames from a freshly captured theme state.
+     * Capturing happens on the cache's background refresh thread; the awaiting
+     * coroutine is resumed through \a executor when it finished.
+     * \param cache Cache to refresh.
+     * \param options Frame color options. Combination of FrameColorOption values.
+     * \param darkMode Whether to use Dark Mode colors.
+     * \param executor Executor used to resume the awaiting coroutine.
+     */
+    template<typename Executor = InlineExecutor>
+    FrameColorsAwaiter<Executor> GetFrameColorsAsync (ThemeCache& cache, unsigned int options = fcDefault,
+                                                      DarkMode darkMode = DarkMode::Light,
+                                                      Executor executor = Executor ())
+    {
+        return FrameColorsAwaiter<Executor> (cache, options, darkMode, std::move (executor));
+    }
+
+#if defined(_WIN32)
+    /// Wait for a relevant change of GetThemeCache(). See NextThemeChange(ThemeCache&, uint64_t, Executor, unsigned int, unsigned int, DarkMode).
+    template<typename Executor = InlineExecutor>
+    ThemeChangeAwaiter<Executor> NextThemeChange (uint64_t generation, Executor executor = Executor (),
+                                                  unsigned int changeMask = ~0u, unsigned int options = fcDefault,
+                                                  DarkMode darkMode = DarkMode::Light)
+    {
+        return NextThemeChange (GetThemeCache (), generation, std::move (executor), changeMask, options, darkMode);
+    }
+
+    /// Get frame colors from a freshly captured state of GetThemeCache(). See GetFrameColorsAsync(ThemeCache&, unsigned int, DarkMode, Executor).
+    template<typename Executor = InlineExecutor>
+    FrameColorsAwaiter<Executor> GetFrameColorsAsync (unsigned int options = fcDefault,
+                                                      DarkMode darkMode = DarkMode::Light,
+                                                      Executor executor = Executor ())
+    {
+        return GetFrameColorsAsync (GetThemeCache (), options, darkMode, std::move (executor));
+    }
+#endif
+} // namespace windows10colors
+
+#endif // defined(__cpp_impl_coroutine)
+
+#endif // __WINDOWS10COLORSCOROUTINE_H__
@@ -0,0 +1,222 @@
+/*
+This library is licensed under the zlib license.
+
+Copyright (C) 2016-2018 Frank Richter
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+claim that you wrote the original software. If you use this software
+in a product, an acknowledgment in the product documentation would be
+appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+
+Original source:
+https://github.com/res2k/Windows10Colors
+
+*/
+#include "Windows10ColorsFileSettings.h"
+
+#if !defined(_WIN32)
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <wctype.h>
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#endif
+
+namespace windows10colors
+{
+
+static const char* KeyFileName (SettingsKey key)
+{
+    switch (key)
+    {
+    case SettingsKey::DWM:          return "DWM";
+    case SettingsKey::Personalize:  return "Personalize";
+    }
+    return "";
+}
+
+// Compare a (narrow) value name from a file with a (wide) value name, ignoring case
+static bool SameValueName (const char* fileName, size_t fileNameLen, const wchar_t* name)
+{
+    for (size_t i = 0; i < fileNameLen; i++, name++)
+    {
+        if (*name == 0) return false;
+        if (towlower (static_cast<unsigned char> (fileName[i])) != towlower (*name)) return false;
+    }
+    return *name == 0;
+}
+
+static HRESULT LastErrorResult ()
+{
+    return MAKE_HRESULT (1, 0x7, errno & 0xffff);
+}
+
+FileSettingsStore::FileSettingsStore (const std::string& directory) : directory (directory), notifyFD (-1)
+{
+    stopPipe[0] = stopPipe[1] = -1;
+}
+
+FileSettingsStore::~FileSettingsStore ()
+{
+    CloseWatch ();
+}
+
+std::string FileSettingsStore::GetKeyPath (SettingsKey key) const
+{
+    return directory + "/" + KeyFileName (key);
+}
+
+HRESULT FileSettingsStore::QueryValues (SettingsKey key, size_t count, const wchar_t* const* names,
+                                        uint32_t* values, HRESULT* results)
+{
+    FILE* file = fopen (GetKeyPath (key).c_str (), "r");
+    if (!file) return HRESULT_FROM_WIN32 (ERROR_FILE_NOT_FOUND);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        results[i] = HRESULT_FROM_WIN32 (ERROR_FILE_NOT_FOUND);
+    }
+
+    char line[256];
+    while (fgets (line, sizeof (line), file))
+    {
+        const char* equals = strchr (line, '=');
+        if (!equals) continue;
+        size_t nameLen = equals - line;
+        for (size_t i = 0; i < count; i++)
+        {
+            if (!SameValueName (line, nameLen, names[i])) continue;
+            char* end;
+            errno = 0;
+            unsigned long v = strtoul (equals + 1, &end, 0);
+            while ((*end == ' ') || (*end == '\t') || (*end == '\r') || (*end == '\n')) end++;
+            if ((end == equals + 1) || (*end != 0) || (errno != 0) || (v > 0xffffffffUL))
+            {
+                results[i] = HRESULT_FROM_WIN32 (ERROR_INVALID_DATA);
+            }
+            else
+            {
+                values[i] = static_cast<uint32_t> (v);
+                results[i] = S_OK;
+            }
+        }
+    }
+
+    fclose (file);
+    return S_OK;
+}
+
+void FileSettingsStore::CloseWatch ()
+{
+    if (notifyFD >= 0) close (notifyFD);
+    notifyFD = -1;
+    for (int& fd : stopPipe)
+    {
+        if (fd >= 0) close (fd);
+        fd = -1;
+    }
+}
+
+HRESULT FileSettingsStore::StartWatching ()
+{
+#if defined(__linux__)
+    CloseWatch ();
+    if (pipe2 (stopPipe, O_CLOEXEC | O_NONBLOCK) != 0)
+    {
+        HRESULT hr = LastErrorResult ();
+        stopPipe[0] = stopPipe[1] = -1;
+        return hr;
+    }
+    notifyFD = inotify_init1 (IN_CLOEXEC | IN_NONBLOCK);
+    if (notifyFD < 0)
+    {
+        HRESULT hr = LastErrorResult ();
+        CloseWatch ();
+        return hr;
+    }
+    // Watch the directory, to also catch files being replaced
+    if (inotify_add_watch (notifyFD, directory.c_str (),
+                           IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO) < 0)
+    {
+        HRESULT hr = LastErrorResult ();
+        CloseWatch ();
+        return hr;
+    }
+    return S_OK;
+#else
+    return E_NOTIMPL;
+#endif
+}
+
+HRESULT FileSettingsStore::WaitForChange ()
+{
+#if defined(__linux__)
+    if (notifyFD < 0) return E_FAIL;
+
+    while (true)
+    {
+        pollfd fds[2] = { { stopPipe[0], POLLIN, 0 }, { notifyFD, POLLIN, 0 } };
+        if (poll (fds, 2, -1) < 0)
+        {
+            if (errno == EINTR) continue;
+            return LastErrorResult ();
+        }
+        if (fds[0].revents != 0) return S_FALSE;
+        if (fds[1].revents == 0) continue;
+
+        // Only report changes to the key files
+        bool keyChanged = false;
+        alignas (inotify_event) char buffer[4096];
+        ssize_t len;
+        while ((len = read (notifyFD, buffer, sizeof (buffer))) > 0)
+        {
+            for (char* p = buffer; p < buffer + len; )
+            {
+                const inotify_event* event = reinterpret_cast<const inotify_event*> (p);
+                if ((event->len > 0)
+                    && ((strcmp (event->name, KeyFileName (SettingsKey::DWM)) == 0)
+                        || (strcmp (event->name, KeyFileName (SettingsKey::Personalize)) == 0)))
+                {
+                    keyChanged = true;
+                }
+                p += sizeof (inotify_event) + event->len;
+            }
+        }
+        if (keyChanged) return S_OK;
+    }
+#else
+    return E_NOTIMPL;
+#endif
+}
+
+void FileSettingsStore::StopWaiting ()
+{
+    if (stopPipe[1] >= 0)
+    {
+        char c = 0;
+        ssize_t written = write (stopPipe[1], &c, 1);
+        (void)written;
+    }
+}
+
+} // namespace windows10colors
+
+#endif // !defined(_WIN32)
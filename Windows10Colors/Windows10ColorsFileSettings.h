@@ -0,0 +1,78 @@
+/*
+This library is licensed under the zlib license.
+
+Copyright (C) 2016-2018 Frank Richter
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+claim that you wrote the original software. If you use this software
+in a product, an acknowledgment in the product documentation would be
+appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+
+Original source:
+https://github.com/res2k/Windows10Colors
+
+*/
+#ifndef __WINDOWS10COLORSFILESETTINGS_H__
+#define __WINDOWS10COLORSFILESETTINGS_H__
+
+/**\file
+ * Settings store backed by plain files, for use on non-Windows platforms.
+ */
+
+#include "Windows10ColorsSettings.h"
+
+#if !defined(_WIN32)
+
+#include <string>
+
+namespace windows10colors
+{
+    /**
+     * Settings store reading values from files in a directory.
+     * Each key is a file (\c DWM, \c Personalize) with lines of the form
+     * <tt>Name=Value</tt>. Values are parsed as C integer literals, so both
+     * decimal and <tt>0x</tt> prefixed hexadecimal values are accepted.
+     * Value names are matched case-insensitively, like registry value names.
+     * Changes are watched with inotify (Linux only).
+     */
+    class FileSettingsStore : public SettingsStore
+    {
+    public:
+        /// \param directory Directory containing the key files.
+        explicit FileSettingsStore (const std::string& directory);
+        ~FileSettingsStore ();
+
+        /// Get path of the file backing a key
+        std::string GetKeyPath (SettingsKey key) const;
+
+        HRESULT QueryValues (SettingsKey key, size_t count, const wchar_t* const* names,
+                             uint32_t* values, HRESULT* results) override;
+        HRESULT StartWatching () override;
+        HRESULT WaitForChange () override;
+        void StopWaiting () override;
+    private:
+        std::string directory;
+        int notifyFD;
+        int stopPipe[2];
+
+        void CloseWatch ();
+
+        FileSettingsStore (const FileSettingsStore&) = delete;
+        FileSettingsStore& operator= (const FileSettingsStore&) = delete;
+    };
+} // namespace windows10colors
+
+#endif // !defined(_WIN32)
+
+#endif // __WINDOWS10COLORSFILESETTINGS_H__
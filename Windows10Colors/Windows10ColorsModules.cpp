@@ -0,0 +1,80 @@
+/*
+This library is licensed under the zlib license.
+
+Copyright (C) 2016-2018 Frank Richter
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+claim that you wrote the original software. If you use this software
+in a product, an acknowledgment in the product documentation would be
+appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+
+Original source:
+https://github.com/res2k/Windows10Colors
+
+*/
+#include "Windows10ColorsModules.h"
+
+#include <wchar.h>
+
+namespace windows10colors
+{
+
+LazyImports::LazyImports (ModuleLoader& loader, const ModuleImport* imports, size_t numImports)
+  : loader (loader), imports (imports), numImports (numImports), loaded (false), loadCount (0),
+    symbols (numImports, nullptr)
+{
+}
+
+LazyImports::~LazyImports ()
+{
+    for (void* module : modules)
+    {
+        loader.FreeModule (module);
+    }
+}
+
+void LazyImports::Load ()
+{
+    std::lock_guard<std::mutex> lock (loadMutex);
+    if (loaded.load (std::memory_order_relaxed)) return;
+
+    // Modules loaded for each import, to load each module only once
+    std::vector<void*> importModules (numImports, nullptr);
+    for (size_t i = 0; i < numImports; i++)
+    {
+        void* module = nullptr;
+        bool seen = false;
+        for (size_t j = 0; j < i; j++)
+        {
+            if (wcscmp (imports[j].module, imports[i].module) == 0)
+            {
+                module = importModules[j];
+                seen = true;
+                break;
+            }
+        }
+        if (!seen)
+        {
+            module = loader.LoadModule (imports[i].module);
+            if (module) modules.push_back (module);
+        }
+        importModules[i] = module;
+        if (module) symbols[i] = loader.GetSymbol (module, imports[i].symbol);
+    }
+
+    loadCount++;
+    loaded.store (true, std::memory_order_release);
+}
+
+} // namespace windows10colors
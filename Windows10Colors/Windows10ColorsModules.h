@@ -0,0 +1,108 @@
+/*
+This library is licensed under the zlib license.
+
+Copyright (C) 2016-2018 Frank Richter
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+claim that you wrote the original software. If you use this software
+in a product, an acknowledgment in the product documentation would be
+appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+
+Original source:
+https://github.com/res2k/Windows10Colors
+
+*/
+#ifndef __WINDOWS10COLORSMODULES_H__
+#define __WINDOWS10COLORSMODULES_H__
+
+/**\file
+ * Thread-safe, lazy loading of functions from dynamically loaded modules.
+ */
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include <stddef.h>
+
+namespace windows10colors
+{
+    /// Interface to load modules and look up symbols (LoadLibrary/GetProcAddress).
+    class ModuleLoader
+    {
+    public:
+        virtual ~ModuleLoader () {}
+
+        /// Load a module. Returns \c nullptr on failure.
+        virtual void* LoadModule (const wchar_t* name) = 0;
+        /// Look up a symbol in a loaded module. Returns \c nullptr if not found.
+        virtual void* GetSymbol (void* module, const char* name) = 0;
+        /// Unload a module returned by LoadModule().
+        virtual void FreeModule (void* module) = 0;
+    };
+
+    /// Symbol imported from a dynamically loaded module
+    struct ModuleImport
+    {
+        /// Module name
+        const wchar_t* module;
+        /// Symbol name
+        const char* symbol;
+    };
+
+    /**
+     * Set of imports, resolved on first use.
+     * Loading happens exactly once, even if the first uses happen concurrently;
+     * after that, obtaining an import is a single atomic load.
+     * Loaded modules are freed on destruction.
+     */
+    class LazyImports
+    {
+    public:
+        /**
+         * Constructor.
+         * \param loader Loader used to load modules and look up symbols.
+         *   Must outlive this object.
+         * \param imports Imports to resolve. Must outlive this object.
+         * \param numImports Number of elements in \a imports.
+         */
+        LazyImports (ModuleLoader& loader, const ModuleImport* imports, size_t numImports);
+        ~LazyImports ();
+
+        /// Get address of import with given index. Returns \c nullptr if unavailable.
+        void* Get (size_t index)
+        {
+            if (!loaded.load (std::memory_order_acquire)) Load ();
+            return symbols[index];
+        }
+        /// Number of times modules were loaded (0 or 1).
+        unsigned long GetLoadCount () const { return loadCount; }
+    private:
+        ModuleLoader& loader;
+        const ModuleImport* imports;
+        size_t numImports;
+        std::atomic<bool> loaded;
+        std::mutex loadMutex;
+        unsigned long loadCount;
+        std::vector<void*> modules;
+        std::vector<void*> symbols;
+
+        void Load ();
+
+        LazyImports (const LazyImports&) = delete;
+        LazyImports& operator= (const LazyImports&) = delete;
+    };
+} // namespace windows10colors
+
+#endif // __WINDOWS10COLORSMODULES_H__
@@ -0,0 +1,103 @@
+/*
+This library is licensed under the zlib license.
+
+Copyright (C) 2016-2018 Frank Richter
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+claim that you wrote the original software. If you use this software
+in a product, an acknowledgment in the product documentation would be
+appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+
+Original source:
+https://github.com/res2k/Windows10Colors
+
+*/
+#include "Windows10ColorsProfiles.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace windows10colors
+{
+
+HRESULT CaptureProfileSnapshot (SettingsStore& store, const ThemeSnapshot& system, ThemeSnapshot& snapshot)
+{
+    snapshot = ThemeSnapshot ();
+    snapshot.osVersion = system.osVersion;
+    snapshot.highContrast = system.highContrast;
+    snapshot.sysColors = system.sysColors;
+    snapshot.uiSettingsResult = E_NOTIMPL;
+    ReadThemeSettings (store, snapshot);
+    return S_OK;
+}
+
+void EvaluateProfileColors (const ThemeSnapshot& snapshot, ProfileColors& colors,
+                            unsigned int options, DarkMode darkMode)
+{
+    colors = ProfileColors ();
+    colors.result = S_OK;
+    colors.accentResult = GetAccentColor (snapshot, colors.accent);
+    colors.frameResult = GetFrameColors (snapshot, colors.frame, options, darkMode);
+    colors.sysPartsModeResult = GetSysPartsMode (snapshot, colors.sysPartsMode);
+}
+
+HRESULT EvaluateProfiles (size_t count, const ProfileCaptureFunction& capture, ProfileColors* colors,
+                          unsigned int options, DarkMode darkMode, unsigned int threads)
+{
+    if (count == 0) return S_OK;
+    if (!colors) return E_POINTER;
+
+    if (threads == 0) threads = std::max (std::thread::hardware_concurrency (), 1u);
+    threads = static_cast<unsigned int> (std::min<size_t> (threads, count));
+
+    // Workers take the next profile from a shared counter, balancing uneven capture times
+    std::atomic<size_t> nextProfile (0);
+    std::atomic<bool> anyFailed (false);
+    auto work = [&]()
+    {
+        size_t index;
+        while ((index = nextProfile.fetch_add (1, std::memory_order_relaxed)) < count)
+        {
+            ThemeSnapshot snapshot;
+            HRESULT hr = capture (index, snapshot);
+            if (FAILED (hr))
+            {
+                colors[index] = ProfileColors ();
+                colors[index].result = hr;
+                anyFailed.store (true, std::memory_order_relaxed);
+                continue;
+            }
+            EvaluateProfileColors (snapshot, colors[index], options, darkMode);
+        }
+    };
+
+    // The calling thread works as well
+    std::vector<std::thread> workers;
+    workers.reserve (threads - 1);
+    for (unsigned int i = 1; i < threads; i++)
+    {
+        workers.emplace_back (work);
+    }
+    work ();
+    for (auto& worker : workers)
+    {
+        worker.join ();
+    }
+
+    return anyFailed.load () ? S_FALSE : S_OK;
+}
+
+} // namespace windows10colors
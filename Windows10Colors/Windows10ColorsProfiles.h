@@ -0,0 +1,104 @@
+/*
+This library is licensed under the zlib license.
+
+Copyright (C) 2016-2018 Frank Richter
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+claim that you wrote the original software. If you use this software
+in a product, an acknowledgment in the product documentation would be
+appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+
+Original source:
+https://github.com/res2k/Windows10Colors
+
+*/
+#ifndef __WINDOWS10COLORSPROFILES_H__
+#define __WINDOWS10COLORSPROFILES_H__
+
+/**\file
+ * Evaluation of theme colors for explicit user profiles, e.g. other users
+ * signed in to the same machine.
+ */
+
+#include "Windows10ColorsCore.h"
+#include "Windows10ColorsSettings.h"
+
+#include <functional>
+
+namespace windows10colors
+{
+    /**
+     * Capture the theme settings of a user profile from a settings store.
+     * The accent color from UISettings is only available for the current user,
+     * so \c uiSettingsResult is set to \c E_NOTIMPL and the accent color is
+     * derived from the DWM colors instead.
+     * \param store Store containing the profile's settings.
+     * \param system Snapshot providing the settings that are not per-profile
+     *   (OS version, high contrast mode and system colors).
+     * \param snapshot Receives the profile's snapshot.
+     */
+    extern HRESULT CaptureProfileSnapshot (SettingsStore& store, const ThemeSnapshot& system,
+                                           ThemeSnapshot& snapshot);
+
+    /// Colors evaluated for a profile
+    struct ProfileColors
+    {
+        /// Result of capturing the profile's snapshot. Other fields are only valid on success.
+        HRESULT result;
+        /// Result of deriving \c accent
+        HRESULT accentResult;
+        /// Accent color shades
+        AccentColor accent;
+        /// Result of deriving \c frame
+        HRESULT frameResult;
+        /// Frame colors
+        FrameColors frame;
+        /// Result of deriving \c sysPartsMode
+        HRESULT sysPartsModeResult;
+        /// Mode of system parts
+        SysPartsMode sysPartsMode;
+    };
+
+    /**
+     * Derive the colors of a profile from its snapshot.
+     * \param snapshot Profile's snapshot.
+     * \param colors Receives colors. \c result is set to \c S_OK.
+     * \param options Frame color options. Combination of FrameColorOption values.
+     * \param darkMode Whether to use Dark Mode frame colors.
+     */
+    extern void EvaluateProfileColors (const ThemeSnapshot& snapshot, ProfileColors& colors,
+                                       unsigned int options = fcDefault, DarkMode darkMode = DarkMode::Light);
+
+    /// Function capturing the snapshot of the profile with the given index
+    typedef std::function<HRESULT (size_t index, ThemeSnapshot& snapshot)> ProfileCaptureFunction;
+
+    /**
+     * Evaluate the colors of many profiles in parallel.
+     * Profiles are distributed over a number of worker threads.
+     * \param count Number of profiles.
+     * \param capture Function capturing a profile's snapshot. Called concurrently
+     *   from the worker threads.
+     * \param colors Receives colors of each profile. Must have room for \a count entries.
+     * \param options Frame color options. Combination of FrameColorOption values.
+     * \param darkMode Whether to use Dark Mode frame colors.
+     * \param threads Number of worker threads. 0 picks the number of hardware threads.
+     * \returns \c S_OK if all profiles were captured successfully, \c S_FALSE if
+     *   some captures failed (see ProfileColors::result).
+     */
+    extern HRESULT EvaluateProfiles (size_t count, const ProfileCaptureFunction& capture, ProfileColors* colors,
+                                     unsigned int options = fcDefault, DarkMode darkMode = DarkMode::Light,
+                                     unsigned int threads = 0);
+} // namespace windows10colors
+
+#endif // __WINDOWS10COLORSPROFILES_H__
@@ -0,0 +1,77 @@
+/*
+This library is licensed under the zlib license.
+
+Copyright (C) 2016-2018 Frank Richter
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+claim that you wrote the original software. If you use this software
+in a product, an acknowledgment in the product documentation would be
+appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+
+Original source:
+https://github.com/res2k/Windows10Colors
+
+*/
+#include "Windows10ColorsRefresh.h"
+
+#include <algorithm>
+
+namespace windows10colors
+{
+
+RefreshCoalescer::RefreshCoalescer (Duration quietPeriod, Duration maxLatency, Clock clock)
+  : quietPeriod (quietPeriod), maxLatency (std::max (maxLatency, quietPeriod)), clock (std::move (clock)),
+    pending (false), eventCount (0), refreshCount (0)
+{
+}
+
+void RefreshCoalescer::Notify ()
+{
+    TimePoint now = clock ();
+    if (!pending)
+    {
+        pending = true;
+        firstEvent = now;
+    }
+    lastEvent = now;
+    eventCount++;
+}
+
+RefreshCoalescer::TimePoint RefreshCoalescer::GetDueTime () const
+{
+    return std::min (lastEvent + quietPeriod, firstEvent + maxLatency);
+}
+
+RefreshCoalescer::Duration RefreshCoalescer::GetDelay () const
+{
+    if (!pending) return Duration (0);
+    TimePoint now = clock ();
+    TimePoint due = GetDueTime ();
+    if (due <= now) return Duration (0);
+    // Round up, so a timer doesn't fire before the refresh is due
+    auto remaining = due - now;
+    Duration delay = std::chrono::duration_cast<Duration> (remaining);
+    if (delay < remaining) delay += Duration (1);
+    return delay;
+}
+
+bool RefreshCoalescer::Poll ()
+{
+    if (!pending || (clock () < GetDueTime ())) return false;
+    pending = false;
+    refreshCount++;
+    return true;
+}
+
+} // namespace windows10colors
@@ -0,0 +1,95 @@
+/*
+This library is licensed under the zlib license.
+
+Copyright (C) 2016-2018 Frank Richter
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+claim that you wrote the original software. If you use this software
+in a product, an acknowledgment in the product documentation would be
+appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+
+Original source:
+https://github.com/res2k/Windows10Colors
+
+*/
+#ifndef __WINDOWS10COLORSREFRESH_H__
+#define __WINDOWS10COLORSREFRESH_H__
+
+/**\file
+ * Coalescing of bursts of change notifications into a single refresh.
+ */
+
+#include <chrono>
+#include <functional>
+
+namespace windows10colors
+{
+    /**
+     * Collapses a burst of change events (e.g. \c WM_SETTINGCHANGE messages
+     * sent while switching themes) into a single refresh.
+     * A refresh becomes due once no event arrived for the quiet period, but
+     * at the latest after the maximum latency has passed since the first
+     * event of a burst.
+     * Typical use: call Notify() for each event and (re)start a timer with
+     * GetDelay(); when the timer fires, refresh if Poll() returns \c true,
+     * otherwise restart the timer.
+     * \remarks Not thread-safe; intended to be used from a single (UI) thread.
+     */
+    class RefreshCoalescer
+    {
+    public:
+        typedef std::chrono::steady_clock::time_point TimePoint;
+        typedef std::chrono::milliseconds Duration;
+        /// Function returning the current time
+        typedef std::function<TimePoint ()> Clock;
+
+        /**
+         * Constructor.
+         * \param quietPeriod Time without events after which a refresh is due.
+         * \param maxLatency Maximum time between the first event of a burst and the refresh.
+         * \param clock Function returning the current time.
+         */
+        RefreshCoalescer (Duration quietPeriod, Duration maxLatency, Clock clock = &std::chrono::steady_clock::now);
+
+        /// Record an event.
+        void Notify ();
+        /// Whether a refresh is pending
+        bool IsPending () const { return pending; }
+        /// Time until the pending refresh is due, rounded up. Zero if due or nothing is pending.
+        Duration GetDelay () const;
+        /**
+         * Check whether a refresh is due.
+         * If it is, the pending state is cleared, so each burst is reported once.
+         */
+        bool Poll ();
+
+        /// Number of events recorded
+        unsigned long GetEventCount () const { return eventCount; }
+        /// Number of refreshes reported by Poll()
+        unsigned long GetRefreshCount () const { return refreshCount; }
+    private:
+        Duration quietPeriod;
+        Duration maxLatency;
+        Clock clock;
+        bool pending;
+        TimePoint firstEvent;
+        TimePoint lastEvent;
+        unsigned long eventCount;
+        unsigned long refreshCount;
+
+        TimePoint GetDueTime () const;
+    };
+} // namespace windows10colors
+
+#endif // __WINDOWS10COLORSREFRESH_H__
@@ -0,0 +1,448 @@
+/*
+This library is licensed under the zlib license.
+
+Copyright (C) 2016-2018 Frank Richter
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+claim that you wrote the original software. If you use this software
+in a product, an acknowledgment in the product documentation would be
+appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+
+Original source:
+https://github.com/res2k/Windows10Colors
+
+*/
+#include "Windows10ColorsRegFile.h"
+
+#include <algorithm>
+
+#if !defined(_WIN32)
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace windows10colors
+{
+
+namespace
+{
+    inline uint32_t FoldCase (uint32_t c)
+    {
+        return ((c >= 'A') && (c <= 'Z')) ? c + ('a' - 'A') : c;
+    }
+
+    // FNV-1a over case folded code points
+    struct NameHash
+    {
+        uint64_t value;
+
+        NameHash () : value (0xcbf29ce484222325ull) {}
+        void Add (uint32_t c) { value = (value ^ FoldCase (c)) * 0x100000001b3ull; }
+    };
+
+    // Read a code point from UTF-16 text. Surrogates are returned as-is, like in wchar_t strings.
+    inline uint32_t NextCodePoint (const uint16_t*& p, const uint16_t*)
+    {
+        return *p++;
+    }
+
+    // Read a code point from UTF-8 text
+    inline uint32_t NextCodePoint (const uint8_t*& p, const uint8_t* end)
+    {
+        uint32_t c = *p++;
+        if (c < 0x80) return c;
+        int extra = (c >= 0xf0) ? 3 : (c >= 0xe0) ? 2 : (c >= 0xc0) ? 1 : 0;
+        c &= 0x3f >> extra;
+        while ((extra-- > 0) && (p < end) && ((*p & 0xc0) == 0x80))
+        {
+            c = (c << 6) | (*p++ & 0x3f);
+        }
+        return c;
+    }
+
+    // Read a code point from a quoted name, resolving backslash escapes
+    template<typename Char>
+    inline uint32_t NextNameCodePoint (const Char*& p, const Char* end)
+    {
+        if ((*p == '\\') && (p + 1 < end)) p++;
+        return NextCodePoint (p, end);
+    }
+
+    // Compare text against a string, ignoring case
+    template<typename Char>
+    static bool SameName (const Char* p, const Char* end, bool escaped, const wchar_t* name)
+    {
+        while (p < end)
+        {
+            if (*name == 0) return false;
+            uint32_t c = escaped ? NextNameCodePoint (p, end) : NextCodePoint (p, end);
+            if (FoldCase (c) != FoldCase (static_cast<uint32_t> (*name++))) return false;
+        }
+        return *name == 0;
+    }
+
+    static uint64_t HashString (const wchar_t* str)
+    {
+        NameHash hash;
+        while (*str) hash.Add (static_cast<uint32_t> (*str++));
+        return hash.value;
+    }
+
+    // Parse "dword:xxxxxxxx" value data
+    template<typename Char>
+    static HRESULT ParseDword (const Char* p, const Char* end, uint32_t& value)
+    {
+        // Deleted value
+        if ((end - p == 1) && (*p == '-')) return HRESULT_FROM_WIN32 (ERROR_FILE_NOT_FOUND);
+
+        static const char prefix[] = "dword:";
+        const size_t prefixLen = sizeof (prefix) - 1;
+        if (static_cast<size_t> (end - p) < prefixLen) return HRESULT_FROM_WIN32 (ERROR_UNSUPPORTED_TYPE);
+        for (size_t i = 0; i < prefixLen; i++)
+        {
+            if (FoldCase (p[i]) != static_cast<uint32_t> (prefix[i])) return HRESULT_FROM_WIN32 (ERROR_UNSUPPORTED_TYPE);
+        }
+        p += prefixLen;
+
+        uint32_t v = 0;
+        int digits = 0;
+        for (; (p < end) && (digits <= 8); p++, digits++)
+        {
+            uint32_t c = FoldCase (*p);
+            if ((c >= '0') && (c <= '9'))
+                v = (v << 4) | (c - '0');
+            else if ((c >= 'a') && (c <= 'f'))
+                v = (v << 4) | (c - 'a' + 10);
+            else
+                break;
+        }
+        // Allow trailing whitespace only
+        while ((p < end) && ((*p == ' ') || (*p == '\t'))) p++;
+        if ((digits == 0) || (digits > 8) || (p != end)) return HRESULT_FROM_WIN32 (ERROR_INVALID_DATA);
+
+        value = v;
+        return S_OK;
+    }
+} // anonymous namespace
+
+RegFileSettingsStore::RegFileSettingsStore (const wchar_t* rootPath) : rootPath (rootPath),
+#if defined(_WIN32)
+    mapping (NULL),
+#endif
+    view (nullptr), viewSize (0), wide (false), textStart (0), textLength (0)
+{
+}
+
+RegFileSettingsStore::~RegFileSettingsStore ()
+{
+    Close ();
+}
+
+#if defined(_WIN32)
+HRESULT RegFileSettingsStore::Open (const wchar_t* path)
+{
+    Close ();
+
+    HANDLE file = CreateFileW (path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                               FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return HRESULT_FROM_WIN32 (GetLastError ());
+
+    HRESULT hr = S_OK;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx (file, &size))
+        hr = HRESULT_FROM_WIN32 (GetLastError ());
+    // Empty files can't be mapped, but are valid (empty) exports
+    else if (size.QuadPart > 0)
+    {
+        mapping = CreateFileMappingW (file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping) view = MapViewOfFile (mapping, FILE_MAP_READ, 0, 0, 0);
+        if (!view) hr = HRESULT_FROM_WIN32 (GetLastError ());
+    }
+    // The mapping stays valid after closing the file
+    CloseHandle (file);
+    if (FAILED (hr))
+    {
+        Close ();
+        return hr;
+    }
+
+    viewSize = view ? static_cast<size_t> (size.QuadPart) : 0;
+    Index ();
+    return S_OK;
+}
+
+void RegFileSettingsStore::Close ()
+{
+    if (view) UnmapViewOfFile (view);
+    view = nullptr;
+    if (mapping) CloseHandle (mapping);
+    mapping = NULL;
+    viewSize = textStart = textLength = 0;
+    keys.clear ();
+    values.clear ();
+    keyIndex.clear ();
+}
+#else
+static HRESULT ErrnoResult ()
+{
+    return MAKE_HRESULT (1, 0x7, errno & 0xffff);
+}
+
+HRESULT RegFileSettingsStore::Open (const char* path)
+{
+    Close ();
+
+    int fd = open (path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return ErrnoResult ();
+
+    struct stat st;
+    HRESULT hr = S_OK;
+    if (fstat (fd, &st) != 0)
+        hr = ErrnoResult ();
+    // Empty files can't be mapped, but are valid (empty) exports
+    else if (st.st_size > 0)
+    {
+        void* mapped = mmap (nullptr, static_cast<size_t> (st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED)
+            hr = ErrnoResult ();
+        else
+        {
+            view = mapped;
+            viewSize = static_cast<size_t> (st.st_size);
+        }
+    }
+    // The mapping stays valid after closing the file
+    close (fd);
+    if (FAILED (hr)) return hr;
+
+    Index ();
+    return S_OK;
+}
+
+void RegFileSettingsStore::Close ()
+{
+    if (view) munmap (const_cast<void*> (view), viewSize);
+    view = nullptr;
+    viewSize = textStart = textLength = 0;
+    keys.clear ();
+    values.clear ();
+    keyIndex.clear ();
+}
+#endif
+
+void RegFileSettingsStore::Index ()
+{
+    const uint8_t* bytes = static_cast<const uint8_t*> (view);
+    wide = (viewSize >= 2) && (bytes[0] == 0xff) && (bytes[1] == 0xfe);
+    if (wide)
+    {
+        textStart = 1;
+        textLength = viewSize / 2 - 1;
+        BuildIndex (static_cast<const uint16_t*> (view) + textStart);
+    }
+    else
+    {
+        bool utf8BOM = (viewSize >= 3) && (bytes[0] == 0xef) && (bytes[1] == 0xbb) && (bytes[2] == 0xbf);
+        textStart = utf8BOM ? 3 : 0;
+        textLength = viewSize - textStart;
+        BuildIndex (bytes + textStart);
+    }
+}
+
+template<typename Char>
+void RegFileSettingsStore::BuildIndex (const Char* text)
+{
+    const Char* const end = text + textLength;
+    bool haveKey = false;
+
+    const Char* line = text;
+    while (line < end)
+    {
+        const Char* lineEnd = line;
+        while ((lineEnd < end) && (*lineEnd != '\n')) lineEnd++;
+        const Char* next = (lineEnd < end) ? lineEnd + 1 : end;
+        if ((lineEnd > line) && (lineEnd[-1] == '\r')) lineEnd--;
+
+        if ((line < lineEnd) && (*line == '['))
+        {
+            const Char* close = lineEnd;
+            while ((close > line) && (*(close - 1) != ']')) close--;
+            // Key deletions ("[-path]") have no values, but hide earlier occurrences
+            bool deletion = (close > line + 1) && (line[1] == '-');
+            haveKey = (close > line + 1) && !deletion;
+            if (haveKey || deletion)
+            {
+                const Char* pathStart = line + (deletion ? 2 : 1);
+                const Char* pathEnd = std::max (close - 1, pathStart);
+                Key key;
+                key.path.offset = pathStart - text;
+                key.path.length = pathEnd - pathStart;
+                key.firstValue = values.size ();
+                key.numValues = 0;
+                key.deleted = deletion;
+
+                NameHash hash;
+                for (const Char* p = pathStart; p < pathEnd; )
+                {
+                    hash.Add (NextCodePoint (p, pathEnd));
+                }
+                keyIndex.emplace (hash.value, keys.size ());
+                keys.push_back (key);
+            }
+        }
+        else if (haveKey && (line < lineEnd) && ((*line == '"') || (*line == '@')))
+        {
+            // Continuation lines of hex data start with whitespace, so they're skipped
+            Value value;
+            NameHash hash;
+            const Char* p = line + 1;
+            value.name.offset = p - text;
+            if (*line == '"')
+            {
+                while ((p < lineEnd) && (*p != '"'))
+                {
+                    p += ((*p == '\\') && (p + 1 < lineEnd)) ? 2 : 1;
+                }
+                value.name.length = (p - text) - value.name.offset;
+                for (const Char* n = text + value.name.offset; n < p; )
+                {
+                    hash.Add (NextNameCodePoint (n, p));
+                }
+                if (p < lineEnd) p++;
+            }
+            else
+            {
+                value.name.length = 0;
+            }
+            if ((p < lineEnd) && (*p == '='))
+            {
+                p++;
+                value.nameHash = hash.value;
+                value.data.offset = p - text;
+                value.data.length = lineEnd - p;
+                values.push_back (value);
+                keys.back ().numValues++;
+            }
+        }
+
+        line = next;
+    }
+}
+
+template<typename Char>
+HRESULT RegFileSettingsStore::Query (const Char* text, const std::wstring& keyPath, size_t count,
+                                     const wchar_t* const* names, uint32_t* values,
+                                     HRESULT* results) const
+{
+    /* Later occurrences of a key take precedence, and a deletion ("[-path]")
+     * drops everything before it. As key and value indices follow the file
+     * order, the value with the highest index after the last deletion wins. */
+    auto range = keyIndex.equal_range (HashString (keyPath.c_str ()));
+    size_t lastDeletion = 0;
+    bool deleted = false;
+    bool exists = false;
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        const Key& key = keys[it->second];
+        if (!SameName (text + key.path.offset, text + key.path.offset + key.path.length, false, keyPath.c_str ()))
+            continue;
+        if (key.deleted && (!deleted || (it->second > lastDeletion)))
+        {
+            lastDeletion = it->second;
+            deleted = true;
+        }
+    }
+    // Value index found for each name, in file order; npos if none
+    const size_t npos = static_cast<size_t> (-1);
+    std::vector<size_t> found (count, npos);
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        const Key& key = keys[it->second];
+        if (key.deleted || (deleted && (it->second < lastDeletion))) continue;
+        if (!SameName (text + key.path.offset, text + key.path.offset + key.path.length, false, keyPath.c_str ()))
+            continue;
+        exists = true;
+        for (size_t i = 0; i < count; i++)
+        {
+            uint64_t nameHash = HashString (names[i]);
+            for (size_t v = key.firstValue + key.numValues; v-- > key.firstValue; )
+            {
+                if ((found[i] != npos) && (v < found[i])) break;
+                const Value& value = this->values[v];
+                if ((value.nameHash != nameHash)
+                    || !SameName (text + value.name.offset, text + value.name.offset + value.name.length,
+                                  true, names[i]))
+                    continue;
+                found[i] = v;
+                break;
+            }
+        }
+    }
+    if (!exists) return HRESULT_FROM_WIN32 (ERROR_FILE_NOT_FOUND);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (found[i] == npos)
+        {
+            results[i] = HRESULT_FROM_WIN32 (ERROR_FILE_NOT_FOUND);
+            continue;
+        }
+        const Value& value = this->values[found[i]];
+        results[i] = ParseDword (text + value.data.offset, text + value.data.offset + value.data.length, values[i]);
+    }
+    return S_OK;
+}
+
+HRESULT RegFileSettingsStore::QueryValue (const wchar_t* keyPath, const wchar_t* name, uint32_t& value) const
+{
+    HRESULT result;
+    HRESULT hr;
+    if (wide)
+        hr = Query (static_cast<const uint16_t*> (view) + textStart, keyPath, 1, &name, &value, &result);
+    else
+        hr = Query (static_cast<const uint8_t*> (view) + textStart, keyPath, 1, &name, &value, &result);
+    return FAILED (hr) ? hr : result;
+}
+
+HRESULT RegFileSettingsStore::QueryValues (SettingsKey key, size_t count, const wchar_t* const* names,
+                                           uint32_t* values, HRESULT* results)
+{
+    std::wstring keyPath (rootPath);
+    keyPath.append (L"\\");
+    keyPath.append (GetSettingsKeyPath (key));
+    if (wide)
+        return Query (static_cast<const uint16_t*> (view) + textStart, keyPath, count, names, values, results);
+    else
+        return Query (static_cast<const uint8_t*> (view) + textStart, keyPath, count, names, values, results);
+}
+
+HRESULT RegFileSettingsStore::StartWatching ()
+{
+    // An export is a snapshot
+    return E_NOTIMPL;
+}
+
+HRESULT RegFileSettingsStore::WaitForChange ()
+{
+    return S_FALSE;
+}
+
+void RegFileSettingsStore::StopWaiting ()
+{
+}
+
+} // namespace windows10colors
@@ -0,0 +1,152 @@
+/*
+This library is licensed under the zlib license.
+
+Copyright (C) 2016-2018 Frank Richter
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+claim that you wrote the original software. If you use this software
+in a product, an acknowledgment in the product documentation would be
+appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+
+Original source:
+https://github.com/res2k/Windows10Colors
+
+*/
+#ifndef __WINDOWS10COLORSREGFILE_H__
+#define __WINDOWS10COLORSREGFILE_H__
+
+/**\file
+ * Settings store reading a registry export (<tt>.reg</tt> file).
+ */
+
+#include "Windows10ColorsSettings.h"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace windows10colors
+{
+    /**
+     * Settings store reading values from a registry export, as written by
+     * \c regedit or <tt>reg export</tt>.
+     * The file is memory mapped and indexed once when opened; values are parsed
+     * from the mapped file when queried, without copying its contents.
+     * Both UTF-16 (the \c regedit default) and UTF-8/ANSI exports are supported.
+     * Key paths and value names are matched case-insensitively (for ASCII letters).
+     * Only \c dword values can be queried; later occurrences of a key or value
+     * take precedence, and deleted values (<tt>"Name"=-</tt>) are reported as missing.
+     * A key deletion (<tt>[-path]</tt>) hides earlier occurrences of that key;
+     * deletions of parent keys aren't considered.
+     * The file can't be watched for changes.
+     */
+    class RegFileSettingsStore : public SettingsStore
+    {
+    public:
+        /**
+         * Constructor.
+         * \param rootPath Path of the key containing the settings keys, as it appears
+         *   in the export. E.g. \c HKEY_CURRENT_USER, or <tt>HKEY_USERS\\<SID></tt>
+         *   for an export of another user's hive.
+         */
+        explicit RegFileSettingsStore (const wchar_t* rootPath = L"HKEY_CURRENT_USER");
+        ~RegFileSettingsStore ();
+
+        /// Map and index an export file. Replaces a previously opened file.
+#if defined(_WIN32)
+        HRESULT Open (const wchar_t* path);
+#else
+        HRESULT Open (const char* path);
+#endif
+        /// Close the file.
+        void Close ();
+
+        /// Number of keys in the file
+        size_t GetKeyCount () const { return keys.size (); }
+        /// Number of values in the file
+        size_t GetValueCount () const { return values.size (); }
+
+        /**
+         * Query a DWORD value by full key path.
+         * \param keyPath Full path of the key, including the root key.
+         * \param name Name of the value. Empty for the default value.
+         * \param value Receives the value.
+         * \returns \c HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND) if the key or value
+         *   doesn't exist, \c HRESULT_FROM_WIN32(ERROR_UNSUPPORTED_TYPE) if the value
+         *   isn't a \c dword value.
+         */
+        HRESULT QueryValue (const wchar_t* keyPath, const wchar_t* name, uint32_t& value) const;
+
+        HRESULT QueryValues (SettingsKey key, size_t count, const wchar_t* const* names,
+                             uint32_t* values, HRESULT* results) override;
+        HRESULT StartWatching () override;
+        HRESULT WaitForChange () override;
+        void StopWaiting () override;
+    private:
+        std::wstring rootPath;
+
+#if defined(_WIN32)
+        HANDLE mapping;
+#endif
+        const void* view;
+        size_t viewSize;
+        /// Whether the text is UTF-16
+        bool wide;
+        /// Offset of the text (after a BOM), in code units
+        size_t textStart;
+        /// Length of the text, in code units
+        size_t textLength;
+
+        /// Range of text, in code units
+        struct Span
+        {
+            size_t offset;
+            size_t length;
+        };
+        struct Key
+        {
+            /// Path, between the brackets
+            Span path;
+            size_t firstValue;
+            size_t numValues;
+            /// Whether this is a deletion (<tt>[-path]</tt>)
+            bool deleted;
+        };
+        struct Value
+        {
+            /// Hash of the unescaped name
+            uint64_t nameHash;
+            /// Name, between the quotes (still escaped). Empty for the default value.
+            Span name;
+            /// Data, after the '='
+            Span data;
+        };
+        std::vector<Key> keys;
+        std::vector<Value> values;
+        /// Maps key path hashes to indices into \c keys
+        std::unordered_multimap<uint64_t, size_t> keyIndex;
+
+        /// Detect the encoding of the mapped file and index it
+        void Index ();
+        template<typename Char> void BuildIndex (const Char* text);
+        template<typename Char> HRESULT Query (const Char* text, const std::wstring& keyPath, size_t count,
+                                               const wchar_t* const* names, uint32_t* values,
+                                               HRESULT* results) const;
+
+        RegFileSettingsStore (const RegFileSettingsStore&) = delete;
+        RegFileSettingsStore& operator= (const RegFileSettingsStore&) = delete;
+    };
+} // namespace windows10colors
+
+#endif // __WINDOWS10COLORSREGFILE_H__
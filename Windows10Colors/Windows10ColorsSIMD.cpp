@@ -0,0 +1,220 @@
+/*
+This library is licensed under the zlib license.
+
+Copyright (C) 2016-2018 Frank Richter
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+claim that you wrote the original software. If you use this software
+in a product, an acknowledgment in the product documentation would be
+appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+
+Original source:
+https://github.com/res2k/Windows10Colors
+
+*/
+
+#include "Windows10ColorsCore.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define W10C_HAVE_X86_SIMD
+#endif
+
+#if defined(W10C_HAVE_X86_SIMD)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#include <immintrin.h>
+#endif
+
+namespace windows10colors
+{
+
+#if defined(W10C_HAVE_X86_SIMD)
+namespace
+{
+    static_assert (sizeof (RGBA) == sizeof (uint32_t), "RGBA is expected to be 32 bits wide");
+
+    static void CPUID (int leaf, int info[4])
+    {
+#if defined(_MSC_VER)
+        __cpuid (info, leaf);
+#else
+        __asm__ __volatile__ ("cpuid" : "=a" (info[0]), "=b" (info[1]), "=c" (info[2]), "=d" (info[3]) : "a" (leaf), "c" (0));
+#endif
+    }
+
+    static bool HaveSSE2 ()
+    {
+        int info[4];
+        CPUID (1, info);
+        return (info[3] & (1 << 26)) != 0;
+    }
+
+    static bool HaveAVX ()
+    {
+        int info[4];
+        CPUID (1, info);
+        const int osxsave = 1 << 27;
+        const int avx = 1 << 28;
+        if ((info[2] & (osxsave | avx)) != (osxsave | avx)) return false;
+        // Check whether the OS saves the YMM registers
+#if defined(_MSC_VER)
+        unsigned long long xcr0 = _xgetbv (0);
+#else
+        unsigned int xcr0_lo, xcr0_hi;
+        __asm__ __volatile__ ("xgetbv" : "=a" (xcr0_lo), "=d" (xcr0_hi) : "c" (0));
+        unsigned long long xcr0 = xcr0_lo | (static_cast<unsigned long long> (xcr0_hi) << 32);
+#endif
+        return (xcr0 & 6) == 6;
+    }
+}
+
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("sse2"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("sse2")
+#endif
+namespace sse2
+{
+    struct Ops
+    {
+        typedef __m128d V;
+        static const size_t Lanes = 2;
+
+        static inline V Set (double x) { return _mm_set1_pd (x); }
+        static inline V Add (V a, V b) { return _mm_add_pd (a, b); }
+        static inline V Sub (V a, V b) { return _mm_sub_pd (a, b); }
+        static inline V Mul (V a, V b) { return _mm_mul_pd (a, b); }
+        static inline V Div (V a, V b) { return _mm_div_pd (a, b); }
+        static inline V Min (V a, V b) { return _mm_min_pd (a, b); }
+        static inline V Max (V a, V b) { return _mm_max_pd (a, b); }
+        // All values are within the int32 range
+        static inline V Trunc (V a) { return _mm_cvtepi32_pd (_mm_cvttpd_epi32 (a)); }
+        static inline V CmpEq (V a, V b) { return _mm_cmpeq_pd (a, b); }
+        static inline V CmpLt (V a, V b) { return _mm_cmplt_pd (a, b); }
+        static inline V CmpGe (V a, V b) { return _mm_cmpge_pd (a, b); }
+        static inline V And (V a, V b) { return _mm_and_pd (a, b); }
+        static inline V AndNot (V a, V b) { return _mm_andnot_pd (a, b); }
+        static inline V Or (V a, V b) { return _mm_or_pd (a, b); }
+        static inline V Select (V mask, V a, V b) { return _mm_or_pd (_mm_and_pd (mask, a), _mm_andnot_pd (mask, b)); }
+        static inline V FromInt (__m128i a) { return _mm_cvtepi32_pd (a); }
+        static inline __m128i ToInt (V a) { return _mm_cvttpd_epi32 (a); }
+        static inline __m128i LoadColors (const RGBA* p) { return _mm_loadl_epi64 (reinterpret_cast<const __m128i*> (p)); }
+    };
+
+#include "Windows10ColorsAccentKernel.inl"
+} // namespace sse2
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx")
+#endif
+namespace avx
+{
+    struct Ops
+    {
+        typedef __m256d V;
+        static const size_t Lanes = 4;
+
+        static inline V Set (double x) { return _mm256_set1_pd (x); }
+        static inline V Add (V a, V b) { return _mm256_add_pd (a, b); }
+        static inline V Sub (V a, V b) { return _mm256_sub_pd (a, b); }
+        static inline V Mul (V a, V b) { return _mm256_mul_pd (a, b); }
+        static inline V Div (V a, V b) { return _mm256_div_pd (a, b); }
+        static inline V Min (V a, V b) { return _mm256_min_pd (a, b); }
+        static inline V Max (V a, V b) { return _mm256_max_pd (a, b); }
+        static inline V Trunc (V a) { return _mm256_round_pd (a, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC); }
+        static inline V CmpEq (V a, V b) { return _mm256_cmp_pd (a, b, _CMP_EQ_OQ); }
+        static inline V CmpLt (V a, V b) { return _mm256_cmp_pd (a, b, _CMP_LT_OQ); }
+        static inline V CmpGe (V a, V b) { return _mm256_cmp_pd (a, b, _CMP_GE_OQ); }
+        static inline V And (V a, V b) { return _mm256_and_pd (a, b); }
+        static inline V AndNot (V a, V b) { return _mm256_andnot_pd (a, b); }
+        static inline V Or (V a, V b) { return _mm256_or_pd (a, b); }
+        static inline V Select (V mask, V a, V b) { return _mm256_blendv_pd (b, a, mask); }
+        static inline V FromInt (__m128i a) { return _mm256_cvtepi32_pd (a); }
+        static inline __m128i ToInt (V a) { return _mm256_cvttpd_epi32 (a); }
+        static inline __m128i LoadColors (const RGBA* p) { return _mm_loadu_si128 (reinterpret_cast<const __m128i*> (p)); }
+    };
+
+#include "Windows10ColorsAccentKernel.inl"
+} // namespace avx
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+#endif // defined(W10C_HAVE_X86_SIMD)
+
+namespace
+{
+    typedef void (*pfnGenerateAccentColors) (const RGBA* base, AccentColor* colors, size_t count);
+
+    static void GenerateAccentColorsScalar (const RGBA* base, AccentColor* colors, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            GenerateAccentColors (base[i], colors[i]);
+        }
+    }
+
+    /// Pick best implementation for the CPU we're running on
+    static pfnGenerateAccentColors SelectGenerateAccentColors ()
+    {
+#if defined(W10C_HAVE_X86_SIMD)
+        if (HaveAVX ()) return &avx::GenerateAccentColorsKernel;
+        if (HaveSSE2 ()) return &sse2::GenerateAccentColorsKernel;
+#endif
+        return &GenerateAccentColorsScalar;
+    }
+}
+
+void GenerateAccentColors (const RGBA* base, AccentColor* colors, size_t count)
+{
+    static const pfnGenerateAccentColors impl = SelectGenerateAccentColors ();
+    impl (base, colors, count);
+}
+
+bool GenerateAccentColors (AccentColorsISA isa, const RGBA* base, AccentColor* colors, size_t count)
+{
+    pfnGenerateAccentColors impl = nullptr;
+    switch (isa)
+    {
+    case AccentColorsISA::Scalar:
+        impl = &GenerateAccentColorsScalar;
+        break;
+#if defined(W10C_HAVE_X86_SIMD)
+    case AccentColorsISA::SSE2:
+        if (HaveSSE2 ()) impl = &sse2::GenerateAccentColorsKernel;
+        break;
+    case AccentColorsISA::AVX:
+        if (HaveAVX ()) impl = &avx::GenerateAccentColorsKernel;
+        break;
+#endif
+    default:
+        break;
+    }
+    if (!impl) return false;
+    impl (base, colors, count);
+    return true;
+}
+
+} // namespace windows10colors
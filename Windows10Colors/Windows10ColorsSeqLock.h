@@ -0,0 +1,123 @@
+/*
+This library is licensed under the zlib license.
+
+Copyright (C) 2016-2018 Frank Richter
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+claim that you wrote the original software. If you use this software
+in a product, an acknowledgment in the product documentation would be
+appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+
+Original source:
+https://github.com/res2k/Windows10Colors
+
+*/
+#ifndef __WINDOWS10COLORSSEQLOCK_H__
+#define __WINDOWS10COLORSSEQLOCK_H__
+
+/**\file
+ * Sequence lock helpers, used to share data with readers without blocking them.
+ */
+
+#include <atomic>
+#include <string.h>
+#include <type_traits>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace windows10colors
+{
+namespace detail
+{
+    /**
+     * Store data in sequence lock protected storage.
+     * Writers must be serialized by the caller.
+     * \param sequence Sequence counter. Odd while a write is in progress.
+     * \param words Storage for the data.
+     * \param numWords Number of 32-bit words in \a words.
+     * \param data Data to store. Must be at least <tt>numWords * 4</tt> bytes.
+     */
+    static inline void SeqLockStore (std::atomic<uint32_t>& sequence, std::atomic<uint32_t>* words,
+                                     size_t numWords, const void* data)
+    {
+        uint32_t seq = sequence.load (std::memory_order_relaxed);
+        sequence.store (seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence (std::memory_order_release);
+        const unsigned char* src = static_cast<const unsigned char*> (data);
+        for (size_t i = 0; i < numWords; i++)
+        {
+            uint32_t w;
+            memcpy (&w, src + i * sizeof (uint32_t), sizeof (uint32_t));
+            words[i].store (w, std::memory_order_relaxed);
+        }
+        sequence.store (seq + 2, std::memory_order_release);
+    }
+
+    /**
+     * Try to load data from sequence lock protected storage.
+     * \returns Whether a consistent copy was obtained. Fails if a write
+     *   happened concurrently; the caller should retry in that case.
+     */
+    static inline bool SeqLockTryLoad (const std::atomic<uint32_t>& sequence, const std::atomic<uint32_t>* words,
+                                       size_t numWords, void* data)
+    {
+        uint32_t seq1 = sequence.load (std::memory_order_acquire);
+        if ((seq1 & 1) != 0) return false;
+        unsigned char* dest = static_cast<unsigned char*> (data);
+        for (size_t i = 0; i < numWords; i++)
+        {
+            uint32_t w = words[i].load (std::memory_order_relaxed);
+            memcpy (dest + i * sizeof (uint32_t), &w, sizeof (uint32_t));
+        }
+        std::atomic_thread_fence (std::memory_order_acquire);
+        return sequence.load (std::memory_order_relaxed) == seq1;
+    }
+
+    /// Sequence lock protected storage of a trivially copyable value.
+    template<typename T>
+    class SeqLocked
+    {
+        static_assert (std::is_trivially_copyable<T>::value, "SeqLocked requires trivially copyable data");
+        static const size_t numWords = (sizeof (T) + sizeof (uint32_t) - 1) / sizeof (uint32_t);
+
+        std::atomic<uint32_t> sequence;
+        std::atomic<uint32_t> words[numWords];
+    public:
+        SeqLocked () : sequence (0)
+        {
+            for (auto& w : words) w.store (0, std::memory_order_relaxed);
+        }
+
+        /// Store a new value. Writers must be serialized by the caller.
+        void Store (const T& value)
+        {
+            uint32_t buffer[numWords] = {};
+            memcpy (buffer, &value, sizeof (T));
+            SeqLockStore (sequence, words, numWords, buffer);
+        }
+
+        /// Obtain a consistent copy of the current value.
+        void Load (T& value) const
+        {
+            uint32_t buffer[numWords];
+            while (!SeqLockTryLoad (sequence, words, numWords, buffer)) {}
+            memcpy (&value, buffer, sizeof (T));
+        }
+    };
+
+} // namespace detail
+} // namespace windows10colors
+
+#endif // __WINDOWS10COLORSSEQLOCK_H__
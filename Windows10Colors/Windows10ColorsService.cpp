@@ -0,0 +1,160 @@
+/*
+This library is licensed under the zlib license.
+
+Copyright (C) 2016-2018 Frank Richter
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+claim that you wrote the original software. If you use this software
+in a product, an acknowledgment in the product documentation would be
+appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+
+Original source:
+https://github.com/res2k/Windows10Colors
+
+*/
+#include "Windows10ColorsService.h"
+
+namespace windows10colors
+{
+
+// Future that is ready with the given result
+static std::shared_future<SnapshotResult> MakeReadyResult (HRESULT hr)
+{
+    std::promise<SnapshotResult> promise;
+    SnapshotResult result = SnapshotResult ();
+    result.result = hr;
+    promise.set_value (result);
+    return promise.get_future ().share ();
+}
+
+QueryService::QueryService (CaptureFunction capture, ThreadHooks hooks)
+  : capture (std::move (capture)), hooks (std::move (hooks)), threadId (std::thread::id ()), running (false),
+    stopping (false), queries (0), captures (0)
+{
+}
+
+QueryService::~QueryService ()
+{
+    Stop ();
+}
+
+HRESULT QueryService::Start ()
+{
+    std::lock_guard<std::mutex> lock (threadMutex);
+    if (thread.joinable ()) return S_FALSE;
+
+    {
+        std::lock_guard<std::mutex> queueLock (queueMutex);
+        stopping = false;
+    }
+    /* Accept queries right away: queries issued while the start hook runs
+     * are answered once the thread enters Run(). */
+    running.store (true, std::memory_order_release);
+    // Report the result of the start hook, as the service is useless if it failed
+    std::promise<HRESULT> started;
+    std::future<HRESULT> startResult = started.get_future ();
+    thread = std::thread ([this, &started]()
+    {
+        threadId.store (std::this_thread::get_id (), std::memory_order_release);
+        HRESULT hr = hooks.start ? hooks.start () : S_OK;
+        started.set_value (hr);
+        if (FAILED (hr)) return;
+        Run ();
+        if (hooks.finish) hooks.finish ();
+    });
+    HRESULT hr = startResult.get ();
+    if (FAILED (hr))
+    {
+        thread.join ();
+        threadId.store (std::thread::id (), std::memory_order_release);
+        running.store (false, std::memory_order_release);
+        std::lock_guard<std::mutex> queueLock (queueMutex);
+        AbortPendingBatch ();
+    }
+    return hr;
+}
+
+void QueryService::Stop ()
+{
+    std::lock_guard<std::mutex> lock (threadMutex);
+    if (!thread.joinable ()) return;
+
+    running.store (false, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> queueLock (queueMutex);
+        stopping = true;
+    }
+    queueChanged.notify_all ();
+    thread.join ();
+    threadId.store (std::thread::id (), std::memory_order_release);
+}
+
+bool QueryService::IsServiceThread () const
+{
+    return std::this_thread::get_id () == threadId.load (std::memory_order_acquire);
+}
+
+std::shared_future<SnapshotResult> QueryService::Query ()
+{
+    queries.fetch_add (1, std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lock (queueMutex);
+    if (stopping || !IsRunning ()) return MakeReadyResult (E_ABORT);
+    if (!pendingBatch)
+    {
+        pendingBatch = std::make_shared<Batch> ();
+        pendingResult = pendingBatch->get_future ().share ();
+        queueChanged.notify_one ();
+    }
+    return pendingResult;
+}
+
+void QueryService::Run ()
+{
+    std::unique_lock<std::mutex> lock (queueMutex);
+    while (true)
+    {
+        queueChanged.wait (lock, [this]() { return stopping || pendingBatch; });
+        if (stopping) break;
+
+        /* Take the batch, so queries issued during the capture start a new one:
+         * the capture may have read the settings before they changed. */
+        std::shared_ptr<Batch> batch;
+        batch.swap (pendingBatch);
+        pendingResult = std::shared_future<SnapshotResult> ();
+        lock.unlock ();
+
+        SnapshotResult result = SnapshotResult ();
+        result.result = capture (result.snapshot);
+        captures.fetch_add (1, std::memory_order_relaxed);
+        batch->set_value (result);
+
+        lock.lock ();
+    }
+
+    // Answer queries that arrived while stopping
+    AbortPendingBatch ();
+}
+
+void QueryService::AbortPendingBatch ()
+{
+    if (!pendingBatch) return;
+    SnapshotResult result = SnapshotResult ();
+    result.result = E_ABORT;
+    pendingBatch->set_value (result);
+    pendingBatch.reset ();
+    pendingResult = std::shared_future<SnapshotResult> ();
+}
+
+} // namespace windows10colors
@@ -0,0 +1,138 @@
+/*
+This library is licensed under the zlib license.
+
+Copyright (C) 2016-2018 Frank Richter
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+claim that you wrote the original software. If you use this software
+in a product, an acknowledgment in the product documentation would be
+appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+
+Original source:
+https://github.com/res2k/Windows10Colors
+
+*/
+#ifndef __WINDOWS10COLORSSERVICE_H__
+#define __WINDOWS10COLORSSERVICE_H__
+
+/**\file
+ * Service thread answering theme queries on behalf of other threads.
+ */
+
+#include "Windows10ColorsCache.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace windows10colors
+{
+    /// Result of a query answered by QueryService
+    struct SnapshotResult
+    {
+        /// Result of capturing the snapshot
+        HRESULT result;
+        /// Captured snapshot. Only valid if \c result indicates success.
+        ThemeSnapshot snapshot;
+    };
+
+    /**
+     * Thread capturing theme snapshots on behalf of other threads.
+     * All captures happen on the service thread, so per-thread setup (like
+     * initializing COM and activating WinRT objects) is only needed there,
+     * not on the threads issuing queries.
+     * Queries issued while the thread is idle or capturing are batched:
+     * they're all answered by a single subsequent capture.
+     */
+    class QueryService
+    {
+    public:
+        /// Function to capture a snapshot. Called on the service thread.
+        typedef ThemeCache::CaptureFunction CaptureFunction;
+
+        /**
+         * Constructor.
+         * \param capture Function to capture a snapshot.
+         * \param hooks Functions to call on the service thread.
+         */
+        explicit QueryService (CaptureFunction capture, ThreadHooks hooks = ThreadHooks ());
+        /// Stops the service thread.
+        ~QueryService ();
+
+        /**
+         * Start the service thread.
+         * Queries are accepted as soon as this is called; if the \c start hook
+         * fails, queries issued in the meantime receive \c E_ABORT.
+         * \returns Result of the \c start hook. \c S_FALSE if already running.
+         */
+        HRESULT Start ();
+        /**
+         * Stop the service thread. Waits for the thread to finish.
+         * Queries not answered yet receive \c E_ABORT.
+         */
+        void Stop ();
+        /// Returns whether the service thread is running
+        bool IsRunning () const { return running.load (std::memory_order_acquire); }
+        /// Returns whether the calling thread is the service thread
+        bool IsServiceThread () const;
+
+        /**
+         * Queue a query. May be called from any thread.
+         * \returns Future receiving the captured snapshot. Receives \c E_ABORT
+         *   if the service isn't running.
+         */
+        std::shared_future<SnapshotResult> Query ();
+
+        /// Number of queries issued
+        unsigned long GetQueryCount () const { return queries.load (std::memory_order_relaxed); }
+        /// Number of snapshots captured to answer queries
+        unsigned long GetCaptureCount () const { return captures.load (std::memory_order_relaxed); }
+    private:
+        typedef std::promise<SnapshotResult> Batch;
+
+        CaptureFunction capture;
+        ThreadHooks hooks;
+        /// Serializes Start() and Stop()
+        std::mutex threadMutex;
+        std::thread thread;
+        /// ID of the service thread while it runs; read without locking by IsServiceThread()
+        std::atomic<std::thread::id> threadId;
+        std::atomic<bool> running;
+
+        /// Protects the queue state
+        std::mutex queueMutex;
+        /// Signalled when a batch was queued or the service is stopping
+        std::condition_variable queueChanged;
+        /// Batch collecting queries for the next capture
+        std::shared_ptr<Batch> pendingBatch;
+        /// Future of \c pendingBatch
+        std::shared_future<SnapshotResult> pendingResult;
+        bool stopping;
+
+        std::atomic<unsigned long> queries;
+        std::atomic<unsigned long> captures;
+
+        void Run ();
+        /// Answer the pending batch with \c E_ABORT, queueMutex must be held
+        void AbortPendingBatch ();
+
+        QueryService (const QueryService&) = delete;
+        QueryService& operator= (const QueryService&) = delete;
+    };
+} // namespace windows10colors
+
+#endif // __WINDOWS10COLORSSERVICE_H__
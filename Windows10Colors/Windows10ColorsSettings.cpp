@@ -0,0 +1,112 @@
+/*
+This library is licensed under the zlib license.
+
+Copyright (C) 2016-2018 Frank Richter
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+claim that you wrote the original software. If you use this software
+in a product, an acknowledgment in the product documentation would be
+appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+
+Original source:
+https://github.com/res2k/Windows10Colors
+
+*/
+#include "Windows10ColorsSettings.h"
+
+namespace windows10colors
+{
+
+const wchar_t* GetSettingsKeyPath (SettingsKey key)
+{
+    switch (key)
+    {
+    case SettingsKey::DWM:          return L"SOFTWARE\\Microsoft\\Windows\\DWM";
+    case SettingsKey::Personalize:  return L"SOFTWARE\\Microsoft\\Windows\\CurrentVersion\\Themes\\Personalize";
+    }
+    return nullptr;
+}
+
+void ReadDwmSettings (SettingsStore& store, ThemeSnapshot& snapshot)
+{
+    enum { valColorizationColor, valColorizationColorBalance, valAccentColor, valColorPrevalence, numValues };
+    static const wchar_t* const names[numValues] =
+        { L"ColorizationColor", L"ColorizationColorBalance", L"AccentColor", L"ColorPrevalence" };
+    uint32_t values[numValues];
+    HRESULT results[numValues];
+    HRESULT hr = store.QueryValues (SettingsKey::DWM, numValues, names, values, results);
+    if (FAILED (hr))
+    {
+        snapshot.dwmResult = hr;
+        return;
+    }
+
+    DwmColors& colors = snapshot.dwmColors;
+    snapshot.dwmResult = S_OK;
+    if (SUCCEEDED (results[valColorizationColor]))
+    {
+        // Stored in the registry as BGRA
+        uint32_t c = values[valColorizationColor];
+        colors.ColorizationColor =
+            MakeRGBA ((c >> 16) & 0xff, (c >> 8) & 0xff, c & 0xff, (c >> 24) & 0xff);
+    }
+    else
+    {
+        snapshot.dwmResult = results[valColorizationColor];
+    }
+    if (SUCCEEDED (results[valColorizationColorBalance]))
+        colors.ColorizationColorBalance = static_cast<int> (values[valColorizationColorBalance]);
+    else
+        snapshot.dwmResult = results[valColorizationColorBalance];
+
+    colors.haveAccentColor = SUCCEEDED (results[valAccentColor]);
+    if (colors.haveAccentColor) colors.AccentColor = static_cast<RGBA> (values[valAccentColor]);
+
+    snapshot.haveDwmColorPrevalence = SUCCEEDED (results[valColorPrevalence]);
+    snapshot.dwmColorPrevalence = snapshot.haveDwmColorPrevalence && (values[valColorPrevalence] != 0);
+}
+
+void ReadPersonalizeSettings (SettingsStore& store, ThemeSnapshot& snapshot)
+{
+    enum { valColorPrevalence, valAppsUseLightTheme, valSystemUsesLightTheme, numValues };
+    static const wchar_t* const names[numValues] =
+        { L"ColorPrevalence", L"AppsUseLightTheme", L"SystemUsesLightTheme" };
+    uint32_t values[numValues];
+    HRESULT results[numValues];
+    HRESULT hr = store.QueryValues (SettingsKey::Personalize, numValues, names, values, results);
+    if (FAILED (hr))
+    {
+        snapshot.personalizeColorPrevalenceResult =
+        snapshot.appsUseLightThemeResult =
+        snapshot.systemUsesLightThemeResult = hr;
+        return;
+    }
+
+    auto SetFlag = [&](int index, HRESULT& flagResult, bool& flag)
+    {
+        flagResult = results[index];
+        if (SUCCEEDED (flagResult)) flag = values[index] != 0;
+    };
+    SetFlag (valColorPrevalence, snapshot.personalizeColorPrevalenceResult, snapshot.personalizeColorPrevalence);
+    SetFlag (valAppsUseLightTheme, snapshot.appsUseLightThemeResult, snapshot.appsUseLightTheme);
+    SetFlag (valSystemUsesLightTheme, snapshot.systemUsesLightThemeResult, snapshot.systemUsesLightTheme);
+}
+
+void ReadThemeSettings (SettingsStore& store, ThemeSnapshot& snapshot)
+{
+    ReadDwmSettings (store, snapshot);
+    ReadPersonalizeSettings (store, snapshot);
+}
+
+} // namespace windows10colors
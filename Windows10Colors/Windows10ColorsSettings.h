@@ -0,0 +1,110 @@
+/*
+This library is licensed under the zlib license.
+
+Copyright (C) 2016-2018 Frank Richter
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+claim that you wrote the original software. If you use this software
+in a product, an acknowledgment in the product documentation would be
+appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+
+Original source:
+https://github.com/res2k/Windows10Colors
+
+*/
+#ifndef __WINDOWS10COLORSSETTINGS_H__
+#define __WINDOWS10COLORSSETTINGS_H__
+
+/**\file
+ * Abstraction of the storage of theme settings (the registry on Windows).
+ */
+
+#include "Windows10ColorsCore.h"
+
+namespace windows10colors
+{
+    /// Keys containing theme settings
+    enum struct SettingsKey
+    {
+        /// DWM settings (<tt>SOFTWARE\\Microsoft\\Windows\\DWM</tt>)
+        DWM,
+        /// Personalization settings (<tt>SOFTWARE\\Microsoft\\Windows\\CurrentVersion\\Themes\\Personalize</tt>)
+        Personalize
+    };
+
+    /// Get registry path of a key, relative to the user's root key
+    extern const wchar_t* GetSettingsKeyPath (SettingsKey key);
+
+    /**
+     * Storage of theme settings.
+     * Provides access to DWORD values in a number of keys, and notification
+     * about changes of those keys.
+     */
+    class SettingsStore
+    {
+    public:
+        virtual ~SettingsStore () {}
+
+        /**
+         * Query a number of DWORD values from a key.
+         * The key is only opened once for all values.
+         * \param key Key to query values from.
+         * \param count Number of values to query.
+         * \param names Names of the values to query.
+         * \param values Receives values. Only set for values that were queried successfully.
+         * \param results Receives the result of querying each value.
+         * \returns Result of opening the key. If it failed, \a values and \a results are not set.
+         */
+        virtual HRESULT QueryValues (SettingsKey key, size_t count, const wchar_t* const* names,
+                                     uint32_t* values, HRESULT* results) = 0;
+
+        /**
+         * Start watching the keys for changes.
+         * Changes happening after this call are reported by WaitForChange().
+         * Some implementations require that all watching happens on the same thread.
+         */
+        virtual HRESULT StartWatching () = 0;
+        /**
+         * Wait until a key changed, or until StopWaiting() is called.
+         * Watching continues after returning, so changes happening
+         * before the next call are reported by that.
+         * \returns \c S_OK if a key changed, \c S_FALSE if waiting was stopped.
+         */
+        virtual HRESULT WaitForChange () = 0;
+        /**
+         * Make a pending WaitForChange() call, and any calls after that, return \c S_FALSE.
+         * Can be called from any thread. StartWatching() resets this.
+         */
+        virtual void StopWaiting () = 0;
+    };
+
+    /**
+     * Read theme settings from a settings store into a snapshot.
+     * Only the fields stored in the DWM and Personalize keys are set (DWM colors,
+     * \c ColorPrevalence and light theme flags); other fields are left unchanged.
+     */
+    extern void ReadThemeSettings (SettingsStore& store, ThemeSnapshot& snapshot);
+    /**
+     * Read the settings from the DWM key into a snapshot.
+     * Sets the DWM colors, \c dwmResult and the DWM \c ColorPrevalence flag.
+     */
+    extern void ReadDwmSettings (SettingsStore& store, ThemeSnapshot& snapshot);
+    /**
+     * Read the settings from the Personalize key into a snapshot.
+     * Sets the \c ColorPrevalence and light theme flags, and their results.
+     */
+    extern void ReadPersonalizeSettings (SettingsStore& store, ThemeSnapshot& snapshot);
+} // namespace windows10colors
+
+#endif // __WINDOWS10COLORSSETTINGS_H__
@@ -0,0 +1,288 @@
+/*
+This library is licensed under the zlib license.
+
+Copyright (C) 2016-2018 Frank Richter
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+claim that you wrote the original software. If you use this software
+in a product, an acknowledgment in the product documentation would be
+appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+
+Original source:
+https://github.com/res2k/Windows10Colors
+
+*/
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif // NOMINMAX
+#include "Windows10ColorsShared.h"
+
+#include "Windows10ColorsSeqLock.h"
+
+#if !defined(_WIN32)
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace windows10colors
+{
+
+namespace
+{
+    // Copy fields between a snapshot and packed words
+    struct PackField
+    {
+        template<typename T>
+        void operator() (uint32_t& word, const T& field) const { word = static_cast<uint32_t> (field); }
+    };
+    struct UnpackField
+    {
+        template<typename T>
+        void operator() (const uint32_t& word, T& field) const { field = static_cast<T> (word); }
+    };
+
+    template<typename Snapshot, typename Word, typename Op>
+    static void TransferSnapshot (Snapshot& snapshot, Word* words, Op op)
+    {
+        size_t n = 0;
+        op (words[n++], snapshot.osVersion.major);
+        op (words[n++], snapshot.osVersion.minor);
+        op (words[n++], snapshot.osVersion.build);
+        op (words[n++], snapshot.highContrast);
+        op (words[n++], snapshot.sysColors.activeCaption);
+        op (words[n++], snapshot.sysColors.captionText);
+        op (words[n++], snapshot.sysColors.inactiveCaption);
+        op (words[n++], snapshot.sysColors.inactiveCaptionText);
+        op (words[n++], snapshot.sysColors.highlight);
+        op (words[n++], snapshot.uiSettingsResult);
+        op (words[n++], snapshot.uiSettingsAccent.accent);
+        op (words[n++], snapshot.uiSettingsAccent.darkest);
+        op (words[n++], snapshot.uiSettingsAccent.darker);
+        op (words[n++], snapshot.uiSettingsAccent.dark);
+        op (words[n++], snapshot.uiSettingsAccent.light);
+        op (words[n++], snapshot.uiSettingsAccent.lighter);
+        op (words[n++], snapshot.uiSettingsAccent.lightest);
+        op (words[n++], snapshot.dwmResult);
+        op (words[n++], snapshot.dwmColors.ColorizationColor);
+        op (words[n++], snapshot.dwmColors.ColorizationColorBalance);
+        op (words[n++], snapshot.dwmColors.haveAccentColor);
+        op (words[n++], snapshot.dwmColors.AccentColor);
+        op (words[n++], snapshot.haveDwmColorPrevalence);
+        op (words[n++], snapshot.dwmColorPrevalence);
+        op (words[n++], snapshot.personalizeColorPrevalenceResult);
+        op (words[n++], snapshot.personalizeColorPrevalence);
+        op (words[n++], snapshot.appsUseLightThemeResult);
+        op (words[n++], snapshot.appsUseLightTheme);
+        op (words[n++], snapshot.systemUsesLightThemeResult);
+        op (words[n++], snapshot.systemUsesLightTheme);
+        op (words[n++], snapshot.systemCalls);
+    }
+
+    // Segment layout, in 32-bit words
+    enum
+    {
+        wordMagic,
+        wordVersion,
+        wordPayloadSize,
+        wordSequence,
+        wordPayload,
+
+        segmentWords = wordPayload + packedThemeSnapshotWords
+    };
+    static const uint32_t segmentMagic = 0x43303157; // "W10C"
+    static const size_t segmentSize = segmentWords * sizeof (uint32_t);
+    // Give up reading after this many inconsistent copies
+    static const int maxReadAttempts = 1000;
+}
+
+void PackThemeSnapshot (const ThemeSnapshot& snapshot, uint32_t (&words)[packedThemeSnapshotWords])
+{
+    TransferSnapshot (snapshot, words, PackField ());
+}
+
+void UnpackThemeSnapshot (const uint32_t (&words)[packedThemeSnapshotWords], ThemeSnapshot& snapshot)
+{
+    snapshot = ThemeSnapshot ();
+    TransferSnapshot (snapshot, words, UnpackField ());
+}
+
+SharedThemeSnapshot::SharedThemeSnapshot () : words (nullptr), writable (false)
+#if defined(_WIN32)
+  , mapping (NULL)
+#endif
+{
+}
+
+SharedThemeSnapshot::~SharedThemeSnapshot ()
+{
+    Close ();
+}
+
+#if defined(_WIN32)
+HRESULT SharedThemeSnapshot::Map (const char* name, bool create)
+{
+    if (create)
+        mapping = CreateFileMappingA (INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, segmentSize, name);
+    else
+        mapping = OpenFileMappingA (FILE_MAP_READ, FALSE, name);
+    if (!mapping) return HRESULT_FROM_WIN32 (GetLastError ());
+
+    void* view = MapViewOfFile (mapping, create ? FILE_MAP_READ | FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, segmentSize);
+    if (!view)
+    {
+        HRESULT hr = HRESULT_FROM_WIN32 (GetLastError ());
+        CloseHandle (mapping);
+        mapping = NULL;
+        return hr;
+    }
+    words = static_cast<std::atomic<uint32_t>*> (view);
+    return S_OK;
+}
+
+void SharedThemeSnapshot::Close ()
+{
+    if (words) UnmapViewOfFile (words);
+    words = nullptr;
+    if (mapping) CloseHandle (mapping);
+    mapping = NULL;
+    writable = false;
+}
+#else
+static HRESULT ErrnoResult ()
+{
+    return MAKE_HRESULT (1, 0x7, errno & 0xffff);
+}
+
+HRESULT SharedThemeSnapshot::Map (const char* name, bool create)
+{
+    int fd = create ? open (name, O_RDWR | O_CREAT | O_CLOEXEC, 0644) : open (name, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return ErrnoResult ();
+
+    struct stat st;
+    HRESULT hr = S_OK;
+    if (fstat (fd, &st) != 0)
+        hr = ErrnoResult ();
+    else if (static_cast<size_t> (st.st_size) < segmentSize)
+    {
+        if (!create)
+            hr = HRESULT_FROM_WIN32 (ERROR_INVALID_DATA);
+        else if (ftruncate (fd, segmentSize) != 0)
+            hr = ErrnoResult ();
+    }
+    if (SUCCEEDED (hr))
+    {
+        void* view = mmap (nullptr, segmentSize, create ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+        if (view == MAP_FAILED)
+            hr = ErrnoResult ();
+        else
+            words = static_cast<std::atomic<uint32_t>*> (view);
+    }
+    // The mapping stays valid after closing the file
+    close (fd);
+    return hr;
+}
+
+void SharedThemeSnapshot::Close ()
+{
+    if (words) munmap (words, segmentSize);
+    words = nullptr;
+    writable = false;
+}
+#endif
+
+bool SharedThemeSnapshot::IsCompatible () const
+{
+    return (words[wordMagic].load (std::memory_order_acquire) == segmentMagic)
+        && (words[wordVersion].load (std::memory_order_relaxed) == layoutVersion)
+        && (words[wordPayloadSize].load (std::memory_order_relaxed) == packedThemeSnapshotWords);
+}
+
+HRESULT SharedThemeSnapshot::Create (const char* name)
+{
+    Close ();
+    HRESULT hr = Map (name, true);
+    if (FAILED (hr)) return hr;
+    writable = true;
+
+    if (!IsCompatible ())
+    {
+        // New (zero-filled) segment or incompatible layout: initialize, publishing the header last
+        words[wordMagic].store (0, std::memory_order_relaxed);
+        std::atomic_thread_fence (std::memory_order_release);
+        words[wordVersion].store (layoutVersion, std::memory_order_relaxed);
+        words[wordPayloadSize].store (packedThemeSnapshotWords, std::memory_order_relaxed);
+        words[wordSequence].store (0, std::memory_order_relaxed);
+        for (size_t i = wordPayload; i < segmentWords; i++)
+        {
+            words[i].store (0, std::memory_order_relaxed);
+        }
+        words[wordMagic].store (segmentMagic, std::memory_order_release);
+    }
+    return S_OK;
+}
+
+HRESULT SharedThemeSnapshot::Open (const char* name)
+{
+    Close ();
+    HRESULT hr = Map (name, false);
+    if (FAILED (hr)) return hr;
+    if (!IsCompatible ())
+    {
+        Close ();
+        return HRESULT_FROM_WIN32 (ERROR_INVALID_DATA);
+    }
+    return S_OK;
+}
+
+HRESULT SharedThemeSnapshot::Write (const ThemeSnapshot& snapshot)
+{
+    if (!words || !writable) return E_FAIL;
+
+    uint32_t packed[packedThemeSnapshotWords];
+    PackThemeSnapshot (snapshot, packed);
+
+    std::lock_guard<std::mutex> lock (writeMutex);
+    // Skip 0 on wrap-around, as that means "nothing published"
+    if (words[wordSequence].load (std::memory_order_relaxed) == UINT32_MAX - 1)
+        words[wordSequence].store (0, std::memory_order_relaxed);
+    detail::SeqLockStore (words[wordSequence], words + wordPayload, packedThemeSnapshotWords, packed);
+    return S_OK;
+}
+
+HRESULT SharedThemeSnapshot::Read (ThemeSnapshot& snapshot) const
+{
+    if (!words) return E_FAIL;
+
+    uint32_t packed[packedThemeSnapshotWords];
+    for (int attempt = 0; attempt < maxReadAttempts; attempt++)
+    {
+        if (words[wordSequence].load (std::memory_order_acquire) == 0) return E_PENDING;
+        if (detail::SeqLockTryLoad (words[wordSequence], words + wordPayload, packedThemeSnapshotWords, packed))
+        {
+            UnpackThemeSnapshot (packed, snapshot);
+            return S_OK;
+        }
+    }
+    return E_PENDING;
+}
+
+uint32_t SharedThemeSnapshot::GetSequence () const
+{
+    return words ? words[wordSequence].load (std::memory_order_acquire) : 0;
+}
+
+} // namespace windows10colors
@@ -0,0 +1,122 @@
+/*
+This library is licensed under the zlib license.
+
+Copyright (C) 2016-2018 Frank Richter
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+claim that you wrote the original software. If you use this software
+in a product, an acknowledgment in the product documentation would be
+appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+
+Original source:
+https://github.com/res2k/Windows10Colors
+
+*/
+#ifndef __WINDOWS10COLORSSHARED_H__
+#define __WINDOWS10COLORSSHARED_H__
+
+/**\file
+ * Sharing of theme snapshots between processes through shared memory.
+ */
+
+#include "Windows10ColorsCore.h"
+
+#include <atomic>
+#include <mutex>
+
+namespace windows10colors
+{
+    /// Number of 32-bit words in a packed ThemeSnapshot
+    static const size_t packedThemeSnapshotWords = 31;
+
+    /**
+     * Pack a snapshot into a fixed layout of 32-bit words.
+     * The layout doesn't depend on compiler or architecture, so it can be
+     * exchanged between processes or stored.
+     */
+    extern void PackThemeSnapshot (const ThemeSnapshot& snapshot, uint32_t (&words)[packedThemeSnapshotWords]);
+    /// Unpack a snapshot packed with PackThemeSnapshot().
+    extern void UnpackThemeSnapshot (const uint32_t (&words)[packedThemeSnapshotWords], ThemeSnapshot& snapshot);
+
+    /**
+     * Theme snapshot in a named shared memory segment.
+     * One process publishes snapshots (Create(), Write()); other processes
+     * map the segment read-only (Open(), Read()) and use the published snapshot
+     * instead of capturing one themselves.
+     * The segment starts with a header (magic, layout version, payload size)
+     * followed by a sequence counter and the packed snapshot. Writes are
+     * protected by a sequence lock, so readers never block the publisher and
+     * never observe a partially written snapshot.
+     * \remarks On Windows, the name is that of a file mapping object (e.g.
+     *   <tt>Local\\Windows10Colors.ThemeSnapshot</tt>). Elsewhere the name is the
+     *   path of a file that is memory mapped.
+     */
+    class SharedThemeSnapshot
+    {
+    public:
+        /// Version of the segment layout. Changes whenever the layout changes.
+        static const uint32_t layoutVersion = 1;
+
+        SharedThemeSnapshot ();
+        ~SharedThemeSnapshot ();
+
+        /**
+         * Create the segment (or open an existing one) for publishing.
+         * An existing segment with an incompatible layout is reinitialized.
+         */
+        HRESULT Create (const char* name);
+        /**
+         * Open an existing segment read-only.
+         * Fails with \c HRESULT_FROM_WIN32(ERROR_INVALID_DATA) if the segment has an
+         * incompatible layout.
+         */
+        HRESULT Open (const char* name);
+        /// Unmap the segment.
+        void Close ();
+
+        /// Whether a segment is mapped
+        bool IsOpen () const { return words != nullptr; }
+        /// Whether the segment is mapped for publishing
+        bool IsWritable () const { return writable; }
+
+        /// Publish a snapshot. Only one process should publish to a segment.
+        HRESULT Write (const ThemeSnapshot& snapshot);
+        /**
+         * Read the published snapshot.
+         * \returns \c E_PENDING if nothing was published yet, or if no consistent
+         *   copy could be obtained (e.g. the publisher died while writing).
+         */
+        HRESULT Read (ThemeSnapshot& snapshot) const;
+        /// Sequence number of the published snapshot. Changes with every write; 0 if nothing was published.
+        uint32_t GetSequence () const;
+    private:
+        std::atomic<uint32_t>* words;
+        bool writable;
+        /// Serializes writers in this process
+        std::mutex writeMutex;
+#if defined(_WIN32)
+        HANDLE mapping;
+#endif
+
+        /// Map segment. Sets \c words on success.
+        HRESULT Map (const char* name, bool create);
+        /// Check segment header
+        bool IsCompatible () const;
+
+        SharedThemeSnapshot (const SharedThemeSnapshot&) = delete;
+        SharedThemeSnapshot& operator= (const SharedThemeSnapshot&) = delete;
+    };
+} // namespace windows10colors
+
+#endif // __WINDOWS10COLORSSHARED_H__
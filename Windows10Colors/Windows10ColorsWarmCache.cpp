@@ -0,0 +1,128 @@
+/*
+This library is licensed under the zlib license.
+
+Copyright (C) 2016-2018 Frank Richter
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+claim that you wrote the original software. If you use this software
+in a product, an acknowledgment in the product documentation would be
+appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+
+Original source:
+https://github.com/res2k/Windows10Colors
+
+*/
+#include "Windows10ColorsWarmCache.h"
+
+#include "Windows10ColorsShared.h"
+
+namespace windows10colors
+{
+
+namespace
+{
+    // Data layout, in little-endian 32-bit words
+    enum
+    {
+        wordMagic,
+        wordVersion,
+        wordOSMajor,
+        wordOSMinor,
+        wordOSBuild,
+        wordPayloadSize,
+        wordPayload,
+        wordChecksum = wordPayload + packedThemeSnapshotWords,
+
+        dataWords
+    };
+    static const uint32_t warmCacheMagic = 0x57303157; // "W10W"
+
+    static void PutWord (unsigned char* p, uint32_t w)
+    {
+        p[0] = static_cast<unsigned char> (w);
+        p[1] = static_cast<unsigned char> (w >> 8);
+        p[2] = static_cast<unsigned char> (w >> 16);
+        p[3] = static_cast<unsigned char> (w >> 24);
+    }
+
+    static uint32_t GetWord (const unsigned char* p)
+    {
+        return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t> (p[3]) << 24);
+    }
+
+    // 32-bit FNV-1a hash
+    static uint32_t Checksum (const unsigned char* data, size_t size)
+    {
+        uint32_t hash = 0x811c9dc5;
+        for (size_t i = 0; i < size; i++)
+        {
+            hash = (hash ^ data[i]) * 0x01000193;
+        }
+        return hash;
+    }
+}
+
+void SerializeWarmCache (const ThemeSnapshot& snapshot, std::vector<unsigned char>& data)
+{
+    uint32_t words[dataWords];
+    words[wordMagic] = warmCacheMagic;
+    words[wordVersion] = warmCacheFormatVersion;
+    words[wordOSMajor] = snapshot.osVersion.major;
+    words[wordOSMinor] = snapshot.osVersion.minor;
+    words[wordOSBuild] = snapshot.osVersion.build;
+    words[wordPayloadSize] = packedThemeSnapshotWords;
+    uint32_t payload[packedThemeSnapshotWords];
+    PackThemeSnapshot (snapshot, payload);
+    for (size_t i = 0; i < packedThemeSnapshotWords; i++)
+    {
+        words[wordPayload + i] = payload[i];
+    }
+
+    data.resize (dataWords * sizeof (uint32_t));
+    for (size_t i = 0; i < wordChecksum; i++)
+    {
+        PutWord (data.data () + i * sizeof (uint32_t), words[i]);
+    }
+    PutWord (data.data () + wordChecksum * sizeof (uint32_t), Checksum (data.data (), wordChecksum * sizeof (uint32_t)));
+}
+
+HRESULT ParseWarmCache (const void* data, size_t size, const OSVersion& osVersion, ThemeSnapshot& snapshot)
+{
+    const HRESULT invalid = HRESULT_FROM_WIN32 (ERROR_INVALID_DATA);
+    if (size != dataWords * sizeof (uint32_t)) return invalid;
+
+    const unsigned char* bytes = static_cast<const unsigned char*> (data);
+    // Cheap header checks first
+    if ((GetWord (bytes + wordMagic * sizeof (uint32_t)) != warmCacheMagic)
+        || (GetWord (bytes + wordVersion * sizeof (uint32_t)) != warmCacheFormatVersion)
+        || (GetWord (bytes + wordPayloadSize * sizeof (uint32_t)) != packedThemeSnapshotWords))
+        return invalid;
+    // Settings may differ after an OS update
+    if ((GetWord (bytes + wordOSMajor * sizeof (uint32_t)) != osVersion.major)
+        || (GetWord (bytes + wordOSMinor * sizeof (uint32_t)) != osVersion.minor)
+        || (GetWord (bytes + wordOSBuild * sizeof (uint32_t)) != osVersion.build))
+        return invalid;
+    if (GetWord (bytes + wordChecksum * sizeof (uint32_t)) != Checksum (bytes, wordChecksum * sizeof (uint32_t)))
+        return invalid;
+
+    uint32_t payload[packedThemeSnapshotWords];
+    for (size_t i = 0; i < packedThemeSnapshotWords; i++)
+    {
+        payload[i] = GetWord (bytes + (wordPayload + i) * sizeof (uint32_t));
+    }
+    UnpackThemeSnapshot (payload, snapshot);
+    return S_OK;
+}
+
+} // namespace windows10colors
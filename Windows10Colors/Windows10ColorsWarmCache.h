@@ -0,0 +1,62 @@
+/*
+This library is licensed under the zlib license.
+
+Copyright (C) 2016-2018 Frank Richter
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+claim that you wrote the original software. If you use this software
+in a product, an acknowledgment in the product documentation would be
+appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+
+Original source:
+https://github.com/res2k/Windows10Colors
+
+*/
+#ifndef __WINDOWS10COLORSWARMCACHE_H__
+#define __WINDOWS10COLORSWARMCACHE_H__
+
+/**\file
+ * Serialization of theme snapshots for a persistent "warm" startup cache.
+ */
+
+#include "Windows10ColorsCore.h"
+
+#include <vector>
+
+namespace windows10colors
+{
+    /// Version of the warm cache data format
+    static const uint32_t warmCacheFormatVersion = 1;
+
+    /**
+     * Serialize a snapshot into warm cache data.
+     * The data contains a format version, the OS version the snapshot was
+     * captured on, the packed snapshot and a checksum.
+     */
+    extern void SerializeWarmCache (const ThemeSnapshot& snapshot, std::vector<unsigned char>& data);
+    /**
+     * Parse warm cache data.
+     * \param data Serialized data.
+     * \param size Size of \a data in bytes.
+     * \param osVersion Version of the running OS. Data captured on a different
+     *   OS version is rejected as stale.
+     * \param snapshot Receives the snapshot.
+     * \returns \c HRESULT_FROM_WIN32(ERROR_INVALID_DATA) if the data is corrupt, has
+     *   a different format version or was captured on a different OS version.
+     */
+    extern HRESULT ParseWarmCache (const void* data, size_t size, const OSVersion& osVersion,
+                                   ThemeSnapshot& snapshot);
+} // namespace windows10colors
+
+#endif // __WINDOWS10COLORSWARMCACHE_H__
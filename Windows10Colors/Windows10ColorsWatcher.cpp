@@ -0,0 +1,91 @@
+/*
+This library is licensed under the zlib license.
+
+Copyright (C) 2016-2018 Frank Richter
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+claim that you wrote the original software. If you use this software
+in a product, an acknowledgment in the product documentation would be
+appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+
+Original source:
+https://github.com/res2k/Windows10Colors
+
+*/
+#include "Windows10ColorsWatcher.h"
+
+#include <future>
+
+namespace windows10colors
+{
+
+ThemeWatcher::ThemeWatcher (SettingsStore& store, ThemeCache& cache, ThreadHooks hooks)
+  : store (store), cache (cache), hooks (std::move (hooks)), changeNotifications (0), invalidations (0)
+{
+}
+
+ThemeWatcher::~ThemeWatcher ()
+{
+    Stop ();
+}
+
+HRESULT ThemeWatcher::Start ()
+{
+    std::lock_guard<std::mutex> lock (threadMutex);
+    if (thread.joinable ()) return S_FALSE;
+
+    /* Start watching on the background thread, as some stores
+     * require watching to happen on a single thread. */
+    std::promise<HRESULT> started;
+    std::future<HRESULT> startResult = started.get_future ();
+    thread = std::thread ([this, &started]()
+    {
+        bool hooked = hooks.start && SUCCEEDED (hooks.start ());
+        HRESULT hr = store.StartWatching ();
+        started.set_value (hr);
+        if (SUCCEEDED (hr)) Run ();
+        if (hooked && hooks.finish) hooks.finish ();
+    });
+    HRESULT hr = startResult.get ();
+    if (FAILED (hr)) thread.join ();
+    return hr;
+}
+
+void ThemeWatcher::Stop ()
+{
+    std::lock_guard<std::mutex> lock (threadMutex);
+    if (!thread.joinable ()) return;
+    store.StopWaiting ();
+    thread.join ();
+}
+
+void ThemeWatcher::Run ()
+{
+    ThemeSnapshot current = ThemeSnapshot ();
+    ReadThemeSettings (store, current);
+    while (store.WaitForChange () == S_OK)
+    {
+        changeNotifications.fetch_add (1, std::memory_order_relaxed);
+
+        ThemeSnapshot updated = ThemeSnapshot ();
+        ReadThemeSettings (store, updated);
+        if (SameThemeSettings (current, updated)) continue;
+
+        current = updated;
+        cache.Invalidate ();
+        invalidations.fetch_add (1, std::memory_order_relaxed);
+    }
+}
+
+} // namespace windows10colors
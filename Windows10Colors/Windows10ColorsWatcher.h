@@ -0,0 +1,93 @@
+/*
+This library is licensed under the zlib license.
+
+Copyright (C) 2016-2018 Frank Richter
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+claim that you wrote the original software. If you use this software
+in a product, an acknowledgment in the product documentation would be
+appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+
+Original source:
+https://github.com/res2k/Windows10Colors
+
+*/
+#ifndef __WINDOWS10COLORSWATCHER_H__
+#define __WINDOWS10COLORSWATCHER_H__
+
+/**\file
+ * Background watching of theme settings for changes.
+ */
+
+#include "Windows10ColorsCache.h"
+#include "Windows10ColorsSettings.h"
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace windows10colors
+{
+    /**
+     * Watches a settings store in a background thread and invalidates a
+     * theme cache when a relevant setting actually changed.
+     * Change notifications for settings not affecting the theme colors
+     * (the watched keys contain others as well) don't cause an invalidation.
+     */
+    class ThemeWatcher
+    {
+    public:
+        /// Functions called on the watcher thread
+        typedef windows10colors::ThreadHooks ThreadHooks;
+
+        /**
+         * Constructor.
+         * \param store Store to watch. Must outlive this object.
+         * \param cache Cache to invalidate on changes. Must outlive this object.
+         * \param hooks Functions to call on the watcher thread.
+         */
+        ThemeWatcher (SettingsStore& store, ThemeCache& cache, ThreadHooks hooks = ThreadHooks ());
+        /// Stops watching.
+        ~ThemeWatcher ();
+
+        /**
+         * Start watching in a background thread.
+         * \returns Result of starting to watch the store. \c S_FALSE if already watching.
+         */
+        HRESULT Start ();
+        /// Stop watching. Waits for the background thread to finish.
+        void Stop ();
+
+        /// Number of change notifications received from the store
+        unsigned long GetChangeNotifications () const { return changeNotifications.load (std::memory_order_relaxed); }
+        /// Number of times the cache was invalidated
+        unsigned long GetInvalidations () const { return invalidations.load (std::memory_order_relaxed); }
+    private:
+        SettingsStore& store;
+        ThemeCache& cache;
+        ThreadHooks hooks;
+        std::mutex threadMutex;
+        std::thread thread;
+        std::atomic<unsigned long> changeNotifications;
+        std::atomic<unsigned long> invalidations;
+
+        void Run ();
+
+        ThemeWatcher (const ThemeWatcher&) = delete;
+        ThemeWatcher& operator= (const ThemeWatcher&) = delete;
+    };
+} // namespace windows10colors
+
+#endif // __WINDOWS10COLORSWATCHER_H__
@@ -0,0 +1,81 @@
+/*
+This library is licensed under the zlib license.
+
+Copyright (C) 2016-2018 Frank Richter
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+claim that you wrote the original software. If you use this software
+in a product, an acknowledgment in the product documentation would be
+appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+
+Original source:
+https://github.com/res2k/Windows10Colors
+
+*/
+#ifndef __BENCHHARNESS_H__
+#define __BENCHHARNESS_H__
+
+/**\file
+ * Minimal benchmark helpers.
+ */
+
+#include <chrono>
+#include <stdio.h>
+
+namespace bench
+{
+    /// Keeps the compiler from optimizing away a computed value
+    template<typename T>
+    inline void Consume (const T& value)
+    {
+        static volatile unsigned char sink;
+        const volatile unsigned char* bytes = reinterpret_cast<const volatile unsigned char*> (&value);
+        sink = sink + bytes[0];
+    }
+
+    /**
+     * Run a function repeatedly, for at least \a minSeconds.
+     * \returns Average duration of a call, in seconds.
+     */
+    template<typename Func>
+    double Measure (Func&& func, double minSeconds = 0.25)
+    {
+        typedef std::chrono::steady_clock Clock;
+        // Warm up caches and lazily initialized state
+        func ();
+        unsigned long calls = 0;
+        Clock::time_point start = Clock::now ();
+        double elapsed = 0;
+        do
+        {
+            func ();
+            calls++;
+            elapsed = std::chrono::duration<double> (Clock::now () - start).count ();
+        } while (elapsed < minSeconds);
+        return elapsed / calls;
+    }
+
+    /**
+     * Print a result line.
+     * \param name Benchmark name.
+     * \param secondsPerCall Average duration of a call.
+     * \param itemsPerCall Number of items processed per call, for the throughput column.
+     */
+    inline void Report (const char* name, double secondsPerCall, double itemsPerCall = 1)
+    {
+        printf ("%-48s %12.3f us/call %14.0f items/s\n", name, secondsPerCall * 1e6, itemsPerCall / secondsPerCall);
+    }
+} // namespace bench
+
+#endif // __BENCHHARNESS_H__
@@ -0,0 +1,83 @@
+/*
+This library is licensed under the zlib license.
+
+Copyright (C) 2016-2018 Frank Richter
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+claim that you wrote the original software. If you use this software
+in a product, an acknowledgment in the product documentation would be
+appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+
+Original source:
+https://github.com/res2k/Windows10Colors
+
+*/
+
+#include "BenchHarness.h"
+
+#include "Blur.h"
+
+#include <vector>
+
+static const char* ISAName (BlurISA isa)
+{
+    switch (isa)
+    {
+    case BlurISA::Scalar:   return "scalar";
+    case BlurISA::SSE2:     return "SSE2";
+    case BlurISA::AVX2:     return "AVX2";
+    case BlurISA::NEON:     return "NEON";
+    }
+    return "?";
+}
+
+int main ()
+{
+    printf ("Vertical passes use %s\n", ISAName (GetBlurISA ()));
+
+    // Shadow mask of a preview window, and a full RGBA preview
+    const struct
+    {
+        int width, height;
+        BlurFormat format;
+        const char* name;
+    } images[] = {
+        { 256, 256, BlurFormat::Alpha8, "Alpha8 256x256" },
+        { 566, 527, BlurFormat::PremultipliedRGBA, "RGBA 566x527" },
+    };
+    for (const auto& image : images)
+    {
+        int channels = (image.format == BlurFormat::Alpha8) ? 1 : 4;
+        std::vector<uint8_t> pixels (static_cast<size_t> (image.width) * image.height * channels, 0x80);
+        for (int radius : { 4, 8, 16, 32, 64 })
+        {
+            char name[64];
+            snprintf (name, sizeof (name), "BoxBlur, %s, radius %d", image.name, radius);
+            bench::Report (name, bench::Measure ([&]()
+            {
+                BoxBlur (pixels.data (), image.width, image.height, image.width * channels, image.format, radius, 1);
+                bench::Consume (pixels[0]);
+            }), 1);
+            snprintf (name, sizeof (name), "GaussianBlurReference, %s, radius %d", image.name, radius);
+            bench::Report (name, bench::Measure ([&]()
+            {
+                GaussianBlurReference (pixels.data (), image.width, image.height, image.width * channels,
+                                       image.format, radius);
+                bench::Consume (pixels[0]);
+            }), 1);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,104 @@
+/*
+This library is licensed under the zlib license.
+
+Copyright (C) 2016-2018 Frank Richter
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+claim that you wrote the original software. If you use this software
+in a product, an acknowledgment in the product documentation would be
+appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+
+Original source:
+https://github.com/res2k/Windows10Colors
+
+*/
+
+#include "BenchHarness.h"
+
+#include "Windows10ColorsCore.h"
+
+#include <vector>
+
+using namespace windows10colors;
+
+int main ()
+{
+    const size_t count = 4096;
+    std::vector<RGBA> bases (count);
+    for (size_t i = 0; i < count; i++)
+    {
+        bases[i] = MakeRGBA (static_cast<uint8_t> (i * 37), static_cast<uint8_t> (i * 101), static_cast<uint8_t> (i * 13), 255);
+    }
+    std::vector<AccentColor> colors (count);
+
+    bench::Report ("GenerateAccentColors, single color", bench::Measure ([&]()
+    {
+        for (size_t i = 0; i < count; i++) GenerateAccentColors (bases[i], colors[i]);
+        bench::Consume (colors[count - 1]);
+    }), count);
+
+    // Full computation vs. selected shades, through the masked entry point
+    const struct
+    {
+        unsigned int shades;
+        const char* name;
+    } masks[] = {
+        { shadeAll, "GenerateAccentColors, masked, all shades" },
+        { shadeAccent, "GenerateAccentColors, masked, accent only" },
+        { shadeAccent | shadeLight, "GenerateAccentColors, masked, accent+light" },
+        { shadeAccent | shadeDark, "GenerateAccentColors, masked, accent+dark" },
+        { shadeLightest, "GenerateAccentColors, masked, lightest" },
+    };
+    for (const auto& mask : masks)
+    {
+        bench::Report (mask.name, bench::Measure ([&]()
+        {
+            for (size_t i = 0; i < count; i++) GenerateAccentColors (bases[i], colors[i], mask.shades);
+            bench::Consume (colors[count - 1]);
+        }), count);
+    }
+
+    // Batch computation, with each implementation
+    const struct
+    {
+        AccentColorsISA isa;
+        const char* name;
+    } isas[] = {
+        { AccentColorsISA::Scalar, "GenerateAccentColors, batch, scalar" },
+        { AccentColorsISA::SSE2, "GenerateAccentColors, batch, SSE2" },
+        { AccentColorsISA::AVX, "GenerateAccentColors, batch, AVX" },
+    };
+    for (const auto& isa : isas)
+    {
+        if (!GenerateAccentColors (isa.isa, bases.data (), colors.data (), count))
+        {
+            printf ("%-48s not available\n", isa.name);
+            continue;
+        }
+        bench::Report (isa.name, bench::Measure ([&]()
+        {
+            GenerateAccentColors (isa.isa, bases.data (), colors.data (), count);
+            bench::Consume (colors[count - 1]);
+        }), count);
+    }
+
+    bench::Report ("BlendRGBA", bench::Measure ([&]()
+    {
+        RGBA result = 0;
+        for (size_t i = 1; i < count; i++) result ^= BlendRGBA (bases[i - 1], bases[i], 0.25f);
+        bench::Consume (result);
+    }), count - 1);
+
+    return 0;
+}
@@ -0,0 +1,105 @@
+/*
+This library is licensed under the zlib license.
+
+Copyright (C) 2016-2018 Frank Richter
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+claim that you wrote the original software. If you use this software
+in a product, an acknowledgment in the product documentation would be
+appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+
+Original source:
+https://github.com/res2k/Windows10Colors
+
+*/
+
+#include "BenchHarness.h"
+
+#include "Preview.h"
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+using namespace windows10colors;
+
+int main ()
+{
+    // Previews of a range of accent colors
+    const size_t count = 64;
+    std::vector<PreviewColors> colors (count);
+    for (size_t i = 0; i < count; i++)
+    {
+        PreviewColors& c = colors[i];
+        c = PreviewColors ();
+        GenerateAccentColors (MakeRGBA (static_cast<uint8_t> (i * 37), static_cast<uint8_t> (i * 101),
+                                        static_cast<uint8_t> (i * 13), 255), c.accents);
+        c.accentsValid = true;
+        c.colors.activeCaptionText = MakeRGBA (0xff, 0xff, 0xff, 0xff);
+        c.colors.activeCaptionBG = c.accents.accent;
+        c.colors.activeFrame = c.accents.dark;
+        c.colors.inactiveCaptionText = MakeRGBA (0x99, 0x99, 0x99, 0xff);
+        c.colors.inactiveCaptionBG = MakeRGBA (0xff, 0xff, 0xff, 0xff);
+        c.colors.inactiveFrame = MakeRGBA (0xaa, 0xaa, 0xaa, 0xff);
+        c.colorsGlass = c.colors;
+        c.colorsGlass.activeCaptionBG = (c.accents.accent & 0xffffff) | 0xcc000000;
+        c.background = c.window = MakeRGBA (0xff, 0xff, 0xff, 0xff);
+        // Vary the shadow color, so each preview generates its own shadow
+        c.shadow = MakeRGBA (0, 0, static_cast<uint8_t> (i), 0xff);
+    }
+
+    int width, height;
+    GetPreviewSize (colors[0], width, height);
+    std::vector<uint8_t> pixels (static_cast<size_t> (width) * height * 4);
+    ShadowCache shadows;
+    bench::Report ("RenderPreview, shared shadow cache", bench::Measure ([&]()
+    {
+        RenderPreview (colors[0], pixels.data (), width, height, width * 4, &shadows);
+        bench::Consume (pixels[0]);
+    }), 1);
+    bench::Report ("RenderPreview, no shadow cache", bench::Measure ([&]()
+    {
+        RenderPreview (colors[0], pixels.data (), width, height, width * 4);
+        bench::Consume (pixels[0]);
+    }), 1);
+
+    auto sink = [](size_t, const uint8_t* pixels, int, int, ptrdiff_t) { bench::Consume (pixels[0]); };
+    unsigned int hardwareThreads = std::max (std::thread::hardware_concurrency (), 1u);
+    std::vector<unsigned int> threadCounts = { 1, 2, 4 };
+    if (hardwareThreads > 4) threadCounts.push_back (hardwareThreads);
+    for (unsigned int threads : threadCounts)
+    {
+        char name[64];
+        snprintf (name, sizeof (name), "RenderPreviews, %u thread(s)", threads);
+        bench::Report (name, bench::Measure ([&]()
+        {
+            RenderPreviews (count, colors.data (), sink, threads);
+        }, 1.0), count);
+    }
+
+    std::vector<uint8_t> encoded;
+    RenderPreview (colors[0], pixels.data (), width, height, width * 4, &shadows);
+    bench::Report ("EncodePPM", bench::Measure ([&]()
+    {
+        EncodePPM (pixels.data (), width, height, width * 4, encoded);
+        bench::Consume (encoded[0]);
+    }), 1);
+    bench::Report ("EncodePNG", bench::Measure ([&]()
+    {
+        EncodePNG (pixels.data (), width, height, width * 4, encoded);
+        bench::Consume (encoded[0]);
+    }), 1);
+
+    return 0;
+}
@@ -0,0 +1,84 @@
+/*
+This library is licensed under the zlib license.
+
+Copyright (C) 2016-2018 Frank Richter
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+claim that you wrote the original software. If you use this software
+in a product, an acknowledgment in the product documentation would be
+appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+
+Original source:
+https://github.com/res2k/Windows10Colors
+
+*/
+
+#include "BenchHarness.h"
+
+#include "Windows10ColorsProfiles.h"
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+using namespace windows10colors;
+
+// Synthetic profile snapshot: DWM colors derived from the index
+static HRESULT CaptureSynthetic (const ThemeSnapshot& system, size_t index, ThemeSnapshot& snapshot)
+{
+    snapshot = system;
+    uint32_t seed = static_cast<uint32_t> (index) * 2654435761u;
+    snapshot.uiSettingsResult = E_NOTIMPL;
+    snapshot.dwmResult = S_OK;
+    snapshot.dwmColors.ColorizationColor = 0xc4000000 | (seed & 0xffffff);
+    snapshot.dwmColors.ColorizationColorBalance = static_cast<int> (seed % 101);
+    snapshot.dwmColors.haveAccentColor = (index % 3) != 0;
+    snapshot.dwmColors.AccentColor = 0xff000000 | (seed >> 8);
+    snapshot.haveDwmColorPrevalence = true;
+    snapshot.dwmColorPrevalence = (index % 2) != 0;
+    snapshot.personalizeColorPrevalenceResult = S_OK;
+    snapshot.personalizeColorPrevalence = (index % 5) == 0;
+    snapshot.appsUseLightThemeResult = S_OK;
+    snapshot.appsUseLightTheme = (index % 4) < 2;
+    snapshot.systemUsesLightThemeResult = S_OK;
+    snapshot.systemUsesLightTheme = (index % 6) == 0;
+    return S_OK;
+}
+
+int main ()
+{
+    ThemeSnapshot system = ThemeSnapshot ();
+    system.osVersion = { 10, 0, 17763 };
+    system.sysColors.activeCaption = MakeRGBA (0x99, 0xb4, 0xd1, 0xff);
+
+    const size_t count = 10000;
+    std::vector<ProfileColors> colors (count);
+    auto capture = [&](size_t index, ThemeSnapshot& snapshot) { return CaptureSynthetic (system, index, snapshot); };
+
+    unsigned int hardwareThreads = std::max (std::thread::hardware_concurrency (), 1u);
+    std::vector<unsigned int> threadCounts = { 1, 2, 4 };
+    if (hardwareThreads > 4) threadCounts.push_back (hardwareThreads);
+    for (unsigned int threads : threadCounts)
+    {
+        char name[64];
+        snprintf (name, sizeof (name), "EvaluateProfiles, %u thread(s)", threads);
+        bench::Report (name, bench::Measure ([&]()
+        {
+            EvaluateProfiles (count, capture, colors.data (), fcDefault, DarkMode::Light, threads);
+            bench::Consume (colors[count - 1]);
+        }), count);
+    }
+
+    return 0;
+}
@@ -0,0 +1,103 @@
+/*
+This library is licensed under the zlib license.
+
+Copyright (C) 2016-2018 Frank Richter
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+claim that you wrote the original software. If you use this software
+in a product, an acknowledgment in the product documentation would be
+appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+
+Original source:
+https://github.com/res2k/Windows10Colors
+
+*/
+
+#include "BenchHarness.h"
+
+#include "Windows10ColorsRegFile.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <string>
+
+using namespace windows10colors;
+
+// Synthetic export: many unrelated keys, with the DWM and Personalize keys near the end
+static std::string MakeExport (size_t keyCount)
+{
+    std::string text = "Windows Registry Editor Version 5.00\r\n\r\n";
+    char buf[160];
+    for (size_t i = 0; i < keyCount; i++)
+    {
+        snprintf (buf, sizeof (buf), "[HKEY_CURRENT_USER\\SOFTWARE\\Vendor%zu\\Product\\Settings%zu]\r\n", i % 97, i);
+        text += buf;
+        snprintf (buf, sizeof (buf), "\"Value\"=dword:%08zx\r\n\"Name\"=\"Item %zu\"\r\n\r\n", i, i);
+        text += buf;
+    }
+    text += "[HKEY_CURRENT_USER\\SOFTWARE\\Microsoft\\Windows\\DWM]\r\n"
+            "\"ColorizationColor\"=dword:c40078d7\r\n"
+            "\"ColorizationColorBalance\"=dword:00000059\r\n"
+            "\"AccentColor\"=dword:ffd77800\r\n"
+            "\"ColorPrevalence\"=dword:00000001\r\n\r\n"
+            "[HKEY_CURRENT_USER\\SOFTWARE\\Microsoft\\Windows\\CurrentVersion\\Themes\\Personalize]\r\n"
+            "\"ColorPrevalence\"=dword:00000000\r\n"
+            "\"AppsUseLightTheme\"=dword:00000001\r\n"
+            "\"SystemUsesLightTheme\"=dword:00000000\r\n";
+    return text;
+}
+
+int main ()
+{
+    const size_t keyCount = 50000;
+    std::string text = MakeExport (keyCount);
+
+    char path[] = "/tmp/w10c-regfile-bench-XXXXXX";
+    int fd = mkstemp (path);
+    if (fd < 0) return 1;
+    bool written = write (fd, text.data (), text.size ()) == static_cast<ssize_t> (text.size ());
+    close (fd);
+    if (!written)
+    {
+        unlink (path);
+        return 1;
+    }
+
+    RegFileSettingsStore store;
+    bench::Report ("RegFileSettingsStore::Open, 50k keys", bench::Measure ([&]()
+    {
+        bench::Consume (store.Open (path));
+    }), keyCount);
+
+    const wchar_t* dwmNames[] = { L"ColorizationColor", L"ColorizationColorBalance", L"AccentColor", L"ColorPrevalence" };
+    uint32_t values[4];
+    HRESULT results[4];
+    bench::Report ("RegFileSettingsStore::QueryValues, DWM", bench::Measure ([&]()
+    {
+        bench::Consume (store.QueryValues (SettingsKey::DWM, 4, dwmNames, values, results));
+        bench::Consume (values[0]);
+    }));
+
+    ThemeSnapshot snapshot = ThemeSnapshot ();
+    bench::Report ("ReadThemeSettings from export", bench::Measure ([&]()
+    {
+        ReadThemeSettings (store, snapshot);
+        bench::Consume (snapshot.dwmColors.ColorizationColor);
+    }));
+
+    unlink (path);
+    return 0;
+}
@@ -0,0 +1,82 @@
+/*
+This library is licensed under the zlib license.
+
+Copyright (C) 2016-2018 Frank Richter
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+claim that you wrote the original software. If you use this software
+in a product, an acknowledgment in the product documentation would be
+appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+
+Original source:
+https://github.com/res2k/Windows10Colors
+
+*/
+
+#include "BenchHarness.h"
+
+#include "DropShadow.h"
+#include "Preview.h"
+
+using namespace preview_layout;
+
+int main ()
+{
+    // Generation cost of the preview's window shadow, at several radii
+    for (int radius : { 10, shadowRadius, 40 })
+    {
+        ShadowKey key = { windowWidth, windowHeight, shadowInset, radius, 0xff000000 };
+        ShadowImage image;
+        char name[64];
+        snprintf (name, sizeof (name), "GenerateShadow, %dx%d, radius %d", windowWidth, windowHeight, radius);
+        bench::Report (name, bench::Measure ([&]()
+        {
+            GenerateShadow (key, image);
+            bench::Consume (image.pixels[0]);
+        }), 1);
+    }
+
+    /* Simulated painting: each paint draws a few windows with the current
+     * shadow color; the theme (and thus the color) changes every 'themeInterval'
+     * paints, which clears the cache. */
+    const int windowsPerPaint = 3;
+    const int themeInterval = 50;
+    const int numPaints = 1000;
+    ShadowCache cache;
+    double seconds = bench::Measure ([&]()
+    {
+        cache = ShadowCache ();
+        uint32_t color = 0xff000000;
+        for (int paint = 0; paint < numPaints; paint++)
+        {
+            if (paint % themeInterval == 0)
+            {
+                cache.Clear ();
+                color = 0xff000000 | ((color + 0x102030) & 0xffffff);
+            }
+            for (int w = 0; w < windowsPerPaint; w++)
+            {
+                const ShadowImage& image = cache.Get (ShadowKey { windowWidth, windowHeight, shadowInset,
+                                                                  shadowRadius, color });
+                bench::Consume (image.pixels[0]);
+            }
+        }
+    }, 1.0);
+    bench::Report ("ShadowCache, simulated paints", seconds, numPaints);
+    unsigned long lookups = cache.GetHits () + cache.GetMisses ();
+    printf ("%-48s %11.2f %% (%lu hits, %lu misses)\n", "ShadowCache, hit rate",
+            100.0 * cache.GetHits () / lookups, cache.GetHits (), cache.GetMisses ());
+
+    return 0;
+}
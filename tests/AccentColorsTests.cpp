@@ -0,0 +1,149 @@
+/*
+This library is licensed under the zlib license.
+
+Copyright (C) 2016-2018 Frank Richter
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+claim that you wrote the original software. If you use this software
+in a product, an acknowledgment in the product documentation would be
+appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+
+Original source:
+https://github.com/res2k/Windows10Colors
+
+*/
+
+#include "TestHarness.h"
+
+#include "Windows10ColorsCore.h"
+
+#include <string.h>
+#include <vector>
+
+using namespace windows10colors;
+
+namespace
+{
+    const AccentColorsISA allISAs[] = { AccentColorsISA::Scalar, AccentColorsISA::SSE2, AccentColorsISA::AVX };
+
+    bool SameShades (const AccentColor& a, const AccentColor& b)
+    {
+        return memcmp (&a, &b, sizeof (AccentColor)) == 0;
+    }
+
+    // Compare a batch implementation against per-color scalar computation
+    void CheckBatch (AccentColorsISA isa, const std::vector<RGBA>& bases)
+    {
+        const size_t count = bases.size ();
+        // One extra entry to detect writes past the end
+        std::vector<AccentColor> colors (count + 1);
+        memset (colors.data (), 0xcd, colors.size () * sizeof (AccentColor));
+        AccentColor guard = colors[count];
+        if (!GenerateAccentColors (isa, bases.data (), colors.data (), count)) return;
+
+        size_t mismatches = 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            AccentColor expected;
+            GenerateAccentColors (bases[i], expected);
+            if (!SameShades (colors[i], expected)) mismatches++;
+        }
+        CHECK (mismatches == 0);
+        CHECK (SameShades (colors[count], guard));
+    }
+} // anonymous namespace
+
+TEST_CASE (BatchMatchesScalarSweep)
+{
+    // Coarse sweep over the RGB cube, plus alpha variations
+    std::vector<RGBA> bases;
+    for (unsigned int r = 0; r < 256; r += 5)
+    {
+        for (unsigned int g = 0; g < 256; g += 5)
+        {
+            for (unsigned int b = 0; b < 256; b += 5)
+            {
+                bases.push_back (MakeRGBA (r, g, b, static_cast<uint8_t> ((r ^ g ^ b) | 0x80)));
+            }
+        }
+    }
+    for (AccentColorsISA isa : allISAs)
+    {
+        CheckBatch (isa, bases);
+    }
+}
+
+TEST_CASE (BatchMatchesScalarEdgeCases)
+{
+    // Grays (no saturation), primaries, secondaries and extremes
+    std::vector<RGBA> bases;
+    for (unsigned int v = 0; v < 256; v++)
+    {
+        bases.push_back (MakeRGBA (v, v, v, 255));
+        bases.push_back (MakeRGBA (v, 0, 0, 255));
+        bases.push_back (MakeRGBA (0, v, 0, 255));
+        bases.push_back (MakeRGBA (0, 0, v, 255));
+        bases.push_back (MakeRGBA (255, v, 0, 0));
+        bases.push_back (MakeRGBA (0, 255, v, 0));
+        bases.push_back (MakeRGBA (v, 0, 255, 0));
+        bases.push_back (MakeRGBA (255, 255, v, 255));
+    }
+    for (AccentColorsISA isa : allISAs)
+    {
+        CheckBatch (isa, bases);
+    }
+}
+
+TEST_CASE (BatchTailCounts)
+{
+    // Counts that aren't multiples of the vector lane count
+    for (size_t count = 0; count <= 19; count++)
+    {
+        std::vector<RGBA> bases (count);
+        for (size_t i = 0; i < count; i++)
+        {
+            bases[i] = MakeRGBA (static_cast<uint8_t> (i * 53 + 7), static_cast<uint8_t> (i * 29), static_cast<uint8_t> (200 - i * 11), 255);
+        }
+        for (AccentColorsISA isa : allISAs)
+        {
+            CheckBatch (isa, bases);
+        }
+    }
+}
+
+TEST_CASE (BatchDispatchMatchesScalar)
+{
+    std::vector<RGBA> bases;
+    for (unsigned int i = 0; i < 1001; i++)
+    {
+        bases.push_back (MakeRGBA (static_cast<uint8_t> (i * 37), static_cast<uint8_t> (i * 101), static_cast<uint8_t> (i * 13), 255));
+    }
+    std::vector<AccentColor> colors (bases.size ());
+    GenerateAccentColors (bases.data (), colors.data (), bases.size ());
+    size_t mismatches = 0;
+    for (size_t i = 0; i < bases.size (); i++)
+    {
+        AccentColor expected;
+        GenerateAccentColors (bases[i], expected);
+        if (!SameShades (colors[i], expected)) mismatches++;
+    }
+    CHECK (mismatches == 0);
+}
+
+TEST_CASE (ScalarISAAlwaysAvailable)
+{
+    RGBA base = MakeRGBA (0, 120, 215, 255);
+    AccentColor color;
+    CHECK (GenerateAccentColors (AccentColorsISA::Scalar, &base, &color, 1));
+}
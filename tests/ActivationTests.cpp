@@ -0,0 +1,208 @@
+/*
+This library is licensed under the zlib license.
+
+Copyright (C) 2016-2018 Frank Richter
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+claim that you wrote the original software. If you use this software
+in a product, an acknowledgment in the product documentation would be
+appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+
+Original source:
+https://github.com/res2k/Windows10Colors
+
+*/
+
+#include "TestHarness.h"
+
+#include "Windows10ColorsActivation.h"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace windows10colors;
+
+namespace
+{
+    // Stands in for an activated UISettings object
+    struct FakeObject
+    {
+        PerApartmentCache<std::shared_ptr<FakeObject>>::ApartmentId apartment;
+        // Cleared when the owning apartment is torn down
+        std::atomic<bool> connected;
+
+        explicit FakeObject (uintptr_t apartment) : apartment (apartment), connected (true) {}
+
+        HRESULT Query () const { return connected ? S_OK : RPC_E_DISCONNECTED; }
+    };
+    typedef std::shared_ptr<FakeObject> FakePtr;
+    typedef PerApartmentCache<FakePtr> FakeCache;
+
+    // Factory creating fake objects for the "current" apartment
+    struct FakeFactory
+    {
+        std::atomic<unsigned long> calls;
+        std::atomic<uintptr_t> currentApartment;
+        HRESULT result;
+
+        FakeFactory () : calls (0), currentApartment (0), result (S_OK) {}
+
+        FakeCache::Factory Get ()
+        {
+            return [this](FakePtr& object) -> HRESULT
+            {
+                calls++;
+                if (FAILED (result)) return result;
+                object = std::make_shared<FakeObject> (currentApartment);
+                return S_OK;
+            };
+        }
+    };
+
+    // Usage pattern of the library: query, replace stale objects
+    HRESULT QueryWithRetry (FakeCache& cache, uintptr_t apartment)
+    {
+        FakePtr object;
+        HRESULT hr = cache.Get (apartment, object);
+        if (FAILED (hr)) return hr;
+        hr = object->Query ();
+        if (IsApartmentGoneError (hr))
+        {
+            cache.Discard (apartment, object);
+            hr = cache.Get (apartment, object);
+            if (SUCCEEDED (hr)) hr = object->Query ();
+        }
+        return hr;
+    }
+} // anonymous namespace
+
+TEST_CASE (ActivatesOncePerApartment)
+{
+    FakeFactory factory;
+    FakeCache cache (factory.Get ());
+    for (uintptr_t apartment = 1; apartment <= 3; apartment++)
+    {
+        factory.currentApartment = apartment;
+        for (int i = 0; i < 100; i++)
+        {
+            FakePtr object;
+            CHECK (SUCCEEDED (cache.Get (apartment, object)));
+            CHECK (object && object->apartment == apartment);
+        }
+    }
+    // 300 queries, but only one activation per apartment
+    CHECK (factory.calls == 3);
+    CHECK (cache.GetActivationCount () == 3);
+    CHECK (cache.GetHitCount () == 297);
+}
+
+TEST_CASE (FailuresAreNotCached)
+{
+    FakeFactory factory;
+    FakeCache cache (factory.Get ());
+    factory.result = REGDB_E_CLASSNOTREG;
+    FakePtr object;
+    CHECK (cache.Get (1, object) == REGDB_E_CLASSNOTREG);
+    CHECK (!object);
+    factory.result = S_OK;
+    CHECK (SUCCEEDED (cache.Get (1, object)));
+    CHECK (factory.calls == 2);
+    CHECK (cache.GetActivationCount () == 1);
+}
+
+TEST_CASE (ReleaseForcesReactivation)
+{
+    FakeFactory factory;
+    FakeCache cache (factory.Get ());
+    FakePtr first, second;
+    CHECK (SUCCEEDED (cache.Get (1, first)));
+    cache.Release (1);
+    CHECK (SUCCEEDED (cache.Get (1, second)));
+    CHECK (first != second);
+    CHECK (factory.calls == 2);
+}
+
+TEST_CASE (StaleObjectFromReusedApartmentIsReplaced)
+{
+    FakeFactory factory;
+    FakeCache cache (factory.Get ());
+    factory.currentApartment = 7;
+    CHECK (QueryWithRetry (cache, 7) == S_OK);
+
+    // Apartment torn down without Release(); a new apartment gets the same identifier
+    FakePtr stale;
+    CHECK (SUCCEEDED (cache.Get (7, stale)));
+    stale->connected = false;
+
+    CHECK (QueryWithRetry (cache, 7) == S_OK);
+    CHECK (cache.GetDiscardCount () == 1);
+    CHECK (factory.calls == 2);
+    FakePtr current;
+    CHECK (SUCCEEDED (cache.Get (7, current)));
+    CHECK (current != stale);
+    CHECK (current->connected);
+}
+
+TEST_CASE (DiscardKeepsNewerObject)
+{
+    FakeFactory factory;
+    FakeCache cache (factory.Get ());
+    FakePtr stale, fresh;
+    CHECK (SUCCEEDED (cache.Get (1, stale)));
+    // Another caller replaced the object already
+    cache.Discard (1, stale);
+    CHECK (SUCCEEDED (cache.Get (1, fresh)));
+    cache.Discard (1, stale);
+    FakePtr current;
+    CHECK (SUCCEEDED (cache.Get (1, current)));
+    CHECK (current == fresh);
+    CHECK (cache.GetDiscardCount () == 1);
+}
+
+TEST_CASE (ConcurrentApartments)
+{
+    FakeFactory factory;
+    FakeCache cache (factory.Get ());
+    const int numThreads = 8;
+    const int numQueries = 2000;
+    std::vector<std::thread> threads;
+    std::atomic<int> failures (0);
+    for (int t = 0; t < numThreads; t++)
+    {
+        threads.emplace_back ([&, t]()
+        {
+            // Two threads share each apartment
+            uintptr_t apartment = 100 + t / 2;
+            for (int i = 0; i < numQueries; i++)
+            {
+                FakePtr object;
+                if (FAILED (cache.Get (apartment, object)) || !object) failures++;
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join ();
+    CHECK (failures == 0);
+    // Racing activations in one apartment may both run, but only one object is kept
+    CHECK (cache.GetActivationCount () <= static_cast<unsigned long> (numThreads));
+    CHECK (cache.GetActivationCount () + cache.GetHitCount () == numThreads * numQueries);
+    for (uintptr_t apartment = 100; apartment < 100 + numThreads / 2; apartment++)
+    {
+        FakePtr a, b;
+        cache.Get (apartment, a);
+        cache.Get (apartment, b);
+        CHECK (a == b);
+    }
+}
@@ -0,0 +1,133 @@
+/*
+This library is licensed under the zlib license.
+
+Copyright (C) 2016-2018 Frank Richter
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+claim that you wrote the original software. If you use this software
+in a product, an acknowledgment in the product documentation would be
+appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+
+Original source:
+https://github.com/res2k/Windows10Colors
+
+*/
+
+#include "TestHarness.h"
+
+#include "Blur.h"
+
+#include <stdlib.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+    // Image with a solid rectangle and some noise, with a blank border of 'border' pixels
+    std::vector<uint8_t> MakeImage (int width, int height, int channels, int border)
+    {
+        std::vector<uint8_t> pixels (static_cast<size_t> (width) * height * channels, 0);
+        uint32_t seed = 12345;
+        for (int y = border; y < height - border; y++)
+        {
+            for (int x = border; x < width - border; x++)
+            {
+                seed = seed * 1103515245 + 12345;
+                bool solid = (x > width / 4) && (x < 3 * width / 4) && (y > height / 4) && (y < 3 * height / 4);
+                for (int c = 0; c < channels; c++)
+                {
+                    pixels[(static_cast<size_t> (y) * width + x) * channels + c] =
+                        solid ? 255 : static_cast<uint8_t> ((seed >> (16 + c)) & 0x3f);
+                }
+            }
+        }
+        return pixels;
+    }
+
+    int MaxDifference (const std::vector<uint8_t>& a, const std::vector<uint8_t>& b)
+    {
+        int maxDiff = 0;
+        for (size_t i = 0; i < a.size (); i++) maxDiff = std::max (maxDiff, abs (int (a[i]) - int (b[i])));
+        return maxDiff;
+    }
+} // anonymous namespace
+
+TEST_CASE (ThreadCountsMatchSingleThread)
+{
+    // Sizes where rounding up the chunk size leaves threads without work
+    const struct
+    {
+        int width, height;
+        BlurFormat format;
+    } sizes[] = {
+        { 300, 300, BlurFormat::Alpha8 },
+        { 256, 256, BlurFormat::Alpha8 },
+        { 257, 300, BlurFormat::Alpha8 },
+        { 130, 600, BlurFormat::PremultipliedRGBA },
+        { 600, 130, BlurFormat::PremultipliedRGBA },
+    };
+    for (const auto& size : sizes)
+    {
+        int channels = (size.format == BlurFormat::Alpha8) ? 1 : 4;
+        int stride = size.width * channels;
+        std::vector<uint8_t> original = MakeImage (size.width, size.height, channels, 0);
+        std::vector<uint8_t> expected = original;
+        BoxBlur (expected.data (), size.width, size.height, stride, size.format, 10, 1);
+        for (unsigned int threads : { 2u, 3u, 4u, 5u, 7u, 8u, 16u, 64u })
+        {
+            std::vector<uint8_t> pixels = original;
+            BoxBlur (pixels.data (), size.width, size.height, stride, size.format, 10, threads);
+            CHECK (pixels == expected);
+        }
+    }
+}
+
+TEST_CASE (ApproximatesGaussian)
+{
+    // Small radii have too few pixels per box for a close approximation
+    for (int radius : { 8, 20, 40, 64 })
+    {
+        const int width = 200, height = 150;
+        std::vector<uint8_t> box = MakeImage (width, height, 1, radius);
+        std::vector<uint8_t> gaussian = box;
+        BoxBlur (box.data (), width, height, width, BlurFormat::Alpha8, radius);
+        GaussianBlurReference (gaussian.data (), width, height, width, BlurFormat::Alpha8, radius);
+        CHECK (MaxDifference (box, gaussian) <= 16);
+    }
+}
+
+TEST_CASE (SolidAreaPreserved)
+{
+    const int width = 200, height = 200, radius = 10;
+    std::vector<uint8_t> pixels (width * height, 0);
+    for (int y = 50; y < 150; y++) std::fill (pixels.begin () + y * width + 50, pixels.begin () + y * width + 150, 200);
+    BoxBlur (pixels.data (), width, height, width, BlurFormat::Alpha8, radius);
+    // Far from the edges of the rectangle: unchanged. Far outside: still empty.
+    CHECK (pixels[100 * width + 100] == 200);
+    CHECK (pixels[10 * width + 10] == 0);
+    CHECK (pixels[100 * width + 45] > 0);
+}
+
+TEST_CASE (DegenerateInputs)
+{
+    std::vector<uint8_t> pixels (16, 7);
+    BoxBlur (pixels.data (), 4, 4, 4, BlurFormat::Alpha8, 0);
+    BoxBlur (pixels.data (), 0, 4, 4, BlurFormat::Alpha8, 5);
+    BoxBlur (pixels.data (), 4, 0, 4, BlurFormat::Alpha8, 5);
+    CHECK (std::count (pixels.begin (), pixels.end (), 7) == 16);
+    // Radius larger than the image
+    BoxBlur (pixels.data (), 4, 4, 4, BlurFormat::Alpha8, 50, 4);
+    CHECK (pixels[5] <= 7);
+}
@@ -0,0 +1,689 @@
+/*
+This library is licensed under the zlib license.
+
+Copyright (C) 2016-2018 Frank Richter
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+claim that you wrote the original software. If you use this software
+in a product, an acknowledgment in the product documentation would be
+appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+
+Original source:
+https://github.com/res2k/Windows10Colors
+
+*/
+
+#include "TestHarness.h"
+
+#include "Windows10ColorsCache.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace windows10colors;
+
+namespace
+{
+    // Snapshot with the given accent color
+    ThemeSnapshot MakeSnapshot (RGBA accent)
+    {
+        ThemeSnapshot snapshot = ThemeSnapshot ();
+        snapshot.uiSettingsResult = S_OK;
+        GenerateAccentColors (accent, snapshot.uiSettingsAccent);
+        return snapshot;
+    }
+
+    // Cache starting with a fixed accent color; changes are made with Publish()
+    struct TestCache : public ThemeCache
+    {
+        TestCache ()
+          : ThemeCache ([](ThemeSnapshot& snapshot) -> HRESULT
+                        {
+                            snapshot = MakeSnapshot (0xffd77800);
+                            return S_OK;
+                        })
+        {
+            ThemeState state;
+            Read (state);
+        }
+    };
+
+    // Capture function with a settable result; can be blocked to simulate slow captures
+    class FakeCapture
+    {
+    public:
+        FakeCapture () : snapshot (MakeSnapshot (0xffd77800)), result (S_OK), blocked (false), captures (0) {}
+
+        void Set (const ThemeSnapshot& newSnapshot, HRESULT newResult = S_OK)
+        {
+            std::lock_guard<std::mutex> lock (mutex);
+            snapshot = newSnapshot;
+            result = newResult;
+        }
+        void Block ()
+        {
+            std::lock_guard<std::mutex> lock (mutex);
+            blocked = true;
+        }
+        void Unblock ()
+        {
+            std::lock_guard<std::mutex> lock (mutex);
+            blocked = false;
+            unblocked.notify_all ();
+        }
+        int GetCaptures ()
+        {
+            std::lock_guard<std::mutex> lock (mutex);
+            return captures;
+        }
+
+        ThemeCache::CaptureFunction Function ()
+        {
+            return [this](ThemeSnapshot& captured) -> HRESULT
+            {
+                std::unique_lock<std::mutex> lock (mutex);
+                captures++;
+                unblocked.wait (lock, [&]() { return !blocked; });
+                captured = snapshot;
+                return result;
+            };
+        }
+    private:
+        std::mutex mutex;
+        std::condition_variable unblocked;
+        ThemeSnapshot snapshot;
+        HRESULT result;
+        bool blocked;
+        int captures;
+    };
+
+    // Wait until a condition holds, giving up after a while
+    template<typename Condition>
+    bool WaitFor (Condition condition)
+    {
+        auto deadline = std::chrono::steady_clock::now () + std::chrono::seconds (5);
+        while (!condition ())
+        {
+            if (std::chrono::steady_clock::now () > deadline) return false;
+            std::this_thread::sleep_for (std::chrono::milliseconds (1));
+        }
+        return true;
+    }
+
+    // Waiter running a function on notification; unregisters itself on destruction
+    class FunctionWaiter final : public ThemeChangeWaiter
+    {
+    public:
+        typedef std::function<void (FunctionWaiter& waiter)> Function;
+
+        FunctionWaiter (ThemeCache& cache, Function function, unsigned int changeMask = ~0u)
+          : ThemeChangeWaiter (changeMask), notifications (0), changes (0), cache (cache),
+            function (std::move (function)) {}
+        ~FunctionWaiter () { cache.RemoveWaiter (*this); }
+
+        std::atomic<int> notifications;
+        std::atomic<unsigned int> changes;
+    private:
+        ThemeCache& cache;
+        Function function;
+
+        void OnThemeChange (const ThemeState&, unsigned int changes) override
+        {
+            notifications++;
+            this->changes = changes;
+            if (function) function (*this);
+        }
+    };
+} // anonymous namespace
+
+TEST_CASE (WaiterNotifiedOnce)
+{
+    TestCache cache;
+    FunctionWaiter waiter (cache, nullptr);
+    CHECK (cache.AddWaiter (waiter, cache.GetGeneration ()));
+    // Unrelated generation: not registered
+    FunctionWaiter stale (cache, nullptr);
+    CHECK (!cache.AddWaiter (stale, cache.GetGeneration () + 1));
+
+    cache.Publish (MakeSnapshot (0xff0000ff));
+    CHECK (waiter.notifications == 1);
+    CHECK ((waiter.changes & tcAccent) != 0);
+    cache.Publish (MakeSnapshot (0xff00ff00));
+    CHECK (waiter.notifications == 1);
+    CHECK (!cache.RemoveWaiter (waiter));
+    CHECK (stale.notifications == 0);
+}
+
+TEST_CASE (WaiterChangeMask)
+{
+    TestCache cache;
+    FunctionWaiter frameOnly (cache, nullptr, tcActiveCaptionText);
+    FunctionWaiter accent (cache, nullptr, tcAccent);
+    CHECK (cache.AddWaiter (frameOnly, cache.GetGeneration ()));
+    CHECK (cache.AddWaiter (accent, cache.GetGeneration ()));
+    cache.Publish (MakeSnapshot (0xff0000ff));
+    CHECK (accent.notifications == 1);
+    CHECK (frameOnly.notifications == 0);
+    CHECK (cache.RemoveWaiter (frameOnly));
+}
+
+TEST_CASE (WaiterDestroyedDuringNotification)
+{
+    TestCache cache;
+    // Destroys itself and another waiter that is still registered
+    FunctionWaiter* other = new FunctionWaiter (cache, nullptr, tcActiveCaptionText);
+    FunctionWaiter* self = new FunctionWaiter (cache, [&](FunctionWaiter& waiter)
+    {
+        delete other;
+        other = nullptr;
+        // Last: this destroys the captures as well
+        delete &waiter;
+    });
+    CHECK (cache.AddWaiter (*other, cache.GetGeneration ()));
+    CHECK (cache.AddWaiter (*self, cache.GetGeneration ()));
+    cache.Publish (MakeSnapshot (0xff0000ff));
+    CHECK (other == nullptr);
+}
+
+TEST_CASE (NextWaiterRemovedDuringNotification)
+{
+    TestCache cache;
+    // Waiters are notified most recently added first; each removes the one notified after it
+    const size_t count = 1000;
+    std::vector<std::unique_ptr<FunctionWaiter>> waiters (count);
+    for (size_t i = 0; i < count; i++)
+    {
+        waiters[i].reset (new FunctionWaiter (cache, [&waiters, i](FunctionWaiter&)
+        {
+            if (i > 0) waiters[i - 1].reset ();
+        }));
+        CHECK (cache.AddWaiter (*waiters[i], cache.GetGeneration ()));
+    }
+    cache.Publish (MakeSnapshot (0xff0000ff));
+    for (size_t i = 0; i < count; i++)
+    {
+        if ((i % 2) == 1)
+            CHECK (waiters[i] && (waiters[i]->notifications == 1));
+        else
+            CHECK (!waiters[i]);
+    }
+}
+
+TEST_CASE (WaiterReregisteredDuringNotification)
+{
+    TestCache cache;
+    FunctionWaiter waiter (cache, [&](FunctionWaiter& w)
+    {
+        // Wait for the next change; must not be notified of this one again
+        cache.AddWaiter (w, cache.GetGeneration ());
+    });
+    CHECK (cache.AddWaiter (waiter, cache.GetGeneration ()));
+    cache.Publish (MakeSnapshot (0xff0000ff));
+    CHECK (waiter.notifications == 1);
+    cache.Publish (MakeSnapshot (0xff00ff00));
+    CHECK (waiter.notifications == 2);
+    CHECK (cache.RemoveWaiter (waiter));
+}
+
+TEST_CASE (RemoveWaitsForNotificationOnOtherThread)
+{
+    TestCache cache;
+    std::atomic<bool> entered (false);
+    std::atomic<bool> left (false);
+    FunctionWaiter* waiter = new FunctionWaiter (cache, [&](FunctionWaiter&)
+    {
+        entered = true;
+        std::this_thread::sleep_for (std::chrono::milliseconds (50));
+        left = true;
+    });
+    CHECK (cache.AddWaiter (*waiter, cache.GetGeneration ()));
+    std::thread publisher ([&]() { cache.Publish (MakeSnapshot (0xff0000ff)); });
+    while (!entered) std::this_thread::yield ();
+    // Notification in progress: destruction must wait for it
+    delete waiter;
+    CHECK (left);
+    publisher.join ();
+}
+
+TEST_CASE (ConcurrentNotifyAndDestroy)
+{
+    TestCache cache;
+    const int numRounds = 2000;
+    std::atomic<int> notifications (0);
+    for (int round = 0; round < numRounds; round++)
+    {
+        FunctionWaiter* waiter = new FunctionWaiter (cache, [&](FunctionWaiter&) { notifications++; });
+        cache.AddWaiter (*waiter, cache.GetGeneration ());
+        std::thread publisher ([&]()
+        {
+            cache.Publish (MakeSnapshot ((round & 1) ? 0xff0000ff : 0xff00ff00));
+        });
+        // Races with the notification
+        delete waiter;
+        publisher.join ();
+    }
+    CHECK (notifications <= numRounds);
+}
+
+TEST_CASE (InitialReadCaptures)
+{
+    FakeCapture capture;
+    ThemeCache cache (capture.Function ());
+    CHECK (cache.GetGeneration () == 0);
+    CHECK (capture.GetCaptures () == 0);
+
+    ThemeState state;
+    CHECK (cache.Read (state) == 1);
+    CHECK (state.generation == 1);
+    CHECK (!state.fromCache);
+    CHECK (state.accent.accent == MakeSnapshot (0xffd77800).uiSettingsAccent.accent);
+    CHECK (cache.Read (state) == 1);
+    CHECK (capture.GetCaptures () == 1);
+}
+
+TEST_CASE (InitialCaptureFailure)
+{
+    FakeCapture capture;
+    capture.Set (MakeSnapshot (0xff0000ff), E_FAIL);
+    ThemeCache cache (capture.Function ());
+
+    // A default state is published, so reads don't retry
+    ThemeState state;
+    CHECK (cache.Read (state) == 1);
+    CHECK (FAILED (state.snapshot.uiSettingsResult));
+    CHECK (FAILED (state.snapshot.dwmResult));
+    CHECK (cache.Read (state) == 1);
+    CHECK (capture.GetCaptures () == 1);
+
+    // A failed invalidation leaves the state alone
+    CHECK (cache.Invalidate () == E_FAIL);
+    CHECK (cache.GetGeneration () == 1);
+    capture.Set (MakeSnapshot (0xff0000ff));
+    CHECK (cache.Invalidate () == S_OK);
+    CHECK (cache.GetGeneration () == 2);
+}
+
+TEST_CASE (GenerationBumpsOnlyOnChanges)
+{
+    FakeCapture capture;
+    ThemeCache cache (capture.Function ());
+    int notifications = 0;
+    cache.Subscribe ([&](const ThemeState&, const ThemeState&, unsigned int) { notifications++; });
+    ThemeState state;
+    cache.Read (state);
+    CHECK (cache.GetGeneration () == 1);
+
+    // Same settings: bookkeeping fields and values of failed queries are ignored
+    ThemeSnapshot same = MakeSnapshot (0xffd77800);
+    same.systemCalls = 42;
+    same.dwmResult = E_FAIL;
+    same.dwmColors.ColorizationColor = 0x12345678;
+    ThemeSnapshot initial = MakeSnapshot (0xffd77800);
+    initial.dwmResult = E_FAIL;
+    capture.Set (initial);
+    CHECK (cache.Invalidate () == S_OK);
+    CHECK (cache.GetGeneration () == 2);
+    CHECK (cache.Publish (same) == 2);
+    CHECK (cache.Publish (initial) == 2);
+    CHECK (cache.Invalidate () == S_OK);
+    CHECK (cache.GetGeneration () == 2);
+    CHECK (notifications == 1);
+
+    // Actual changes
+    CHECK (cache.Publish (MakeSnapshot (0xff0000ff)) == 3);
+    ThemeSnapshot lightApps = MakeSnapshot (0xff0000ff);
+    lightApps.appsUseLightTheme = true;
+    CHECK (cache.Publish (lightApps) == 4);
+    CHECK (notifications == 3);
+    CHECK (cache.Read (state) == 4);
+    CHECK (state.snapshot.appsUseLightTheme);
+    CHECK (capture.GetCaptures () == 3);
+}
+
+TEST_CASE (ConcurrentReadersSeeConsistentStates)
+{
+    TestCache cache;
+    // Generation parity tells which snapshot is current
+    const RGBA odd = 0xffd77800;
+    const RGBA even = 0xff0000ff;
+    const AccentColor oddAccent = MakeSnapshot (odd).uiSettingsAccent;
+    const AccentColor evenAccent = MakeSnapshot (even).uiSettingsAccent;
+    std::atomic<bool> stop (false);
+    std::atomic<int> inconsistent (0);
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 2; i++)
+    {
+        readers.emplace_back ([&]()
+        {
+            while (!stop)
+            {
+                ThemeState state;
+                uint64_t generation = cache.Read (state);
+                const AccentColor& expected = (generation & 1) ? oddAccent : evenAccent;
+                if ((state.accent.accent != expected.accent) || (state.accent.darkest != expected.darkest)
+                    || (state.snapshot.uiSettingsAccent.lightest != expected.lightest))
+                    inconsistent++;
+            }
+        });
+    }
+    for (int i = 0; i < 20000; i++)
+    {
+        cache.Publish (MakeSnapshot ((cache.GetGeneration () & 1) ? even : odd));
+    }
+    stop = true;
+    for (auto& reader : readers) reader.join ();
+    CHECK (inconsistent == 0);
+    CHECK (cache.GetGeneration () == 20001);
+}
+
+TEST_CASE (PublishCachedUntilVerified)
+{
+    FakeCapture capture;
+    ThemeCache cache (capture.Function ());
+    int notifications = 0;
+    cache.Subscribe ([&](const ThemeState&, const ThemeState&, unsigned int) { notifications++; });
+
+    ThemeSnapshot cached = MakeSnapshot (0xffd77800);
+    cached.systemCalls = 7;
+    CHECK (cache.PublishCached (cached));
+    CHECK (!cache.PublishCached (MakeSnapshot (0xff0000ff)));
+    ThemeState state;
+    CHECK (cache.Read (state) == 1);
+    CHECK (state.fromCache);
+    CHECK (state.snapshot.systemCalls == 7);
+    // Reading doesn't capture; the cached state counts as initial state
+    CHECK (capture.GetCaptures () == 0);
+
+    // Verified by an identical capture: same generation, no notification
+    CHECK (cache.Invalidate () == S_OK);
+    CHECK (cache.Read (state) == 1);
+    CHECK (!state.fromCache);
+    CHECK (state.snapshot.systemCalls == 0);
+    CHECK (notifications == 0);
+
+    // Stale cache: replaced, subscribers notified
+    ThemeCache staleCache (capture.Function ());
+    int staleNotifications = 0;
+    staleCache.Subscribe ([&](const ThemeState& oldState, const ThemeState& newState, unsigned int changes)
+    {
+        CHECK (oldState.fromCache && !newState.fromCache);
+        CHECK ((changes & tcAccent) != 0);
+        staleNotifications++;
+    });
+    CHECK (staleCache.PublishCached (MakeSnapshot (0xff0000ff)));
+    CHECK (staleCache.Invalidate () == S_OK);
+    CHECK (staleCache.Read (state) == 2);
+    CHECK (!state.fromCache);
+    CHECK (staleNotifications == 1);
+
+    // Too late once a state was captured
+    CHECK (!staleCache.PublishCached (MakeSnapshot (0xff00ff00)));
+}
+
+TEST_CASE (SubscribersNotifiedOfChanges)
+{
+    TestCache cache;
+    unsigned int defaultChanges = 0;
+    unsigned int coloredChanges = 0;
+    int defaultCalls = 0;
+    cache.Subscribe ([&](const ThemeState& oldState, const ThemeState& newState, unsigned int changes)
+    {
+        CHECK (newState.generation == oldState.generation + 1);
+        defaultChanges = changes;
+        defaultCalls++;
+    });
+    cache.Subscribe ([&](const ThemeState&, const ThemeState&, unsigned int changes) { coloredChanges = changes; },
+                     fcTitleBarsColored);
+
+    ThemeSnapshot snapshot = MakeSnapshot (0xff0000ff);
+    snapshot.osVersion = { 10, 0, 18362 };
+    cache.Publish (snapshot);
+    // Windows 10 title bars aren't colored by default; the options of each subscription are compared
+    CHECK ((defaultChanges & tcAccent) != 0);
+    CHECK ((defaultChanges & tcActiveCaptionBG) != 0);
+    CHECK ((coloredChanges & tcActiveCaptionBG) != 0);
+
+    snapshot.uiSettingsAccent = MakeSnapshot (0xff00ff00).uiSettingsAccent;
+    cache.Publish (snapshot);
+    CHECK ((defaultChanges & tcFrameAll) == 0);
+    CHECK ((coloredChanges & tcActiveCaptionBG) != 0);
+
+    // A settings change that doesn't change any compared color isn't reported
+    defaultCalls = 0;
+    snapshot.sysColors.highlight = 0xff123456;
+    uint64_t generation = cache.GetGeneration ();
+    CHECK (cache.Publish (snapshot) == generation + 1);
+    CHECK (defaultCalls == 0);
+}
+
+TEST_CASE (UnsubscribeDuringNotification)
+{
+    TestCache cache;
+    int selfCalls = 0;
+    int otherCalls = 0;
+    ThemeCache::SubscriptionId self = 0;
+    self = cache.Subscribe ([&](const ThemeState&, const ThemeState&, unsigned int)
+    {
+        selfCalls++;
+        cache.Unsubscribe (self);
+    });
+    cache.Subscribe ([&](const ThemeState&, const ThemeState&, unsigned int) { otherCalls++; });
+
+    cache.Publish (MakeSnapshot (0xff0000ff));
+    CHECK (selfCalls == 1);
+    // Subscribers after the removed one are still called for the same change
+    CHECK (otherCalls == 1);
+    cache.Publish (MakeSnapshot (0xff00ff00));
+    CHECK (selfCalls == 1);
+    CHECK (otherCalls == 2);
+    // Unknown ids are ignored
+    cache.Unsubscribe (self);
+    cache.Unsubscribe (12345);
+}
+
+TEST_CASE (SubscribeDuringNotification)
+{
+    TestCache cache;
+    int lateCalls = 0;
+    bool subscribed = false;
+    ThemeCache::SubscriptionId first = 0;
+    first = cache.Subscribe ([&](const ThemeState&, const ThemeState&, unsigned int)
+    {
+        if (subscribed) return;
+        subscribed = true;
+        cache.Subscribe ([&](const ThemeState&, const ThemeState&, unsigned int) { lateCalls++; });
+        // Reentrant reads see the new state
+        ThemeState state;
+        CHECK (cache.Read (state) == 2);
+    });
+
+    cache.Publish (MakeSnapshot (0xff0000ff));
+    // Only called for changes published after subscribing
+    CHECK (subscribed);
+    CHECK (lateCalls == 0);
+    cache.Unsubscribe (first);
+    cache.Publish (MakeSnapshot (0xff00ff00));
+    CHECK (lateCalls == 1);
+}
+
+TEST_CASE (DiffMasks)
+{
+    ThemeSnapshot base = MakeSnapshot (0xffd77800);
+    base.osVersion = { 10, 0, 18362 };
+    base.dwmResult = S_OK;
+    base.dwmColors.ColorizationColor = 0xc4d77800;
+    base.dwmColors.ColorizationColorBalance = 89;
+    base.haveDwmColorPrevalence = true;
+    base.dwmColorPrevalence = false;
+    base.appsUseLightTheme = true;
+    base.systemUsesLightTheme = true;
+    ThemeState oldState;
+    MakeThemeState (base, oldState);
+
+    auto Diff = [&](const ThemeSnapshot& snapshot, unsigned int options, DarkMode darkMode)
+    {
+        ThemeState newState;
+        MakeThemeState (snapshot, newState);
+        return DiffThemeStates (oldState, newState, options, darkMode);
+    };
+
+    CHECK (Diff (base, fcDefault, DarkMode::Light) == 0);
+    CHECK (Diff (base, fcGlassEffect | fcTitleBarsColored, DarkMode::Auto) == 0);
+
+    // Each shade has its own bit
+    ThemeState shades = oldState;
+    shades.accent.dark ^= 1;
+    CHECK (DiffThemeStates (oldState, shades) == tcAccentDark);
+    shades.accent.lightest ^= 1;
+    CHECK (DiffThemeStates (oldState, shades) == (tcAccentDark | tcAccentLightest));
+
+    // Accent: frame colors only change with colored title bars
+    ThemeSnapshot accent = base;
+    accent.uiSettingsAccent = MakeSnapshot (0xff00ff00).uiSettingsAccent;
+    CHECK ((Diff (accent, fcDefault, DarkMode::Light) & ~tcAccentAll) == 0);
+    CHECK ((Diff (accent, fcDefault, DarkMode::Light) & tcAccentAll) == tcAccentAll);
+    CHECK ((Diff (accent, fcTitleBarsColored, DarkMode::Light) & tcActiveCaptionBG) != 0);
+    ThemeSnapshot colored = base;
+    colored.dwmColorPrevalence = true;
+    unsigned int coloredChanges = Diff (colored, fcDefault, DarkMode::Light);
+    CHECK ((coloredChanges & (tcActiveCaptionBG | tcActiveFrame)) == (tcActiveCaptionBG | tcActiveFrame));
+    CHECK ((coloredChanges & (tcAccentAll | tcInactiveCaptionBG | tcAppDarkMode | tcSysPartsMode)) == 0);
+    // Glass ignores the colored title bars setting
+    CHECK (Diff (colored, fcGlassEffect, DarkMode::Light) == 0);
+
+    // App dark mode: frame colors only change if the dark mode follows the setting
+    ThemeSnapshot darkApps = base;
+    darkApps.appsUseLightTheme = false;
+    CHECK (Diff (darkApps, fcDefault, DarkMode::Light) == tcAppDarkMode);
+    CHECK (Diff (darkApps, fcDefault, DarkMode::Dark) == tcAppDarkMode);
+    unsigned int autoChanges = Diff (darkApps, fcDefault, DarkMode::Auto);
+    CHECK ((autoChanges & tcAppDarkMode) != 0);
+    CHECK ((autoChanges & (tcActiveCaptionBG | tcActiveCaptionText | tcInactiveCaptionBG | tcInactiveCaptionText))
+           == (tcActiveCaptionBG | tcActiveCaptionText | tcInactiveCaptionBG | tcInactiveCaptionText));
+    CHECK ((autoChanges & (tcActiveFrame | tcInactiveFrame)) == 0);
+    darkApps.osVersion = { 10, 0, 17763 };
+    CHECK ((Diff (darkApps, fcDefault, DarkMode::Auto) & tcFrameAll) == 0);
+    CHECK ((Diff (darkApps, fcDefault, DarkMode::User) & tcFrameAll) != 0);
+
+    // System parts
+    ThemeSnapshot darkSystem = base;
+    darkSystem.systemUsesLightTheme = false;
+    CHECK (Diff (darkSystem, fcDefault, DarkMode::Auto) == tcSysPartsMode);
+    // On 1607 and later, the Personalize flag only colors the taskbar and start menu
+    ThemeSnapshot accentSystem = base;
+    accentSystem.personalizeColorPrevalence = true;
+    CHECK (Diff (accentSystem, fcDefault, DarkMode::Auto) == tcSysPartsMode);
+}
+
+TEST_CASE (RefreshWithinBudget)
+{
+    FakeCapture capture;
+    ThemeCache cache (capture.Function ());
+    ThemeState state;
+    cache.Read (state);
+
+    capture.Set (MakeSnapshot (0xff0000ff));
+    bool called = false;
+    CHECK (cache.RefreshWithin (std::chrono::seconds (5), state, [&](const ThemeState&) { called = true; }) == S_OK);
+    CHECK (state.generation == 2);
+    CHECK (state.accent.accent == MakeSnapshot (0xff0000ff).uiSettingsAccent.accent);
+    // Refreshed in time: the callback is not needed
+    CHECK (!called);
+    CHECK (capture.GetCaptures () == 2);
+}
+
+TEST_CASE (RefreshExceedingBudget)
+{
+    FakeCapture capture;
+    ThemeCache cache (capture.Function ());
+    ThemeState state;
+    cache.Read (state);
+
+    capture.Block ();
+    capture.Set (MakeSnapshot (0xff0000ff));
+    std::atomic<int> calls (0);
+    std::atomic<uint64_t> refreshedGeneration (0);
+    auto onComplete = [&](const ThemeState& refreshed)
+    {
+        refreshedGeneration = refreshed.generation;
+        calls++;
+    };
+    // Last known state is returned; the Windows wrappers report this as S_COLOR_REFRESH_PENDING
+    CHECK (cache.RefreshWithin (std::chrono::milliseconds (10), state, onComplete) == S_FALSE);
+    CHECK (state.generation == 1);
+    // Calls while the refresh is running wait for it instead of starting another
+    CHECK (cache.RefreshWithin (std::chrono::milliseconds (0), state, onComplete) == S_FALSE);
+    CHECK (calls == 0);
+
+    capture.Unblock ();
+    CHECK (WaitFor ([&]() { return calls == 2; }));
+    CHECK (refreshedGeneration == 2);
+    // Initial capture and one refresh
+    CHECK (capture.GetCaptures () == 2);
+}
+
+TEST_CASE (RefreshWithoutKnownState)
+{
+    FakeCapture capture;
+    ThemeCache cache (capture.Function ());
+    capture.Block ();
+
+    ThemeState state;
+    state.generation = 1234;
+    std::atomic<bool> called (false);
+    CHECK (cache.RefreshWithin (std::chrono::milliseconds (10), state,
+                                [&](const ThemeState& refreshed)
+                                {
+                                    CHECK (refreshed.generation == 1);
+                                    called = true;
+                                }) == E_PENDING);
+    CHECK (state.generation == 1234);
+    capture.Unblock ();
+    CHECK (WaitFor ([&]() { return called.load (); }));
+    CHECK (cache.GetGeneration () == 1);
+}
+
+TEST_CASE (RefreshFromRefreshCallback)
+{
+    FakeCapture capture;
+    ThemeCache cache (capture.Function ());
+    ThemeState state;
+    cache.Read (state);
+
+    /* The second refresh is started while the first thread still runs callbacks;
+     * its thread waits for the previous one instead of blocking the caller */
+    capture.Block ();
+    std::atomic<int> chained (0);
+    CHECK (cache.RefreshWithin (std::chrono::milliseconds (0), state, [&](const ThemeState&)
+    {
+        capture.Set (MakeSnapshot (0xff0000ff));
+        ThemeState inner;
+        HRESULT hr = cache.RefreshWithin (std::chrono::milliseconds (0), inner, [&](const ThemeState& refreshed)
+        {
+            CHECK (refreshed.accent.accent == MakeSnapshot (0xff0000ff).uiSettingsAccent.accent);
+            chained++;
+        });
+        CHECK (hr == S_FALSE);
+        chained++;
+    }) == S_FALSE);
+    capture.Unblock ();
+    CHECK (WaitFor ([&]() { return chained == 2; }));
+    CHECK (cache.GetGeneration () == 2);
+    CHECK (capture.GetCaptures () == 3);
+}
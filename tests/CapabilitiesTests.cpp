@@ -0,0 +1,162 @@
+/*
+This library is licensed under the zlib license.
+
+Copyright (C) 2016-2018 Frank Richter
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+claim that you wrote the original software. If you use this software
+in a product, an acknowledgment in the product documentation would be
+appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+
+Original source:
+https://github.com/res2k/Windows10Colors
+
+*/
+
+#include "TestHarness.h"
+
+#include "Windows10ColorsCapabilities.h"
+
+#include <initializer_list>
+#include <thread>
+#include <vector>
+
+using namespace windows10colors;
+
+namespace
+{
+    // Accent color source using a capability, as the WinRT query does
+    struct FakeSource
+    {
+        HRESULT result = S_OK;
+        int attempts = 0;
+
+        HRESULT Query (CapabilityCache& cache, Capability capability)
+        {
+            if (!cache.ShouldTry (capability)) return E_NOTIMPL;
+            attempts++;
+            cache.RecordResult (capability, result);
+            return result;
+        }
+    };
+} // anonymous namespace
+
+TEST_CASE (PermanentFailures)
+{
+    CHECK (CapabilityCache::IsPermanentFailure (E_NOTIMPL));
+    CHECK (CapabilityCache::IsPermanentFailure (REGDB_E_CLASSNOTREG));
+    CHECK (CapabilityCache::IsPermanentFailure (E_NOINTERFACE));
+    for (HRESULT hr : { S_OK, S_FALSE, E_FAIL, E_OUTOFMEMORY, E_ABORT, E_PENDING, CO_E_OBJNOTCONNECTED,
+                        RPC_E_DISCONNECTED, RPC_E_SERVER_DIED_DNE, HRESULT_FROM_WIN32 (ERROR_FILE_NOT_FOUND) })
+    {
+        CHECK (!CapabilityCache::IsPermanentFailure (hr));
+    }
+}
+
+TEST_CASE (PermanentFailureSkipsLaterAttempts)
+{
+    for (HRESULT hr : { E_NOTIMPL, REGDB_E_CLASSNOTREG, E_NOINTERFACE })
+    {
+        CapabilityCache cache;
+        FakeSource source;
+        source.result = hr;
+        CHECK (source.Query (cache, capUISettings3) == hr);
+        CHECK (cache.IsUnavailable (capUISettings3));
+        for (int i = 0; i < 5; i++)
+        {
+            CHECK (FAILED (source.Query (cache, capUISettings3)));
+        }
+        CHECK (source.attempts == 1);
+        CHECK (cache.GetSkippedAttempts (capUISettings3) == 5);
+        // Other capabilities are unaffected
+        CHECK (!cache.IsUnavailable (capWinRT));
+        CHECK (cache.ShouldTry (capWinRT));
+        CHECK (cache.GetSkippedAttempts (capWinRT) == 0);
+    }
+}
+
+TEST_CASE (TransientFailureRetried)
+{
+    CapabilityCache cache;
+    FakeSource source;
+    for (HRESULT hr : { E_FAIL, RPC_E_DISCONNECTED, E_OUTOFMEMORY })
+    {
+        source.result = hr;
+        CHECK (source.Query (cache, capWinRT) == hr);
+        CHECK (!cache.IsUnavailable (capWinRT));
+    }
+    source.result = S_OK;
+    CHECK (source.Query (cache, capWinRT) == S_OK);
+    CHECK (source.attempts == 4);
+    CHECK (cache.GetSkippedAttempts (capWinRT) == 0);
+
+    // Success doesn't clear a known permanent failure
+    cache.RecordResult (capWinRT, E_NOTIMPL);
+    cache.RecordResult (capWinRT, S_OK);
+    CHECK (cache.IsUnavailable (capWinRT));
+}
+
+TEST_CASE (ResetRestoresAttempts)
+{
+    CapabilityCache cache;
+    FakeSource source;
+    source.result = E_NOINTERFACE;
+    source.Query (cache, capUISettings3);
+    source.Query (cache, capUISettings3);
+    CHECK (cache.GetSkippedAttempts (capUISettings3) == 1);
+    cache.SetOSVersion ({ 10, 0, 19045 });
+
+    cache.Reset ();
+    CHECK (!cache.IsUnavailable (capUISettings3));
+    CHECK (cache.GetSkippedAttempts (capUISettings3) == 0);
+    OSVersion version;
+    CHECK (!cache.GetOSVersion (version));
+
+    source.result = S_OK;
+    CHECK (source.Query (cache, capUISettings3) == S_OK);
+    CHECK (source.attempts == 2);
+}
+
+TEST_CASE (OSVersionCached)
+{
+    CapabilityCache cache;
+    OSVersion version = { 1, 2, 3 };
+    CHECK (!cache.GetOSVersion (version));
+    cache.SetOSVersion ({ 10, 0, 22621 });
+    CHECK (cache.GetOSVersion (version));
+    CHECK ((version.major == 10) && (version.minor == 0) && (version.build == 22621));
+}
+
+TEST_CASE (ConcurrentSkipCounting)
+{
+    CapabilityCache cache;
+    cache.RecordResult (capWinRT, E_NOTIMPL);
+    const int threadCount = 4;
+    const int attemptsPerThread = 10000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; t++)
+    {
+        threads.emplace_back ([&]()
+        {
+            for (int i = 0; i < attemptsPerThread; i++)
+            {
+                CHECK (!cache.ShouldTry (capWinRT));
+                CHECK (cache.ShouldTry (capUISettings3));
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join ();
+    CHECK (cache.GetSkippedAttempts (capWinRT) == threadCount * attemptsPerThread);
+    CHECK (cache.GetSkippedAttempts (capUISettings3) == 0);
+}
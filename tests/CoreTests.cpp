@@ -0,0 +1,107 @@
+/*
+This library is licensed under the zlib license.
+
+Copyright (C) 2016-2018 Frank Richter
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+claim that you wrote the original software. If you use this software
+in a product, an acknowledgment in the product documentation would be
+appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+
+Original source:
+https://github.com/res2k/Windows10Colors
+
+*/
+
+#include "TestHarness.h"
+
+#include "Windows10ColorsCore.h"
+
+using namespace windows10colors;
+
+TEST_CASE (RGBAComponents)
+{
+    RGBA c = MakeRGBA (1, 2, 3, 4);
+    CHECK (c == 0x04030201);
+    CHECK (GetRed (c) == 1);
+    CHECK (GetGreen (c) == 2);
+    CHECK (GetBlue (c) == 3);
+    CHECK (GetAlpha (c) == 4);
+    CHECK (MakeOpaque (c) == 0xff030201);
+}
+
+TEST_CASE (BlendRGBAEndpoints)
+{
+    RGBA a = MakeRGBA (10, 20, 30, 40);
+    RGBA b = MakeRGBA (200, 150, 100, 250);
+    CHECK (BlendRGBA (a, b, 0) == a);
+    CHECK (BlendRGBA (a, b, 1) == b);
+    CHECK (BlendRGBA (MakeRGBA (0, 0, 0, 0), MakeRGBA (255, 255, 255, 255), 0.5f) == 0x7f7f7f7f);
+}
+
+TEST_CASE (IsColorDarkThreshold)
+{
+    CHECK (IsColorDark (MakeRGBA (0, 0, 0, 255)));
+    CHECK (!IsColorDark (MakeRGBA (255, 255, 255, 255)));
+    // Default accent color of Windows 10
+    CHECK (IsColorDark (MakeRGBA (0, 120, 215, 255)));
+    // Formula is weighted; green counts most
+    CHECK (!IsColorDark (MakeRGBA (0, 210, 0, 255)));
+    CHECK (IsColorDark (MakeRGBA (0, 0, 255, 255)));
+}
+
+TEST_CASE (GenerateAccentColorsKnownValues)
+{
+    struct Expected
+    {
+        RGBA base;
+        AccentColor shades;
+    };
+    // Values computed by the original Windows-only implementation
+    static const Expected expected[] = {
+        { 0xffd77800, { 0xffd77800, 0xff351e00, 0xff6b3b00, 0xffa15900, 0xffffaa3f, 0xffffbf6f, 0xffffcf93 } },
+        { 0xff0000ff, { 0xff0000ff, 0xff00003f, 0xff00007f, 0xff0000bf, 0xff3f3fff, 0xff6f6fff, 0xff9393ff } },
+        { 0xff808080, { 0xff808080, 0xff1f1f1f, 0xff3f3f3f, 0xff5f5f5f, 0xff9f9f9f, 0xffbfbfbf, 0xffdfdfdf } },
+    };
+    for (const auto& e : expected)
+    {
+        AccentColor c;
+        GenerateAccentColors (e.base, c);
+        CHECK (c.accent == e.shades.accent);
+        CHECK (c.darkest == e.shades.darkest);
+        CHECK (c.darker == e.shades.darker);
+        CHECK (c.dark == e.shades.dark);
+        CHECK (c.light == e.shades.light);
+        CHECK (c.lighter == e.shades.lighter);
+        CHECK (c.lightest == e.shades.lightest);
+    }
+}
+
+TEST_CASE (GenerateAccentColorsOrdering)
+{
+    // Shades get brighter from darkest to lightest, for any hue
+    for (unsigned int i = 0; i < 4096; i++)
+    {
+        RGBA base = MakeRGBA ((i * 37) & 0xff, (i * 101) & 0xff, (i * 13) & 0xff, 255);
+        AccentColor c;
+        GenerateAccentColors (base, c);
+        auto sum = [](RGBA x) { return GetRed (x) + GetGreen (x) + GetBlue (x); };
+        CHECK (sum (c.darkest) <= sum (c.darker));
+        CHECK (sum (c.darker) <= sum (c.dark));
+        CHECK (sum (c.dark) <= sum (c.accent));
+        CHECK (sum (c.accent) <= sum (c.light));
+        CHECK (sum (c.light) <= sum (c.lighter));
+        CHECK (sum (c.lighter) <= sum (c.lightest));
+    }
+}
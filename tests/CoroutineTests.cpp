@@ -0,0 +1,262 @@
+/*
+This library is licensed under the zlib license.
+
+Copyright (C) 2016-2018 Frank Richter
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+claim that you wrote the original software. If you use this software
+in a product, an acknowledgment in the product documentation would be
+appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+
+Original source:
+https://github.com/res2k/Windows10Colors
+
+*/
+
+#include "TestHarness.h"
+
+#include "Windows10ColorsCoroutine.h"
+
+#if !defined(W10C_HAVE_COROUTINES)
+#error CoroutineTests requires a compiler with C++20 coroutine support
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+
+using namespace windows10colors;
+
+namespace
+{
+    // Snapshot with the given accent color
+    ThemeSnapshot MakeSnapshot (RGBA accent)
+    {
+        ThemeSnapshot snapshot = ThemeSnapshot ();
+        snapshot.uiSettingsResult = S_OK;
+        GenerateAccentColors (accent, snapshot.uiSettingsAccent);
+        return snapshot;
+    }
+
+    // Cache starting with a fixed accent color; changes are made with Publish()
+    struct TestCache : public ThemeCache
+    {
+        TestCache ()
+          : ThemeCache ([](ThemeSnapshot& snapshot) -> HRESULT
+                        {
+                            snapshot = MakeSnapshot (0xffd77800);
+                            return S_OK;
+                        })
+        {
+            ThemeState state;
+            Read (state);
+        }
+    };
+
+    // Coroutine handles queued for resumption by RunQueued(), e.g. on a "UI thread"
+    class ResumeQueue
+    {
+    public:
+        void Post (std::coroutine_handle<> handle)
+        {
+            std::lock_guard<std::mutex> lock (mutex);
+            handles.push_back (handle);
+            posted.notify_all ();
+        }
+        size_t GetSize ()
+        {
+            std::lock_guard<std::mutex> lock (mutex);
+            return handles.size ();
+        }
+        bool WaitNotEmpty ()
+        {
+            std::unique_lock<std::mutex> lock (mutex);
+            return posted.wait_for (lock, std::chrono::seconds (5), [&]() { return !handles.empty (); });
+        }
+        /// Resume all queued coroutines on the calling thread
+        void RunQueued ()
+        {
+            std::unique_lock<std::mutex> lock (mutex);
+            while (!handles.empty ())
+            {
+                auto handle = handles.front ();
+                handles.pop_front ();
+                lock.unlock ();
+                handle.resume ();
+                lock.lock ();
+            }
+        }
+    private:
+        std::mutex mutex;
+        std::condition_variable posted;
+        std::deque<std::coroutine_handle<>> handles;
+    };
+
+    // Executor posting to a ResumeQueue
+    struct QueueExecutor
+    {
+        ResumeQueue* queue;
+        void operator() (std::coroutine_handle<> handle) const { queue->Post (handle); }
+    };
+
+    // Eagerly started coroutine; the frame is destroyed with the task
+    struct Task
+    {
+        struct promise_type
+        {
+            Task get_return_object () { return Task (std::coroutine_handle<promise_type>::from_promise (*this)); }
+            std::suspend_never initial_suspend () { return {}; }
+            std::suspend_always final_suspend () noexcept { return {}; }
+            void return_void () {}
+            void unhandled_exception () { std::terminate (); }
+        };
+
+        explicit Task (std::coroutine_handle<promise_type> handle) : handle (handle) {}
+        Task (Task&& other) : handle (other.handle) { other.handle = nullptr; }
+        ~Task () { if (handle) handle.destroy (); }
+
+        bool IsDone () const { return handle.done (); }
+    private:
+        std::coroutine_handle<promise_type> handle;
+    };
+
+    // Records progress of a coroutine
+    struct Progress
+    {
+        std::atomic<int> step { 0 };
+        ThemeState state;
+        FrameColorsResult colors;
+    };
+
+    Task AwaitThemeChange (ThemeCache& cache, uint64_t generation, ResumeQueue& queue, Progress& progress,
+                           unsigned int changeMask = ~0u)
+    {
+        progress.step = 1;
+        progress.state = co_await NextThemeChange (cache, generation, QueueExecutor { &queue }, changeMask);
+        progress.step = 2;
+    }
+
+    Task AwaitFrameColors (ThemeCache& cache, ResumeQueue& queue, Progress& progress)
+    {
+        progress.step = 1;
+        progress.colors = co_await GetFrameColorsAsync (cache, fcDefault, DarkMode::Light, QueueExecutor { &queue });
+        progress.step = 2;
+    }
+} // anonymous namespace
+
+TEST_CASE (ResumedThroughExecutorAfterPublish)
+{
+    TestCache cache;
+    ResumeQueue queue;
+    Progress progress;
+    uint64_t generation = cache.GetGeneration ();
+    Task task = AwaitThemeChange (cache, generation, queue, progress);
+    CHECK (progress.step == 1);
+
+    uint64_t newGeneration = cache.Publish (MakeSnapshot (0xff0000ff));
+    CHECK (newGeneration != generation);
+    // Not resumed by the publishing thread, but queued
+    CHECK (progress.step == 1);
+    CHECK (queue.GetSize () == 1);
+
+    queue.RunQueued ();
+    CHECK (progress.step == 2);
+    CHECK (task.IsDone ());
+    CHECK (progress.state.generation == newGeneration);
+    CHECK (progress.state.accent.accent == MakeSnapshot (0xff0000ff).uiSettingsAccent.accent);
+
+    // Further changes don't resume the finished coroutine again
+    cache.Publish (MakeSnapshot (0xff00ff00));
+    CHECK (queue.GetSize () == 0);
+}
+
+TEST_CASE (ReadyIfGenerationChanged)
+{
+    TestCache cache;
+    ResumeQueue queue;
+    Progress progress;
+    uint64_t generation = cache.GetGeneration ();
+    cache.Publish (MakeSnapshot (0xff0000ff));
+
+    // The change was missed: completes without suspending
+    Task task = AwaitThemeChange (cache, generation, queue, progress);
+    CHECK (progress.step == 2);
+    CHECK (task.IsDone ());
+    CHECK (progress.state.generation == cache.GetGeneration ());
+    CHECK (queue.GetSize () == 0);
+}
+
+TEST_CASE (ChangeMaskFiltersResumption)
+{
+    TestCache cache;
+    ResumeQueue queue;
+    Progress progress;
+    Task task = AwaitThemeChange (cache, cache.GetGeneration (), queue, progress, tcActiveCaptionText);
+
+    // Accent change doesn't change the default frame text color
+    cache.Publish (MakeSnapshot (0xff0000ff));
+    CHECK (queue.GetSize () == 0);
+    CHECK (progress.step == 1);
+}
+
+TEST_CASE (DestroyedWhileSuspended)
+{
+    TestCache cache;
+    ResumeQueue queue;
+    Progress progress;
+    {
+        Task task = AwaitThemeChange (cache, cache.GetGeneration (), queue, progress);
+        CHECK (progress.step == 1);
+        CHECK (!task.IsDone ());
+        // Destroying the frame destroys the awaiter, which unlinks its waiter
+    }
+    // A waiter left registered would resume the destroyed frame here
+    cache.Publish (MakeSnapshot (0xff0000ff));
+    CHECK (queue.GetSize () == 0);
+    CHECK (progress.step == 1);
+
+    // Other waiters are unaffected
+    Progress other;
+    Task otherTask = AwaitThemeChange (cache, cache.GetGeneration (), queue, other);
+    cache.Publish (MakeSnapshot (0xff00ff00));
+    CHECK (queue.GetSize () == 1);
+    queue.RunQueued ();
+    CHECK (other.step == 2);
+}
+
+TEST_CASE (FrameColorsAsync)
+{
+    TestCache cache;
+    ResumeQueue queue;
+    Progress progress;
+    Task task = AwaitFrameColors (cache, queue, progress);
+    if (progress.step == 1)
+    {
+        // Refreshing in the background; resumed through the executor afterwards
+        REQUIRE (queue.WaitNotEmpty ());
+        queue.RunQueued ();
+    }
+    CHECK (progress.step == 2);
+    CHECK (task.IsDone ());
+    CHECK (progress.colors.result == S_OK);
+
+    FrameColors expected;
+    CHECK (GetFrameColors (MakeSnapshot (0xffd77800), expected, fcDefault, DarkMode::Light) == S_OK);
+    CHECK (progress.colors.colors.activeCaptionBG == expected.activeCaptionBG);
+    CHECK (progress.colors.colors.activeFrame == expected.activeFrame);
+}
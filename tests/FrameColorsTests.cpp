@@ -0,0 +1,286 @@
+/*
+This library is licensed under the zlib license.
+
+Copyright (C) 2016-2018 Frank Richter
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+claim that you wrote the original software. If you use this software
+in a product, an acknowledgment in the product documentation would be
+appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+
+Original source:
+https://github.com/res2k/Windows10Colors
+
+*/
+
+#include "TestHarness.h"
+
+#include "Windows10ColorsCore.h"
+
+#include <initializer_list>
+
+#include <string.h>
+
+using namespace windows10colors;
+
+namespace
+{
+    const RGBA white = 0xffffffff;
+    const RGBA black = 0xff000000;
+    // Accent color stored by DWM (dark: white caption text)
+    const RGBA dwmAccent = MakeRGBA (0x00, 0x78, 0xd7, 0xff);
+    // Accent color from WinRT or a guess (bright: black caption text)
+    const RGBA fallbackAccent = MakeRGBA (0xff, 0xe0, 0x40, 0xff);
+    const RGBA colorization = MakeRGBA (0x10, 0x60, 0xa0, 0xc4);
+    // Active frame based on the DWM colorization color
+    const RGBA dwmFrame = BlendRGBA (0xffd9d9d9, MakeOpaque (colorization), 0.89f);
+    // Active frame without colored title bars, since 1809
+    const RGBA grayFrame = 0xb2323232;
+
+    const OSVersion win81 = { 6, 3, 9600 };
+    const OSVersion win10_1607 = { 10, 0, 14393 };
+    const OSVersion win10_1809 = { 10, 0, 17763 };
+    const OSVersion win10_1903 = { 10, 0, 18362 };
+
+    // Which accent color sources are available
+    enum AccentSource { dwmWithAccent, dwmWithoutAccent, noDwm };
+
+    struct FrameColorsCase
+    {
+        const char* name;
+        OSVersion osVersion;
+        AccentSource source;
+        bool coloredTitleBars;
+        bool appsDarkMode;
+        unsigned int options;
+        DarkMode darkMode;
+
+        RGBA activeCaptionBG;
+        RGBA activeCaptionText;
+        RGBA activeFrame;
+        bool dark;
+    };
+
+    const FrameColorsCase frameColorsCases[] = {
+        // Colored and uncolored title bars
+        { "uncolored", win10_1903, dwmWithAccent, false, false, fcDefault, DarkMode::Light,
+          white, black, grayFrame, false },
+        { "colored", win10_1903, dwmWithAccent, true, false, fcDefault, DarkMode::Light,
+          dwmAccent, white, dwmFrame, false },
+        { "colored by option", win10_1903, dwmWithAccent, false, false, fcTitleBarsColored, DarkMode::Light,
+          dwmAccent, white, dwmFrame, false },
+        { "uncolored before 1809", win10_1607, dwmWithAccent, false, false, fcDefault, DarkMode::Light,
+          white, black, dwmFrame, false },
+        // Pre-Win10: title bars are always colored
+        { "Windows 8.1", win81, dwmWithoutAccent, false, false, fcDefault, DarkMode::Light,
+          fallbackAccent, black, dwmFrame, false },
+        { "Windows 8.1 glass", win81, dwmWithoutAccent, false, false, fcGlassEffect, DarkMode::Light,
+          fallbackAccent, black, fallbackAccent, false },
+        { "Windows 8.1 no DWM", win81, noDwm, false, false, fcDefault, DarkMode::Light,
+          fallbackAccent, black, fallbackAccent, false },
+        // Glass: ignores the colored title bars setting, frame matches caption
+        { "glass", win10_1903, dwmWithAccent, true, false, fcGlassEffect, DarkMode::Light,
+          white, black, white, false },
+        { "glass colored by option", win10_1903, dwmWithAccent, false, false, fcGlassEffect | fcTitleBarsColored,
+          DarkMode::Light, dwmAccent, white, dwmAccent, false },
+        { "glass dark", win10_1903, dwmWithAccent, false, false, fcGlassEffect, DarkMode::Dark,
+          black, white, black, true },
+        // Missing DWM accent: WinRT (or guessed) accent is used
+        { "DWM without accent", win10_1903, dwmWithoutAccent, true, false, fcDefault, DarkMode::Light,
+          fallbackAccent, black, dwmFrame, false },
+        { "no DWM colors", win10_1903, noDwm, true, false, fcDefault, DarkMode::Light,
+          fallbackAccent, black, fallbackAccent, false },
+        { "no DWM colors, uncolored", win10_1903, noDwm, false, false, fcDefault, DarkMode::Light,
+          white, black, grayFrame, false },
+        // Dark mode: Auto follows the apps setting from 1903 on
+        { "auto 1903 dark", win10_1903, dwmWithAccent, false, true, fcDefault, DarkMode::Auto,
+          black, white, grayFrame, true },
+        { "auto 1903 light", win10_1903, dwmWithAccent, false, false, fcDefault, DarkMode::Auto,
+          white, black, grayFrame, false },
+        { "auto 1809", win10_1809, dwmWithAccent, false, true, fcDefault, DarkMode::Auto,
+          white, black, grayFrame, false },
+        { "auto 1607", win10_1607, dwmWithAccent, false, true, fcDefault, DarkMode::Auto,
+          white, black, dwmFrame, false },
+        { "user 1809 dark", win10_1809, dwmWithAccent, false, true, fcDefault, DarkMode::User,
+          black, white, grayFrame, true },
+        { "user 1903 light", win10_1903, dwmWithAccent, false, false, fcDefault, DarkMode::User,
+          white, black, grayFrame, false },
+        { "off", win10_1903, dwmWithAccent, false, true, fcDefault, DarkMode::Light,
+          white, black, grayFrame, false },
+        { "forced dark", win10_1903, dwmWithAccent, false, false, fcDefault, DarkMode::Dark,
+          black, white, grayFrame, true },
+        // Colored title bars don't change with dark mode, inactive ones do
+        { "colored dark", win10_1903, dwmWithAccent, true, true, fcDefault, DarkMode::Auto,
+          dwmAccent, white, dwmFrame, true },
+    };
+
+    ThemeInputs MakeInputs (const FrameColorsCase& c)
+    {
+        ThemeInputs inputs = ThemeInputs ();
+        inputs.osVersion = c.osVersion;
+        inputs.haveDwmColors = c.source != noDwm;
+        inputs.dwmColors.ColorizationColor = colorization;
+        inputs.dwmColors.ColorizationColorBalance = 89;
+        inputs.dwmColors.haveAccentColor = c.source == dwmWithAccent;
+        inputs.dwmColors.AccentColor = dwmAccent;
+        inputs.accent = fallbackAccent;
+        inputs.coloredTitleBars = c.coloredTitleBars;
+        inputs.appsDarkMode = c.appsDarkMode;
+        return inputs;
+    }
+
+    void CheckCase (const FrameColorsCase& c)
+    {
+        FrameColors colors = ComputeFrameColors (MakeInputs (c), c.options, c.darkMode);
+        bool ok = (colors.activeCaptionBG == c.activeCaptionBG)
+            && (colors.activeCaptionText == c.activeCaptionText)
+            && (colors.activeFrame == c.activeFrame);
+        // Inactive colors only depend on dark mode
+        RGBA inactiveBG = c.dark ? 0xff2b2b2b : white;
+        ok = ok && (colors.inactiveCaptionBG == inactiveBG)
+            && (colors.inactiveCaptionText == BlendRGBA (c.dark ? white : black, inactiveBG, c.dark ? 0.4f : 0.6f))
+            && (colors.inactiveFrame == 0x7f565656);
+        if (!ok) test::ReportFailure (__FILE__, __LINE__, c.name);
+    }
+} // anonymous namespace
+
+TEST_CASE (FrameColorsTable)
+{
+    for (const auto& c : frameColorsCases)
+    {
+        CheckCase (c);
+    }
+}
+
+TEST_CASE (HighContrast)
+{
+    ThemeInputs inputs = MakeInputs (frameColorsCases[1]);
+    inputs.highContrast = true;
+    inputs.sysColors.activeCaption = MakeRGBA (0x80, 0x00, 0x80, 0x00);
+    inputs.sysColors.captionText = MakeRGBA (0xff, 0xff, 0x00, 0x00);
+    inputs.sysColors.inactiveCaption = MakeRGBA (0x00, 0x80, 0x00, 0x00);
+    inputs.sysColors.inactiveCaptionText = MakeRGBA (0x00, 0x00, 0xff, 0x00);
+
+    // System colors, regardless of options and dark mode
+    for (unsigned int options = 0; options < 4; options++)
+    {
+        for (DarkMode darkMode : { DarkMode::Auto, DarkMode::User, DarkMode::Light, DarkMode::Dark })
+        {
+            FrameColors colors = ComputeFrameColors (inputs, options, darkMode);
+            CHECK (colors.activeCaptionBG == MakeRGBA (0x80, 0x00, 0x80, 0xff));
+            CHECK (colors.activeCaptionText == MakeRGBA (0xff, 0xff, 0x00, 0xff));
+            CHECK (colors.activeFrame == MakeRGBA (0xff, 0xff, 0x00, 0xff));
+            CHECK (colors.inactiveCaptionBG == MakeRGBA (0x00, 0x80, 0x00, 0xff));
+            CHECK (colors.inactiveFrame == MakeRGBA (0x00, 0x00, 0xff, 0xff));
+            CHECK (colors.inactiveCaptionText
+                   == BlendRGBA (MakeRGBA (0x00, 0x00, 0xff, 0xff), MakeRGBA (0x00, 0x80, 0x00, 0xff), 0.6f));
+        }
+    }
+}
+
+TEST_CASE (NegativeColorizationBalance)
+{
+    // Frame falls back to the accent color
+    ThemeInputs inputs = MakeInputs (frameColorsCases[1]);
+    inputs.dwmColors.ColorizationColorBalance = -1;
+    CHECK (ComputeFrameColors (inputs).activeFrame == dwmAccent);
+    inputs.dwmColors.haveAccentColor = false;
+    CHECK (ComputeFrameColors (inputs).activeFrame == fallbackAccent);
+}
+
+TEST_CASE (ResolveDarkModeAcrossBuilds)
+{
+    const struct
+    {
+        OSVersion osVersion;
+        bool appsDarkMode;
+        DarkMode darkMode;
+        bool dark;
+    } cases[] = {
+        { win10_1607, true, DarkMode::Auto, false },
+        { win10_1809, true, DarkMode::Auto, false },
+        { win10_1903, true, DarkMode::Auto, true },
+        { win10_1903, false, DarkMode::Auto, false },
+        { { 10, 0, 22621 }, true, DarkMode::Auto, true },
+        { win81, true, DarkMode::User, true },
+        { win10_1809, false, DarkMode::User, false },
+        { win10_1903, true, DarkMode::Light, false },
+        { win81, false, DarkMode::Dark, true },
+    };
+    for (const auto& c : cases)
+    {
+        ThemeInputs inputs = ThemeInputs ();
+        inputs.osVersion = c.osVersion;
+        inputs.appsDarkMode = c.appsDarkMode;
+        CHECK (ResolveDarkMode (inputs, c.darkMode) == c.dark);
+    }
+}
+
+TEST_CASE (WinRTAccentFallbackFromSnapshot)
+{
+    // DWM without AccentColor (e.g. Windows 10 before 1511): WinRT accent, or composed colorization color
+    ThemeSnapshot snapshot = ThemeSnapshot ();
+    snapshot.osVersion = win10_1903;
+    snapshot.dwmResult = S_OK;
+    snapshot.dwmColors.ColorizationColor = colorization;
+    snapshot.dwmColors.ColorizationColorBalance = 89;
+    snapshot.haveDwmColorPrevalence = true;
+    snapshot.dwmColorPrevalence = true;
+    snapshot.uiSettingsResult = S_OK;
+    snapshot.uiSettingsAccent.accent = fallbackAccent;
+
+    FrameColors colors;
+    CHECK (GetFrameColors (snapshot, colors, fcDefault, DarkMode::Light) == S_OK);
+    CHECK (colors.activeCaptionBG == fallbackAccent);
+
+    snapshot.uiSettingsResult = E_NOTIMPL;
+    CHECK (GetFrameColors (snapshot, colors, fcDefault, DarkMode::Light) == S_OK);
+    CHECK (colors.activeCaptionBG
+           == BlendRGBA (white, MakeOpaque (colorization), GetAlpha (colorization) / 255.0f));
+
+    // DWM accent wins over WinRT
+    snapshot.uiSettingsResult = S_OK;
+    snapshot.dwmColors.haveAccentColor = true;
+    snapshot.dwmColors.AccentColor = dwmAccent;
+    CHECK (GetFrameColors (snapshot, colors, fcDefault, DarkMode::Light) == S_OK);
+    CHECK (colors.activeCaptionBG == dwmAccent);
+}
+
+TEST_CASE (VariantsMatchSingleComputation)
+{
+    for (const auto& c : frameColorsCases)
+    {
+        ThemeInputs inputs = MakeInputs (c);
+        FrameColorVariants variants;
+        ComputeAllFrameColorVariants (inputs, variants);
+        CHECK (variants.userDarkMode == ResolveDarkMode (inputs, DarkMode::User));
+        CHECK (variants.autoDarkMode == ResolveDarkMode (inputs, DarkMode::Auto));
+
+        for (unsigned int options = 0; options < 4; options++)
+        {
+            for (int dark = 0; dark < 2; dark++)
+            {
+                FrameColors single = ComputeFrameColors (inputs, options, dark ? DarkMode::Dark : DarkMode::Light);
+                CHECK (memcmp (&variants.colors[options][dark], &single, sizeof (single)) == 0);
+            }
+            for (DarkMode darkMode : { DarkMode::Auto, DarkMode::User, DarkMode::Light, DarkMode::Dark })
+            {
+                FrameColors single = ComputeFrameColors (inputs, options, darkMode);
+                CHECK (memcmp (&variants.Get (options, darkMode), &single, sizeof (single)) == 0);
+                // Options beyond the ones affecting the colors are ignored
+                CHECK (&variants.Get (options | 4, darkMode) == &variants.Get (options, darkMode));
+            }
+        }
+    }
+}
@@ -0,0 +1,167 @@
+/*
+This library is licensed under the zlib license.
+
+Copyright (C) 2016-2018 Frank Richter
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+claim that you wrote the original software. If you use this software
+in a product, an acknowledgment in the product documentation would be
+appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+
+Original source:
+https://github.com/res2k/Windows10Colors
+
+*/
+
+#include "TestHarness.h"
+
+#include "Windows10ColorsModules.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <string.h>
+
+using namespace windows10colors;
+
+namespace
+{
+    // Loader handing out fake module handles and symbol addresses, counting calls
+    class MockModuleLoader : public ModuleLoader
+    {
+    public:
+        std::atomic<unsigned long> loads;
+        std::atomic<unsigned long> lookups;
+        std::atomic<unsigned long> frees;
+        std::atomic<long> liveModules;
+        // Delay inside LoadModule(), to widen race windows
+        std::chrono::microseconds loadDelay;
+
+        MockModuleLoader () : loads (0), lookups (0), frees (0), liveModules (0), loadDelay (0) {}
+
+        void* LoadModule (const wchar_t* name) override
+        {
+            loads++;
+            if (loadDelay.count () > 0) std::this_thread::sleep_for (loadDelay);
+            if (wcscmp (name, L"missing.dll") == 0) return nullptr;
+            liveModules++;
+            return const_cast<wchar_t*> (name);
+        }
+        void* GetSymbol (void* module, const char* name) override
+        {
+            lookups++;
+            if (strcmp (name, "Missing") == 0) return nullptr;
+            return SymbolAddress (static_cast<const wchar_t*> (module), name);
+        }
+        void FreeModule (void*) override
+        {
+            frees++;
+            liveModules--;
+        }
+
+        /// Deterministic fake address for a symbol
+        static void* SymbolAddress (const wchar_t* module, const char* name)
+        {
+            size_t hash = 0;
+            for (const wchar_t* p = module; *p; p++) hash = hash * 31 + static_cast<size_t> (*p);
+            for (const char* p = name; *p; p++) hash = hash * 31 + static_cast<unsigned char> (*p);
+            return reinterpret_cast<void*> (hash | 1);
+        }
+    };
+
+    const ModuleImport testImports[] = {
+        { L"a.dll", "First" },
+        { L"b.dll", "Second" },
+        { L"a.dll", "Third" },
+        { L"a.dll", "Missing" },
+        { L"missing.dll", "Fourth" },
+    };
+    const size_t numTestImports = sizeof (testImports) / sizeof (testImports[0]);
+} // anonymous namespace
+
+TEST_CASE (ResolvesOnFirstUse)
+{
+    MockModuleLoader loader;
+    {
+        LazyImports imports (loader, testImports, numTestImports);
+        CHECK (loader.loads == 0);
+        CHECK (imports.GetLoadCount () == 0);
+
+        CHECK (imports.Get (0) == MockModuleLoader::SymbolAddress (L"a.dll", "First"));
+        CHECK (imports.Get (1) == MockModuleLoader::SymbolAddress (L"b.dll", "Second"));
+        CHECK (imports.Get (2) == MockModuleLoader::SymbolAddress (L"a.dll", "Third"));
+        CHECK (imports.Get (3) == nullptr);
+        CHECK (imports.Get (4) == nullptr);
+
+        // Each distinct module loaded once, missing module not looked up
+        CHECK (loader.loads == 3);
+        CHECK (loader.lookups == 4);
+        CHECK (imports.GetLoadCount () == 1);
+    }
+    CHECK (loader.frees == 2);
+    CHECK (loader.liveModules == 0);
+}
+
+TEST_CASE (UnusedImportsLoadNothing)
+{
+    MockModuleLoader loader;
+    {
+        LazyImports imports (loader, testImports, numTestImports);
+    }
+    CHECK (loader.loads == 0);
+    CHECK (loader.frees == 0);
+}
+
+TEST_CASE (ConcurrentFirstUseStress)
+{
+    const int numRounds = 200;
+    const int numThreads = 8;
+    for (int round = 0; round < numRounds; round++)
+    {
+        MockModuleLoader loader;
+        // Slow down some rounds so threads pile up on the load lock
+        if (round % 4 == 0) loader.loadDelay = std::chrono::microseconds (50);
+        {
+            LazyImports imports (loader, testImports, numTestImports);
+            std::atomic<int> ready (0);
+            std::atomic<int> mismatches (0);
+            std::vector<std::thread> threads;
+            for (int t = 0; t < numThreads; t++)
+            {
+                threads.emplace_back ([&, t]()
+                {
+                    // Start all threads at once
+                    ready++;
+                    while (ready < numThreads) std::this_thread::yield ();
+                    for (int i = 0; i < 100; i++)
+                    {
+                        size_t index = static_cast<size_t> (t + i) % 3;
+                        void* expected = MockModuleLoader::SymbolAddress (testImports[index].module,
+                                                                          testImports[index].symbol);
+                        if (imports.Get (index) != expected) mismatches++;
+                        if (imports.Get (3) != nullptr) mismatches++;
+                    }
+                });
+            }
+            for (auto& thread : threads) thread.join ();
+            CHECK (mismatches == 0);
+            CHECK (imports.GetLoadCount () == 1);
+            CHECK (loader.loads == 3);
+            CHECK (loader.lookups == 4);
+        }
+        CHECK (loader.liveModules == 0);
+    }
+}
@@ -0,0 +1,217 @@
+/*
+This library is licensed under the zlib license.
+
+Copyright (C) 2016-2018 Frank Richter
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+claim that you wrote the original software. If you use this software
+in a product, an acknowledgment in the product documentation would be
+appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+
+Original source:
+https://github.com/res2k/Windows10Colors
+
+*/
+
+#include "TestHarness.h"
+
+#include "Preview.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace windows10colors;
+
+namespace
+{
+    // Light theme with the default blue accent; glass captions are translucent
+    PreviewColors MakeBlueColors ()
+    {
+        PreviewColors colors = PreviewColors ();
+        GenerateAccentColors (MakeRGBA (0x00, 0x78, 0xd7, 0xff), colors.accents);
+        colors.accentsValid = true;
+        colors.colors.activeCaptionText = MakeRGBA (0xff, 0xff, 0xff, 0xff);
+        colors.colors.activeCaptionBG = colors.accents.accent;
+        colors.colors.activeFrame = colors.accents.dark;
+        colors.colors.inactiveCaptionText = MakeRGBA (0x99, 0x99, 0x99, 0xff);
+        colors.colors.inactiveCaptionBG = MakeRGBA (0xff, 0xff, 0xff, 0xff);
+        colors.colors.inactiveFrame = MakeRGBA (0xaa, 0xaa, 0xaa, 0xff);
+        colors.colorsGlass = colors.colors;
+        colors.colorsGlass.activeCaptionBG = MakeRGBA (0x00, 0x78, 0xd7, 0xcc);
+        colors.colorsGlass.inactiveCaptionBG = MakeRGBA (0xff, 0xff, 0xff, 0x80);
+        colors.background = MakeRGBA (0xff, 0xff, 0xff, 0xff);
+        colors.window = colors.background;
+        colors.shadow = MakeRGBA (0x00, 0x00, 0x00, 0xff);
+        return colors;
+    }
+
+    // Dark theme without accent colors
+    PreviewColors MakeDarkColors ()
+    {
+        PreviewColors colors = PreviewColors ();
+        colors.accentsValid = false;
+        colors.colors.activeCaptionText = MakeRGBA (0xff, 0xff, 0xff, 0xff);
+        colors.colors.activeCaptionBG = MakeRGBA (0x20, 0x20, 0x20, 0xff);
+        colors.colors.activeFrame = MakeRGBA (0x40, 0x40, 0x40, 0xff);
+        colors.colors.inactiveCaptionText = MakeRGBA (0x80, 0x80, 0x80, 0xff);
+        colors.colors.inactiveCaptionBG = MakeRGBA (0x2b, 0x2b, 0x2b, 0xff);
+        colors.colors.inactiveFrame = MakeRGBA (0x55, 0x55, 0x55, 0xff);
+        colors.colorsGlass = colors.colors;
+        colors.background = MakeRGBA (0x1e, 0x1e, 0x1e, 0xff);
+        colors.window = MakeRGBA (0x33, 0x33, 0x33, 0xff);
+        colors.shadow = MakeRGBA (0x00, 0x00, 0x00, 0xff);
+        return colors;
+    }
+
+    std::string DataPath (const char* name)
+    {
+        return std::string (W10C_TEST_DATA_DIR) + "/" + name;
+    }
+
+    bool ReadFile (const std::string& path, std::vector<uint8_t>& data)
+    {
+        FILE* file = fopen (path.c_str (), "rb");
+        if (!file) return false;
+        data.clear ();
+        uint8_t buffer[65536];
+        size_t n;
+        while ((n = fread (buffer, 1, sizeof (buffer), file)) > 0) data.insert (data.end (), buffer, buffer + n);
+        fclose (file);
+        return true;
+    }
+
+    bool WriteFile (const std::string& path, const std::vector<uint8_t>& data)
+    {
+        FILE* file = fopen (path.c_str (), "wb");
+        if (!file) return false;
+        bool ok = fwrite (data.data (), 1, data.size (), file) == data.size ();
+        return (fclose (file) == 0) && ok;
+    }
+
+    /* Compare an encoded image with a golden file in the test data directory.
+     * Set W10C_UPDATE_GOLDENS to rewrite the golden files instead.
+     * On mismatch, the image is written to the working directory for inspection. */
+    bool MatchesGolden (const char* name, const std::vector<uint8_t>& encoded)
+    {
+        if (getenv ("W10C_UPDATE_GOLDENS")) return WriteFile (DataPath (name), encoded);
+
+        std::vector<uint8_t> golden;
+        if (ReadFile (DataPath (name), golden) && (golden == encoded)) return true;
+        std::string actualPath = std::string (name) + ".actual";
+        WriteFile (actualPath, encoded);
+        fprintf (stderr, "%s differs from golden, written to %s\n", name, actualPath.c_str ());
+        return false;
+    }
+} // anonymous namespace
+
+TEST_CASE (PreviewSize)
+{
+    int width, height;
+    GetPreviewSize (MakeBlueColors (), width, height);
+    CHECK (width == 566);
+    CHECK (height == 527);
+    int darkWidth, darkHeight;
+    GetPreviewSize (MakeDarkColors (), darkWidth, darkHeight);
+    CHECK (darkWidth < width);
+    CHECK (darkHeight == height);
+}
+
+TEST_CASE (GoldenPPM)
+{
+    PreviewColors colors = MakeBlueColors ();
+    int width, height;
+    GetPreviewSize (colors, width, height);
+    std::vector<uint8_t> pixels (static_cast<size_t> (width) * height * 4);
+    RenderPreview (colors, pixels.data (), width, height, width * 4);
+    std::vector<uint8_t> ppm;
+    EncodePPM (pixels.data (), width, height, width * 4, ppm);
+    CHECK (MatchesGolden ("preview_blue.ppm", ppm));
+}
+
+TEST_CASE (GoldenPNGClipped)
+{
+    // Smaller than the preview: content is clipped
+    const int width = 160, height = 120;
+    // Padded rows
+    const ptrdiff_t stride = width * 4 + 12;
+    std::vector<uint8_t> pixels (stride * height, 0xee);
+    RenderPreview (MakeDarkColors (), pixels.data (), width, height, stride);
+    std::vector<uint8_t> png;
+    EncodePNG (pixels.data (), width, height, stride, png);
+    CHECK (MatchesGolden ("preview_dark_clipped.png", png));
+    // Padding untouched
+    CHECK (pixels[width * 4] == 0xee);
+}
+
+TEST_CASE (SharedShadowCacheMatches)
+{
+    PreviewColors colors = MakeBlueColors ();
+    int width, height;
+    GetPreviewSize (colors, width, height);
+    std::vector<uint8_t> expected (static_cast<size_t> (width) * height * 4);
+    RenderPreview (colors, expected.data (), width, height, width * 4);
+
+    ShadowCache shadows;
+    std::vector<uint8_t> pixels (expected.size ());
+    for (int i = 0; i < 2; i++)
+    {
+        RenderPreview (colors, pixels.data (), width, height, width * 4, &shadows);
+        CHECK (pixels == expected);
+    }
+    CHECK (shadows.GetHits () > 0);
+}
+
+TEST_CASE (RenderPreviewsMatchesSingle)
+{
+    const PreviewColors variants[2] = { MakeBlueColors (), MakeDarkColors () };
+    std::vector<uint8_t> expected[2];
+    for (int v = 0; v < 2; v++)
+    {
+        int width, height;
+        GetPreviewSize (variants[v], width, height);
+        expected[v].resize (static_cast<size_t> (width) * height * 4);
+        RenderPreview (variants[v], expected[v].data (), width, height, width * 4);
+    }
+
+    const size_t count = 12;
+    std::vector<PreviewColors> colors;
+    for (size_t i = 0; i < count; i++) colors.push_back (variants[i % 2]);
+    std::mutex resultMutex;
+    std::vector<int> seen (count, 0);
+    std::atomic<int> mismatches (0);
+    RenderPreviews (count, colors.data (), [&](size_t index, const uint8_t* pixels, int width, int height,
+                                               ptrdiff_t stride)
+    {
+        const std::vector<uint8_t>& reference = expected[index % 2];
+        for (int y = 0; y < height; y++)
+        {
+            if (!std::equal (pixels + y * stride, pixels + y * stride + width * 4,
+                             reference.begin () + static_cast<size_t> (y) * width * 4))
+            {
+                mismatches++;
+                break;
+            }
+        }
+        std::lock_guard<std::mutex> lock (resultMutex);
+        seen[index]++;
+    }, 3);
+    CHECK (mismatches == 0);
+    for (int s : seen) CHECK (s == 1);
+}
@@ -0,0 +1,217 @@
+/*
+This library is licensed under the zlib license.
+
+Copyright (C) 2016-2018 Frank Richter
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+claim that you wrote the original software. If you use this software
+in a product, an acknowledgment in the product documentation would be
+appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+
+Original source:
+https://github.com/res2k/Windows10Colors
+
+*/
+
+#include "TestHarness.h"
+
+#include "Windows10ColorsProfiles.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include <wchar.h>
+
+using namespace windows10colors;
+
+namespace
+{
+    // Settings store holding the values of one synthetic profile
+    class SyntheticProfileStore : public SettingsStore
+    {
+    public:
+        explicit SyntheticProfileStore (size_t index)
+        {
+            uint32_t seed = static_cast<uint32_t> (index) * 2654435761u;
+            colorizationColor = 0xc4000000 | (seed & 0xffffff);
+            colorizationColorBalance = seed % 101;
+            accentColor = 0xff000000 | (seed >> 8);
+            haveAccentColor = (index % 3) != 0;
+            dwmColorPrevalence = (index % 2) != 0;
+            personalizeColorPrevalence = (index % 5) == 0;
+            appsUseLightTheme = (index % 4) < 2;
+            systemUsesLightTheme = (index % 6) == 0;
+        }
+
+        HRESULT QueryValues (SettingsKey key, size_t count, const wchar_t* const* names,
+                             uint32_t* values, HRESULT* results) override
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                results[i] = Lookup (key, names[i], values[i]) ? S_OK : HRESULT_FROM_WIN32 (ERROR_FILE_NOT_FOUND);
+            }
+            return S_OK;
+        }
+        HRESULT StartWatching () override { return E_NOTIMPL; }
+        HRESULT WaitForChange () override { return E_NOTIMPL; }
+        void StopWaiting () override {}
+    private:
+        uint32_t colorizationColor;
+        uint32_t colorizationColorBalance;
+        uint32_t accentColor;
+        bool haveAccentColor;
+        bool dwmColorPrevalence;
+        bool personalizeColorPrevalence;
+        bool appsUseLightTheme;
+        bool systemUsesLightTheme;
+
+        bool Lookup (SettingsKey key, const wchar_t* name, uint32_t& value) const
+        {
+            if (key == SettingsKey::DWM)
+            {
+                if (wcscmp (name, L"ColorizationColor") == 0) value = colorizationColor;
+                else if (wcscmp (name, L"ColorizationColorBalance") == 0) value = colorizationColorBalance;
+                else if ((wcscmp (name, L"AccentColor") == 0) && haveAccentColor) value = accentColor;
+                else if (wcscmp (name, L"ColorPrevalence") == 0) value = dwmColorPrevalence;
+                else return false;
+            }
+            else
+            {
+                if (wcscmp (name, L"ColorPrevalence") == 0) value = personalizeColorPrevalence;
+                else if (wcscmp (name, L"AppsUseLightTheme") == 0) value = appsUseLightTheme;
+                else if (wcscmp (name, L"SystemUsesLightTheme") == 0) value = systemUsesLightTheme;
+                else return false;
+            }
+            return true;
+        }
+    };
+
+    ThemeSnapshot MakeSystemSnapshot ()
+    {
+        ThemeSnapshot system = ThemeSnapshot ();
+        system.osVersion = { 10, 0, 17763 };
+        system.sysColors.activeCaption = MakeRGBA (0x99, 0xb4, 0xd1, 0xff);
+        system.sysColors.highlight = MakeRGBA (0x00, 0x78, 0xd7, 0xff);
+        return system;
+    }
+
+    // Capture of synthetic profiles; every 7th profile fails
+    HRESULT CaptureSynthetic (const ThemeSnapshot& system, size_t index, ThemeSnapshot& snapshot)
+    {
+        if (index % 7 == 3) return HRESULT_FROM_WIN32 (ERROR_FILE_NOT_FOUND);
+        SyntheticProfileStore store (index);
+        return CaptureProfileSnapshot (store, system, snapshot);
+    }
+
+    bool SameAccent (const AccentColor& a, const AccentColor& b)
+    {
+        return (a.accent == b.accent) && (a.darkest == b.darkest) && (a.darker == b.darker) && (a.dark == b.dark)
+            && (a.light == b.light) && (a.lighter == b.lighter) && (a.lightest == b.lightest);
+    }
+
+    bool SameFrame (const FrameColors& a, const FrameColors& b)
+    {
+        return (a.activeCaptionText == b.activeCaptionText) && (a.activeCaptionBG == b.activeCaptionBG)
+            && (a.activeFrame == b.activeFrame) && (a.inactiveCaptionText == b.inactiveCaptionText)
+            && (a.inactiveCaptionBG == b.inactiveCaptionBG) && (a.inactiveFrame == b.inactiveFrame);
+    }
+
+    bool SameColors (const ProfileColors& a, const ProfileColors& b)
+    {
+        if (a.result != b.result) return false;
+        if (FAILED (a.result)) return true;
+        return (a.accentResult == b.accentResult) && SameAccent (a.accent, b.accent)
+            && (a.frameResult == b.frameResult) && SameFrame (a.frame, b.frame)
+            && (a.sysPartsModeResult == b.sysPartsModeResult) && (a.sysPartsMode == b.sysPartsMode);
+    }
+} // anonymous namespace
+
+TEST_CASE (CaptureProfileSnapshotUsesSystemAndStore)
+{
+    ThemeSnapshot system = MakeSystemSnapshot ();
+    system.highContrast = true;
+    SyntheticProfileStore store (1);
+    ThemeSnapshot snapshot;
+    CHECK (CaptureProfileSnapshot (store, system, snapshot) == S_OK);
+    CHECK (snapshot.highContrast);
+    CHECK (snapshot.osVersion.build == 17763);
+    CHECK (snapshot.sysColors.highlight == system.sysColors.highlight);
+    // UISettings is only available for the current user
+    CHECK (snapshot.uiSettingsResult == E_NOTIMPL);
+    CHECK (snapshot.dwmResult == S_OK);
+    CHECK (snapshot.haveDwmColorPrevalence && snapshot.dwmColorPrevalence);
+    CHECK (snapshot.appsUseLightThemeResult == S_OK && snapshot.appsUseLightTheme);
+}
+
+TEST_CASE (ParallelMatchesSerial)
+{
+    const size_t count = 1000;
+    const ThemeSnapshot system = MakeSystemSnapshot ();
+
+    // Reference: evaluated one by one
+    std::vector<ProfileColors> expected (count);
+    for (size_t i = 0; i < count; i++)
+    {
+        ThemeSnapshot snapshot;
+        HRESULT hr = CaptureSynthetic (system, i, snapshot);
+        if (FAILED (hr))
+        {
+            expected[i] = ProfileColors ();
+            expected[i].result = hr;
+        }
+        else
+        {
+            EvaluateProfileColors (snapshot, expected[i], fcDefault, DarkMode::Dark);
+        }
+    }
+
+    for (unsigned int threads : { 1u, 2u, 3u, 8u, 0u })
+    {
+        std::unique_ptr<std::atomic<int>[]> captures (new std::atomic<int>[count]);
+        for (size_t i = 0; i < count; i++) captures[i] = 0;
+        std::vector<ProfileColors> colors (count);
+        HRESULT hr = EvaluateProfiles (count, [&](size_t index, ThemeSnapshot& snapshot)
+                                       {
+                                           captures[index]++;
+                                           return CaptureSynthetic (system, index, snapshot);
+                                       }, colors.data (), fcDefault, DarkMode::Dark, threads);
+        CHECK (hr == S_FALSE);
+        size_t mismatches = 0, wrongCaptures = 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            if (!SameColors (colors[i], expected[i])) mismatches++;
+            if (captures[i] != 1) wrongCaptures++;
+        }
+        CHECK (mismatches == 0);
+        CHECK (wrongCaptures == 0);
+    }
+}
+
+TEST_CASE (ResultCodes)
+{
+    const ThemeSnapshot system = MakeSystemSnapshot ();
+    auto succeeding = [&](size_t index, ThemeSnapshot& snapshot)
+    {
+        SyntheticProfileStore store (index);
+        return CaptureProfileSnapshot (store, system, snapshot);
+    };
+    std::vector<ProfileColors> colors (10);
+    CHECK (EvaluateProfiles (colors.size (), succeeding, colors.data ()) == S_OK);
+    for (const auto& c : colors) CHECK (c.result == S_OK);
+    // More threads than profiles
+    CHECK (EvaluateProfiles (3, succeeding, colors.data (), fcDefault, DarkMode::Light, 64) == S_OK);
+    CHECK (EvaluateProfiles (0, succeeding, nullptr) == S_OK);
+    CHECK (EvaluateProfiles (1, succeeding, nullptr) == E_POINTER);
+}
@@ -0,0 +1,182 @@
+/*
+This library is licensed under the zlib license.
+
+Copyright (C) 2016-2018 Frank Richter
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+claim that you wrote the original software. If you use this software
+in a product, an acknowledgment in the product documentation would be
+appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+
+Original source:
+https://github.com/res2k/Windows10Colors
+
+*/
+
+#include "TestHarness.h"
+
+#include "Windows10ColorsRefresh.h"
+
+using namespace windows10colors;
+
+namespace
+{
+    // Manually advanced clock
+    struct FakeClock
+    {
+        RefreshCoalescer::TimePoint now;
+
+        RefreshCoalescer::Clock Get () { return [this]() { return now; }; }
+        template<typename Rep, typename Period>
+        void Advance (std::chrono::duration<Rep, Period> d)
+        {
+            now += std::chrono::duration_cast<RefreshCoalescer::TimePoint::duration> (d);
+        }
+    };
+
+    typedef std::chrono::milliseconds ms;
+    typedef std::chrono::microseconds us;
+} // anonymous namespace
+
+TEST_CASE (IdleHasNothingPending)
+{
+    FakeClock clock;
+    RefreshCoalescer coalescer (ms (50), ms (500), clock.Get ());
+    CHECK (!coalescer.IsPending ());
+    CHECK (coalescer.GetDelay () == ms (0));
+    clock.Advance (ms (1000));
+    CHECK (!coalescer.Poll ());
+    CHECK (coalescer.GetRefreshCount () == 0);
+}
+
+TEST_CASE (SingleEventRefreshesAfterQuietPeriod)
+{
+    FakeClock clock;
+    RefreshCoalescer coalescer (ms (50), ms (500), clock.Get ());
+    coalescer.Notify ();
+    CHECK (coalescer.IsPending ());
+    CHECK (coalescer.GetDelay () == ms (50));
+
+    clock.Advance (ms (49));
+    CHECK (!coalescer.Poll ());
+    CHECK (coalescer.IsPending ());
+    CHECK (coalescer.GetDelay () == ms (1));
+
+    clock.Advance (ms (1));
+    CHECK (coalescer.Poll ());
+    CHECK (!coalescer.IsPending ());
+    CHECK (coalescer.GetDelay () == ms (0));
+    // Reported once
+    CHECK (!coalescer.Poll ());
+    CHECK (coalescer.GetRefreshCount () == 1);
+}
+
+TEST_CASE (BurstIsCoalesced)
+{
+    FakeClock clock;
+    RefreshCoalescer coalescer (ms (50), ms (500), clock.Get ());
+    // 20 events, 10ms apart: each one extends the quiet period
+    for (int i = 0; i < 20; i++)
+    {
+        coalescer.Notify ();
+        CHECK (coalescer.GetDelay () == ms (50));
+        clock.Advance (ms (10));
+        CHECK (!coalescer.Poll ());
+    }
+    CHECK (coalescer.GetDelay () == ms (40));
+    clock.Advance (ms (40));
+    CHECK (coalescer.Poll ());
+    CHECK (coalescer.GetEventCount () == 20);
+    CHECK (coalescer.GetRefreshCount () == 1);
+
+    // A later event starts a new burst
+    clock.Advance (ms (1000));
+    coalescer.Notify ();
+    CHECK (coalescer.GetDelay () == ms (50));
+    clock.Advance (ms (50));
+    CHECK (coalescer.Poll ());
+    CHECK (coalescer.GetRefreshCount () == 2);
+}
+
+TEST_CASE (MaxLatencyFlushesLongBurst)
+{
+    FakeClock clock;
+    RefreshCoalescer coalescer (ms (50), ms (200), clock.Get ());
+    int refreshes = 0;
+    int refreshTimes[4] = {};
+    // Endless burst: an event every 20ms, never quiet for 50ms
+    for (int t = 0; t < 700; t += 20)
+    {
+        coalescer.Notify ();
+        if (coalescer.Poll () && (refreshes < 4)) refreshTimes[refreshes++] = t;
+        // Delay never exceeds the time left until the maximum latency
+        CHECK (coalescer.GetDelay () <= ms (200));
+        clock.Advance (ms (20));
+    }
+    // Flushed every 200ms, measured from the first event of each burst
+    CHECK (refreshes == 3);
+    CHECK (refreshTimes[0] == 200);
+    CHECK (refreshTimes[1] == 420);
+    CHECK (refreshTimes[2] == 640);
+    CHECK (coalescer.GetRefreshCount () == 3);
+}
+
+TEST_CASE (DelayAfterPollTracksMaxLatency)
+{
+    FakeClock clock;
+    RefreshCoalescer coalescer (ms (50), ms (100), clock.Get ());
+    coalescer.Notify ();
+    clock.Advance (ms (40));
+    coalescer.Notify ();
+    clock.Advance (ms (40));
+    coalescer.Notify ();
+    // Quiet period would end at 130ms, max latency at 100ms
+    CHECK (!coalescer.Poll ());
+    CHECK (coalescer.IsPending ());
+    CHECK (coalescer.GetDelay () == ms (20));
+    clock.Advance (ms (20));
+    CHECK (coalescer.Poll ());
+    CHECK (!coalescer.IsPending ());
+    CHECK (coalescer.GetDelay () == ms (0));
+
+    // Events after the flush start a new burst with a fresh maximum latency
+    clock.Advance (ms (5));
+    coalescer.Notify ();
+    CHECK (coalescer.IsPending ());
+    CHECK (coalescer.GetDelay () == ms (50));
+}
+
+TEST_CASE (DelayRoundsUp)
+{
+    FakeClock clock;
+    RefreshCoalescer coalescer (ms (50), ms (500), clock.Get ());
+    coalescer.Notify ();
+    clock.Advance (us (49500));
+    CHECK (coalescer.GetDelay () == ms (1));
+    CHECK (!coalescer.Poll ());
+    clock.Advance (us (500));
+    CHECK (coalescer.Poll ());
+}
+
+TEST_CASE (MaxLatencyNotBelowQuietPeriod)
+{
+    FakeClock clock;
+    RefreshCoalescer coalescer (ms (100), ms (10), clock.Get ());
+    coalescer.Notify ();
+    CHECK (coalescer.GetDelay () == ms (100));
+    clock.Advance (ms (99));
+    CHECK (!coalescer.Poll ());
+    clock.Advance (ms (1));
+    CHECK (coalescer.Poll ());
+}
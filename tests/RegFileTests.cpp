@@ -0,0 +1,308 @@
+/*
+This library is licensed under the zlib license.
+
+Copyright (C) 2016-2018 Frank Richter
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+claim that you wrote the original software. If you use this software
+in a product, an acknowledgment in the product documentation would be
+appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+
+Original source:
+https://github.com/res2k/Windows10Colors
+
+*/
+
+#include "TestHarness.h"
+
+#include "Windows10ColorsRegFile.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+using namespace windows10colors;
+
+namespace
+{
+    // Export file in a temporary location, removed on destruction
+    class TempRegFile
+    {
+    public:
+        TempRegFile ()
+        {
+            char pattern[] = "/tmp/w10c-regfile-XXXXXX";
+            int fd = mkstemp (pattern);
+            if (fd >= 0)
+            {
+                close (fd);
+                path = pattern;
+            }
+        }
+        ~TempRegFile ()
+        {
+            if (!path.empty ()) unlink (path.c_str ());
+        }
+
+        const char* GetPath () const { return path.c_str (); }
+
+        bool Write (const std::string& bytes)
+        {
+            FILE* file = fopen (path.c_str (), "wb");
+            if (!file) return false;
+            bool ok = fwrite (bytes.data (), 1, bytes.size (), file) == bytes.size ();
+            return (fclose (file) == 0) && ok;
+        }
+        /// Write text given as UTF-8 as UTF-16LE, with BOM, as regedit does
+        bool WriteUTF16 (const std::string& utf8) { return Write (ToUTF16LE (utf8)); }
+    private:
+        std::string path;
+
+        static std::string ToUTF16LE (const std::string& utf8)
+        {
+            std::string out ("\xff\xfe", 2);
+            for (size_t i = 0; i < utf8.size (); )
+            {
+                uint32_t c = static_cast<unsigned char> (utf8[i++]);
+                int extra = (c >= 0xf0) ? 3 : (c >= 0xe0) ? 2 : (c >= 0xc0) ? 1 : 0;
+                if (extra > 0) c &= 0x3f >> extra;
+                while ((extra-- > 0) && (i < utf8.size ())) c = (c << 6) | (utf8[i++] & 0x3f);
+                out.push_back (static_cast<char> (c & 0xff));
+                out.push_back (static_cast<char> (c >> 8));
+            }
+            return out;
+        }
+    };
+
+    const char exportText[] =
+        "Windows Registry Editor Version 5.00\r\n"
+        "\r\n"
+        "[HKEY_CURRENT_USER\\SOFTWARE\\Microsoft\\Windows\\DWM]\r\n"
+        "\"ColorizationColor\"=dword:c40078d7\r\n"
+        "\"ColorizationColorBalance\"=dword:00000059\r\n"
+        "\"AccentColor\"=dword:ffd77800\r\n"
+        "\"ColorPrevalence\"=dword:00000001\r\n"
+        "\"Composition\"=hex:01,00,\\\r\n"
+        "  00,00\r\n"
+        "\"Text\"=\"not a dword\"\r\n"
+        "\"Quoted \\\"name\\\"\"=dword:00000007\r\n"
+        "\"Back\\\\slash\"=dword:00000008\r\n"
+        "\"Gr\xc3\xbc\xc3\x9f\"=dword:00000009\r\n"
+        "@=dword:0000000a\r\n"
+        "\r\n"
+        "[HKEY_CURRENT_USER\\SOFTWARE\\Microsoft\\Windows\\CurrentVersion\\Themes\\Personalize]\r\n"
+        "\"ColorPrevalence\"=dword:00000000\r\n"
+        "\"AppsUseLightTheme\"=dword:00000001\r\n"
+        "\"SystemUsesLightTheme\"=dword:00000000\r\n";
+
+    const wchar_t dwmPath[] = L"HKEY_CURRENT_USER\\SOFTWARE\\Microsoft\\Windows\\DWM";
+
+    void CheckExport (RegFileSettingsStore& store)
+    {
+        CHECK (store.GetKeyCount () == 2);
+        uint32_t value = 0;
+        CHECK (store.QueryValue (dwmPath, L"ColorizationColor", value) == S_OK);
+        CHECK (value == 0xc40078d7);
+        // Names and paths are case-insensitive
+        CHECK (store.QueryValue (L"hkey_current_user\\software\\microsoft\\windows\\dwm", L"COLORIZATIONCOLORBALANCE",
+                                 value) == S_OK);
+        CHECK (value == 0x59);
+        CHECK (store.QueryValue (dwmPath, L"Quoted \"name\"", value) == S_OK);
+        CHECK (value == 7);
+        CHECK (store.QueryValue (dwmPath, L"Back\\slash", value) == S_OK);
+        CHECK (value == 8);
+        CHECK (store.QueryValue (dwmPath, L"Grüß", value) == S_OK);
+        CHECK (value == 9);
+        CHECK (store.QueryValue (dwmPath, L"", value) == S_OK);
+        CHECK (value == 10);
+        CHECK (store.QueryValue (dwmPath, L"Composition", value) == HRESULT_FROM_WIN32 (ERROR_UNSUPPORTED_TYPE));
+        CHECK (store.QueryValue (dwmPath, L"Text", value) == HRESULT_FROM_WIN32 (ERROR_UNSUPPORTED_TYPE));
+        CHECK (store.QueryValue (dwmPath, L"Missing", value) == HRESULT_FROM_WIN32 (ERROR_FILE_NOT_FOUND));
+        CHECK (store.QueryValue (L"HKEY_CURRENT_USER\\Missing", L"ColorizationColor", value)
+               == HRESULT_FROM_WIN32 (ERROR_FILE_NOT_FOUND));
+
+        // Through the SettingsStore interface, relative to the root key
+        ThemeSnapshot snapshot = ThemeSnapshot ();
+        ReadThemeSettings (store, snapshot);
+        CHECK (snapshot.dwmResult == S_OK);
+        CHECK (snapshot.dwmColors.ColorizationColorBalance == 0x59);
+        CHECK (snapshot.dwmColors.haveAccentColor && (snapshot.dwmColors.AccentColor == 0xffd77800));
+        CHECK (snapshot.appsUseLightThemeResult == S_OK && snapshot.appsUseLightTheme);
+        CHECK (snapshot.systemUsesLightThemeResult == S_OK && !snapshot.systemUsesLightTheme);
+    }
+
+    HRESULT QueryFrom (const std::string& text, const wchar_t* name, uint32_t& value)
+    {
+        TempRegFile file;
+        if (!file.Write (text)) return E_FAIL;
+        RegFileSettingsStore store;
+        HRESULT hr = store.Open (file.GetPath ());
+        if (FAILED (hr)) return hr;
+        return store.QueryValue (L"HKEY_CURRENT_USER\\Key", name, value);
+    }
+} // anonymous namespace
+
+TEST_CASE (UTF16WithBOM)
+{
+    TempRegFile file;
+    REQUIRE (file.WriteUTF16 (exportText));
+    RegFileSettingsStore store;
+    REQUIRE (store.Open (file.GetPath ()) == S_OK);
+    CheckExport (store);
+}
+
+TEST_CASE (UTF8)
+{
+    TempRegFile file;
+    REQUIRE (file.Write (exportText));
+    RegFileSettingsStore store;
+    REQUIRE (store.Open (file.GetPath ()) == S_OK);
+    CheckExport (store);
+
+    // With BOM, and LF line endings
+    std::string lf;
+    for (const char* p = exportText; *p; p++)
+    {
+        if (*p != '\r') lf.push_back (*p);
+    }
+    REQUIRE (file.Write ("\xef\xbb\xbf" + lf));
+    REQUIRE (store.Open (file.GetPath ()) == S_OK);
+    CheckExport (store);
+}
+
+TEST_CASE (DwordParsing)
+{
+    const struct
+    {
+        const char* data;
+        HRESULT result;
+        uint32_t value;
+    } cases[] = {
+        { "dword:00000000", S_OK, 0 },
+        { "dword:ffffffff", S_OK, 0xffffffff },
+        { "DWORD:0000ABcd", S_OK, 0xabcd },
+        { "dword:1", S_OK, 1 },
+        { "dword:00000002  ", S_OK, 2 },
+        { "dword:", HRESULT_FROM_WIN32 (ERROR_INVALID_DATA), 0 },
+        { "dword:123456789", HRESULT_FROM_WIN32 (ERROR_INVALID_DATA), 0 },
+        { "dword:0000000g", HRESULT_FROM_WIN32 (ERROR_INVALID_DATA), 0 },
+        { "dword:-1", HRESULT_FROM_WIN32 (ERROR_INVALID_DATA), 0 },
+        { "dwor", HRESULT_FROM_WIN32 (ERROR_UNSUPPORTED_TYPE), 0 },
+        { "qword:00000000", HRESULT_FROM_WIN32 (ERROR_UNSUPPORTED_TYPE), 0 },
+        { "hex(4):01,00,00,00", HRESULT_FROM_WIN32 (ERROR_UNSUPPORTED_TYPE), 0 },
+        { "-", HRESULT_FROM_WIN32 (ERROR_FILE_NOT_FOUND), 0 },
+    };
+    for (const auto& c : cases)
+    {
+        uint32_t value = 0xdeadbeef;
+        HRESULT hr = QueryFrom (std::string ("[HKEY_CURRENT_USER\\Key]\n\"V\"=") + c.data + "\n", L"V", value);
+        CHECK (hr == c.result);
+        if (SUCCEEDED (c.result)) CHECK (value == c.value);
+    }
+}
+
+TEST_CASE (DeletedValuesAndKeys)
+{
+    uint32_t value = 0;
+    // Deleted value
+    CHECK (QueryFrom ("[HKEY_CURRENT_USER\\Key]\n\"A\"=dword:1\n\"A\"=-\n", L"A", value)
+           == HRESULT_FROM_WIN32 (ERROR_FILE_NOT_FOUND));
+    // Re-added after deletion
+    CHECK (QueryFrom ("[HKEY_CURRENT_USER\\Key]\n\"A\"=-\n[HKEY_CURRENT_USER\\Key]\n\"A\"=dword:2\n", L"A", value)
+           == S_OK);
+    CHECK (value == 2);
+    // Deleted key: earlier values are gone, the key too
+    CHECK (QueryFrom ("[HKEY_CURRENT_USER\\Key]\n\"A\"=dword:1\n[-HKEY_CURRENT_USER\\Key]\n\"A\"=dword:3\n", L"A", value)
+           == HRESULT_FROM_WIN32 (ERROR_FILE_NOT_FOUND));
+    // Deleted and recreated key: only later values count
+    std::string recreated = "[HKEY_CURRENT_USER\\Key]\n\"A\"=dword:1\n\"B\"=dword:1\n"
+                            "[-HKEY_CURRENT_USER\\Key]\n[HKEY_CURRENT_USER\\Key]\n\"B\"=dword:4\n";
+    CHECK (QueryFrom (recreated, L"A", value) == HRESULT_FROM_WIN32 (ERROR_FILE_NOT_FOUND));
+    CHECK (QueryFrom (recreated, L"B", value) == S_OK);
+    CHECK (value == 4);
+}
+
+TEST_CASE (LaterDuplicateKeyWins)
+{
+    uint32_t value = 0;
+    CHECK (QueryFrom ("[HKEY_CURRENT_USER\\Key]\n\"A\"=dword:1\n\"B\"=dword:5\n"
+                      "[HKEY_CURRENT_USER\\key]\n\"A\"=dword:2\n", L"A", value) == S_OK);
+    CHECK (value == 2);
+    // Values not repeated come from the earlier occurrence
+    CHECK (QueryFrom ("[HKEY_CURRENT_USER\\Key]\n\"A\"=dword:1\n\"B\"=dword:5\n"
+                      "[HKEY_CURRENT_USER\\key]\n\"A\"=dword:2\n", L"B", value) == S_OK);
+    CHECK (value == 5);
+
+    // Many occurrences: the last one wins, regardless of hash table order
+    for (int occurrences : { 2, 16, 17, 40, 200 })
+    {
+        std::string text;
+        for (int i = 1; i <= occurrences; i++)
+        {
+            char line[64];
+            snprintf (line, sizeof (line), "[HKEY_CURRENT_USER\\Key]\n\"A\"=dword:%x\n", i);
+            text += line;
+            // Unrelated keys in between
+            snprintf (line, sizeof (line), "[HKEY_CURRENT_USER\\Other%d]\n\"A\"=dword:0\n", i);
+            text += line;
+        }
+        CHECK (QueryFrom (text, L"A", value) == S_OK);
+        CHECK (value == static_cast<uint32_t> (occurrences));
+    }
+}
+
+TEST_CASE (TruncatedFiles)
+{
+    TempRegFile file;
+    std::string utf8 (exportText);
+    // Every prefix of the file must parse without crashing
+    for (size_t length = 0; length <= utf8.size (); length += 7)
+    {
+        REQUIRE (file.Write (utf8.substr (0, length)));
+        RegFileSettingsStore store;
+        CHECK (store.Open (file.GetPath ()) == S_OK);
+        uint32_t value;
+        store.QueryValue (dwmPath, L"ColorizationColor", value);
+        store.QueryValue (dwmPath, L"Grüß", value);
+    }
+    // Cut within a value: not a complete dword
+    uint32_t value = 0;
+    CHECK (QueryFrom ("[HKEY_CURRENT_USER\\Key]\n\"A\"=dwo", L"A", value) == HRESULT_FROM_WIN32 (ERROR_UNSUPPORTED_TYPE));
+    CHECK (QueryFrom ("[HKEY_CURRENT_USER\\Key]\n\"A", L"A", value) == HRESULT_FROM_WIN32 (ERROR_FILE_NOT_FOUND));
+    CHECK (QueryFrom ("[HKEY_CURRENT_USER\\Ke", L"A", value) == HRESULT_FROM_WIN32 (ERROR_FILE_NOT_FOUND));
+    // Odd number of bytes in UTF-16, and an incomplete UTF-8 sequence
+    REQUIRE (file.Write (std::string ("\xff\xfe[\0H", 5)));
+    RegFileSettingsStore store;
+    CHECK (store.Open (file.GetPath ()) == S_OK);
+    CHECK (QueryFrom ("[HKEY_CURRENT_USER\\Key]\n\"A\xc3", L"A", value) == HRESULT_FROM_WIN32 (ERROR_FILE_NOT_FOUND));
+    // Empty file
+    CHECK (QueryFrom ("", L"A", value) == HRESULT_FROM_WIN32 (ERROR_FILE_NOT_FOUND));
+}
+
+TEST_CASE (MissingFile)
+{
+    RegFileSettingsStore store;
+    HRESULT hr = store.Open ("/nonexistent/w10c/export.reg");
+    CHECK (hr == MAKE_HRESULT (1, 0x7, ENOENT));
+    CHECK (hr == HRESULT_FROM_WIN32 (ERROR_FILE_NOT_FOUND));
+    CHECK (store.GetKeyCount () == 0);
+    uint32_t values[1];
+    HRESULT results[1];
+    const wchar_t* names[] = { L"ColorizationColor" };
+    CHECK (store.QueryValues (SettingsKey::DWM, 1, names, values, results) == HRESULT_FROM_WIN32 (ERROR_FILE_NOT_FOUND));
+}
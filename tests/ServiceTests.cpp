@@ -0,0 +1,276 @@
+/*
+This library is licensed under the zlib license.
+
+Copyright (C) 2016-2018 Frank Richter
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+claim that you wrote the original software. If you use this software
+in a product, an acknowledgment in the product documentation would be
+appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+
+Original source:
+https://github.com/res2k/Windows10Colors
+
+*/
+
+#include "TestHarness.h"
+
+#include "Windows10ColorsService.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace windows10colors;
+
+namespace
+{
+    // Gate blocking threads until opened
+    class Gate
+    {
+    public:
+        void Open ()
+        {
+            std::lock_guard<std::mutex> lock (mutex);
+            open = true;
+            changed.notify_all ();
+        }
+        bool Wait ()
+        {
+            std::unique_lock<std::mutex> lock (mutex);
+            return changed.wait_for (lock, std::chrono::seconds (5), [this]() { return open; });
+        }
+    private:
+        std::mutex mutex;
+        std::condition_variable changed;
+        bool open = false;
+    };
+
+    // Capture backend: numbers captures and records whether they ran on the service thread
+    struct FakeBackend
+    {
+        QueryService* service = nullptr;
+        std::atomic<unsigned long> captures;
+        std::atomic<unsigned long> offThreadCaptures;
+        // If set, captures wait for this gate; \c capturing is opened when one starts
+        Gate* release = nullptr;
+        Gate capturing;
+
+        FakeBackend () : captures (0), offThreadCaptures (0) {}
+
+        QueryService::CaptureFunction Get ()
+        {
+            return [this](ThemeSnapshot& snapshot) -> HRESULT
+            {
+                if (!service->IsServiceThread ()) offThreadCaptures++;
+                capturing.Open ();
+                if (release) release->Wait ();
+                snapshot = ThemeSnapshot ();
+                snapshot.dwmColors.ColorizationColor = static_cast<RGBA> (++captures);
+                return S_OK;
+            };
+        }
+    };
+
+    bool IsReady (const std::shared_future<SnapshotResult>& result)
+    {
+        return result.wait_for (std::chrono::seconds (5)) == std::future_status::ready;
+    }
+} // anonymous namespace
+
+TEST_CASE (QueryWhenNotRunningAborts)
+{
+    FakeBackend backend;
+    QueryService service (backend.Get ());
+    backend.service = &service;
+    CHECK (!service.IsRunning ());
+    CHECK (!service.IsServiceThread ());
+    auto result = service.Query ();
+    REQUIRE (IsReady (result));
+    CHECK (result.get ().result == E_ABORT);
+
+    CHECK (service.Start () == S_OK);
+    CHECK (service.Start () == S_FALSE);
+    service.Stop ();
+    result = service.Query ();
+    REQUIRE (IsReady (result));
+    CHECK (result.get ().result == E_ABORT);
+    CHECK (backend.captures == 0);
+}
+
+TEST_CASE (QueriesCapturedOnServiceThread)
+{
+    FakeBackend backend;
+    std::atomic<bool> hookOnServiceThread (false);
+    std::atomic<int> finishCalls (0);
+    ThreadHooks hooks;
+    QueryService* servicePtr = nullptr;
+    hooks.start = [&]() -> HRESULT
+    {
+        hookOnServiceThread = servicePtr->IsServiceThread ();
+        return S_OK;
+    };
+    hooks.finish = [&]() { finishCalls++; };
+    QueryService service (backend.Get (), hooks);
+    servicePtr = &service;
+    backend.service = &service;
+
+    REQUIRE (service.Start () == S_OK);
+    CHECK (hookOnServiceThread);
+    CHECK (service.IsRunning ());
+    CHECK (!service.IsServiceThread ());
+    for (unsigned long i = 1; i <= 5; i++)
+    {
+        auto result = service.Query ();
+        REQUIRE (IsReady (result));
+        CHECK (result.get ().result == S_OK);
+        CHECK (result.get ().snapshot.dwmColors.ColorizationColor == i);
+    }
+    CHECK (backend.offThreadCaptures == 0);
+    CHECK (service.GetCaptureCount () == 5);
+    service.Stop ();
+    CHECK (finishCalls == 1);
+    CHECK (!service.IsServiceThread ());
+}
+
+TEST_CASE (QueriesDuringCaptureAreBatched)
+{
+    FakeBackend backend;
+    Gate release;
+    backend.release = &release;
+    QueryService service (backend.Get ());
+    backend.service = &service;
+    REQUIRE (service.Start () == S_OK);
+
+    auto first = service.Query ();
+    REQUIRE (backend.capturing.Wait ());
+    // Issued while the first capture runs: all answered by one later capture
+    std::vector<std::shared_future<SnapshotResult>> batched;
+    std::vector<std::thread> threads;
+    std::mutex batchedMutex;
+    for (int t = 0; t < 8; t++)
+    {
+        threads.emplace_back ([&]()
+        {
+            auto result = service.Query ();
+            std::lock_guard<std::mutex> lock (batchedMutex);
+            batched.push_back (result);
+        });
+    }
+    for (auto& thread : threads) thread.join ();
+    release.Open ();
+
+    REQUIRE (IsReady (first));
+    CHECK (first.get ().snapshot.dwmColors.ColorizationColor == 1);
+    for (const auto& result : batched)
+    {
+        REQUIRE (IsReady (result));
+        CHECK (result.get ().result == S_OK);
+        CHECK (result.get ().snapshot.dwmColors.ColorizationColor == 2);
+    }
+    CHECK (service.GetQueryCount () == 9);
+    CHECK (service.GetCaptureCount () == 2);
+}
+
+TEST_CASE (QueryDuringStartupIsAnswered)
+{
+    FakeBackend backend;
+    Gate inHook, queried;
+    ThreadHooks hooks;
+    hooks.start = [&]() -> HRESULT
+    {
+        inHook.Open ();
+        queried.Wait ();
+        return S_OK;
+    };
+    QueryService service (backend.Get (), hooks);
+    backend.service = &service;
+
+    std::shared_future<SnapshotResult> result;
+    std::thread client ([&]()
+    {
+        inHook.Wait ();
+        result = service.Query ();
+        queried.Open ();
+    });
+    CHECK (service.Start () == S_OK);
+    client.join ();
+    REQUIRE (IsReady (result));
+    CHECK (result.get ().result == S_OK);
+    CHECK (backend.captures == 1);
+}
+
+TEST_CASE (FailedStartAbortsQueries)
+{
+    FakeBackend backend;
+    Gate inHook, queried;
+    std::atomic<int> finishCalls (0);
+    ThreadHooks hooks;
+    hooks.start = [&]() -> HRESULT
+    {
+        inHook.Open ();
+        queried.Wait ();
+        return E_FAIL;
+    };
+    hooks.finish = [&]() { finishCalls++; };
+    QueryService service (backend.Get (), hooks);
+    backend.service = &service;
+
+    std::shared_future<SnapshotResult> result;
+    std::thread client ([&]()
+    {
+        inHook.Wait ();
+        result = service.Query ();
+        queried.Open ();
+    });
+    CHECK (service.Start () == E_FAIL);
+    client.join ();
+    CHECK (!service.IsRunning ());
+    CHECK (!service.IsServiceThread ());
+    REQUIRE (IsReady (result));
+    CHECK (result.get ().result == E_ABORT);
+    CHECK (backend.captures == 0);
+    CHECK (finishCalls == 0);
+}
+
+TEST_CASE (IsServiceThreadDuringStartStop)
+{
+    FakeBackend backend;
+    QueryService service (backend.Get ());
+    backend.service = &service;
+    std::atomic<bool> done (false);
+    std::atomic<int> falsePositives (0);
+    // Polled concurrently with Start() and Stop(); must never be true off the service thread
+    std::thread poller ([&]()
+    {
+        while (!done)
+        {
+            if (service.IsServiceThread ()) falsePositives++;
+        }
+    });
+    for (int i = 0; i < 50; i++)
+    {
+        CHECK (service.Start () == S_OK);
+        auto result = service.Query ();
+        CHECK (IsReady (result));
+        service.Stop ();
+    }
+    done = true;
+    poller.join ();
+    CHECK (falsePositives == 0);
+    CHECK (backend.offThreadCaptures == 0);
+}
@@ -0,0 +1,214 @@
+/*
+This library is licensed under the zlib license.
+
+Copyright (C) 2016-2018 Frank Richter
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+claim that you wrote the original software. If you use this software
+in a product, an acknowledgment in the product documentation would be
+appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+
+Original source:
+https://github.com/res2k/Windows10Colors
+
+*/
+
+#include "TestHarness.h"
+
+#include "Windows10ColorsFileSettings.h"
+#include "Windows10ColorsWatcher.h"
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace windows10colors;
+
+namespace
+{
+    // Temporary directory holding settings files, removed on destruction
+    class TempSettingsDir
+    {
+    public:
+        TempSettingsDir ()
+        {
+            char pattern[] = "/tmp/w10c-settings-XXXXXX";
+            if (mkdtemp (pattern)) path = pattern;
+        }
+        ~TempSettingsDir ()
+        {
+            if (path.empty ()) return;
+            for (const char* name : { "DWM", "Personalize", "Other" })
+            {
+                unlink ((path + "/" + name).c_str ());
+            }
+            rmdir (path.c_str ());
+        }
+
+        bool IsValid () const { return !path.empty (); }
+        const std::string& GetPath () const { return path; }
+
+        bool Write (const char* name, const char* contents)
+        {
+            FILE* file = fopen ((path + "/" + name).c_str (), "w");
+            if (!file) return false;
+            fputs (contents, file);
+            return fclose (file) == 0;
+        }
+    private:
+        std::string path;
+    };
+
+    // Wait until a condition holds, giving up after a while
+    template<typename Condition>
+    bool WaitFor (Condition condition)
+    {
+        auto deadline = std::chrono::steady_clock::now () + std::chrono::seconds (5);
+        while (!condition ())
+        {
+            if (std::chrono::steady_clock::now () > deadline) return false;
+            std::this_thread::sleep_for (std::chrono::milliseconds (1));
+        }
+        return true;
+    }
+
+    const char dwmContents[] =
+        "ColorizationColor=0xc40078d7\n"
+        "ColorizationColorBalance=89\n"
+        "AccentColor=0xffd77800\n"
+        "ColorPrevalence=1\n";
+    const char personalizeContents[] =
+        "ColorPrevalence=0\n"
+        "AppsUseLightTheme=1\n"
+        "SystemUsesLightTheme=0\n";
+} // anonymous namespace
+
+TEST_CASE (QueryValues)
+{
+    TempSettingsDir dir;
+    REQUIRE (dir.IsValid ());
+    REQUIRE (dir.Write ("DWM", "colorizationcolor = 0x12345678\nColorizationColorBalance=89\r\n"
+                               "AccentColor=bogus\nNoEquals\nHuge=0x100000000\n"));
+    FileSettingsStore store (dir.GetPath ());
+
+    const wchar_t* const names[] = { L"ColorizationColor", L"ColorizationColorBalance", L"AccentColor",
+                                     L"Huge", L"Missing" };
+    uint32_t values[5] = {};
+    HRESULT results[5];
+    CHECK (store.QueryValues (SettingsKey::DWM, 5, names, values, results) == S_OK);
+    // Names are matched exactly (apart from case), so "colorizationcolor " doesn't match
+    CHECK (results[0] == HRESULT_FROM_WIN32 (ERROR_FILE_NOT_FOUND));
+    CHECK (results[1] == S_OK);
+    CHECK (values[1] == 89);
+    CHECK (results[2] == HRESULT_FROM_WIN32 (ERROR_INVALID_DATA));
+    CHECK (results[3] == HRESULT_FROM_WIN32 (ERROR_INVALID_DATA));
+    CHECK (results[4] == HRESULT_FROM_WIN32 (ERROR_FILE_NOT_FOUND));
+
+    REQUIRE (dir.Write ("DWM", "colorizationCOLOR=0x12345678\n"));
+    CHECK (store.QueryValues (SettingsKey::DWM, 1, names, values, results) == S_OK);
+    CHECK (results[0] == S_OK);
+    CHECK (values[0] == 0x12345678);
+
+    // Missing key file
+    CHECK (store.QueryValues (SettingsKey::Personalize, 1, names, values, results)
+           == HRESULT_FROM_WIN32 (ERROR_FILE_NOT_FOUND));
+}
+
+TEST_CASE (ReadThemeSettingsFromFiles)
+{
+    TempSettingsDir dir;
+    REQUIRE (dir.IsValid ());
+    REQUIRE (dir.Write ("DWM", dwmContents));
+    REQUIRE (dir.Write ("Personalize", personalizeContents));
+    FileSettingsStore store (dir.GetPath ());
+
+    ThemeSnapshot snapshot = ThemeSnapshot ();
+    ReadThemeSettings (store, snapshot);
+    CHECK (snapshot.dwmResult == S_OK);
+    // ColorizationColor is stored as BGRA
+    CHECK (snapshot.dwmColors.ColorizationColor == MakeRGBA (0x00, 0x78, 0xd7, 0xc4));
+    CHECK (snapshot.dwmColors.ColorizationColorBalance == 89);
+    CHECK (snapshot.dwmColors.haveAccentColor);
+    CHECK (snapshot.dwmColors.AccentColor == 0xffd77800);
+    CHECK (snapshot.haveDwmColorPrevalence && snapshot.dwmColorPrevalence);
+    CHECK (snapshot.personalizeColorPrevalenceResult == S_OK && !snapshot.personalizeColorPrevalence);
+    CHECK (snapshot.appsUseLightThemeResult == S_OK && snapshot.appsUseLightTheme);
+    CHECK (snapshot.systemUsesLightThemeResult == S_OK && !snapshot.systemUsesLightTheme);
+}
+
+#if defined(__linux__)
+TEST_CASE (StopWaitingWakesWaiter)
+{
+    TempSettingsDir dir;
+    REQUIRE (dir.IsValid ());
+    FileSettingsStore store (dir.GetPath ());
+    REQUIRE (store.StartWatching () == S_OK);
+    std::thread stopper ([&]()
+    {
+        std::this_thread::sleep_for (std::chrono::milliseconds (10));
+        store.StopWaiting ();
+    });
+    CHECK (store.WaitForChange () == S_FALSE);
+    stopper.join ();
+    // Further waits return immediately
+    CHECK (store.WaitForChange () == S_FALSE);
+}
+
+TEST_CASE (WatcherInvalidatesOnRelevantChanges)
+{
+    TempSettingsDir dir;
+    REQUIRE (dir.IsValid ());
+    REQUIRE (dir.Write ("DWM", dwmContents));
+    REQUIRE (dir.Write ("Personalize", personalizeContents));
+    FileSettingsStore store (dir.GetPath ());
+    ThemeCache cache ([&](ThemeSnapshot& snapshot) -> HRESULT
+    {
+        snapshot = ThemeSnapshot ();
+        ReadThemeSettings (store, snapshot);
+        return S_OK;
+    });
+    ThemeState state;
+    cache.Read (state);
+    uint64_t initialGeneration = cache.GetGeneration ();
+
+    ThemeWatcher watcher (store, cache);
+    REQUIRE (watcher.Start () == S_OK);
+    CHECK (watcher.Start () == S_FALSE);
+
+    // Files not backing a key are ignored
+    REQUIRE (dir.Write ("Other", "ColorizationColor=0\n"));
+    // Rewriting a key file with a setting not affecting the theme is reported, but doesn't invalidate
+    REQUIRE (dir.Write ("DWM", (std::string (dwmContents) + "Unrelated=1\n").c_str ()));
+    CHECK (WaitFor ([&]() { return watcher.GetChangeNotifications () >= 1; }));
+    CHECK (watcher.GetChangeNotifications () == 1);
+    CHECK (watcher.GetInvalidations () == 0);
+    CHECK (cache.GetGeneration () == initialGeneration);
+
+    // Changing a theme setting invalidates the cache
+    REQUIRE (dir.Write ("Personalize", "ColorPrevalence=0\nAppsUseLightTheme=0\nSystemUsesLightTheme=0\n"));
+    CHECK (WaitFor ([&]() { return watcher.GetInvalidations () >= 1; }));
+    CHECK (watcher.GetInvalidations () == 1);
+    CHECK (cache.GetGeneration () > initialGeneration);
+
+    watcher.Stop ();
+    unsigned long notifications = watcher.GetChangeNotifications ();
+    REQUIRE (dir.Write ("DWM", dwmContents));
+    std::this_thread::sleep_for (std::chrono::milliseconds (20));
+    CHECK (watcher.GetChangeNotifications () == notifications);
+}
+#endif // defined(__linux__)
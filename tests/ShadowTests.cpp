@@ -0,0 +1,125 @@
+/*
+This library is licensed under the zlib license.
+
+Copyright (C) 2016-2018 Frank Richter
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+claim that you wrote the original software. If you use this software
+in a product, an acknowledgment in the product documentation would be
+appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+
+Original source:
+https://github.com/res2k/Windows10Colors
+
+*/
+
+#include "TestHarness.h"
+
+#include "DropShadow.h"
+
+namespace
+{
+    uint8_t AlphaAt (const ShadowImage& image, int x, int y)
+    {
+        return static_cast<uint8_t> (image.pixels[static_cast<size_t> (y) * image.width + x] >> 24);
+    }
+
+    bool AllAlpha (const ShadowImage& image, uint8_t alpha)
+    {
+        for (uint32_t pixel : image.pixels)
+        {
+            if ((pixel >> 24) != alpha) return false;
+        }
+        return true;
+    }
+} // anonymous namespace
+
+TEST_CASE (ShadowShape)
+{
+    ShadowImage image;
+    GenerateShadow (ShadowKey { 100, 60, 4, 8, 0x80123456 }, image);
+    CHECK (image.width == 116);
+    CHECK (image.height == 76);
+    REQUIRE (image.pixels.size () == 116u * 76u);
+    // Solid in the middle, faded out at the corners, color unchanged
+    CHECK (AlphaAt (image, 58, 38) == 0x80);
+    CHECK (AlphaAt (image, 0, 0) == 0);
+    CHECK (AlphaAt (image, 115, 75) == 0);
+    CHECK ((image.pixels[58 + 38 * 116] & 0xffffff) == 0x123456);
+    // Symmetric
+    for (int x = 0; x < image.width; x++)
+    {
+        CHECK (AlphaAt (image, x, 38) == AlphaAt (image, image.width - 1 - x, 38));
+    }
+}
+
+TEST_CASE (ShadowInsetLargerThanRectangle)
+{
+    // Inset exceeds half the width: no solid part at all
+    ShadowImage image;
+    GenerateShadow (ShadowKey { 10, 100, 8, 4, 0xff000000 }, image);
+    CHECK (image.width == 18);
+    CHECK (image.height == 108);
+    CHECK (AllAlpha (image, 0));
+
+    GenerateShadow (ShadowKey { 20, 20, 50, 0, 0xff000000 }, image);
+    CHECK (image.width == 20);
+    CHECK (AllAlpha (image, 0));
+}
+
+TEST_CASE (ShadowNegativeInset)
+{
+    // Solid part extends beyond the image: clipped, so the whole image is covered
+    ShadowImage image;
+    GenerateShadow (ShadowKey { 20, 30, -10, 0, 0xc0000000 }, image);
+    CHECK (image.width == 20);
+    CHECK (image.height == 30);
+    CHECK (AllAlpha (image, 0xc0));
+
+    GenerateShadow (ShadowKey { 20, 30, -100, 3, 0xff000000 }, image);
+    CHECK (image.width == 26);
+    CHECK (image.height == 36);
+    CHECK (AlphaAt (image, 13, 18) == 0xff);
+}
+
+TEST_CASE (ShadowEmptyRectangle)
+{
+    ShadowImage image;
+    GenerateShadow (ShadowKey { 0, 0, 0, 4, 0xff000000 }, image);
+    CHECK (image.width == 8);
+    CHECK (image.height == 8);
+    CHECK (AllAlpha (image, 0));
+
+    GenerateShadow (ShadowKey { -5, 10, 0, 0, 0xff000000 }, image);
+    CHECK (image.width == 0);
+    CHECK (image.pixels.empty ());
+}
+
+TEST_CASE (ShadowCacheHits)
+{
+    ShadowCache cache;
+    const ShadowKey a { 100, 60, 4, 8, 0x80000000 };
+    const ShadowKey b { 100, 60, 4, 8, 0x40000000 };
+    const ShadowImage* first = &cache.Get (a);
+    CHECK (&cache.Get (a) == first);
+    cache.Get (b);
+    cache.Get (b);
+    CHECK (cache.GetSize () == 2);
+    CHECK (cache.GetMisses () == 2);
+    CHECK (cache.GetHits () == 2);
+    cache.Clear ();
+    CHECK (cache.GetSize () == 0);
+    cache.Get (a);
+    CHECK (cache.GetMisses () == 3);
+}
@@ -0,0 +1,302 @@
+/*
+This library is licensed under the zlib license.
+
+Copyright (C) 2016-2018 Frank Richter
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+claim that you wrote the original software. If you use this software
+in a product, an acknowledgment in the product documentation would be
+appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+
+Original source:
+https://github.com/res2k/Windows10Colors
+
+*/
+
+#include "TestHarness.h"
+
+#include "Windows10ColorsShared.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+using namespace windows10colors;
+
+namespace
+{
+    // Path for a segment file, removed on destruction
+    class TempSegment
+    {
+    public:
+        TempSegment ()
+        {
+            char pattern[] = "/tmp/w10c-shared-XXXXXX";
+            int fd = mkstemp (pattern);
+            if (fd >= 0)
+            {
+                close (fd);
+                // Segments start out missing
+                unlink (pattern);
+                path = pattern;
+            }
+        }
+        ~TempSegment ()
+        {
+            if (!path.empty ()) unlink (path.c_str ());
+        }
+
+        const char* GetPath () const { return path.c_str (); }
+
+        /// Overwrite a header word of the segment
+        bool PatchWord (size_t index, uint32_t value)
+        {
+            FILE* file = fopen (path.c_str (), "r+b");
+            if (!file) return false;
+            bool ok = (fseek (file, static_cast<long> (index * sizeof (value)), SEEK_SET) == 0)
+                && (fwrite (&value, sizeof (value), 1, file) == 1);
+            return (fclose (file) == 0) && ok;
+        }
+        bool Truncate (size_t size)
+        {
+            return truncate (path.c_str (), static_cast<off_t> (size)) == 0;
+        }
+    private:
+        std::string path;
+    };
+
+    // Header words, as laid out by SharedThemeSnapshot
+    enum { wordMagic, wordVersion, wordPayloadSize, wordSequence };
+
+    // Snapshot with all fields derived from a number, so torn copies can be detected
+    ThemeSnapshot MakeSnapshot (uint32_t n)
+    {
+        ThemeSnapshot snapshot = ThemeSnapshot ();
+        snapshot.osVersion = { 10, 0, n };
+        snapshot.highContrast = (n & 1) != 0;
+        snapshot.sysColors.activeCaption = n * 3;
+        snapshot.sysColors.captionText = n * 5;
+        snapshot.sysColors.inactiveCaption = n * 7;
+        snapshot.sysColors.inactiveCaptionText = n * 11;
+        snapshot.sysColors.highlight = n * 13;
+        snapshot.uiSettingsResult = (n & 2) ? S_OK : E_NOTIMPL;
+        snapshot.uiSettingsAccent.accent = n ^ 0xff000000;
+        snapshot.uiSettingsAccent.darkest = n ^ 0xff000001;
+        snapshot.uiSettingsAccent.darker = n ^ 0xff000002;
+        snapshot.uiSettingsAccent.dark = n ^ 0xff000003;
+        snapshot.uiSettingsAccent.light = n ^ 0xff000004;
+        snapshot.uiSettingsAccent.lighter = n ^ 0xff000005;
+        snapshot.uiSettingsAccent.lightest = n ^ 0xff000006;
+        snapshot.dwmResult = (n & 4) ? S_OK : E_FAIL;
+        snapshot.dwmColors.ColorizationColor = n * 17;
+        snapshot.dwmColors.ColorizationColorBalance = static_cast<int> (n % 101);
+        snapshot.dwmColors.haveAccentColor = (n & 8) != 0;
+        snapshot.dwmColors.AccentColor = n * 19;
+        snapshot.haveDwmColorPrevalence = (n & 16) != 0;
+        snapshot.dwmColorPrevalence = (n & 32) != 0;
+        snapshot.personalizeColorPrevalenceResult = (n & 64) ? S_OK : E_FAIL;
+        snapshot.personalizeColorPrevalence = (n & 128) != 0;
+        snapshot.appsUseLightThemeResult = (n & 256) ? S_OK : E_FAIL;
+        snapshot.appsUseLightTheme = (n & 512) != 0;
+        snapshot.systemUsesLightThemeResult = (n & 1024) ? S_OK : E_FAIL;
+        snapshot.systemUsesLightTheme = (n & 2048) != 0;
+        snapshot.systemCalls = n * 23;
+        return snapshot;
+    }
+
+    bool SameSnapshot (const ThemeSnapshot& a, const ThemeSnapshot& b)
+    {
+        uint32_t wordsA[packedThemeSnapshotWords];
+        uint32_t wordsB[packedThemeSnapshotWords];
+        PackThemeSnapshot (a, wordsA);
+        PackThemeSnapshot (b, wordsB);
+        return memcmp (wordsA, wordsB, sizeof (wordsA)) == 0;
+    }
+} // anonymous namespace
+
+TEST_CASE (PackRoundTrip)
+{
+    for (uint32_t n : { 0u, 1u, 0x5a5u, 0xfffu, 0xffffffffu })
+    {
+        uint32_t words[packedThemeSnapshotWords];
+        PackThemeSnapshot (MakeSnapshot (n), words);
+        ThemeSnapshot unpacked;
+        UnpackThemeSnapshot (words, unpacked);
+        CHECK (SameSnapshot (unpacked, MakeSnapshot (n)));
+        CHECK (unpacked.osVersion.build == n);
+        CHECK (unpacked.uiSettingsResult == MakeSnapshot (n).uiSettingsResult);
+        CHECK (unpacked.dwmColors.ColorizationColorBalance == MakeSnapshot (n).dwmColors.ColorizationColorBalance);
+    }
+}
+
+TEST_CASE (WriteThenRead)
+{
+    TempSegment segment;
+    SharedThemeSnapshot publisher;
+    REQUIRE (publisher.Create (segment.GetPath ()) == S_OK);
+    CHECK (publisher.IsOpen () && publisher.IsWritable ());
+
+    SharedThemeSnapshot reader;
+    REQUIRE (reader.Open (segment.GetPath ()) == S_OK);
+    CHECK (reader.IsOpen () && !reader.IsWritable ());
+    CHECK (reader.Write (MakeSnapshot (1)) == E_FAIL);
+
+    ThemeSnapshot snapshot;
+    for (uint32_t n : { 42u, 43u, 0x12345u })
+    {
+        uint32_t sequence = reader.GetSequence ();
+        REQUIRE (publisher.Write (MakeSnapshot (n)) == S_OK);
+        CHECK (reader.GetSequence () != sequence);
+        CHECK (reader.GetSequence () != 0);
+        REQUIRE (reader.Read (snapshot) == S_OK);
+        CHECK (SameSnapshot (snapshot, MakeSnapshot (n)));
+    }
+
+    // Reopening keeps the published snapshot
+    SharedThemeSnapshot republisher;
+    REQUIRE (republisher.Create (segment.GetPath ()) == S_OK);
+    REQUIRE (republisher.Read (snapshot) == S_OK);
+    CHECK (SameSnapshot (snapshot, MakeSnapshot (0x12345)));
+
+    reader.Close ();
+    CHECK (!reader.IsOpen ());
+    CHECK (reader.Read (snapshot) == E_FAIL);
+    CHECK (reader.GetSequence () == 0);
+}
+
+TEST_CASE (PendingBeforeFirstPublish)
+{
+    TempSegment segment;
+    SharedThemeSnapshot publisher;
+    REQUIRE (publisher.Create (segment.GetPath ()) == S_OK);
+    SharedThemeSnapshot reader;
+    REQUIRE (reader.Open (segment.GetPath ()) == S_OK);
+
+    ThemeSnapshot snapshot = MakeSnapshot (7);
+    CHECK (reader.GetSequence () == 0);
+    CHECK (reader.Read (snapshot) == E_PENDING);
+    CHECK (publisher.Read (snapshot) == E_PENDING);
+    // Not touched
+    CHECK (SameSnapshot (snapshot, MakeSnapshot (7)));
+}
+
+TEST_CASE (MissingSegment)
+{
+    TempSegment segment;
+    SharedThemeSnapshot reader;
+    CHECK (reader.Open (segment.GetPath ()) == HRESULT_FROM_WIN32 (ERROR_FILE_NOT_FOUND));
+    CHECK (!reader.IsOpen ());
+}
+
+TEST_CASE (IncompatibleSegment)
+{
+    TempSegment segment;
+    {
+        SharedThemeSnapshot publisher;
+        REQUIRE (publisher.Create (segment.GetPath ()) == S_OK);
+        REQUIRE (publisher.Write (MakeSnapshot (5)) == S_OK);
+    }
+
+    const struct
+    {
+        size_t word;
+        uint32_t value;
+    } patches[] = {
+        { wordMagic, 0x12345678 },
+        { wordVersion, SharedThemeSnapshot::layoutVersion + 1 },
+        { wordPayloadSize, packedThemeSnapshotWords - 1 },
+        { wordPayloadSize, packedThemeSnapshotWords + 1 },
+    };
+    for (const auto& patch : patches)
+    {
+        SharedThemeSnapshot good;
+        REQUIRE (good.Create (segment.GetPath ()) == S_OK);
+        REQUIRE (good.Write (MakeSnapshot (5)) == S_OK);
+        good.Close ();
+
+        REQUIRE (segment.PatchWord (patch.word, patch.value));
+        SharedThemeSnapshot reader;
+        CHECK (reader.Open (segment.GetPath ()) == HRESULT_FROM_WIN32 (ERROR_INVALID_DATA));
+        CHECK (!reader.IsOpen ());
+
+        // The publisher reinitializes the segment
+        SharedThemeSnapshot publisher;
+        REQUIRE (publisher.Create (segment.GetPath ()) == S_OK);
+        ThemeSnapshot snapshot;
+        CHECK (publisher.Read (snapshot) == E_PENDING);
+        CHECK (reader.Open (segment.GetPath ()) == S_OK);
+    }
+
+    // Segment smaller than the layout
+    REQUIRE (segment.Truncate (4 * sizeof (uint32_t)));
+    SharedThemeSnapshot reader;
+    CHECK (reader.Open (segment.GetPath ()) == HRESULT_FROM_WIN32 (ERROR_INVALID_DATA));
+    SharedThemeSnapshot publisher;
+    CHECK (publisher.Create (segment.GetPath ()) == S_OK);
+    CHECK (reader.Open (segment.GetPath ()) == S_OK);
+}
+
+TEST_CASE (ConcurrentWriteAndRead)
+{
+    TempSegment segment;
+    SharedThemeSnapshot publisher;
+    REQUIRE (publisher.Create (segment.GetPath ()) == S_OK);
+    REQUIRE (publisher.Write (MakeSnapshot (1)) == S_OK);
+    SharedThemeSnapshot reader;
+    REQUIRE (reader.Open (segment.GetPath ()) == S_OK);
+
+    // Keep writing and reading until both sides did enough work to overlap
+    const int readsWanted = 20000;
+    const uint32_t writesWanted = 20000;
+    std::atomic<bool> stop (false);
+    std::atomic<uint32_t> written (1);
+    std::thread writer ([&]()
+    {
+        for (uint32_t n = 2; !stop; n++)
+        {
+            publisher.Write (MakeSnapshot (n));
+            written = n;
+        }
+    });
+
+    int reads = 0;
+    int torn = 0;
+    uint32_t last = 0;
+    bool ordered = true;
+    while ((reads < readsWanted) || (written < writesWanted))
+    {
+        ThemeSnapshot snapshot;
+        HRESULT hr = reader.Read (snapshot);
+        if (hr == E_PENDING) continue; // Writer kept interfering
+        CHECK (hr == S_OK);
+        uint32_t n = snapshot.osVersion.build;
+        if (!SameSnapshot (snapshot, MakeSnapshot (n))) torn++;
+        if (n < last) ordered = false;
+        last = n;
+        reads++;
+    }
+    stop = true;
+    writer.join ();
+
+    CHECK (torn == 0);
+    CHECK (ordered);
+    ThemeSnapshot snapshot;
+    REQUIRE (reader.Read (snapshot) == S_OK);
+    CHECK (SameSnapshot (snapshot, MakeSnapshot (written)));
+}
@@ -0,0 +1,73 @@
+/*
+This library is licensed under the zlib license.
+
+Copyright (C) 2016-2018 Frank Richter
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+claim that you wrote the original software. If you use this software
+in a product, an acknowledgment in the product documentation would be
+appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+
+Original source:
+https://github.com/res2k/Windows10Colors
+
+*/
+#ifndef __TESTHARNESS_H__
+#define __TESTHARNESS_H__
+
+/**\file
+ * Minimal unit test harness.
+ * Test cases are defined with TEST_CASE() and run by TestMain.cpp.
+ * A failed CHECK() is reported, but the test case continues.
+ */
+
+namespace test
+{
+    typedef void (*TestFunction) ();
+
+    /// Registers a test case on construction
+    struct Registration
+    {
+        Registration (const char* name, TestFunction function);
+    };
+
+    /// Report a failed check. Safe to call from any thread.
+    void ReportFailure (const char* file, int line, const char* expression);
+} // namespace test
+
+/// Define a test case
+#define TEST_CASE(Name)                                                 \
+    static void Name ();                                                \
+    static test::Registration Name##_registration (#Name, &Name);       \
+    static void Name ()
+
+/// Check a condition; report a failure if it doesn't hold
+#define CHECK(Expr)                                                     \
+    do                                                                  \
+    {                                                                   \
+        if (!(Expr)) test::ReportFailure (__FILE__, __LINE__, #Expr);   \
+    } while (0)
+
+/// Check a condition; report a failure and leave the test case if it doesn't hold
+#define REQUIRE(Expr)                                                   \
+    do                                                                  \
+    {                                                                   \
+        if (!(Expr))                                                    \
+        {                                                               \
+            test::ReportFailure (__FILE__, __LINE__, #Expr);            \
+            return;                                                     \
+        }                                                               \
+    } while (0)
+
+#endif // __TESTHARNESS_H__
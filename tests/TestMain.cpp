@@ -0,0 +1,95 @@
+/*
+This library is licensed under the zlib license.
+
+Copyright (C) 2016-2018 Frank Richter
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+claim that you wrote the original software. If you use this software
+in a product, an acknowledgment in the product documentation would be
+appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+
+Original source:
+https://github.com/res2k/Windows10Colors
+
+*/
+
+#include "TestHarness.h"
+
+#include <atomic>
+#include <mutex>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+namespace test
+{
+    namespace
+    {
+        struct TestCase
+        {
+            const char* name;
+            TestFunction function;
+        };
+
+        // Function-local, as registrations run during static initialization
+        std::vector<TestCase>& GetTestCases ()
+        {
+            static std::vector<TestCase> testCases;
+            return testCases;
+        }
+
+        std::mutex reportMutex;
+        std::atomic<unsigned int> failureCount (0);
+    } // anonymous namespace
+
+    Registration::Registration (const char* name, TestFunction function)
+    {
+        GetTestCases ().push_back (TestCase { name, function });
+    }
+
+    void ReportFailure (const char* file, int line, const char* expression)
+    {
+        std::lock_guard<std::mutex> lock (reportMutex);
+        fprintf (stderr, "%s:%d: check failed: %s\n", file, line, expression);
+        failureCount++;
+    }
+} // namespace test
+
+/* Runs all test cases, or those whose names are given on the command line.
+ * Returns non-zero if any check failed. */
+int main (int argc, char* argv[])
+{
+    unsigned int failedCases = 0;
+    unsigned int runCases = 0;
+    for (const auto& testCase : test::GetTestCases ())
+    {
+        bool selected = argc < 2;
+        for (int i = 1; i < argc; i++)
+        {
+            if (strcmp (argv[i], testCase.name) == 0) selected = true;
+        }
+        if (!selected) continue;
+
+        printf ("[ RUN  ] %s\n", testCase.name);
+        fflush (stdout);
+        unsigned int failuresBefore = test::failureCount;
+        testCase.function ();
+        bool passed = test::failureCount == failuresBefore;
+        printf ("[ %s ] %s\n", passed ? " OK " : "FAIL", testCase.name);
+        runCases++;
+        if (!passed) failedCases++;
+    }
+    printf ("%u of %u test cases passed\n", runCases - failedCases, runCases);
+    return failedCases == 0 ? 0 : 1;
+}
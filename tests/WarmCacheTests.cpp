@@ -0,0 +1,189 @@
+/*
+This library is licensed under the zlib license.
+
+Copyright (C) 2016-2018 Frank Richter
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+claim that you wrote the original software. If you use this software
+in a product, an acknowledgment in the product documentation would be
+appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+
+Original source:
+https://github.com/res2k/Windows10Colors
+
+*/
+
+#include "TestHarness.h"
+
+#include "Windows10ColorsShared.h"
+#include "Windows10ColorsWarmCache.h"
+
+#include <string.h>
+
+#include <vector>
+
+using namespace windows10colors;
+
+namespace
+{
+    const OSVersion osVersion = { 10, 0, 19045 };
+    const HRESULT invalidData = HRESULT_FROM_WIN32 (ERROR_INVALID_DATA);
+
+    // Header words, as laid out by SerializeWarmCache()
+    enum { wordMagic, wordVersion, wordOSMajor, wordOSMinor, wordOSBuild, wordPayloadSize, wordPayload };
+
+    ThemeSnapshot MakeSnapshot ()
+    {
+        ThemeSnapshot snapshot = ThemeSnapshot ();
+        snapshot.osVersion = osVersion;
+        snapshot.sysColors.activeCaption = MakeRGBA (0x99, 0xb4, 0xd1, 0xff);
+        snapshot.uiSettingsResult = S_OK;
+        GenerateAccentColors (0xffd77800, snapshot.uiSettingsAccent);
+        snapshot.dwmResult = S_OK;
+        snapshot.dwmColors.ColorizationColor = 0xc4d77800;
+        snapshot.dwmColors.ColorizationColorBalance = 89;
+        snapshot.dwmColors.haveAccentColor = true;
+        snapshot.dwmColors.AccentColor = 0xffd77800;
+        snapshot.haveDwmColorPrevalence = true;
+        snapshot.dwmColorPrevalence = true;
+        snapshot.personalizeColorPrevalenceResult = E_FAIL;
+        snapshot.appsUseLightThemeResult = S_OK;
+        snapshot.appsUseLightTheme = false;
+        snapshot.systemUsesLightThemeResult = S_OK;
+        snapshot.systemUsesLightTheme = true;
+        snapshot.systemCalls = 12;
+        return snapshot;
+    }
+
+    bool SameSnapshot (const ThemeSnapshot& a, const ThemeSnapshot& b)
+    {
+        uint32_t wordsA[packedThemeSnapshotWords];
+        uint32_t wordsB[packedThemeSnapshotWords];
+        PackThemeSnapshot (a, wordsA);
+        PackThemeSnapshot (b, wordsB);
+        return memcmp (wordsA, wordsB, sizeof (wordsA)) == 0;
+    }
+
+    void PutWord (std::vector<unsigned char>& data, size_t index, uint32_t w)
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            data[index * 4 + i] = static_cast<unsigned char> (w >> (i * 8));
+        }
+    }
+
+    // Recompute the trailing checksum (32-bit FNV-1a), so only the modified field is wrong
+    void FixChecksum (std::vector<unsigned char>& data)
+    {
+        uint32_t hash = 0x811c9dc5;
+        for (size_t i = 0; i + 4 < data.size (); i++)
+        {
+            hash = (hash ^ data[i]) * 0x01000193;
+        }
+        PutWord (data, data.size () / 4 - 1, hash);
+    }
+
+    // Parse, checking the snapshot is left alone on failure
+    HRESULT Parse (const std::vector<unsigned char>& data, const OSVersion& version = osVersion)
+    {
+        ThemeSnapshot snapshot = ThemeSnapshot ();
+        snapshot.systemCalls = 0xdead;
+        HRESULT hr = ParseWarmCache (data.data (), data.size (), version, snapshot);
+        if (FAILED (hr)) CHECK (snapshot.systemCalls == 0xdead);
+        return hr;
+    }
+} // anonymous namespace
+
+TEST_CASE (RoundTrip)
+{
+    std::vector<unsigned char> data;
+    SerializeWarmCache (MakeSnapshot (), data);
+    CHECK (data.size () == (wordPayload + packedThemeSnapshotWords + 1) * 4);
+    // Little-endian, regardless of the host
+    CHECK (data[0] == 'W' && data[1] == '1' && data[2] == '0' && data[3] == 'W');
+
+    ThemeSnapshot snapshot;
+    REQUIRE (ParseWarmCache (data.data (), data.size (), osVersion, snapshot) == S_OK);
+    CHECK (SameSnapshot (snapshot, MakeSnapshot ()));
+    CHECK (snapshot.dwmColors.ColorizationColorBalance == 89);
+    CHECK (snapshot.personalizeColorPrevalenceResult == E_FAIL);
+
+    // Serializing is deterministic
+    std::vector<unsigned char> again;
+    SerializeWarmCache (snapshot, again);
+    CHECK (again == data);
+}
+
+TEST_CASE (FlippedByte)
+{
+    std::vector<unsigned char> data;
+    SerializeWarmCache (MakeSnapshot (), data);
+    for (size_t i = 0; i < data.size (); i++)
+    {
+        for (unsigned char bit : { 0x01, 0x80 })
+        {
+            std::vector<unsigned char> corrupt (data);
+            corrupt[i] ^= bit;
+            CHECK (Parse (corrupt) == invalidData);
+        }
+    }
+}
+
+TEST_CASE (Truncated)
+{
+    std::vector<unsigned char> data;
+    SerializeWarmCache (MakeSnapshot (), data);
+    for (size_t size = 0; size < data.size (); size++)
+    {
+        std::vector<unsigned char> truncated (data.begin (), data.begin () + size);
+        CHECK (Parse (truncated) == invalidData);
+    }
+    // Trailing garbage
+    data.push_back (0);
+    CHECK (Parse (data) == invalidData);
+}
+
+TEST_CASE (WrongVersion)
+{
+    std::vector<unsigned char> data;
+    SerializeWarmCache (MakeSnapshot (), data);
+    for (uint32_t version : { 0u, warmCacheFormatVersion + 1 })
+    {
+        std::vector<unsigned char> other (data);
+        PutWord (other, wordVersion, version);
+        FixChecksum (other);
+        CHECK (Parse (other) == invalidData);
+    }
+    // Different payload size
+    std::vector<unsigned char> other (data);
+    PutWord (other, wordPayloadSize, packedThemeSnapshotWords - 1);
+    FixChecksum (other);
+    CHECK (Parse (other) == invalidData);
+    // Sanity check of FixChecksum(): an unmodified copy still parses
+    other = data;
+    FixChecksum (other);
+    CHECK (Parse (other) == S_OK);
+}
+
+TEST_CASE (DifferentOSVersion)
+{
+    std::vector<unsigned char> data;
+    SerializeWarmCache (MakeSnapshot (), data);
+    const OSVersion others[] = { { 6, 3, 9600 }, { 10, 1, 19045 }, { 10, 0, 19044 }, { 10, 0, 22000 } };
+    for (const auto& other : others)
+    {
+        CHECK (Parse (data, other) == invalidData);
+    }
+    CHECK (Parse (data, osVersion) == S_OK);
+}